@@ -1,6 +1,7 @@
 #include <Engine/Application.h>
 #include <Engine/Graphics.h>
 
+#include <Engine/Audio/AudioStreamDecoder.h>
 #include <Engine/Bytecode/GarbageCollector.h>
 #include <Engine/Bytecode/ScriptEntity.h>
 #include <Engine/Bytecode/ScriptManager.h>
@@ -8,14 +9,20 @@
 #include <Engine/Bytecode/VMThreadDebugger.h>
 #include <Engine/Data/DefaultFonts.h>
 #include <Engine/Diagnostics/Clock.h>
+#include <Engine/Diagnostics/FrameHistory.h>
 #include <Engine/Diagnostics/Log.h>
 #include <Engine/Diagnostics/Memory.h>
 #include <Engine/Diagnostics/MemoryPools.h>
 #include <Engine/Diagnostics/PerformanceViewer.h>
+#include <Engine/Diagnostics/Profiler.h>
 #include <Engine/Extensions/Discord.h>
 #include <Engine/Filesystem/Directory.h>
 #include <Engine/Filesystem/File.h>
 #include <Engine/Filesystem/VFS/MemoryCache.h>
+#include <Engine/Rendering/Software/TileRasterizer.h>
+#include <Engine/Rendering/SpriteAtlas.h>
+#include <Engine/ResourceTypes/AsyncLoader.h>
+#include <Engine/ResourceTypes/ISound.h>
 #include <Engine/ResourceTypes/ImageFormats/PNG.h>
 #include <Engine/ResourceTypes/ResourceManager.h>
 #include <Engine/Scene/SceneInfo.h>
@@ -164,6 +171,9 @@ double AutomaticPerformanceSnapshotFrameTimeThreshold;
 double AutomaticPerformanceSnapshotLastTime;
 double AutomaticPerformanceSnapshotMinInterval;
 
+double CmdLineSpikeBudget = -1.0;
+std::string FrameStatsFilename;
+
 int BenchmarkFrame = 0;
 float BenchmarkCounter = 0;
 
@@ -187,6 +197,8 @@ void Application::Init(int argc, char* args[]) {
 
 	Log::Init();
 
+	PROFILE_THREAD("Main");
+
 	MemoryPools::Init();
 
 	Application::InitPerformanceMetrics();
@@ -407,6 +419,54 @@ size_t Application::ProcessCommandLineOption(std::string arg, size_t i) {
 		SceneToLoad = scenePath;
 		return i + 1;
 	}
+	// Capture a profile of the given frames, as "count" or "start:count"
+	else if (arg == "--profile") {
+		std::string range = GetCmdLineOption(i + 1);
+		if (range.size() == 0) {
+			return i;
+		}
+
+		int start = 0, count = 0;
+		size_t colon = range.find(':');
+		if (colon != std::string::npos) {
+			StringUtils::ToNumber(&start, range.substr(0, colon));
+			StringUtils::ToNumber(&count, range.substr(colon + 1));
+		}
+		else {
+			StringUtils::ToNumber(&count, range);
+		}
+
+		std::string output = GetCmdLineOption("--profile-output");
+		if (output.size() == 0) {
+			output = "profile.json";
+		}
+
+		Profiler::StartCapture(start, count, output.c_str());
+		return i + 1;
+	}
+	else if (arg == "--profile-output") {
+		return i + 1;
+	}
+	// Write frame time percentiles to a file on exit
+	else if (arg == "--frame-stats") {
+		std::string path = GetCmdLineOption(i + 1);
+		if (path.size() == 0) {
+			return i;
+		}
+
+		FrameStatsFilename = path;
+		return i + 1;
+	}
+	// Dump the frames around any frame slower than this many milliseconds
+	else if (arg == "--spike-budget") {
+		std::string budget = GetCmdLineOption(i + 1);
+		if (budget.size() == 0) {
+			return i;
+		}
+
+		CmdLineSpikeBudget = atof(budget.c_str());
+		return i + 1;
+	}
 
 	return i;
 }
@@ -882,6 +942,23 @@ void Application::GetPerformanceSnapshot() {
 		Log::Print(Log::LOG_INFO, "%s:%s%s", measure->Name, padStr, timeString);
 	}
 	Log::Print(Log::LOG_INFO, "FPS: %27.3f", CurrentFPS);
+	SpriteAtlas::PrintReport();
+	Log::Print(Log::LOG_INFO,
+		"Audio callback: %.3f ms (worst %.3f ms)",
+		AudioManager::LastCallbackTime,
+		AudioManager::MaxCallbackTime);
+	Log::Print(Log::LOG_INFO,
+		"Resource finalization: %.3f ms (worst %.3f ms, %d pending)",
+		AsyncLoader::LastFrameTime,
+		AsyncLoader::MaxFrameTime,
+		AsyncLoader::GetPendingCount());
+	Log::Print(Log::LOG_INFO,
+		"Pre-converted sound data: %.1f KB",
+		ISound::TotalConvertedSize / 1024.0);
+	Log::Print(Log::LOG_INFO,
+		"Draw commands last frame: %u (%u draw call(s))",
+		Graphics::LastFrameDrawCommands,
+		Graphics::LastFrameDrawCalls);
 
 	// View Rendering Performance Snapshot
 	char layerText[2048];
@@ -1057,6 +1134,8 @@ void Application::EndGame() {
 
 	InputManager::ControllerStopRumble();
 
+	AsyncLoader::Reset();
+
 	Scene::Dispose();
 	SceneInfo::Dispose();
 	Graphics::UnloadData();
@@ -1241,6 +1320,17 @@ void Application::LoadVideoSettings() {
 			"graphics", "precompileShaders", &Graphics::PrecompileShaders);
 		Application::Settings->GetBool(
 			"graphics", "layerTileBuffering", &Graphics::LayerTileBufferingEnabled);
+		Application::Settings->GetBool(
+			"graphics", "drawBatching", &Graphics::DrawBatchingEnabled);
+		Application::Settings->GetBool("graphics", "spriteAtlas", &SpriteAtlas::Enabled);
+		Application::Settings->GetInteger(
+			"graphics", "spriteAtlasPageSize", &SpriteAtlas::PageSize);
+		Application::Settings->GetInteger(
+			"graphics", "softwareRasterThreads", &TileRasterizer::ThreadCount);
+
+		if (SpriteAtlas::PageSize < 64) {
+			SpriteAtlas::PageSize = 64;
+		}
 
 		if (Graphics::MultisamplingEnabled < 0) {
 			Graphics::MultisamplingEnabled = 0;
@@ -1295,6 +1385,13 @@ void Application::LoadAudioSettings() {
 	Application::SetMasterVolume(masterVolume);
 	Application::SetMusicVolume(musicVolume);
 	Application::SetSoundVolume(soundVolume);
+
+	settings->GetBool("audio", "streamDecoding", &AudioStreamDecoder::Enabled);
+	settings->GetInteger("audio", "streamLookahead", &AudioStreamDecoder::Lookahead);
+
+	if (AudioStreamDecoder::Lookahead < 1) {
+		AudioStreamDecoder::Lookahead = AUDIO_STREAM_DEFAULT_LOOKAHEAD;
+	}
 }
 
 #undef CLAMP_VOLUME
@@ -1378,6 +1475,7 @@ void Application::InitPerformanceMetrics() {
 
 	AddPerformanceMetric(&Metrics.Event, "Event Polling", 1.0, 0.0, 0.0);
 	AddPerformanceMetric(&Metrics.AfterScene, "Post-Scene", 0.0, 1.0, 0.0);
+	AddPerformanceMetric(&Metrics.ResourceLoading, "Resource Loading", 0.5, 1.0, 0.5);
 	AddPerformanceMetric(&Metrics.Poll, "Input Polling", 0.0, 0.0, 1.0);
 	AddPerformanceMetric(&Metrics.Update, "Entity Update", 1.0, 1.0, 0.0);
 	AddPerformanceMetric(&Metrics.Clear, "Clear Time", 0.0, 1.0, 1.0);
@@ -1391,6 +1489,22 @@ void Application::InitPerformanceMetrics() {
 	AddPerformanceMetric(&Metrics.Present, "Frame Present Time", 0.75, 0.75, 0.75);
 }
 
+void Application::LoadPerformanceSettings() {
+	INI* settings = Application::Settings;
+
+	int historyLength = FRAME_HISTORY_DEFAULT_LENGTH;
+	settings->GetInteger("performance", "frameHistory", &historyLength);
+	settings->GetDecimal("performance", "spikeBudget", &FrameHistory::SpikeBudget);
+	settings->GetInteger("performance", "spikeFrames", &FrameHistory::SpikeFrames);
+	settings->GetDecimal("performance", "spikeCooldown", &FrameHistory::SpikeCooldown);
+
+	if (CmdLineSpikeBudget >= 0.0) {
+		FrameHistory::SpikeBudget = CmdLineSpikeBudget;
+	}
+
+	FrameHistory::Init(historyLength > 0 ? (size_t)historyLength : 1);
+}
+
 void Application::LoadDevSettings() {
 #ifdef DEVELOPER_MODE
 	Application::Settings->GetBool("dev", "devMenu", &Application::DevMode);
@@ -1753,10 +1867,14 @@ void Application::MainLoopCallback(void* p) {
 	MainLoop();
 }
 void Application::RunFrame(int runFrames) {
+	Profiler::BeginFrame();
+
 	Metrics.Frame.Begin();
 
 	FrameTimeStart = Clock::GetTicks();
 
+	Memory::EndFrame();
+
 	Metrics.Clear.Begin();
 	Graphics::Clear();
 	Metrics.Clear.End();
@@ -1779,6 +1897,11 @@ void Application::RunFrame(int runFrames) {
 	Scene::AfterScene();
 	Metrics.AfterScene.End();
 
+	// Finish resources that were loaded in the background
+	Metrics.ResourceLoading.Begin();
+	AsyncLoader::Update();
+	Metrics.ResourceLoading.End();
+
 	if (DoNothing) {
 		goto DO_NOTHING;
 	}
@@ -1878,6 +2001,8 @@ DO_NOTHING:
 	Metrics.Present.End();
 
 	Metrics.Frame.End();
+
+	Profiler::EndFrame();
 }
 
 void Application::TakeScreenshot(const char* path, Operation operation) {
@@ -2121,6 +2246,8 @@ void Application::MainLoop() {
 		Application::DelayFrame();
 	}
 
+	FrameHistory::Record();
+
 	// Do benchmarking stuff
 	BenchmarkFrame++;
 	BenchmarkCounter += DeltaTime;
@@ -2162,6 +2289,14 @@ void Application::MainLoop() {
 }
 
 void Application::Cleanup() {
+	Profiler::Dispose();
+
+	FrameHistory::LogSummary();
+	if (FrameStatsFilename.size()) {
+		FrameHistory::WriteSummary(FrameStatsFilename.c_str());
+	}
+	FrameHistory::Dispose();
+
 	Application::TerminateScripting();
 
 	Application::UnloadDefaultFont();
@@ -2169,6 +2304,8 @@ void Application::Cleanup() {
 
 	Application::DisposeSettings();
 
+	AsyncLoader::Dispose();
+
 	MemoryCache::Dispose();
 	ResourceManager::Dispose();
 	AudioManager::Dispose();
@@ -2748,6 +2885,7 @@ bool Application::LoadSettings(const char* filename) {
 void Application::ReadSettings() {
 	Application::LoadVideoSettings();
 	Application::LoadAudioSettings();
+	Application::LoadPerformanceSettings();
 	Application::LoadDevSettings();
 	Application::LoadKeyBinds();
 }
@@ -6,6 +6,13 @@ class ISound;
 #include <Engine/Audio/AudioIncludes.h>
 #include <Engine/Audio/AudioPlayback.h>
 
+#include <atomic>
+
+#define AUDIO_CHANNEL_STOPPED (1 << 0)
+#define AUDIO_CHANNEL_PAUSED (1 << 1)
+#define AUDIO_CHANNEL_FLAG_BITS 2
+#define AUDIO_CHANNEL_GENERATION_MASK (0xFFFFFFFF >> AUDIO_CHANNEL_FLAG_BITS)
+
 struct AudioChannel {
 	ISound* Audio = nullptr;
 	AudioPlayback* Playback = nullptr;
@@ -20,6 +27,7 @@ struct AudioChannel {
 	float Pan = 0.0f;
 	float Volume = 0.0f;
 	void* Origin = nullptr;
+	Uint32 Generation = 0;
 
 	~AudioChannel() {
 		delete Playback;
@@ -27,4 +35,13 @@ struct AudioChannel {
 	}
 };
 
+// A sound channel as seen outside of the audio thread. Flags holds the
+// channel's generation, shifted by AUDIO_CHANNEL_FLAG_BITS, along with the
+// AUDIO_CHANNEL_STOPPED and AUDIO_CHANNEL_PAUSED flags.
+struct AudioChannelState {
+	std::atomic<Uint32> Flags;
+	std::atomic<ISound*> Audio;
+	std::atomic<void*> Origin;
+};
+
 #endif /* ENGINE_AUDIO_AUDIOCHANNEL_H */
@@ -0,0 +1,73 @@
+#include <Engine/Audio/AudioCommandQueue.h>
+
+// Every cell carries a sequence number that tells producers and the consumer
+// whose turn it is: a producer may fill a cell whose sequence equals the
+// position it claimed, and the consumer may read it once the sequence is one
+// past that position.
+
+AudioCommandQueue::AudioCommandQueue(size_t capacity) {
+	// Round up to a power of two so positions can be masked.
+	Capacity = 2;
+	while (Capacity < capacity) {
+		Capacity <<= 1;
+	}
+
+	Mask = Capacity - 1;
+	Cells = new Cell[Capacity];
+	for (size_t i = 0; i < Capacity; i++) {
+		Cells[i].Sequence.store(i, std::memory_order_relaxed);
+	}
+
+	EnqueuePos.store(0, std::memory_order_relaxed);
+	DequeuePos.store(0, std::memory_order_relaxed);
+}
+AudioCommandQueue::~AudioCommandQueue() {
+	delete[] Cells;
+}
+
+size_t AudioCommandQueue::GetCapacity() {
+	return Capacity;
+}
+
+bool AudioCommandQueue::Push(const AudioCommand& command) {
+	Cell* cell;
+	size_t pos = EnqueuePos.load(std::memory_order_relaxed);
+	for (;;) {
+		cell = &Cells[pos & Mask];
+		size_t sequence = cell->Sequence.load(std::memory_order_acquire);
+		intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+		if (diff == 0) {
+			if (EnqueuePos.compare_exchange_weak(
+				    pos, pos + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		}
+		else if (diff < 0) {
+			// Full.
+			return false;
+		}
+		else {
+			pos = EnqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	cell->Command = command;
+	cell->Sequence.store(pos + 1, std::memory_order_release);
+	return true;
+}
+bool AudioCommandQueue::Pop(AudioCommand& command) {
+	size_t pos = DequeuePos.load(std::memory_order_relaxed);
+	Cell* cell = &Cells[pos & Mask];
+	size_t sequence = cell->Sequence.load(std::memory_order_acquire);
+
+	// Either empty, or the producer that claimed this cell hasn't finished
+	// writing it yet. Later commands wait so that order is kept.
+	if (sequence != pos + 1) {
+		return false;
+	}
+
+	command = cell->Command;
+	cell->Sequence.store(pos + Capacity, std::memory_order_release);
+	DequeuePos.store(pos + 1, std::memory_order_relaxed);
+	return true;
+}
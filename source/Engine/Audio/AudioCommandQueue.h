@@ -0,0 +1,72 @@
+#ifndef ENGINE_AUDIO_AUDIOCOMMANDQUEUE_H
+#define ENGINE_AUDIO_AUDIOCOMMANDQUEUE_H
+
+class ISound;
+class AudioPlayback;
+
+#include <Engine/Includes/Standard.h>
+
+#include <atomic>
+
+#define AUDIO_COMMAND_QUEUE_DEFAULT_SIZE 4096
+
+enum {
+	AudioCommand_PlaySound,
+	AudioCommand_AlterChannel,
+	AudioCommand_StopChannel,
+	AudioCommand_PauseChannel,
+	AudioCommand_UnpauseChannel,
+	AudioCommand_StopSound,
+	AudioCommand_PauseSound,
+	AudioCommand_UnpauseSound,
+	AudioCommand_StopOriginSound,
+	AudioCommand_StopAllOriginSounds,
+	AudioCommand_StopAll,
+	AudioCommand_PauseAll,
+	AudioCommand_UnpauseAll,
+	AudioCommand_FadeOutMusic,
+	AudioCommand_AlterMusic,
+	AudioCommand_PauseMusic,
+	AudioCommand_ResumeMusic
+};
+
+struct AudioCommand {
+	Uint8 Type;
+	int Channel;
+	Uint32 Generation;
+	ISound* Sound;
+	void* Origin;
+	bool Loop;
+	int LoopPoint;
+	float Pan;
+	float Speed;
+	float Volume;
+	double Seconds;
+	AudioPlayback* Playback;
+};
+
+// Bounded multi-producer, single-consumer queue. Any number of threads may
+// call Push concurrently without locking; Pop must only ever be called by
+// one thread at a time.
+class AudioCommandQueue {
+private:
+	struct Cell {
+		std::atomic<size_t> Sequence;
+		AudioCommand Command;
+	};
+
+	Cell* Cells;
+	size_t Capacity;
+	size_t Mask;
+	std::atomic<size_t> EnqueuePos;
+	std::atomic<size_t> DequeuePos;
+
+public:
+	AudioCommandQueue(size_t capacity);
+	~AudioCommandQueue();
+	size_t GetCapacity();
+	bool Push(const AudioCommand& command);
+	bool Pop(AudioCommand& command);
+};
+
+#endif /* ENGINE_AUDIO_AUDIOCOMMANDQUEUE_H */
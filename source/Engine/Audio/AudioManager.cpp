@@ -1,17 +1,23 @@
 #include <Engine/Audio/AudioManager.h>
+#include <Engine/Audio/AudioMixer.h>
 #include <Engine/Audio/AudioPlayback.h>
+#include <Engine/Audio/AudioStreamDecoder.h>
+#include <Engine/Diagnostics/Clock.h>
 #include <Engine/Diagnostics/Log.h>
 #include <Engine/Diagnostics/Memory.h>
+#include <Engine/Diagnostics/Profiler.h>
 #include <Engine/ResourceTypes/SoundFormats/SoundFormat.h>
 
+#include <mutex>
+
 SDL_AudioDeviceID AudioManager::Device;
 SDL_AudioSpec AudioManager::DeviceFormat;
 bool AudioManager::AudioEnabled = false;
 bool AudioManager::Interrupted = false;
 
 Uint8 AudioManager::BytesPerSample;
-Uint8* AudioManager::MixBuffer;
-size_t AudioManager::MixBufferSize;
+float* AudioManager::MixBus = NULL;
+size_t AudioManager::MixBusLength = 0;
 
 deque<AudioChannel*> AudioManager::MusicStack;
 AudioChannel* AudioManager::SoundArray = NULL;
@@ -27,6 +33,17 @@ Uint8* AudioManager::AudioQueue = NULL;
 size_t AudioManager::AudioQueueSize = 0;
 size_t AudioManager::AudioQueueMaxSize = 0;
 
+double AudioManager::LastCallbackTime = 0.0;
+double AudioManager::MaxCallbackTime = 0.0;
+
+AudioCommandQueue* AudioManager::Commands = nullptr;
+AudioCommandQueue* AudioManager::RetiredPlaybacks = nullptr;
+AudioChannelState* AudioManager::ChannelStates = nullptr;
+std::atomic_flag AudioManager::ProcessingCommands = ATOMIC_FLAG_INIT;
+
+// Any thread may post a sound, so taking a retired playback is serialized.
+static std::mutex RetiredPlaybacksLock;
+
 enum {
 	FILTER_TYPE_LOW_PASS,
 	FILTER_TYPE_HIGH_PASS,
@@ -123,6 +140,15 @@ void AudioManager::Init() {
 		SoundArray[i].Paused = true;
 	}
 
+	Commands = new AudioCommandQueue(AUDIO_COMMAND_QUEUE_DEFAULT_SIZE);
+	RetiredPlaybacks = new AudioCommandQueue(AUDIO_COMMAND_QUEUE_DEFAULT_SIZE);
+	ChannelStates = new AudioChannelState[SoundArrayLength];
+	for (int i = 0; i < SoundArrayLength; i++) {
+		ChannelStates[i].Flags.store(AUDIO_CHANNEL_STOPPED | AUDIO_CHANNEL_PAUSED);
+		ChannelStates[i].Audio.store(nullptr);
+		ChannelStates[i].Origin.store(nullptr);
+	}
+
 	SDL_AudioSpec Want;
 	memset(&Want, 0, sizeof(Want));
 
@@ -144,7 +170,6 @@ void AudioManager::Init() {
 	if (Application::Platform != Platforms::Android) {
 		if (SDL_OpenAudio(&Want, &DeviceFormat) >= 0) {
 			AudioEnabled = true;
-			SDL_PauseAudio(0);
 			Device = 1;
 		}
 		else {
@@ -155,7 +180,6 @@ void AudioManager::Init() {
 		if ((Device = SDL_OpenAudioDevice(
 			     NULL, 0, &Want, &DeviceFormat, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE))) {
 			AudioEnabled = true;
-			SDL_PauseAudioDevice(Device, 0);
 		}
 		else {
 			Log::Print(Log::LOG_ERROR, "Could not open audio device!");
@@ -177,10 +201,16 @@ void AudioManager::Init() {
 
 	BytesPerSample = ((DeviceFormat.format & 0xFF) >> 3) * DeviceFormat.channels;
 
-	if (DeviceFormat.channels == 2) {
-		MixBufferSize = DeviceFormat.samples;
-		MixBuffer = (Uint8*)Memory::Malloc(MixBufferSize * BytesPerSample);
+	// SDL asks for the device's whole buffer on every callback, so the bus is
+	// sized for that here and never grows on the audio thread.
+	MixBusLength = DeviceFormat.samples * DeviceFormat.channels;
+	if (BytesPerSample > 0) {
+		MixBusLength = std::max(MixBusLength,
+			(size_t)(DeviceFormat.size / BytesPerSample) * DeviceFormat.channels);
 	}
+	MixBus = (float*)Memory::TrackedCalloc("AudioManager::MixBus", MixBusLength, sizeof(float));
+
+	Log::Print(Log::LOG_VERBOSE, "Mixing with the %s backend", AudioMixer::GetBackendName());
 
 	// AudioQueueMaxSize = DeviceFormat.samples *
 	// DeviceFormat.channels *
@@ -188,6 +218,13 @@ void AudioManager::Init() {
 	AudioQueueMaxSize = 0x1000;
 	AudioQueueSize = 0;
 	AudioQueue = (Uint8*)Memory::Calloc(8, AudioQueueMaxSize);
+
+	// The callback only starts once everything it mixes into exists.
+	if (AudioEnabled) {
+		SDL_PauseAudioDevice(Device, 0);
+	}
+
+	AudioStreamDecoder::Init();
 }
 
 void AudioManager::ClampParams(float& pan, float& speed, float& volume) {
@@ -226,6 +263,7 @@ void AudioManager::UpdateChannelPlayer(AudioPlayback* playback, ISound* sound) {
 	}
 
 	playback->SoundData->SampleIndex = 0;
+	playback->SampleScale = sound->SampleScale;
 }
 
 void AudioManager::SetSound(int channel, ISound* music) {
@@ -239,23 +277,75 @@ void AudioManager::SetSound(int channel,
 	float speed,
 	float volume,
 	void* origin) {
-	AudioManager::Lock();
-
-	AudioChannel* audio = &SoundArray[channel];
-	AudioPlayback* playback = audio->Playback;
+	Uint32 generation;
+	AudioManager::ClaimChannel(channel, false, generation);
+	AudioManager::PostPlaySound(
+		channel, generation, sound, loop, loopPoint, pan, speed, volume, origin);
+}
+int AudioManager::PlaySound(ISound* music) {
+	return AudioManager::PlaySound(music, false, 0, 0.0f, 1.0f, 1.0f, nullptr);
+}
+int AudioManager::PlaySound(ISound* music,
+	bool loop,
+	int loopPoint,
+	float pan,
+	float speed,
+	float volume,
+	void* origin) {
+	for (int i = 0; i < SoundArrayLength; i++) {
+		Uint32 generation;
+		if (AudioManager::ClaimChannel(i, true, generation)) {
+			AudioManager::PostPlaySound(
+				i, generation, music, loop, loopPoint, pan, speed, volume, origin);
+			return i;
+		}
+	}
 
+	return -1;
+}
+void AudioManager::PostPlaySound(int channel,
+	Uint32 generation,
+	ISound* sound,
+	bool loop,
+	int loopPoint,
+	float pan,
+	float speed,
+	float volume,
+	void* origin) {
 	AudioManager::ClampParams(pan, speed, volume);
 
-	audio->Audio = sound;
-	audio->Stopped = false;
-	audio->Paused = false;
-	audio->Origin = origin;
-	audio->Loop = loop;
-	audio->LoopPoint = loopPoint;
-	audio->Fading = MusicFade_None;
-	audio->Pan = pan;
-	audio->Speed = (Uint32)(speed * 0x10000);
-	audio->Volume = volume;
+	ChannelStates[channel].Audio.store(sound);
+	ChannelStates[channel].Origin.store(origin);
+
+	AudioCommand command = {};
+	command.Type = AudioCommand_PlaySound;
+	command.Channel = channel;
+	command.Generation = generation;
+	command.Sound = sound;
+	command.Origin = origin;
+	command.Loop = loop;
+	command.LoopPoint = loopPoint;
+	command.Pan = pan;
+	command.Speed = speed;
+	command.Volume = volume;
+	command.Playback = AudioManager::PreparePlayback(sound);
+	AudioManager::PostCommand(command);
+}
+
+// Sets up the playback of a sound that's about to start on a channel. This
+// allocates, so it's done by whoever posts the command; the audio callback
+// only swaps the playback in. Sounds are fully loaded when they're loaded as
+// resources, so any number of threads can prepare playbacks of the same one.
+// Playbacks that the callback swapped out are reused.
+AudioPlayback* AudioManager::PreparePlayback(ISound* sound) {
+	AudioPlayback* playback = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(RetiredPlaybacksLock);
+		AudioCommand retired;
+		if (RetiredPlaybacks->Pop(retired)) {
+			playback = retired.Playback;
+		}
+	}
 
 	int requiredSamples = AudioManager::DeviceFormat.samples * AUDIO_FIRST_LOAD_SAMPLE_BOOST;
 	if (playback == nullptr) {
@@ -263,7 +353,6 @@ void AudioManager::SetSound(int channel,
 			requiredSamples,
 			sound->BytesPerSample,
 			AudioManager::BytesPerSample);
-		audio->Playback = playback;
 	}
 	else {
 		playback->Change(sound->Format,
@@ -275,32 +364,42 @@ void AudioManager::SetSound(int channel,
 	AudioManager::UpdateChannelPlayer(playback, sound);
 
 	playback->Seek(0);
-	if (playback->ConversionStream) {
-		SDL_AudioStreamClear(playback->ConversionStream);
-	}
 
-	AudioManager::Unlock();
+	return playback;
 }
-int AudioManager::PlaySound(ISound* music) {
-	return AudioManager::PlaySound(music, false, 0, 0.0f, 1.0f, 1.0f, nullptr);
-}
-int AudioManager::PlaySound(ISound* music,
-	bool loop,
-	int loopPoint,
-	float pan,
-	float speed,
-	float volume,
-	void* origin) {
-	for (int i = 0; i < SoundArrayLength; i++) {
-		AudioChannel* audio = &SoundArray[i];
-		if (!audio->Audio || audio->Stopped) {
-			AudioManager::SetSound(
-				i, music, loop, loopPoint, pan, speed, volume, origin);
-			return i;
-		}
+// Hands a playback the audio callback no longer uses back to the posting
+// side. This never blocks or frees memory, unless nothing has taken a
+// retired playback in so long that the queue is full.
+void AudioManager::RetirePlayback(AudioPlayback* playback) {
+	if (!playback) {
+		return;
 	}
 
-	return -1;
+	AudioCommand command = {};
+	command.Playback = playback;
+	if (!RetiredPlaybacks->Push(command)) {
+		delete playback;
+	}
+}
+void AudioManager::StartChannel(AudioCommand& command) {
+	AudioChannel* audio = &SoundArray[command.Channel];
+	AudioPlayback* previous = audio->Playback;
+	ISound* sound = command.Sound;
+
+	audio->Audio = sound;
+	audio->Generation = command.Generation;
+	audio->Stopped = false;
+	audio->Paused = false;
+	audio->Origin = command.Origin;
+	audio->Loop = command.Loop;
+	audio->LoopPoint = command.LoopPoint;
+	audio->Fading = MusicFade_None;
+	audio->Pan = command.Pan;
+	audio->Speed = (Uint32)(command.Speed * 0x10000);
+	audio->Volume = command.Volume;
+	audio->Playback = command.Playback;
+
+	AudioManager::RetirePlayback(previous);
 }
 
 void AudioManager::PushMusic(ISound* music,
@@ -347,17 +446,14 @@ void AudioManager::PushMusicAt(ISound* music,
 	newms->FadeTimer = 1.0;
 	newms->FadeTimerMax = 1.0;
 
-	int start_sample = (int)std::ceil(at * music->Format.freq);
-
-	newms->Playback->Seek(start_sample);
-	if (newms->Playback->ConversionStream) {
-		SDL_AudioStreamClear(newms->Playback->ConversionStream);
-	}
-
 	if (loop) {
 		newms->Playback->LoopIndex = (Sint32)lp;
 	}
 
+	int start_sample = (int)std::ceil(at * music->Format.freq);
+
+	newms->Playback->Seek(start_sample);
+
 	MusicStack.push_front(newms);
 
 	AudioManager::Unlock();
@@ -400,27 +496,35 @@ void AudioManager::ClearSounds() {
 			delete SoundArray[i].Playback;
 			SoundArray[i].Playback = NULL;
 		}
+		AudioManager::ModifyChannelState(i, AUDIO_CHANNEL_STOPPED, 0);
 	}
 	AudioManager::Unlock();
 }
 void AudioManager::FadeOutMusic(double seconds) {
-	AudioManager::Lock();
-	if (MusicStack.size() > 0) {
-		MusicStack[0]->Fading = MusicFade_Out;
-		MusicStack[0]->FadeTimer = seconds;
-		MusicStack[0]->FadeTimerMax = seconds;
-	}
-	AudioManager::Unlock();
+	AudioCommand command = {};
+	command.Type = AudioCommand_FadeOutMusic;
+	command.Seconds = seconds;
+	AudioManager::PostCommand(command);
 }
 void AudioManager::AlterMusic(float pan, float speed, float volume) {
-	AudioManager::Lock();
-	if (MusicStack.size() > 0) {
-		AudioManager::ClampParams(pan, speed, volume);
-		MusicStack[0]->Pan = pan;
-		MusicStack[0]->Speed = (Uint32)(speed * 0x10000);
-		MusicStack[0]->Volume = volume;
-	}
-	AudioManager::Unlock();
+	AudioManager::ClampParams(pan, speed, volume);
+
+	AudioCommand command = {};
+	command.Type = AudioCommand_AlterMusic;
+	command.Pan = pan;
+	command.Speed = speed;
+	command.Volume = volume;
+	AudioManager::PostCommand(command);
+}
+void AudioManager::PauseMusic() {
+	AudioCommand command = {};
+	command.Type = AudioCommand_PauseMusic;
+	AudioManager::PostCommand(command);
+}
+void AudioManager::ResumeMusic() {
+	AudioCommand command = {};
+	command.Type = AudioCommand_ResumeMusic;
+	AudioManager::PostCommand(command);
 }
 double AudioManager::GetMusicDuration(ISound* music) {
 	AudioManager::Lock();
@@ -439,7 +543,7 @@ double AudioManager::GetMusicPosition(ISound* music) {
 	double position = 0.0;
 	for (size_t i = 0; i < MusicStack.size(); i++) {
 		if (MusicStack[i]->Audio == music) {
-			position = MusicStack[i]->Playback->SoundData->GetPosition();
+			position = MusicStack[i]->Playback->GetPosition();
 			break;
 		}
 	}
@@ -447,95 +551,262 @@ double AudioManager::GetMusicPosition(ISound* music) {
 	return position;
 }
 
+// Taking the lock also applies every queued command, so that whatever the
+// caller does next sees them.
 void AudioManager::Lock() {
 	SDL_LockAudioDevice(Device);
+	AudioManager::ProcessCommands();
 }
 void AudioManager::Unlock() {
 	SDL_UnlockAudioDevice(Device);
 }
 
-int AudioManager::GetFreeChannel() {
-	AudioManager::Lock();
-	int channel = -1;
+// Script-side audio operations are posted as commands and applied by the
+// audio callback before it mixes, so neither side waits on the other. If the
+// queue is ever full, the command is applied under the device lock instead.
+void AudioManager::PostCommand(AudioCommand& command) {
+	if (!Commands->Push(command)) {
+		AudioManager::Lock();
+		AudioManager::ApplyCommand(command);
+		AudioManager::Unlock();
+	}
+}
+void AudioManager::ProcessCommands() {
+	// Only one thread may consume the queue at a time. The device lock
+	// already guarantees that, except when no device could be opened.
+	if (!Commands || ProcessingCommands.test_and_set(std::memory_order_acquire)) {
+		return;
+	}
+
+	AudioCommand command;
+	while (Commands->Pop(command)) {
+		AudioManager::ApplyCommand(command);
+	}
+
+	ProcessingCommands.clear(std::memory_order_release);
+}
+void AudioManager::ApplyCommand(AudioCommand& command) {
+	AudioChannel* audio = nullptr;
+	if (command.Channel >= 0 && command.Channel < SoundArrayLength) {
+		audio = &SoundArray[command.Channel];
+		if (command.Type != AudioCommand_PlaySound &&
+			audio->Generation != command.Generation) {
+			audio = nullptr;
+		}
+	}
+
+	AudioChannel* music = MusicStack.size() > 0 ? MusicStack[0] : nullptr;
+
+	switch (command.Type) {
+	case AudioCommand_PlaySound:
+		if (audio) {
+			AudioManager::StartChannel(command);
+		}
+		else {
+			AudioManager::RetirePlayback(command.Playback);
+		}
+		break;
+	case AudioCommand_AlterChannel:
+		if (audio && !audio->Stopped && !audio->Paused) {
+			audio->Pan = command.Pan;
+			audio->Speed = (Uint32)(command.Speed * 0x10000);
+			audio->Volume = command.Volume;
+		}
+		break;
+	case AudioCommand_StopChannel:
+		if (audio) {
+			audio->Stopped = true;
+		}
+		break;
+	case AudioCommand_PauseChannel:
+	case AudioCommand_UnpauseChannel:
+		if (audio) {
+			audio->Paused = command.Type == AudioCommand_PauseChannel;
+		}
+		break;
+	case AudioCommand_StopSound:
+	case AudioCommand_PauseSound:
+	case AudioCommand_UnpauseSound:
+	case AudioCommand_StopOriginSound:
+	case AudioCommand_StopAllOriginSounds:
+	case AudioCommand_StopAll:
+	case AudioCommand_PauseAll:
+	case AudioCommand_UnpauseAll:
+		for (int i = 0; i < SoundArrayLength; i++) {
+			AudioChannel* channel = &SoundArray[i];
+			if (!AudioManager::CommandMatches(command, channel->Audio, channel->Origin)) {
+				continue;
+			}
+
+			if (command.Type == AudioCommand_PauseSound ||
+				command.Type == AudioCommand_PauseAll) {
+				channel->Paused = true;
+			}
+			else if (command.Type == AudioCommand_UnpauseSound ||
+				command.Type == AudioCommand_UnpauseAll) {
+				channel->Paused = false;
+			}
+			else {
+				channel->Stopped = true;
+			}
+		}
+		break;
+	case AudioCommand_FadeOutMusic:
+		if (music) {
+			music->Fading = MusicFade_Out;
+			music->FadeTimer = command.Seconds;
+			music->FadeTimerMax = command.Seconds;
+		}
+		break;
+	case AudioCommand_AlterMusic:
+		if (music) {
+			music->Pan = command.Pan;
+			music->Speed = (Uint32)(command.Speed * 0x10000);
+			music->Volume = command.Volume;
+		}
+		break;
+	case AudioCommand_PauseMusic:
+	case AudioCommand_ResumeMusic:
+		if (music) {
+			music->Paused = command.Type == AudioCommand_PauseMusic;
+		}
+		break;
+	}
+}
+bool AudioManager::CommandMatches(AudioCommand& command, ISound* sound, void* origin) {
+	switch (command.Type) {
+	case AudioCommand_StopSound:
+	case AudioCommand_PauseSound:
+	case AudioCommand_UnpauseSound:
+		return sound == command.Sound;
+	case AudioCommand_StopOriginSound:
+		return sound == command.Sound && origin == command.Origin;
+	case AudioCommand_StopAllOriginSounds:
+		return origin == command.Origin;
+	default:
+		return true;
+	}
+}
+void AudioManager::PostChannelCommand(int channel, Uint8 type, Uint32 setFlags, Uint32 clearFlags) {
+	AudioCommand command = {};
+	command.Type = type;
+	command.Channel = channel;
+	command.Generation = AudioManager::ModifyChannelState(channel, setFlags, clearFlags);
+	AudioManager::PostCommand(command);
+}
+void AudioManager::PostMatchingCommand(AudioCommand& command, Uint32 setFlags, Uint32 clearFlags) {
+	command.Channel = -1;
+
 	for (int i = 0; i < SoundArrayLength; i++) {
-		if (SoundArray[i].Stopped) {
-			channel = i;
+		ISound* sound = ChannelStates[i].Audio.load();
+		void* origin = ChannelStates[i].Origin.load();
+		if (AudioManager::CommandMatches(command, sound, origin)) {
+			AudioManager::ModifyChannelState(i, setFlags, clearFlags);
+		}
+	}
+
+	AudioManager::PostCommand(command);
+}
+
+// Channel states are what the rest of the engine sees of each sound
+// channel. They are updated immediately by whoever posts a command, and by
+// the audio callback when a sound ends, so they never need the device lock.
+// Every new sound on a channel bumps its generation, which keeps commands
+// and callback updates meant for a previous sound from affecting it.
+bool AudioManager::ClaimChannel(int channel, bool onlyIfStopped, Uint32& generation) {
+	std::atomic<Uint32>& flags = ChannelStates[channel].Flags;
+	Uint32 state = flags.load();
+	do {
+		if (onlyIfStopped && !(state & AUDIO_CHANNEL_STOPPED)) {
+			return false;
+		}
+
+		generation = ((state >> AUDIO_CHANNEL_FLAG_BITS) + 1) & AUDIO_CHANNEL_GENERATION_MASK;
+	} while (!flags.compare_exchange_weak(state, generation << AUDIO_CHANNEL_FLAG_BITS));
+
+	return true;
+}
+Uint32 AudioManager::ModifyChannelState(int channel, Uint32 setFlags, Uint32 clearFlags) {
+	std::atomic<Uint32>& flags = ChannelStates[channel].Flags;
+	Uint32 state = flags.load();
+	while (!flags.compare_exchange_weak(state, (state | setFlags) & ~clearFlags)) {
+	}
+
+	return state >> AUDIO_CHANNEL_FLAG_BITS;
+}
+void AudioManager::PublishChannelStopped(int channel, Uint32 generation) {
+	std::atomic<Uint32>& flags = ChannelStates[channel].Flags;
+	Uint32 state = flags.load();
+	while ((state >> AUDIO_CHANNEL_FLAG_BITS) == generation &&
+		!(state & AUDIO_CHANNEL_STOPPED)) {
+		if (flags.compare_exchange_weak(state, state | AUDIO_CHANNEL_STOPPED)) {
 			break;
 		}
 	}
-	AudioManager::Unlock();
-	return channel;
 }
-void AudioManager::AlterChannel(int channel, float pan, float speed, float volume) {
-	AudioManager::Lock();
-	if (!SoundArray[channel].Stopped && !SoundArray[channel].Paused) {
-		AudioManager::ClampParams(pan, speed, volume);
-		SoundArray[channel].Pan = pan;
-		SoundArray[channel].Speed = (Uint32)(speed * 0x10000);
-		SoundArray[channel].Volume = volume;
+bool AudioManager::IsChannelPlaying(int channel) {
+	Uint32 state = ChannelStates[channel].Flags.load();
+	return !(state & (AUDIO_CHANNEL_STOPPED | AUDIO_CHANNEL_PAUSED));
+}
+
+int AudioManager::GetFreeChannel() {
+	for (int i = 0; i < SoundArrayLength; i++) {
+		if (ChannelStates[i].Flags.load() & AUDIO_CHANNEL_STOPPED) {
+			return i;
+		}
 	}
-	AudioManager::Unlock();
+	return -1;
+}
+void AudioManager::AlterChannel(int channel, float pan, float speed, float volume) {
+	AudioManager::ClampParams(pan, speed, volume);
+
+	AudioCommand command = {};
+	command.Type = AudioCommand_AlterChannel;
+	command.Channel = channel;
+	command.Generation = ChannelStates[channel].Flags.load() >> AUDIO_CHANNEL_FLAG_BITS;
+	command.Pan = pan;
+	command.Speed = speed;
+	command.Volume = volume;
+	AudioManager::PostCommand(command);
 }
 bool AudioManager::AudioIsPlaying(int channel) {
-	bool isPlaying = false;
-	AudioManager::Lock();
-	isPlaying = !SoundArray[channel].Stopped && !SoundArray[channel].Paused;
-	AudioManager::Unlock();
-	return isPlaying;
+	return AudioManager::IsChannelPlaying(channel);
 }
 bool AudioManager::AudioIsPlaying(ISound* audio) {
-	bool isPlaying = false;
-	AudioManager::Lock();
 	for (int i = 0; i < SoundArrayLength; i++) {
-		AudioChannel* channel = &SoundArray[i];
-		if (!channel->Stopped && !channel->Paused && channel->Audio == audio) {
-			isPlaying = true;
+		if (ChannelStates[i].Audio.load() == audio && AudioManager::IsChannelPlaying(i)) {
+			return true;
 		}
 	}
-	AudioManager::Unlock();
-	return isPlaying;
+	return false;
 }
 void AudioManager::AudioUnpause(int channel) {
-	AudioManager::Lock();
-	SoundArray[channel].Paused = false;
-	AudioManager::Unlock();
+	AudioManager::PostChannelCommand(
+		channel, AudioCommand_UnpauseChannel, 0, AUDIO_CHANNEL_PAUSED);
 }
 void AudioManager::AudioUnpause(ISound* audio) {
-	AudioManager::Lock();
-	for (int i = 0; i < SoundArrayLength; i++) {
-		if (SoundArray[i].Audio == audio) {
-			SoundArray[i].Paused = false;
-		}
-	}
-	AudioManager::Unlock();
+	AudioCommand command = {};
+	command.Type = AudioCommand_UnpauseSound;
+	command.Sound = audio;
+	AudioManager::PostMatchingCommand(command, 0, AUDIO_CHANNEL_PAUSED);
 }
 void AudioManager::AudioPause(int channel) {
-	AudioManager::Lock();
-	SoundArray[channel].Paused = true;
-	AudioManager::Unlock();
+	AudioManager::PostChannelCommand(channel, AudioCommand_PauseChannel, AUDIO_CHANNEL_PAUSED, 0);
 }
 void AudioManager::AudioPause(ISound* audio) {
-	AudioManager::Lock();
-	for (int i = 0; i < SoundArrayLength; i++) {
-		if (SoundArray[i].Audio == audio) {
-			SoundArray[i].Paused = true;
-		}
-	}
-	AudioManager::Unlock();
+	AudioCommand command = {};
+	command.Type = AudioCommand_PauseSound;
+	command.Sound = audio;
+	AudioManager::PostMatchingCommand(command, AUDIO_CHANNEL_PAUSED, 0);
 }
 void AudioManager::AudioStop(int channel) {
-	AudioManager::Lock();
-	SoundArray[channel].Stopped = true;
-	AudioManager::Unlock();
+	AudioManager::PostChannelCommand(channel, AudioCommand_StopChannel, AUDIO_CHANNEL_STOPPED, 0);
 }
 void AudioManager::AudioStop(ISound* audio) {
-	AudioManager::Lock();
-	for (int i = 0; i < SoundArrayLength; i++) {
-		if (SoundArray[i].Audio == audio) {
-			SoundArray[i].Stopped = true;
-		}
-	}
-	AudioManager::Unlock();
+	AudioCommand command = {};
+	command.Type = AudioCommand_StopSound;
+	command.Sound = audio;
+	AudioManager::PostMatchingCommand(command, AUDIO_CHANNEL_STOPPED, 0);
 }
 void AudioManager::AudioRemove(ISound* audio) {
 	AudioManager::Lock();
@@ -547,61 +818,50 @@ void AudioManager::AudioRemove(ISound* audio) {
 				SoundArray[i].Playback = NULL;
 			}
 		}
+		if (ChannelStates[i].Audio.load() == audio) {
+			AudioManager::ModifyChannelState(i, AUDIO_CHANNEL_STOPPED, 0);
+			ChannelStates[i].Audio.store(nullptr);
+		}
 	}
 	AudioManager::Unlock();
 }
 void AudioManager::AudioUnpauseAll() {
-	AudioManager::Lock();
-	for (int i = 0; i < SoundArrayLength; i++) {
-		SoundArray[i].Paused = false;
-	}
-	AudioManager::Unlock();
+	AudioCommand command = {};
+	command.Type = AudioCommand_UnpauseAll;
+	AudioManager::PostMatchingCommand(command, 0, AUDIO_CHANNEL_PAUSED);
 }
 void AudioManager::AudioPauseAll() {
-	AudioManager::Lock();
-	for (int i = 0; i < SoundArrayLength; i++) {
-		SoundArray[i].Paused = true;
-	}
-	AudioManager::Unlock();
+	AudioCommand command = {};
+	command.Type = AudioCommand_PauseAll;
+	AudioManager::PostMatchingCommand(command, AUDIO_CHANNEL_PAUSED, 0);
 }
 void AudioManager::AudioStopAll() {
-	AudioManager::Lock();
-	for (int i = 0; i < SoundArrayLength; i++) {
-		SoundArray[i].Stopped = true;
-	}
-	AudioManager::Unlock();
+	AudioCommand command = {};
+	command.Type = AudioCommand_StopAll;
+	AudioManager::PostMatchingCommand(command, AUDIO_CHANNEL_STOPPED, 0);
 }
 
 bool AudioManager::IsOriginPlaying(void* origin, ISound* audio) {
-	bool isPlaying = false;
-	AudioManager::Lock();
 	for (int i = 0; i < SoundArrayLength; i++) {
-		AudioChannel* channel = &SoundArray[i];
-		if (!channel->Stopped && !channel->Paused && channel->Audio == audio &&
-			channel->Origin == origin) {
-			isPlaying = true;
+		if (ChannelStates[i].Audio.load() == audio &&
+			ChannelStates[i].Origin.load() == origin && AudioManager::IsChannelPlaying(i)) {
+			return true;
 		}
 	}
-	AudioManager::Unlock();
-	return isPlaying;
+	return false;
 }
 void AudioManager::StopOriginSound(void* origin, ISound* audio) {
-	AudioManager::Lock();
-	for (int i = 0; i < SoundArrayLength; i++) {
-		if (SoundArray[i].Audio == audio && SoundArray[i].Origin == origin) {
-			SoundArray[i].Stopped = true;
-		}
-	}
-	AudioManager::Unlock();
+	AudioCommand command = {};
+	command.Type = AudioCommand_StopOriginSound;
+	command.Sound = audio;
+	command.Origin = origin;
+	AudioManager::PostMatchingCommand(command, AUDIO_CHANNEL_STOPPED, 0);
 }
 void AudioManager::StopAllOriginSounds(void* origin) {
-	AudioManager::Lock();
-	for (int i = 0; i < SoundArrayLength; i++) {
-		if (SoundArray[i].Origin == origin) {
-			SoundArray[i].Stopped = true;
-		}
-	}
-	AudioManager::Unlock();
+	AudioCommand command = {};
+	command.Type = AudioCommand_StopAllOriginSounds;
+	command.Origin = origin;
+	AudioManager::PostMatchingCommand(command, AUDIO_CHANNEL_STOPPED, 0);
 }
 
 void AudioManager::SetInterrupted(bool interrupted) {
@@ -610,51 +870,6 @@ void AudioManager::SetInterrupted(bool interrupted) {
 	AudioManager::Unlock();
 }
 
-void AudioManager::MixAudioLR(Uint8* dest, Uint8* src, size_t len, float volumeL, float volumeR) {
-#define DEFINE_STREAM_PTR(type) \
-	type* src##type; \
-	type* dest##type
-#define PAN_STREAM_PTR(type) \
-	src##type = (type*)(src); \
-	dest##type = (type*)(dest); \
-	for (Uint32 o = 0; o < len; o++) { \
-		dest##type[0] = (type)(src##type[0] * volumeL); \
-		dest##type[1] = (type)(src##type[1] * volumeR); \
-		src##type += 2; \
-		dest##type += 2; \
-	}
-
-	DEFINE_STREAM_PTR(Uint8);
-	DEFINE_STREAM_PTR(Sint8);
-	DEFINE_STREAM_PTR(Uint16);
-	DEFINE_STREAM_PTR(Sint16);
-	DEFINE_STREAM_PTR(Sint32);
-	DEFINE_STREAM_PTR(float);
-
-	switch (DeviceFormat.format) {
-	case AUDIO_U8:
-		PAN_STREAM_PTR(Uint8);
-		break;
-	case AUDIO_S8:
-		PAN_STREAM_PTR(Sint8);
-		break;
-	case AUDIO_U16SYS:
-		PAN_STREAM_PTR(Uint16);
-		break;
-	case AUDIO_S16SYS:
-		PAN_STREAM_PTR(Sint16);
-		break;
-	case AUDIO_S32SYS:
-		PAN_STREAM_PTR(Sint32);
-		break;
-	case AUDIO_F32SYS:
-		PAN_STREAM_PTR(float);
-		break;
-	}
-#undef DEFINE_STREAM_PTR
-#undef PAN_STREAM_PTR
-}
-
 bool AudioManager::HandleFading(AudioChannel* audio) {
 	if (audio->Fading == MusicFade_Out) {
 		audio->FadeTimer -= (double)DeviceFormat.samples / DeviceFormat.freq;
@@ -676,7 +891,9 @@ bool AudioManager::HandleFading(AudioChannel* audio) {
 	}
 	return false;
 }
-bool AudioManager::AudioPlayMix(AudioChannel* audio, Uint8* stream, int len, float volume) {
+// Accumulates the channel into the float mix bus. The channel's volume,
+// pan and fade are folded into a single gain per side.
+bool AudioManager::AudioPlayMix(AudioChannel* audio, float* bus, int len, float volume) {
 	if (AudioManager::HandleFading(audio)) {
 		return true;
 	}
@@ -687,6 +904,7 @@ bool AudioManager::AudioPlayMix(AudioChannel* audio, Uint8* stream, int len, flo
 	}
 
 	int bytesPerSample = BytesPerSample;
+	int channels = DeviceFormat.channels;
 	int bytes = playback->BufferedSamples * bytesPerSample;
 
 	unsigned advanceAccumulator = 0;
@@ -703,25 +921,20 @@ bool AudioManager::AudioPlayMix(AudioChannel* audio, Uint8* stream, int len, flo
 		advanceReadIndex = len - bytes;
 	}
 
-	int mixVolume;
+	float gain = volume;
 	if (audio->Fading) {
-		mixVolume = (int)(SDL_MIX_MAXVOLUME * MasterVolume * volume *
-			(audio->FadeTimer / audio->FadeTimerMax));
-	}
-	else {
-		mixVolume = (int)(SDL_MIX_MAXVOLUME * MasterVolume * volume);
+		gain *= (float)(audio->FadeTimer / audio->FadeTimerMax);
 	}
 
-	float volumeL = 1.0f;
-	float volumeR = 1.0f;
+	float volumeL = gain;
+	float volumeR = gain;
 
-	bool doPanning = audio->Pan != 0.0f && DeviceFormat.channels == 2;
-	if (doPanning) {
+	if (audio->Pan != 0.0f && channels == 2) {
 		if (audio->Pan < 0.f) {
-			volumeR += audio->Pan;
+			volumeR *= 1.0f + audio->Pan;
 		}
 		else {
-			volumeL -= audio->Pan;
+			volumeL *= 1.0f - audio->Pan;
 		}
 	}
 
@@ -738,29 +951,13 @@ bool AudioManager::AudioPlayMix(AudioChannel* audio, Uint8* stream, int len, flo
 	// Normal
 	default:
 		if (speed == 0x10000) {
-			if (!doPanning) {
-				SDL_MixAudioFormat(stream,
-					playback->Buffer,
-					DeviceFormat.format,
-					(Uint32)bytes,
-					mixVolume);
-			}
-			else {
-				Uint32 mixAdvance = MixBufferSize * bytesPerSample;
-				for (Uint32 o = 0; o < (unsigned)len; o += mixAdvance) {
-					AudioManager::MixAudioLR(MixBuffer,
-						playback->Buffer + advanceReadIndex,
-						MixBufferSize,
-						volumeL,
-						volumeR);
-					SDL_MixAudioFormat(stream + o,
-						MixBuffer,
-						DeviceFormat.format,
-						mixAdvance,
-						mixVolume);
-					advanceReadIndex += mixAdvance;
-				}
-			}
+			int mixBytes = std::min(bytes, len);
+			AudioMixer::Accumulate(bus,
+				playback->Buffer + advanceReadIndex,
+				DeviceFormat.format,
+				(mixBytes / bytesPerSample) * channels,
+				volumeL,
+				volumeR);
 
 			playback->BufferedSamples -= bytes / bytesPerSample;
 		}
@@ -770,25 +967,13 @@ bool AudioManager::AudioPlayMix(AudioChannel* audio, Uint8* stream, int len, flo
 				advance = advanceAccumulator >> 16;
 				advanceAccumulator &= 0xFFFF;
 
-				if (doPanning) {
-					AudioManager::MixAudioLR(MixBuffer,
-						playback->Buffer + advanceReadIndex,
-						1,
-						volumeL,
-						volumeR);
-					SDL_MixAudioFormat(stream + o,
-						MixBuffer,
-						DeviceFormat.format,
-						(Uint32)bytesPerSample,
-						mixVolume);
-				}
-				else {
-					SDL_MixAudioFormat(stream + o,
-						playback->Buffer + advanceReadIndex,
-						DeviceFormat.format,
-						(Uint32)bytesPerSample,
-						mixVolume);
-				}
+				AudioMixer::AccumulateFrame(bus,
+					playback->Buffer + advanceReadIndex,
+					DeviceFormat.format,
+					channels,
+					volumeL,
+					volumeR);
+				bus += channels;
 
 				advanceReadIndex += advance * bytesPerSample;
 				if (playback->BufferedSamples <= advance) {
@@ -808,19 +993,49 @@ bool AudioManager::AudioPlayMix(AudioChannel* audio, Uint8* stream, int len, flo
 	return false;
 }
 
+// Every source is accumulated into a 32-bit float bus, which is clipped and
+// converted to the device's format once at the end. The master volume is
+// applied during that conversion.
 void AudioManager::AudioCallback(void* data, Uint8* stream, int len) {
+	PROFILE_THREAD("Audio");
+	PROFILE_ZONE("AudioManager::AudioCallback");
+
 	memset(stream, 0x00, len);
 
+	AudioManager::ProcessCommands();
+
 	if (Interrupted) {
 		return;
 	}
 
+	double callbackStart = Clock::GetTicks();
+
+	// A request longer than the bus is mixed in parts, rather than
+	// allocating on the audio thread.
+	int maxLen = (int)(MixBusLength / DeviceFormat.channels) * BytesPerSample;
+	if (maxLen <= 0) {
+		return;
+	}
+
+	while (len > 0) {
+		int chunkLen = std::min(len, maxLen);
+		AudioManager::MixChunk(stream, chunkLen);
+		stream += chunkLen;
+		len -= chunkLen;
+	}
+
+	LastCallbackTime = Clock::GetTicks() - callbackStart;
+	if (LastCallbackTime > MaxCallbackTime) {
+		MaxCallbackTime = LastCallbackTime;
+	}
+}
+void AudioManager::MixChunk(Uint8* stream, int len) {
+	size_t busLength = len / (SDL_AUDIO_BITSIZE(DeviceFormat.format) / 8);
+	memset(MixBus, 0x00, busLength * sizeof(float));
+
 	if (AudioManager::AudioQueueSize >= (size_t)len) {
-		SDL_MixAudioFormat(stream,
-			AudioManager::AudioQueue,
-			DeviceFormat.format,
-			(Uint32)len,
-			(int)(SDL_MIX_MAXVOLUME * MasterVolume));
+		AudioMixer::Accumulate(
+			MixBus, AudioManager::AudioQueue, DeviceFormat.format, busLength, 1.0f, 1.0f);
 
 		AudioManager::AudioQueueSize -= len;
 		if (AudioManager::AudioQueueSize > 0) {
@@ -835,7 +1050,7 @@ void AudioManager::AudioCallback(void* data, Uint8* stream, int len) {
 		AudioChannel* audio = MusicStack.front();
 		if (!audio->Paused) {
 			if (AudioManager::AudioPlayMix(
-				    audio, stream, len, audio->Volume * MusicVolume)) {
+				    audio, MixBus, len, audio->Volume * MusicVolume)) {
 				delete audio;
 				MusicStack.pop_front();
 			}
@@ -848,34 +1063,24 @@ void AudioManager::AudioCallback(void* data, Uint8* stream, int len) {
 			continue;
 		}
 
-		if (AudioManager::AudioPlayMix(audio, stream, len, audio->Volume * SoundVolume)) {
+		if (AudioManager::AudioPlayMix(audio, MixBus, len, audio->Volume * SoundVolume)) {
 			audio->Stopped = true;
+			AudioManager::PublishChannelStopped(i, audio->Generation);
 		}
 	}
 
-	if (LowPassFilter > 0.0) {
-		size_t channels = 2;
-		if (SDL_AUDIO_ISFLOAT(DeviceFormat.format)) {
-			size_t samples = len / sizeof(float) / channels;
+	if (LowPassFilter > 0.0 && DeviceFormat.channels == 2) {
+		size_t samples = busLength / 2;
 
-			float* in = (float*)stream;
-			float* out = (float*)stream;
-			for (size_t i = 0; i < samples; i++) {
-				*out++ = ProcessSampleFloat(*in++, 1);
-				*out++ = ProcessSampleFloat(*in++, 0);
-			}
-		}
-		else {
-			size_t samples = len / sizeof(Sint16) / channels;
-
-			Sint16* in = (Sint16*)stream;
-			Sint16* out = (Sint16*)stream;
-			for (size_t i = 0; i < samples; i++) {
-				*out++ = (Sint16)ProcessSample(*in++, 1);
-				*out++ = (Sint16)ProcessSample(*in++, 0);
-			}
+		float* sample = MixBus;
+		for (size_t i = 0; i < samples; i++) {
+			sample[0] = ProcessSampleFloat(sample[0], 1);
+			sample[1] = ProcessSampleFloat(sample[1], 0);
+			sample += 2;
 		}
 	}
+
+	AudioMixer::Output(stream, MixBus, DeviceFormat.format, busLength, MasterVolume);
 }
 
 void AudioManager::Dispose() {
@@ -883,10 +1088,26 @@ void AudioManager::Dispose() {
 		AudioManager::ClearSounds();
 	}
 
-	Memory::Free(SoundArray);
-	Memory::Free(AudioQueue);
-	Memory::Free(MixBuffer);
+	AudioManager::ClearMusic();
+
+	AudioStreamDecoder::Dispose();
 
 	SDL_PauseAudioDevice(Device, 1);
 	SDL_CloseAudioDevice(Device);
+
+	Memory::Free(SoundArray);
+	Memory::Free(AudioQueue);
+	Memory::Free(MixBus);
+
+	AudioCommand retired;
+	while (RetiredPlaybacks->Pop(retired)) {
+		delete retired.Playback;
+	}
+
+	delete Commands;
+	delete RetiredPlaybacks;
+	delete[] ChannelStates;
+	Commands = nullptr;
+	RetiredPlaybacks = nullptr;
+	ChannelStates = nullptr;
 }
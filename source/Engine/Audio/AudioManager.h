@@ -3,6 +3,7 @@
 
 #include <Engine/Application.h>
 #include <Engine/Audio/AudioChannel.h>
+#include <Engine/Audio/AudioCommandQueue.h>
 #include <Engine/Includes/Standard.h>
 #include <Engine/Includes/StandardSDL2.h>
 #include <Engine/ResourceTypes/ISound.h>
@@ -11,6 +12,32 @@ class AudioManager {
 private:
 	static void UpdateChannelPlayer(AudioPlayback* playback, ISound* sound);
 	static bool HandleFading(AudioChannel* audio);
+	static AudioCommandQueue* Commands;
+	static AudioCommandQueue* RetiredPlaybacks;
+	static AudioChannelState* ChannelStates;
+	static std::atomic_flag ProcessingCommands;
+	static void PostCommand(AudioCommand& command);
+	static void ProcessCommands();
+	static void ApplyCommand(AudioCommand& command);
+	static bool CommandMatches(AudioCommand& command, ISound* sound, void* origin);
+	static void PostChannelCommand(int channel, Uint8 type, Uint32 setFlags, Uint32 clearFlags);
+	static void PostMatchingCommand(AudioCommand& command, Uint32 setFlags, Uint32 clearFlags);
+	static void PostPlaySound(int channel,
+		Uint32 generation,
+		ISound* sound,
+		bool loop,
+		int loopPoint,
+		float pan,
+		float speed,
+		float volume,
+		void* origin);
+	static AudioPlayback* PreparePlayback(ISound* sound);
+	static void RetirePlayback(AudioPlayback* playback);
+	static void StartChannel(AudioCommand& command);
+	static bool ClaimChannel(int channel, bool onlyIfStopped, Uint32& generation);
+	static Uint32 ModifyChannelState(int channel, Uint32 setFlags, Uint32 clearFlags);
+	static void PublishChannelStopped(int channel, Uint32 generation);
+	static bool IsChannelPlaying(int channel);
 
 public:
 	static SDL_AudioDeviceID Device;
@@ -18,8 +45,8 @@ public:
 	static bool AudioEnabled;
 	static bool Interrupted;
 	static Uint8 BytesPerSample;
-	static Uint8* MixBuffer;
-	static size_t MixBufferSize;
+	static float* MixBus;
+	static size_t MixBusLength;
 	static deque<AudioChannel*> MusicStack;
 	static AudioChannel* SoundArray;
 	static int SoundArrayLength;
@@ -30,6 +57,8 @@ public:
 	static Uint8* AudioQueue;
 	static size_t AudioQueueSize;
 	static size_t AudioQueueMaxSize;
+	static double LastCallbackTime;
+	static double MaxCallbackTime;
 	enum {
 		REQUEST_EOF = 0,
 		REQUEST_ERROR = -1,
@@ -80,6 +109,8 @@ public:
 	static void ClearSounds();
 	static void FadeOutMusic(double seconds);
 	static void AlterMusic(float pan, float speed, float volume);
+	static void PauseMusic();
+	static void ResumeMusic();
 	static double GetMusicDuration(ISound* music);
 	static double GetMusicPosition(ISound* music);
 	static void Lock();
@@ -102,8 +133,8 @@ public:
 	static void StopOriginSound(void* origin, ISound* audio);
 	static void StopAllOriginSounds(void* origin);
 	static void SetInterrupted(bool interrupted);
-	static void MixAudioLR(Uint8* dest, Uint8* src, size_t len, float volumeL, float volumeR);
-	static bool AudioPlayMix(AudioChannel* audio, Uint8* stream, int len, float volume);
+	static bool AudioPlayMix(AudioChannel* audio, float* bus, int len, float volume);
+	static void MixChunk(Uint8* stream, int len);
 	static void AudioCallback(void* data, Uint8* stream, int len);
 	static void Dispose();
 };
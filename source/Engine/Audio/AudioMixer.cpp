@@ -0,0 +1,224 @@
+#include <Engine/Audio/AudioMixer.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AUDIO_MIXER_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define AUDIO_MIXER_NEON
+#include <arm_neon.h>
+#endif
+
+// The mix bus holds samples in the [-1.0, 1.0] range, interleaved the same
+// way the device expects them. Gains alternate between gainL and gainR for
+// every sample, so they are only meaningful for stereo; callers mixing any
+// other layout pass the same gain for both.
+
+static inline float ReadSample(const Uint8* src, SDL_AudioFormat format, size_t index) {
+	switch (format) {
+	case AUDIO_U8:
+		return ((int)src[index] - 0x80) * (1.0f / 128.0f);
+	case AUDIO_S8:
+		return ((const Sint8*)src)[index] * (1.0f / 128.0f);
+	case AUDIO_U16SYS:
+		return ((int)((const Uint16*)src)[index] - 0x8000) * (1.0f / 32768.0f);
+	case AUDIO_S16SYS:
+		return ((const Sint16*)src)[index] * (1.0f / 32768.0f);
+	case AUDIO_S32SYS:
+		return (float)(((const Sint32*)src)[index] * (1.0 / 2147483648.0));
+	case AUDIO_F32SYS:
+		return ((const float*)src)[index];
+	}
+
+	return 0.0f;
+}
+static inline float ClipSample(float sample) {
+	if (sample > 1.0f) {
+		return 1.0f;
+	}
+	else if (sample < -1.0f) {
+		return -1.0f;
+	}
+	return sample;
+}
+static inline void
+WriteSample(Uint8* dest, SDL_AudioFormat format, size_t index, float sample) {
+	sample = ClipSample(sample);
+
+	switch (format) {
+	case AUDIO_U8:
+		dest[index] = (Uint8)(std::lrint(sample * 127.0f) + 0x80);
+		break;
+	case AUDIO_S8:
+		((Sint8*)dest)[index] = (Sint8)std::lrint(sample * 127.0f);
+		break;
+	case AUDIO_U16SYS:
+		((Uint16*)dest)[index] = (Uint16)(std::lrint(sample * 32767.0f) + 0x8000);
+		break;
+	case AUDIO_S16SYS:
+		((Sint16*)dest)[index] = (Sint16)std::lrint(sample * 32767.0f);
+		break;
+	case AUDIO_S32SYS:
+		((Sint32*)dest)[index] = (Sint32)std::llrint(sample * 2147483647.0);
+		break;
+	case AUDIO_F32SYS:
+		((float*)dest)[index] = sample;
+		break;
+	}
+}
+
+#if defined(AUDIO_MIXER_NEON)
+// Rounds half to even, like _mm_cvtps_epi32 and std::lrint do. ARMv7 only
+// has a truncating conversion, so there the value is rounded by adding and
+// subtracting 1.5 * 2^23, which is exact for anything within 2^22.
+static inline int32x4_t RoundToInt(float32x4_t value) {
+#if defined(__aarch64__) || defined(_M_ARM64)
+	return vcvtnq_s32_f32(value);
+#else
+	const float32x4_t magic = vdupq_n_f32(12582912.0f);
+	return vcvtq_s32_f32(vsubq_f32(vaddq_f32(value, magic), magic));
+#endif
+}
+#endif
+
+const char* AudioMixer::GetBackendName() {
+#if defined(AUDIO_MIXER_SSE2)
+	return "SSE2";
+#elif defined(AUDIO_MIXER_NEON)
+	return "NEON";
+#else
+	return "scalar";
+#endif
+}
+
+void AudioMixer::Accumulate(float* bus,
+	const Uint8* src,
+	SDL_AudioFormat format,
+	size_t count,
+	float gainL,
+	float gainR) {
+	size_t i = 0;
+
+#if defined(AUDIO_MIXER_SSE2)
+	__m128 gain = _mm_setr_ps(gainL, gainR, gainL, gainR);
+	if (format == AUDIO_S16SYS) {
+		const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+		const Sint16* in = (const Sint16*)src;
+		gain = _mm_mul_ps(gain, scale);
+		for (; i + 8 <= count; i += 8) {
+			__m128i samples = _mm_loadu_si128((const __m128i*)(in + i));
+			__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+			__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+			__m128 busLo = _mm_loadu_ps(bus + i);
+			__m128 busHi = _mm_loadu_ps(bus + i + 4);
+			busLo = _mm_add_ps(busLo, _mm_mul_ps(_mm_cvtepi32_ps(lo), gain));
+			busHi = _mm_add_ps(busHi, _mm_mul_ps(_mm_cvtepi32_ps(hi), gain));
+			_mm_storeu_ps(bus + i, busLo);
+			_mm_storeu_ps(bus + i + 4, busHi);
+		}
+	}
+	else if (format == AUDIO_F32SYS) {
+		const float* in = (const float*)src;
+		for (; i + 4 <= count; i += 4) {
+			__m128 samples = _mm_loadu_ps(in + i);
+			__m128 mixed = _mm_add_ps(_mm_loadu_ps(bus + i), _mm_mul_ps(samples, gain));
+			_mm_storeu_ps(bus + i, mixed);
+		}
+	}
+#elif defined(AUDIO_MIXER_NEON)
+	const float gains[4] = {gainL, gainR, gainL, gainR};
+	float32x4_t gain = vld1q_f32(gains);
+	if (format == AUDIO_S16SYS) {
+		const Sint16* in = (const Sint16*)src;
+		gain = vmulq_n_f32(gain, 1.0f / 32768.0f);
+		for (; i + 8 <= count; i += 8) {
+			int16x8_t samples = vld1q_s16(in + i);
+			float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(samples)));
+			float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(samples)));
+			vst1q_f32(bus + i, vmlaq_f32(vld1q_f32(bus + i), lo, gain));
+			vst1q_f32(bus + i + 4, vmlaq_f32(vld1q_f32(bus + i + 4), hi, gain));
+		}
+	}
+	else if (format == AUDIO_F32SYS) {
+		const float* in = (const float*)src;
+		for (; i + 4 <= count; i += 4) {
+			vst1q_f32(bus + i, vmlaq_f32(vld1q_f32(bus + i), vld1q_f32(in + i), gain));
+		}
+	}
+#endif
+
+	for (; i < count; i++) {
+		bus[i] += ReadSample(src, format, i) * ((i & 1) ? gainR : gainL);
+	}
+}
+
+void AudioMixer::AccumulateFrame(float* bus,
+	const Uint8* src,
+	SDL_AudioFormat format,
+	int channels,
+	float gainL,
+	float gainR) {
+	for (int c = 0; c < channels; c++) {
+		bus[c] += ReadSample(src, format, c) * ((c & 1) ? gainR : gainL);
+	}
+}
+
+// Clipping and conversion to the device format happen only here, once per
+// callback, after every source has been accumulated.
+void AudioMixer::Output(Uint8* dest,
+	const float* bus,
+	SDL_AudioFormat format,
+	size_t count,
+	float gain) {
+	size_t i = 0;
+
+#if defined(AUDIO_MIXER_SSE2)
+	const __m128 gainVec = _mm_set1_ps(gain);
+	const __m128 minVec = _mm_set1_ps(-1.0f);
+	const __m128 maxVec = _mm_set1_ps(1.0f);
+	if (format == AUDIO_S16SYS) {
+		const __m128 scale = _mm_set1_ps(32767.0f);
+		Sint16* out = (Sint16*)dest;
+		for (; i + 8 <= count; i += 8) {
+			__m128 lo = _mm_mul_ps(_mm_loadu_ps(bus + i), gainVec);
+			__m128 hi = _mm_mul_ps(_mm_loadu_ps(bus + i + 4), gainVec);
+			lo = _mm_mul_ps(_mm_min_ps(_mm_max_ps(lo, minVec), maxVec), scale);
+			hi = _mm_mul_ps(_mm_min_ps(_mm_max_ps(hi, minVec), maxVec), scale);
+			__m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(lo), _mm_cvtps_epi32(hi));
+			_mm_storeu_si128((__m128i*)(out + i), packed);
+		}
+	}
+	else if (format == AUDIO_F32SYS) {
+		float* out = (float*)dest;
+		for (; i + 4 <= count; i += 4) {
+			__m128 samples = _mm_mul_ps(_mm_loadu_ps(bus + i), gainVec);
+			_mm_storeu_ps(out + i, _mm_min_ps(_mm_max_ps(samples, minVec), maxVec));
+		}
+	}
+#elif defined(AUDIO_MIXER_NEON)
+	const float32x4_t minVec = vdupq_n_f32(-1.0f);
+	const float32x4_t maxVec = vdupq_n_f32(1.0f);
+	if (format == AUDIO_S16SYS) {
+		Sint16* out = (Sint16*)dest;
+		for (; i + 8 <= count; i += 8) {
+			float32x4_t lo = vmulq_n_f32(vld1q_f32(bus + i), gain);
+			float32x4_t hi = vmulq_n_f32(vld1q_f32(bus + i + 4), gain);
+			lo = vmulq_n_f32(vminq_f32(vmaxq_f32(lo, minVec), maxVec), 32767.0f);
+			hi = vmulq_n_f32(vminq_f32(vmaxq_f32(hi, minVec), maxVec), 32767.0f);
+			int16x4_t outLo = vqmovn_s32(RoundToInt(lo));
+			int16x4_t outHi = vqmovn_s32(RoundToInt(hi));
+			vst1q_s16(out + i, vcombine_s16(outLo, outHi));
+		}
+	}
+	else if (format == AUDIO_F32SYS) {
+		float* out = (float*)dest;
+		for (; i + 4 <= count; i += 4) {
+			float32x4_t samples = vmulq_n_f32(vld1q_f32(bus + i), gain);
+			vst1q_f32(out + i, vminq_f32(vmaxq_f32(samples, minVec), maxVec));
+		}
+	}
+#endif
+
+	for (; i < count; i++) {
+		WriteSample(dest, format, i, bus[i] * gain);
+	}
+}
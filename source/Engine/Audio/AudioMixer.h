@@ -0,0 +1,26 @@
+#ifndef ENGINE_AUDIO_AUDIOMIXER_H
+#define ENGINE_AUDIO_AUDIOMIXER_H
+
+#include <Engine/Includes/Standard.h>
+#include <Engine/Includes/StandardSDL2.h>
+
+class AudioMixer {
+public:
+	static const char* GetBackendName();
+	static void Accumulate(float* bus,
+		const Uint8* src,
+		SDL_AudioFormat format,
+		size_t count,
+		float gainL,
+		float gainR);
+	static void AccumulateFrame(float* bus,
+		const Uint8* src,
+		SDL_AudioFormat format,
+		int channels,
+		float gainL,
+		float gainR);
+	static void
+	Output(Uint8* dest, const float* bus, SDL_AudioFormat format, size_t count, float gain);
+};
+
+#endif /* ENGINE_AUDIO_AUDIOMIXER_H */
@@ -72,7 +72,29 @@ void AudioPlayback::CreateConversionStream(SDL_AudioSpec format) {
 	}
 }
 
+// Hands decoding of soundData, which this playback takes ownership of, to
+// the stream decoder thread. RequestSamples then only copies decoded audio
+// out of the stream's ring buffer.
+bool AudioPlayback::StartStreaming(SoundFormat* soundData) {
+	DecodeStream =
+		AudioStreamDecoder::Create(soundData, Format, BytesPerSample, DeviceBytesPerSample);
+	if (!DecodeStream) {
+		return false;
+	}
+
+	// The decoder thread owns the sound data from now on.
+	SoundData = soundData;
+	OwnsSoundData = false;
+
+	return true;
+}
+
 void AudioPlayback::Dispose() {
+	if (DecodeStream) {
+		AudioStreamDecoder::Release(DecodeStream);
+		DecodeStream = NULL;
+	}
+
 	if (Buffer) {
 		Memory::Free(Buffer);
 		Buffer = NULL;
@@ -100,6 +122,36 @@ int AudioPlayback::RequestSamples(int samples, bool loop, int sample_to_loop_to)
 		return AudioManager::REQUEST_ERROR;
 	}
 
+	if (DecodeStream) {
+		if (LoopIndex >= 0) {
+			DecodeStream->LoopPoint.store(LoopIndex);
+		}
+		else {
+			DecodeStream->LoopPoint.store(loop ? sample_to_loop_to : -1);
+		}
+
+		int received = (int)AudioStreamDecoder::Read(
+			DecodeStream, Buffer, (size_t)samples * DeviceBytesPerSample);
+		if (received == 0) {
+			if (DecodeStream->Finished.load()) {
+				return AudioManager::REQUEST_EOF;
+			}
+
+			// The decoder fell behind.
+			return AudioManager::REQUEST_CONVERTING;
+		}
+
+		BufferedSamples = received / DeviceBytesPerSample;
+
+		return received;
+	}
+
+	// Loop points are given in samples of the source file, which may
+	// have been converted to another rate at load time.
+	if (SampleScale != 1.0 && sample_to_loop_to > 0) {
+		sample_to_loop_to = (int)(sample_to_loop_to * SampleScale);
+	}
+
 	// If the format is the same, no need to convert.
 	if (Format.freq == AudioManager::DeviceFormat.freq &&
 		Format.format == AudioManager::DeviceFormat.format &&
@@ -178,7 +230,31 @@ void AudioPlayback::Seek(int samples) {
 		return;
 	}
 
+	if (DecodeStream) {
+		DecodeStream->LoopPoint.store(LoopIndex);
+		BufferedSamples = 0;
+
+		AudioStreamDecoder::Seek(DecodeStream, samples);
+		return;
+	}
+
 	SoundData->SeekSample(samples);
+
+	if (ConversionStream) {
+		SDL_AudioStreamClear(ConversionStream);
+	}
+}
+
+double AudioPlayback::GetPosition() {
+	if (!SoundData) {
+		return 0.0;
+	}
+
+	if (DecodeStream) {
+		return AudioStreamDecoder::GetPosition(DecodeStream);
+	}
+
+	return SoundData->GetPosition();
 }
 
 AudioPlayback::~AudioPlayback() {
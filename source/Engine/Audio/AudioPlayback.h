@@ -1,6 +1,7 @@
 #ifndef ENGINE_AUDIO_AUDIOPLAYBACK_H
 #define ENGINE_AUDIO_AUDIOPLAYBACK_H
 
+#include <Engine/Audio/AudioStreamDecoder.h>
 #include <Engine/Includes/Standard.h>
 #include <Engine/Includes/StandardSDL2.h>
 #include <Engine/ResourceTypes/SoundFormats/SoundFormat.h>
@@ -21,6 +22,8 @@ public:
 	SoundFormat* SoundData = NULL;
 	bool OwnsSoundData = false;
 	Sint32 LoopIndex = -1;
+	double SampleScale = 1.0;
+	AudioDecodeStream* DecodeStream = NULL;
 
 	AudioPlayback(SDL_AudioSpec format,
 		size_t requiredSamples,
@@ -30,9 +33,11 @@ public:
 		size_t requiredSamples,
 		size_t audioBytesPerSample,
 		size_t deviceBytesPerSample);
+	bool StartStreaming(SoundFormat* soundData);
 	void Dispose();
 	int RequestSamples(int samples, bool loop, int sample_to_loop_to);
 	void Seek(int samples);
+	double GetPosition();
 	~AudioPlayback();
 };
 
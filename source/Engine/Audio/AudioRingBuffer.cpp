@@ -0,0 +1,79 @@
+#include <Engine/Audio/AudioRingBuffer.h>
+
+#include <Engine/Diagnostics/Memory.h>
+
+AudioRingBuffer::AudioRingBuffer(size_t capacity) {
+	// Round up to a power of two so positions can be masked.
+	Capacity = 1;
+	while (Capacity < capacity) {
+		Capacity <<= 1;
+	}
+
+	Mask = Capacity - 1;
+	Data = (Uint8*)Memory::TrackedMalloc("AudioRingBuffer::Data", Capacity);
+
+	ReadIndex.store(0);
+	WriteIndex.store(0);
+}
+AudioRingBuffer::~AudioRingBuffer() {
+	Memory::Free(Data);
+}
+
+size_t AudioRingBuffer::GetCapacity() {
+	return Capacity;
+}
+size_t AudioRingBuffer::GetAvailable() {
+	return WriteIndex.load(std::memory_order_acquire) -
+		ReadIndex.load(std::memory_order_acquire);
+}
+size_t AudioRingBuffer::GetFree() {
+	return Capacity - GetAvailable();
+}
+
+size_t AudioRingBuffer::Write(const Uint8* data, size_t length) {
+	size_t write = WriteIndex.load(std::memory_order_relaxed);
+	size_t read = ReadIndex.load(std::memory_order_acquire);
+
+	size_t space = Capacity - (write - read);
+	if (length > space) {
+		length = space;
+	}
+	if (length == 0) {
+		return 0;
+	}
+
+	size_t start = write & Mask;
+	size_t first = std::min(length, Capacity - start);
+	memcpy(Data + start, data, first);
+	memcpy(Data, data + first, length - first);
+
+	WriteIndex.store(write + length, std::memory_order_release);
+
+	return length;
+}
+size_t AudioRingBuffer::Read(Uint8* data, size_t length) {
+	size_t read = ReadIndex.load(std::memory_order_relaxed);
+	size_t write = WriteIndex.load(std::memory_order_acquire);
+
+	size_t available = write - read;
+	if (length > available) {
+		length = available;
+	}
+	if (length == 0) {
+		return 0;
+	}
+
+	size_t start = read & Mask;
+	size_t first = std::min(length, Capacity - start);
+	memcpy(data, Data + start, first);
+	memcpy(data + first, Data, length - first);
+
+	ReadIndex.store(read + length, std::memory_order_release);
+
+	return length;
+}
+
+void AudioRingBuffer::Clear() {
+	ReadIndex.store(0);
+	WriteIndex.store(0);
+}
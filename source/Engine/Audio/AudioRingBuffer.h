@@ -0,0 +1,30 @@
+#ifndef ENGINE_AUDIO_AUDIORINGBUFFER_H
+#define ENGINE_AUDIO_AUDIORINGBUFFER_H
+
+#include <Engine/Includes/Standard.h>
+
+#include <atomic>
+
+// Single-producer, single-consumer byte ring. One thread may call Write and
+// another may call Read at the same time without locking; Clear may only be
+// called while neither side is active.
+class AudioRingBuffer {
+private:
+	Uint8* Data;
+	size_t Capacity;
+	size_t Mask;
+	std::atomic<size_t> ReadIndex;
+	std::atomic<size_t> WriteIndex;
+
+public:
+	AudioRingBuffer(size_t capacity);
+	~AudioRingBuffer();
+	size_t GetCapacity();
+	size_t GetAvailable();
+	size_t GetFree();
+	size_t Write(const Uint8* data, size_t length);
+	size_t Read(Uint8* data, size_t length);
+	void Clear();
+};
+
+#endif /* ENGINE_AUDIO_AUDIORINGBUFFER_H */
@@ -0,0 +1,409 @@
+#include <Engine/Audio/AudioStreamDecoder.h>
+
+#include <Engine/Audio/AudioManager.h>
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Memory.h>
+#include <Engine/Diagnostics/Profiler.h>
+
+SDL_Thread* AudioStreamDecoder::Thread = NULL;
+SDL_mutex* AudioStreamDecoder::ListLock = NULL;
+SDL_sem* AudioStreamDecoder::WakeSignal = NULL;
+bool AudioStreamDecoder::Running = false;
+vector<AudioDecodeStream*> AudioStreamDecoder::Streams;
+
+bool AudioStreamDecoder::Enabled = true;
+int AudioStreamDecoder::Lookahead = AUDIO_STREAM_DEFAULT_LOOKAHEAD;
+
+// How long the decoder thread sleeps when nobody wakes it up, in milliseconds.
+#define AUDIO_STREAM_POLL_INTERVAL 10
+
+void AudioStreamDecoder::Init() {
+	if (!Enabled || !AudioManager::AudioEnabled || Running) {
+		return;
+	}
+
+	ListLock = SDL_CreateMutex();
+	if (ListLock == NULL) {
+		Log::Print(Log::LOG_ERROR,
+			"Unable to create the audio stream decoder mutex: %s",
+			SDL_GetError());
+		return;
+	}
+
+	WakeSignal = SDL_CreateSemaphore(0);
+	if (WakeSignal == NULL) {
+		Log::Print(Log::LOG_ERROR,
+			"Unable to create the audio stream decoder semaphore: %s",
+			SDL_GetError());
+		SDL_DestroyMutex(ListLock);
+		ListLock = NULL;
+		return;
+	}
+
+	Running = true;
+
+	Thread = SDL_CreateThread(
+		AudioStreamDecoder::ThreadFunc, "AudioStreamDecoder::ThreadFunc", NULL);
+	if (Thread == NULL) {
+		Log::Print(Log::LOG_ERROR,
+			"Unable to create the audio stream decoder thread: %s",
+			SDL_GetError());
+		Running = false;
+		SDL_DestroySemaphore(WakeSignal);
+		SDL_DestroyMutex(ListLock);
+		WakeSignal = NULL;
+		ListLock = NULL;
+	}
+}
+bool AudioStreamDecoder::IsRunning() {
+	return Running;
+}
+
+int AudioStreamDecoder::ThreadFunc(void* data) {
+	vector<AudioDecodeStream*> active;
+	vector<AudioDecodeStream*> released;
+
+	PROFILE_THREAD("Audio Stream Decoder");
+
+	while (true) {
+		SDL_SemWaitTimeout(WakeSignal, AUDIO_STREAM_POLL_INTERVAL);
+
+		SDL_LockMutex(ListLock);
+		if (!Running) {
+			SDL_UnlockMutex(ListLock);
+			break;
+		}
+
+		// Streams are only ever deleted here, so the ones in the
+		// active list stay valid until the next pass.
+		active.clear();
+		released.clear();
+		for (size_t i = 0; i < Streams.size();) {
+			if (Streams[i]->Released.load()) {
+				released.push_back(Streams[i]);
+				Streams.erase(Streams.begin() + i);
+				continue;
+			}
+
+			active.push_back(Streams[i]);
+			i++;
+		}
+		SDL_UnlockMutex(ListLock);
+
+		for (size_t i = 0; i < released.size(); i++) {
+			Delete(released[i]);
+		}
+
+		for (size_t i = 0; i < active.size(); i++) {
+			AudioDecodeStream* stream = active[i];
+			if (stream->Released.load()) {
+				continue;
+			}
+
+			PROFILE_ZONE("Fill Audio Stream");
+
+			// The ring is topped up about one callback's worth at a
+			// time, and the lock is let go in between, so that Seek
+			// and GetPosition never wait on a whole lookahead.
+			bool more = true;
+			while (more && !stream->Released.load()) {
+				SDL_LockMutex(stream->Lock);
+				more = Fill(stream, stream->LookaheadBytes, stream->ConvertBufferSize);
+				SDL_UnlockMutex(stream->Lock);
+			}
+		}
+	}
+
+	return 0;
+}
+
+int AudioStreamDecoder::Decode(AudioDecodeStream* stream, size_t count) {
+	int loopPoint = stream->LoopPoint.load();
+
+	int numSamples = stream->SoundData->GetSamples(stream->DecodeBuffer, count, loopPoint);
+	if (numSamples == 0 && loopPoint >= 0) {
+		stream->SoundData->SeekSample(loopPoint);
+		numSamples = stream->SoundData->GetSamples(stream->DecodeBuffer, count, loopPoint);
+	}
+
+	return numSamples;
+}
+// Decodes until the ring holds targetBytes of device-format audio, or the
+// sound ends, adding no more than about maxBytes to it. Returns true if it
+// stopped only because of maxBytes. Must be called with the stream's lock
+// held.
+bool AudioStreamDecoder::Fill(AudioDecodeStream* stream, size_t targetBytes, size_t maxBytes) {
+	AudioRingBuffer* ring = stream->Ring;
+	size_t frameSize = stream->DeviceBytesPerSample;
+
+	bool limited = false;
+	size_t available = ring->GetAvailable();
+	if (available < targetBytes && targetBytes - available > maxBytes) {
+		targetBytes = available + maxBytes;
+		limited = true;
+	}
+
+	while (!stream->Finished.load()) {
+		available = ring->GetAvailable();
+		if (available >= targetBytes) {
+			return limited;
+		}
+
+		size_t space = std::min(ring->GetFree(), targetBytes - available);
+		space -= space % frameSize;
+		if (space == 0) {
+			break;
+		}
+
+		// Same format as the device; decode straight into the ring.
+		if (stream->ConversionStream == NULL) {
+			if (stream->EndOfInput) {
+				stream->Finished.store(true);
+				break;
+			}
+
+			size_t count = std::min(space / frameSize, stream->DecodeBufferSamples);
+			int numSamples = Decode(stream, count);
+			if (numSamples <= 0) {
+				stream->EndOfInput = true;
+				continue;
+			}
+
+			ring->Write(stream->DecodeBuffer, numSamples * frameSize);
+			continue;
+		}
+
+		// Move converted audio into the ring first.
+		int converted = SDL_AudioStreamAvailable(stream->ConversionStream);
+		if (converted > 0) {
+			size_t length = std::min((size_t)converted, space);
+			length = std::min(length, stream->ConvertBufferSize);
+			length -= length % frameSize;
+			if (length == 0) {
+				break;
+			}
+
+			int received = SDL_AudioStreamGet(
+				stream->ConversionStream, stream->ConvertBuffer, (int)length);
+			if (received <= 0) {
+				break;
+			}
+
+			ring->Write(stream->ConvertBuffer, received);
+			continue;
+		}
+
+		if (stream->EndOfInput) {
+			stream->Finished.store(true);
+			break;
+		}
+
+		int numSamples = Decode(stream, stream->DecodeBufferSamples);
+		if (numSamples <= 0) {
+			stream->EndOfInput = true;
+			SDL_AudioStreamFlush(stream->ConversionStream);
+			continue;
+		}
+
+		int result = SDL_AudioStreamPut(stream->ConversionStream,
+			stream->DecodeBuffer,
+			numSamples * stream->BytesPerSample);
+		if (result == -1) {
+			Log::Print(Log::LOG_ERROR,
+				"Failed to put samples in conversion stream: %s",
+				SDL_GetError());
+			stream->Finished.store(true);
+			break;
+		}
+	}
+
+	return false;
+}
+
+AudioDecodeStream* AudioStreamDecoder::Create(SoundFormat* soundData,
+	SDL_AudioSpec format,
+	size_t bytesPerSample,
+	size_t deviceBytesPerSample) {
+	if (!Running) {
+		return nullptr;
+	}
+
+	SDL_AudioSpec deviceFormat = AudioManager::DeviceFormat;
+
+	SDL_AudioStream* conversionStream = NULL;
+	if (format.freq != deviceFormat.freq || format.format != deviceFormat.format ||
+		format.channels != deviceFormat.channels) {
+		conversionStream = SDL_NewAudioStream(format.format,
+			format.channels,
+			format.freq,
+			deviceFormat.format,
+			deviceFormat.channels,
+			deviceFormat.freq);
+		if (conversionStream == NULL) {
+			Log::Print(Log::LOG_ERROR,
+				"Conversion stream failed to create: %s",
+				SDL_GetError());
+			return nullptr;
+		}
+	}
+
+	SDL_mutex* lock = SDL_CreateMutex();
+	if (lock == NULL) {
+		if (conversionStream) {
+			SDL_FreeAudioStream(conversionStream);
+		}
+		return nullptr;
+	}
+
+	size_t lookaheadSamples = (size_t)deviceFormat.freq * Lookahead / 1000;
+	if (lookaheadSamples < (size_t)deviceFormat.samples * 2) {
+		lookaheadSamples = (size_t)deviceFormat.samples * 2;
+	}
+
+	AudioDecodeStream* stream = new AudioDecodeStream;
+	stream->SoundData = soundData;
+	stream->Format = format;
+	stream->BytesPerSample = bytesPerSample;
+	stream->DeviceBytesPerSample = deviceBytesPerSample;
+	stream->ConversionStream = conversionStream;
+	stream->LookaheadBytes = lookaheadSamples * deviceBytesPerSample;
+	stream->Ring = new AudioRingBuffer(stream->LookaheadBytes);
+	stream->DecodeBufferSamples = deviceFormat.samples;
+	stream->DecodeBuffer = (Uint8*)Memory::TrackedMalloc(
+		"AudioStreamDecoder::DecodeBuffer", stream->DecodeBufferSamples * bytesPerSample);
+	stream->ConvertBufferSize = (size_t)deviceFormat.samples * deviceBytesPerSample;
+	stream->ConvertBuffer = (Uint8*)Memory::TrackedMalloc(
+		"AudioStreamDecoder::ConvertBuffer", stream->ConvertBufferSize);
+	stream->Lock = lock;
+	stream->EndOfInput = false;
+	stream->LoopPoint.store(-1);
+	stream->Finished.store(false);
+	stream->Released.store(false);
+
+	SDL_LockMutex(ListLock);
+	Streams.push_back(stream);
+	SDL_UnlockMutex(ListLock);
+
+	return stream;
+}
+// Hands the stream back to the decoder thread, which deletes it. This never
+// blocks, so it can be called from the audio callback.
+void AudioStreamDecoder::Release(AudioDecodeStream* stream) {
+	if (!Running) {
+		Delete(stream);
+		return;
+	}
+
+	stream->Released.store(true);
+
+	Wake();
+}
+void AudioStreamDecoder::Delete(AudioDecodeStream* stream) {
+	if (stream->SoundData) {
+		stream->SoundData->Dispose();
+		delete stream->SoundData;
+	}
+	if (stream->ConversionStream) {
+		SDL_FreeAudioStream(stream->ConversionStream);
+	}
+
+	delete stream->Ring;
+
+	Memory::Free(stream->DecodeBuffer);
+	Memory::Free(stream->ConvertBuffer);
+
+	SDL_DestroyMutex(stream->Lock);
+
+	delete stream;
+}
+
+// Repositions the stream and decodes enough audio for the next callback.
+// The caller must hold the audio device lock, so that the callback isn't
+// reading from the ring while it is cleared.
+void AudioStreamDecoder::Seek(AudioDecodeStream* stream, int sample) {
+	SDL_LockMutex(stream->Lock);
+
+	stream->SoundData->SeekSample(sample);
+	if (stream->ConversionStream) {
+		SDL_AudioStreamClear(stream->ConversionStream);
+	}
+
+	stream->Ring->Clear();
+	stream->EndOfInput = false;
+	stream->Finished.store(false);
+
+	size_t prefill =
+		(size_t)AudioManager::DeviceFormat.samples * 2 * stream->DeviceBytesPerSample;
+	Fill(stream, std::min(prefill, stream->LookaheadBytes), SIZE_MAX);
+
+	SDL_UnlockMutex(stream->Lock);
+}
+size_t AudioStreamDecoder::Read(AudioDecodeStream* stream, Uint8* buffer, size_t length) {
+	length -= length % stream->DeviceBytesPerSample;
+
+	size_t received = stream->Ring->Read(buffer, length);
+
+	// Let the decoder top the ring back up.
+	Wake();
+
+	return received;
+}
+double AudioStreamDecoder::GetPosition(AudioDecodeStream* stream) {
+	SDL_LockMutex(stream->Lock);
+
+	// The decoder runs ahead of playback by whatever is still buffered.
+	size_t pendingBytes = stream->Ring->GetAvailable();
+	if (stream->ConversionStream) {
+		pendingBytes += SDL_AudioStreamAvailable(stream->ConversionStream);
+	}
+
+	double pendingSamples = (double)(pendingBytes / stream->DeviceBytesPerSample) *
+		stream->Format.freq / AudioManager::DeviceFormat.freq;
+	double sample = (double)stream->SoundData->TellSample() - pendingSamples;
+
+	int loopPoint = stream->LoopPoint.load();
+	if (sample < 0.0 && loopPoint >= 0) {
+		sample += stream->SoundData->TotalPossibleSamples - loopPoint;
+	}
+	if (sample < 0.0) {
+		sample = 0.0;
+	}
+
+	SDL_UnlockMutex(stream->Lock);
+
+	return sample / stream->Format.freq;
+}
+
+void AudioStreamDecoder::Wake() {
+	if (WakeSignal && SDL_SemValue(WakeSignal) == 0) {
+		SDL_SemPost(WakeSignal);
+	}
+}
+
+void AudioStreamDecoder::Dispose() {
+	if (!Running) {
+		return;
+	}
+
+	SDL_LockMutex(ListLock);
+	Running = false;
+	SDL_UnlockMutex(ListLock);
+
+	SDL_SemPost(WakeSignal);
+	SDL_WaitThread(Thread, NULL);
+	Thread = NULL;
+
+	// Streams that are still in use get deleted once their playback
+	// releases them.
+	for (size_t i = 0; i < Streams.size(); i++) {
+		if (Streams[i]->Released.load()) {
+			Delete(Streams[i]);
+		}
+	}
+	Streams.clear();
+
+	SDL_DestroySemaphore(WakeSignal);
+	SDL_DestroyMutex(ListLock);
+	WakeSignal = NULL;
+	ListLock = NULL;
+}
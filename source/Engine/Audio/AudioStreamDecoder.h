@@ -0,0 +1,63 @@
+#ifndef ENGINE_AUDIO_AUDIOSTREAMDECODER_H
+#define ENGINE_AUDIO_AUDIOSTREAMDECODER_H
+
+#include <Engine/Audio/AudioRingBuffer.h>
+#include <Engine/Includes/Standard.h>
+#include <Engine/Includes/StandardSDL2.h>
+#include <Engine/ResourceTypes/SoundFormats/SoundFormat.h>
+
+#include <atomic>
+
+#define AUDIO_STREAM_DEFAULT_LOOKAHEAD 250
+
+struct AudioDecodeStream {
+	SoundFormat* SoundData;
+	SDL_AudioSpec Format;
+	size_t BytesPerSample;
+	size_t DeviceBytesPerSample;
+	SDL_AudioStream* ConversionStream;
+	AudioRingBuffer* Ring;
+	size_t LookaheadBytes;
+	Uint8* DecodeBuffer;
+	size_t DecodeBufferSamples;
+	Uint8* ConvertBuffer;
+	size_t ConvertBufferSize;
+	SDL_mutex* Lock;
+	bool EndOfInput;
+	std::atomic<int> LoopPoint;
+	std::atomic<bool> Finished;
+	std::atomic<bool> Released;
+};
+
+class AudioStreamDecoder {
+private:
+	static SDL_Thread* Thread;
+	static SDL_mutex* ListLock;
+	static SDL_sem* WakeSignal;
+	static bool Running;
+	static vector<AudioDecodeStream*> Streams;
+
+	static int ThreadFunc(void* data);
+	static int Decode(AudioDecodeStream* stream, size_t count);
+	static bool Fill(AudioDecodeStream* stream, size_t targetBytes, size_t maxBytes);
+	static void Delete(AudioDecodeStream* stream);
+
+public:
+	static bool Enabled;
+	static int Lookahead;
+
+	static void Init();
+	static bool IsRunning();
+	static AudioDecodeStream* Create(SoundFormat* soundData,
+		SDL_AudioSpec format,
+		size_t bytesPerSample,
+		size_t deviceBytesPerSample);
+	static void Release(AudioDecodeStream* stream);
+	static void Seek(AudioDecodeStream* stream, int sample);
+	static size_t Read(AudioDecodeStream* stream, Uint8* buffer, size_t length);
+	static double GetPosition(AudioDecodeStream* stream);
+	static void Wake();
+	static void Dispose();
+};
+
+#endif /* ENGINE_AUDIO_AUDIOSTREAMDECODER_H */
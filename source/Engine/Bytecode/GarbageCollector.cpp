@@ -5,7 +5,9 @@
 #include <Engine/Bytecode/ScriptManager.h>
 #include <Engine/Diagnostics/Clock.h>
 #include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Profiler.h>
 #include <Engine/Scene.h>
+#include <Engine/Scene/SceneSnapshot.h>
 
 #define GC_HEAP_GROW_FACTOR 2
 
@@ -15,6 +17,7 @@ Obj* GarbageCollector::RootObject;
 size_t GarbageCollector::NextGC = 1024;
 size_t GarbageCollector::GarbageSize = 0;
 double GarbageCollector::MaxTimeAlotted = 1.0; // 1ms
+double GarbageCollector::PauseTime = 0.0;
 
 bool GarbageCollector::Print = false;
 bool GarbageCollector::FilterSweepEnabled = false;
@@ -31,6 +34,8 @@ void GarbageCollector::Collect() {
 		return;
 	}
 
+	PROFILE_ZONE("GarbageCollector::Collect");
+
 	double grayElapsed = Clock::GetTicks();
 
 	// Mark threads (should lock here for safety)
@@ -58,6 +63,19 @@ void GarbageCollector::Collect() {
 		GrayObject(scriptEntity->Instance);
 	}
 
+	// Mark snapshots
+	for (SceneSnapshot* snapshot : SceneSnapshot::List) {
+		if (!snapshot) {
+			continue;
+		}
+		for (SnapshotEntity& record : snapshot->Entities) {
+			GrayObject(record.Instance);
+		}
+		for (SnapshotField& field : snapshot->Fields) {
+			GrayValue(field.Value);
+		}
+	}
+
 	// Mark modules
 	for (size_t i = 0; i < ScriptManager::ModuleList.size(); i++) {
 		GrayObject(ScriptManager::ModuleList[i]);
@@ -114,6 +132,9 @@ void GarbageCollector::Collect() {
 	Log::Print(Log::LOG_VERBOSE, "Sweep: Blackening took %.1f ms", blackenElapsed);
 	Log::Print(Log::LOG_VERBOSE, "Sweep: Freeing took %.1f ms", freeElapsed);
 
+	// Added up until whoever is keeping track of it resets it.
+	GarbageCollector::PauseTime += grayElapsed + blackenElapsed + freeElapsed;
+
 	for (size_t i = 0; i < MAX_OBJ_TYPE; i++) {
 		if (objectTypeFreed[i] && objectTypeCounts[i]) {
 			Log::Print(Log::LOG_VERBOSE,
@@ -18,6 +18,7 @@ public:
 	static size_t NextGC;
 	static size_t GarbageSize;
 	static double MaxTimeAlotted;
+	static double PauseTime;
 	static bool Print;
 	static bool FilterSweepEnabled;
 	static int FilterSweepType;
@@ -14,6 +14,7 @@
 #include <Engine/Bytecode/Value.h>
 #include <Engine/Bytecode/ValuePrinter.h>
 #include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Profiler.h>
 #include <Engine/Filesystem/File.h>
 #include <Engine/Hashing/CombinedHash.h>
 #include <Engine/Hashing/FNV1A.h>
@@ -667,6 +668,8 @@ bool ScriptManager::CallStaticClassFunction(ObjClass* klass, const char* functio
 		return false;
 	}
 
+	PROFILE_ZONE_DETAIL("Script Event", functionName);
+
 	VMThread* thread = &ScriptManager::Threads[0];
 	VMValue* stackTop = thread->StackTop;
 	thread->RunValue(callable, 0);
@@ -683,6 +686,8 @@ bool ScriptManager::CallStaticClassFunction(ObjClass* klass, const char* functio
 		return false;
 	}
 
+	PROFILE_ZONE_DETAIL("Script Event", functionName);
+
 	VMThread* thread = &ScriptManager::Threads[0];
 	VMValue* stackTop = thread->StackTop;
 
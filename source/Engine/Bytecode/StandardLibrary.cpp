@@ -12,6 +12,8 @@
 #include <Engine/Bytecode/Value.h>
 #include <Engine/Bytecode/ValuePrinter.h>
 #include <Engine/Diagnostics/Clock.h>
+#include <Engine/Diagnostics/FrameHistory.h>
+#include <Engine/Diagnostics/Profiler.h>
 #include <Engine/Error.h>
 #include <Engine/Extensions/Discord.h>
 #include <Engine/Filesystem/Directory.h>
@@ -36,6 +38,8 @@
 #include <Engine/Network/WebSocketClient.h>
 #include <Engine/Platforms/Capability.h>
 #include <Engine/Rendering/Software/SoftwareRenderer.h>
+#include <Engine/Rendering/TextLayout.h>
+#include <Engine/ResourceTypes/AsyncLoader.h>
 #include <Engine/ResourceTypes/ImageFormats/GIF.h>
 #include <Engine/ResourceTypes/ImageFormats/PNG.h>
 #include <Engine/ResourceTypes/ResourceManager.h>
@@ -44,6 +48,7 @@
 #include <Engine/Scene.h>
 #include <Engine/Scene/SceneEnums.h>
 #include <Engine/Scene/SceneInfo.h>
+#include <Engine/Scene/SceneSnapshot.h>
 #include <Engine/Utilities/ColorUtils.h>
 #include <Engine/Utilities/StringUtils.h>
 
@@ -413,6 +418,17 @@ inline ISprite* GetSpriteIndex(int where, Uint32 threadID) {
 
 	return Scene::SpriteList[where]->AsSprite;
 }
+inline bool CheckLoadHandle(int where, Uint32 threadID) {
+	if (!AsyncLoader::Exists(where)) {
+		if (THROW_ERROR("Load handle \"%d\" does not exist.", where) == ERROR_RES_CONTINUE) {
+			ScriptManager::Threads[threadID].ReturnFromNative();
+		}
+
+		return false;
+	}
+
+	return true;
+}
 inline ISprite* GetSprite(VMValue* args, int index, Uint32 threadID) {
 	int where = GetInteger(args, index, threadID);
 	return GetSpriteIndex(where, threadID);
@@ -554,6 +570,34 @@ inline MediaBag* GetVideo(VMValue* args, int index, Uint32 threadID) {
 
 	return Scene::MediaList[where]->AsMedia;
 }
+inline TextLayout* GetTextLayout(VMValue* args, int index, Uint32 threadID) {
+	int where = GetInteger(args, index, threadID);
+	TextLayout* layout = TextLayoutCache::GetHandle(where);
+	if (!layout) {
+		if (THROW_ERROR("Text layout index \"%d\" is not valid.", where) ==
+			ERROR_RES_CONTINUE) {
+			ScriptManager::Threads[threadID].ReturnFromNative();
+		}
+
+		return NULL;
+	}
+
+	return layout;
+}
+inline SceneSnapshot* GetSceneSnapshot(VMValue* args, int index, Uint32 threadID) {
+	int where = GetInteger(args, index, threadID);
+	SceneSnapshot* snapshot = SceneSnapshot::Get(where);
+	if (!snapshot) {
+		if (THROW_ERROR("Snapshot index \"%d\" is not valid.", where) ==
+			ERROR_RES_CONTINUE) {
+			ScriptManager::Threads[threadID].ReturnFromNative();
+		}
+
+		return NULL;
+	}
+
+	return snapshot;
+}
 inline Animator* GetAnimator(VMValue* args, int index, Uint32 threadID) {
 	int where = GetInteger(args, index, threadID);
 	if (where < 0 || where >= (int)Scene::AnimatorList.size()) {
@@ -1947,6 +1991,153 @@ VMValue Application_ShowFPSCounter(int argCount, VMValue* args, Uint32 threadID)
 	Application::ShowFPS = !!GET_ARG(0, GetInteger);
 	return NULL_VAL;
 }
+/***
+ * Application.GetMemoryUsage
+ * \desc Gets how much memory the engine has allocated. This only works if memory tracking is enabled, which requires a debug build and the `trackMemory` developer setting.
+ * \return integer Returns the number of bytes currently allocated, or `0` if memory tracking is disabled.
+ * \ns Application
+ */
+VMValue Application_GetMemoryUsage(int argCount, VMValue* args, Uint32 threadID) {
+	CHECK_ARGCOUNT(0);
+	if (!Memory::IsTracking) {
+		return INTEGER_VAL(0);
+	}
+	return INTEGER_VAL((int)Memory::MemoryUsage);
+}
+/***
+ * Application.GetMemoryStats
+ * \desc Gets memory usage grouped by the name each allocation was tracked with. This only works if memory tracking is enabled, which requires a debug build and the `trackMemory` developer setting.
+ * \return map Returns a map of names to maps with the keys `liveBytes`, `peakBytes`, `liveCount`, `totalAllocations` and `frameAllocations` (the number of allocations made during the last frame), or `null` if memory tracking is disabled.
+ * \ns Application
+ */
+VMValue Application_GetMemoryStats(int argCount, VMValue* args, Uint32 threadID) {
+	CHECK_ARGCOUNT(0);
+	if (!Memory::IsTracking) {
+		return NULL_VAL;
+	}
+
+	vector<MemoryTagStats> stats = Memory::GetTagStats();
+
+	if (ScriptManager::Lock()) {
+		ObjMap* map = NewMap();
+		for (size_t i = 0; i < stats.size(); i++) {
+			MemoryTagStats& tag = stats[i];
+
+			ObjMap* tagMap = NewMap();
+			AddToMap(tagMap, "liveBytes", INTEGER_VAL((int)tag.LiveBytes));
+			AddToMap(tagMap, "peakBytes", INTEGER_VAL((int)tag.PeakBytes));
+			AddToMap(tagMap, "liveCount", INTEGER_VAL((int)tag.LiveCount));
+			AddToMap(tagMap, "totalAllocations", INTEGER_VAL((int)tag.TotalAllocations));
+			AddToMap(tagMap, "frameAllocations", INTEGER_VAL((int)tag.LastFrameAllocations));
+
+			AddToMap(map, tag.Name.c_str(), OBJECT_VAL(tagMap));
+		}
+		ScriptManager::Unlock();
+		return OBJECT_VAL(map);
+	}
+	return NULL_VAL;
+}
+/***
+ * Application.DumpMemoryStats
+ * \desc Writes the memory usage of every allocation name to a CSV file, with the names using the most memory first. This only works if memory tracking is enabled, which requires a debug build and the `trackMemory` developer setting.
+ * \param filename (string): The path of the file to write.
+ * \return boolean Returns whether the file could be written.
+ * \ns Application
+ */
+VMValue Application_DumpMemoryStats(int argCount, VMValue* args, Uint32 threadID) {
+	CHECK_ARGCOUNT(1);
+	char* filename = GET_ARG(0, GetString);
+	if (!Memory::IsTracking) {
+		return INTEGER_VAL(false);
+	}
+
+	vector<MemoryTagStats> stats = Memory::GetTagStats();
+
+	Stream* stream = FileStream::New(filename, FileStream::WRITE_ACCESS);
+	if (!stream) {
+		Log::Print(Log::LOG_ERROR, "Couldn't open \"%s\" for writing!", filename);
+		return INTEGER_VAL(false);
+	}
+
+	char line[512];
+	int length = snprintf(line,
+		sizeof line,
+		"tag,live_bytes,peak_bytes,live_count,total_allocations,last_frame_allocations\n");
+	stream->WriteBytes(line, length);
+
+	for (size_t i = 0; i < stats.size(); i++) {
+		MemoryTagStats& tag = stats[i];
+		length = snprintf(line,
+			sizeof line,
+			"\"%s\",%zu,%zu,%zu,%llu,%u\n",
+			tag.Name.c_str(),
+			tag.LiveBytes,
+			tag.PeakBytes,
+			tag.LiveCount,
+			(unsigned long long)tag.TotalAllocations,
+			tag.LastFrameAllocations);
+		if (length > 0) {
+			stream->WriteBytes(line, std::min((size_t)length, sizeof line - 1));
+		}
+	}
+
+	stream->Close();
+	return INTEGER_VAL(true);
+}
+/***
+ * Application.GetFrameStats
+ * \desc Gets frame time statistics, in milliseconds. The percentiles of the whole run are accurate to within 0.1 milliseconds; the ones of the recent frames are exact.
+ * \paramOpt recent (boolean): Whether to only count the frames still in the frame history (see the <code>frameHistory</code> performance setting), rather than every frame since the game started. (default: <code>false</code>)
+ * \return map Returns a map with the keys <code>frames</code>, <code>average</code>, <code>p50</code>, <code>p95</code>, <code>p99</code>, <code>max</code> and <code>spikes</code>.
+ * \ns Application
+ */
+VMValue Application_GetFrameStats(int argCount, VMValue* args, Uint32 threadID) {
+	CHECK_AT_LEAST_ARGCOUNT(0);
+	bool recent = !!GET_ARG_OPT(0, GetInteger, false);
+
+	FrameStats stats = recent ? FrameHistory::GetRecentStats() : FrameHistory::GetRunStats();
+
+	if (ScriptManager::Lock()) {
+		ObjMap* map = NewMap();
+		AddToMap(map, "frames", INTEGER_VAL((int)stats.Frames));
+		AddToMap(map, "average", DECIMAL_VAL((float)stats.Average));
+		AddToMap(map, "p50", DECIMAL_VAL((float)stats.P50));
+		AddToMap(map, "p95", DECIMAL_VAL((float)stats.P95));
+		AddToMap(map, "p99", DECIMAL_VAL((float)stats.P99));
+		AddToMap(map, "max", DECIMAL_VAL((float)stats.Max));
+		AddToMap(map, "spikes", INTEGER_VAL((int)FrameHistory::SpikeCount));
+		ScriptManager::Unlock();
+		return OBJECT_VAL(map);
+	}
+	return NULL_VAL;
+}
+/***
+ * Application.SetFrameBudget
+ * \desc Sets how long a frame may take before the frames around it are written to a file next to the log file. Only one such file is written every few seconds (see the <code>spikeCooldown</code> performance setting).
+ * \param budget (decimal): The frame budget, in milliseconds, or <code>0</code> to turn this off.
+ * \ns Application
+ */
+VMValue Application_SetFrameBudget(int argCount, VMValue* args, Uint32 threadID) {
+	CHECK_ARGCOUNT(1);
+	FrameHistory::SpikeBudget = GET_ARG(0, GetDecimal);
+	return NULL_VAL;
+}
+/***
+ * Application.CaptureProfile
+ * \desc Records a timeline of what the engine does over the next few frames, and writes it to a file in the Chrome Trace Event format, which can be opened in Perfetto or <code>chrome://tracing</code>. This only works if the engine was built with the profiler enabled.
+ * \param frameCount (integer): How many frames to record.
+ * \param filename (string): The path of the file to write once the capture is done.
+ * \paramOpt delay (integer): How many frames to wait before recording. (default: <code>0</code>)
+ * \return boolean Returns whether the capture was started.
+ * \ns Application
+ */
+VMValue Application_CaptureProfile(int argCount, VMValue* args, Uint32 threadID) {
+	CHECK_AT_LEAST_ARGCOUNT(2);
+	int frameCount = GET_ARG(0, GetInteger);
+	char* filename = GET_ARG(1, GetString);
+	int delay = GET_ARG_OPT(2, GetInteger, 0);
+	return INTEGER_VAL(Profiler::StartCapture(delay, frameCount, filename));
+}
 /***
  * Application.GetKeyBind
  * \desc Gets a keybind.
@@ -4985,6 +5176,120 @@ VMValue Draw_TextEllipsis(int argCount, VMValue* args, Uint32 threadID) {
 
 	return NULL_VAL;
 }
+/***
+ * Draw.CreateTextLayout
+ * \desc Lays out UTF-8 text using a font, and keeps the layout until it's deleted. Drawing a layout is faster than drawing the text it was created from, which helps with text that doesn't change often.
+ * \param font (Font): The Font to be used as text.
+ * \param text (string): Text to lay out.
+ * \paramOpt maxWidth (number): Max width that a line can be. Use `null` to not wrap the text.
+ * \paramOpt maxLines (integer): Max number of lines to lay out. Use `null` to lay out all lines.
+ * \paramOpt fontSize (number): The size of the font. If this argument is not given, this uses the pixels per unit value that the font was configured with.
+ * \paramOpt ellipsis (boolean): Whether to add ellipsis if the text doesn't fit in <param maxWidth>. (default: `false`)
+ * \return integer Returns the index of the text layout.
+ * \ns Draw
+ */
+VMValue Draw_CreateTextLayout(int argCount, VMValue* args, Uint32 threadID) {
+	CHECK_AT_LEAST_ARGCOUNT(2);
+
+	ObjFont* objFont = GET_ARG(0, GetFont);
+	char* text = GET_ARG(1, GetString);
+	bool wrapped = argCount > 2 && !IS_NULL(args[2]);
+	float maxWidth = wrapped ? GET_ARG(2, GetDecimal) : 0.0f;
+	int maxLines = 0;
+	if (argCount > 3 && !IS_NULL(args[3])) {
+		maxLines = GET_ARG(3, GetInteger);
+	}
+	float fontSize = GET_ARG_OPT(4, GetDecimal, 0.0f);
+	bool ellipsis = !!GET_ARG_OPT(5, GetInteger, false);
+
+	if (!objFont) {
+		return NULL_VAL;
+	}
+
+	Font* font = (Font*)objFont->FontPtr;
+
+	if (argCount < 5 || IS_NULL(args[4])) {
+		fontSize = font->Size;
+	}
+
+	TextDrawParams params;
+	params.FontSize = fontSize;
+	params.Ascent = font->Ascent;
+	params.Descent = font->Descent;
+	params.Leading = font->Leading;
+	params.MaxWidth = maxWidth;
+	params.MaxLines = maxLines;
+	if (ellipsis) {
+		params.Flags |= TEXTDRAW_ELLIPSIS;
+	}
+
+	return INTEGER_VAL(TextLayoutCache::Create(font, text, &params, wrapped));
+}
+/***
+ * Draw.TextLayout
+ * \desc Draws a text layout.
+ * \param layout (integer): The index of the text layout.
+ * \param x (number): X position of where to draw the text.
+ * \param y (number): Y position of where to draw the text.
+ * \paramOpt paletteID (integer): Which palette index to use. (default: `0`)
+ * \ns Draw
+ */
+VMValue Draw_TextLayout(int argCount, VMValue* args, Uint32 threadID) {
+	CHECK_AT_LEAST_ARGCOUNT(3);
+
+	TextLayout* layout = GetTextLayout(args, 0, threadID);
+	float x = GET_ARG(1, GetDecimal);
+	float y = GET_ARG(2, GetDecimal);
+	int paletteID = GET_ARG_OPT(3, GetInteger, 0);
+
+	CHECK_PALETTE_INDEX(paletteID);
+
+	if (layout) {
+		layout->Draw(x, y, paletteID);
+	}
+
+	return NULL_VAL;
+}
+/***
+ * Draw.MeasureTextLayout
+ * \desc Stores the max width and max height of a text layout into the array.
+ * \param outArray (array): Array to output size values to.
+ * \param layout (integer): The index of the text layout.
+ * \return array Returns the array inputted into the function.
+ * \ns Draw
+ */
+VMValue Draw_MeasureTextLayout(int argCount, VMValue* args, Uint32 threadID) {
+	CHECK_ARGCOUNT(2);
+
+	ObjArray* array = GET_ARG(0, GetArray);
+	TextLayout* layout = GetTextLayout(args, 1, threadID);
+	if (!layout) {
+		return NULL_VAL;
+	}
+
+	if (ScriptManager::Lock()) {
+		array->Values->clear();
+		array->Values->push_back(DECIMAL_VAL(layout->Width));
+		array->Values->push_back(DECIMAL_VAL(layout->Height));
+		ScriptManager::Unlock();
+		return OBJECT_VAL(array);
+	}
+	return NULL_VAL;
+}
+/***
+ * Draw.DeleteTextLayout
+ * \desc Deletes a text layout.
+ * \param layout (integer): The index of the text layout.
+ * \ns Draw
+ */
+VMValue Draw_DeleteTextLayout(int argCount, VMValue* args, Uint32 threadID) {
+	CHECK_ARGCOUNT(1);
+	int index = GET_ARG(0, GetInteger);
+	if (GetTextLayout(args, 0, threadID)) {
+		TextLayoutCache::Delete(index);
+	}
+	return NULL_VAL;
+}
 /***
  * Draw.Glyph
  * \desc Draws a glyph for a given code point.
@@ -11895,11 +12200,7 @@ VMValue Music_StopWithFadeOut(int argCount, VMValue* args, Uint32 threadID) {
  */
 VMValue Music_Pause(int argCount, VMValue* args, Uint32 threadID) {
 	CHECK_ARGCOUNT(0);
-	AudioManager::Lock();
-	if (AudioManager::MusicStack.size() > 0) {
-		AudioManager::MusicStack[0]->Paused = true;
-	}
-	AudioManager::Unlock();
+	AudioManager::PauseMusic();
 	return NULL_VAL;
 }
 /***
@@ -11910,11 +12211,7 @@ VMValue Music_Pause(int argCount, VMValue* args, Uint32 threadID) {
  */
 VMValue Music_Resume(int argCount, VMValue* args, Uint32 threadID) {
 	CHECK_ARGCOUNT(0);
-	AudioManager::Lock();
-	if (AudioManager::MusicStack.size() > 0) {
-		AudioManager::MusicStack[0]->Paused = false;
-	}
-	AudioManager::Unlock();
+	AudioManager::ResumeMusic();
 	return NULL_VAL;
 }
 /***
@@ -12929,6 +13226,164 @@ VMValue Resources_LoadVideo(int argCount, VMValue* args, Uint32 threadID) {
 
 	return INTEGER_VAL(result);
 }
+/***
+ * Resources.LoadImageAsync
+ * \desc Starts loading an Image resource in the background. Reading and decoding the file happens on another thread, while creating its texture happens on the main thread; the resource is added to the Image list at the start of a later frame.
+ * \param filename (string): Filename of the resource.
+ * \param unloadPolicy (integer): Whether to unload the resource at the end of the current Scene, or the game end.
+ * \return integer Returns a load handle, which can be given to <ref Resources.IsLoadComplete>, <ref Resources.GetLoadResult> or <ref Resources.WaitForLoad>.
+ * \ns Resources
+ */
+VMValue Resources_LoadImageAsync(int argCount, VMValue* args, Uint32 threadID) {
+	CHECK_ARGCOUNT(2);
+	char* filename = GET_ARG(0, GetString);
+	int unloadPolicy = GET_ARG(1, GetInteger);
+
+	return INTEGER_VAL(AsyncLoader::Load(ASYNC_LOAD_IMAGE, filename, unloadPolicy));
+}
+/***
+ * Resources.LoadModelAsync
+ * \desc Starts loading a Model resource in the background. Reading the file happens on another thread, while parsing it happens on the main thread; the resource is added to the Model list at the start of a later frame.
+ * \param filename (string): Filename of the resource.
+ * \param unloadPolicy (integer): Whether to unload the resource at the end of the current Scene, or the game end.
+ * \return integer Returns a load handle, which can be given to <ref Resources.IsLoadComplete>, <ref Resources.GetLoadResult> or <ref Resources.WaitForLoad>.
+ * \ns Resources
+ */
+VMValue Resources_LoadModelAsync(int argCount, VMValue* args, Uint32 threadID) {
+	CHECK_ARGCOUNT(2);
+	char* filename = GET_ARG(0, GetString);
+	int unloadPolicy = GET_ARG(1, GetInteger);
+
+	return INTEGER_VAL(AsyncLoader::Load(ASYNC_LOAD_MODEL, filename, unloadPolicy));
+}
+/***
+ * Resources.LoadMusicAsync
+ * \desc Starts loading a Music resource in the background. Reading and decoding the file happens on another thread; the resource is added to the Music list at the start of a later frame.
+ * \param filename (string): Filename of the resource.
+ * \param unloadPolicy (integer): Whether to unload the resource at the end of the current Scene, or the game end.
+ * \return integer Returns a load handle, which can be given to <ref Resources.IsLoadComplete>, <ref Resources.GetLoadResult> or <ref Resources.WaitForLoad>.
+ * \ns Resources
+ */
+VMValue Resources_LoadMusicAsync(int argCount, VMValue* args, Uint32 threadID) {
+	CHECK_ARGCOUNT(2);
+	char* filename = GET_ARG(0, GetString);
+	int unloadPolicy = GET_ARG(1, GetInteger);
+
+	return INTEGER_VAL(AsyncLoader::Load(ASYNC_LOAD_MUSIC, filename, unloadPolicy));
+}
+/***
+ * Resources.LoadSoundAsync
+ * \desc Starts loading a Sound resource in the background. Reading and decoding the file happens on another thread; the resource is added to the Sound list at the start of a later frame.
+ * \param filename (string): Filename of the resource.
+ * \param unloadPolicy (integer): Whether to unload the resource at the end of the current Scene, or the game end.
+ * \return integer Returns a load handle, which can be given to <ref Resources.IsLoadComplete>, <ref Resources.GetLoadResult> or <ref Resources.WaitForLoad>.
+ * \ns Resources
+ */
+VMValue Resources_LoadSoundAsync(int argCount, VMValue* args, Uint32 threadID) {
+	CHECK_ARGCOUNT(2);
+	char* filename = GET_ARG(0, GetString);
+	int unloadPolicy = GET_ARG(1, GetInteger);
+
+	return INTEGER_VAL(AsyncLoader::Load(ASYNC_LOAD_SOUND, filename, unloadPolicy));
+}
+/***
+ * Resources.LoadSpriteAsync
+ * \desc Starts loading a Sprite resource in the background. Reading and decoding the file happens on another thread, while creating its textures happens on the main thread; the resource is added to the Sprite list at the start of a later frame.
+ * \param filename (string): Filename of the resource.
+ * \param unloadPolicy (integer): Whether to unload the resource at the end of the current Scene, or the game end.
+ * \return integer Returns a load handle, which can be given to <ref Resources.IsLoadComplete>, <ref Resources.GetLoadResult> or <ref Resources.WaitForLoad>.
+ * \ns Resources
+ */
+VMValue Resources_LoadSpriteAsync(int argCount, VMValue* args, Uint32 threadID) {
+	CHECK_ARGCOUNT(2);
+	char* filename = GET_ARG(0, GetString);
+	int unloadPolicy = GET_ARG(1, GetInteger);
+
+	return INTEGER_VAL(AsyncLoader::Load(ASYNC_LOAD_SPRITE, filename, unloadPolicy));
+}
+/***
+ * Resources.IsLoadComplete
+ * \desc Checks if a background load has finished, whether it succeeded or not.
+ * \param handle (integer): The load handle.
+ * \return boolean Returns whether the load has finished.
+ * \ns Resources
+ */
+VMValue Resources_IsLoadComplete(int argCount, VMValue* args, Uint32 threadID) {
+	CHECK_ARGCOUNT(1);
+	int handle = GET_ARG(0, GetInteger);
+	if (!CheckLoadHandle(handle, threadID)) {
+		return NULL_VAL;
+	}
+
+	return INTEGER_VAL(AsyncLoader::IsComplete(handle));
+}
+/***
+ * Resources.GetLoadResult
+ * \desc Gets the result of a background load.
+ * \param handle (integer): The load handle.
+ * \return integer Returns the index of the Resource, `-1` if it could not be loaded or has been unloaded since, or `null` if it hasn't finished loading.
+ * \ns Resources
+ */
+VMValue Resources_GetLoadResult(int argCount, VMValue* args, Uint32 threadID) {
+	CHECK_ARGCOUNT(1);
+	int handle = GET_ARG(0, GetInteger);
+	if (!CheckLoadHandle(handle, threadID) || !AsyncLoader::IsComplete(handle)) {
+		return NULL_VAL;
+	}
+
+	return INTEGER_VAL(AsyncLoader::GetResult(handle));
+}
+/***
+ * Resources.WaitForLoad
+ * \desc Blocks until a background load has finished.
+ * \param handle (integer): The load handle.
+ * \return integer Returns the index of the Resource, or `-1` if it could not be loaded or has been unloaded since.
+ * \ns Resources
+ */
+VMValue Resources_WaitForLoad(int argCount, VMValue* args, Uint32 threadID) {
+	CHECK_ARGCOUNT(1);
+	int handle = GET_ARG(0, GetInteger);
+	if (!CheckLoadHandle(handle, threadID)) {
+		return NULL_VAL;
+	}
+
+	return INTEGER_VAL(AsyncLoader::Wait(handle));
+}
+/***
+ * Resources.GetLoadProgress
+ * \desc Gets how far along the background loads are. Once every load has finished, this starts over for the next ones.
+ * \return decimal Returns a value between `0.0` and `1.0`.
+ * \ns Resources
+ */
+VMValue Resources_GetLoadProgress(int argCount, VMValue* args, Uint32 threadID) {
+	CHECK_ARGCOUNT(0);
+	return DECIMAL_VAL(AsyncLoader::GetProgress());
+}
+/***
+ * Resources.GetPendingLoadCount
+ * \desc Gets how many background loads haven't finished yet.
+ * \return integer Returns the number of pending loads.
+ * \ns Resources
+ */
+VMValue Resources_GetPendingLoadCount(int argCount, VMValue* args, Uint32 threadID) {
+	CHECK_ARGCOUNT(0);
+	return INTEGER_VAL(AsyncLoader::GetPendingCount());
+}
+/***
+ * Resources.SetLoadBudget
+ * \desc Sets how long the main thread may spend per frame finishing background loads. At least one load is always finished per frame, if there are any.
+ * \param milliseconds (decimal): The time budget, in milliseconds. The default is 4.
+ * \ns Resources
+ */
+VMValue Resources_SetLoadBudget(int argCount, VMValue* args, Uint32 threadID) {
+	CHECK_ARGCOUNT(1);
+	float budget = GET_ARG(0, GetDecimal);
+	if (budget < 0.0f) {
+		budget = 0.0f;
+	}
+	AsyncLoader::FinalizeBudget = budget;
+	return NULL_VAL;
+}
 /***
  * Resources.FileExists
  * \desc Checks to see if a Resource exists with the given filename.
@@ -13138,6 +13593,60 @@ VMValue Scene_Restart(int argCount, VMValue* args, Uint32 threadID) {
 	Scene::DoRestart = true;
 	return NULL_VAL;
 }
+/***
+ * Scene.SaveSnapshot
+ * \desc Takes a snapshot of the scene's entities, their fields and the lists they are in, the tiles that were changed, the scene's timers, and the state of the random number generators. Objects stored in fields (such as arrays and maps) are kept by reference, not copied. Snapshots are deleted when the scene changes.
+ * \paramOpt snapshot (integer): The index of an existing snapshot to overwrite. This reuses its memory.
+ * \return integer Returns the index of the snapshot.
+ * \ns Scene
+ */
+VMValue Scene_SaveSnapshot(int argCount, VMValue* args, Uint32 threadID) {
+	CHECK_AT_LEAST_ARGCOUNT(0);
+	int index = GET_ARG_OPT(0, GetInteger, -1);
+	return INTEGER_VAL(SceneSnapshot::Save(index));
+}
+/***
+ * Scene.RestoreSnapshot
+ * \desc Puts the scene back into the state it was in when the snapshot was taken. This happens at the end of the current frame. Entities that still exist are restored in place; entities that were created after the snapshot was taken are removed without calling their Dispose event, and entities that were removed are created again.
+ * \param snapshot (integer): The index of the snapshot.
+ * \ns Scene
+ */
+VMValue Scene_RestoreSnapshot(int argCount, VMValue* args, Uint32 threadID) {
+	CHECK_ARGCOUNT(1);
+	if (GetSceneSnapshot(args, 0, threadID)) {
+		SceneSnapshot::PendingRestore = GET_ARG(0, GetInteger);
+	}
+	return NULL_VAL;
+}
+/***
+ * Scene.DeleteSnapshot
+ * \desc Deletes a snapshot.
+ * \param snapshot (integer): The index of the snapshot.
+ * \ns Scene
+ */
+VMValue Scene_DeleteSnapshot(int argCount, VMValue* args, Uint32 threadID) {
+	CHECK_ARGCOUNT(1);
+	int index = GET_ARG(0, GetInteger);
+	if (GetSceneSnapshot(args, 0, threadID)) {
+		SceneSnapshot::Delete(index);
+	}
+	return NULL_VAL;
+}
+/***
+ * Scene.GetSnapshotSize
+ * \desc Gets how much memory a snapshot uses.
+ * \param snapshot (integer): The index of the snapshot.
+ * \return integer Returns the size of the snapshot in bytes.
+ * \ns Scene
+ */
+VMValue Scene_GetSnapshotSize(int argCount, VMValue* args, Uint32 threadID) {
+	CHECK_ARGCOUNT(1);
+	SceneSnapshot* snapshot = GetSceneSnapshot(args, 0, threadID);
+	if (!snapshot) {
+		return INTEGER_VAL(0);
+	}
+	return INTEGER_VAL((int)snapshot->GetSize());
+}
 /***
  * Scene.PropertyExists
  * \desc Checks if a property exists.
@@ -14757,6 +15266,26 @@ VMValue Scene_SetLayerUsePaletteIndexLines(int argCount, VMValue* args, Uint32 t
 	Scene::Layers[index]->UsePaletteIndexLines = usePaletteIndexLines;
 	return NULL_VAL;
 }
+/***
+ * Scene.SetLayerUseChunkCache
+ * \desc Enables or disables the chunk cache for the specified layer. When enabled, the software renderer draws the layer from pre-rendered chunks that are only rebuilt when their tiles, tile animations or palettes change. Layers that use the global palette index table or a custom scanline function are drawn normally.
+ * \param layerIndex (integer): Index of layer.
+ * \param useChunkCache (boolean): Whether the layer uses the chunk cache.
+ * \ns Scene
+ */
+VMValue Scene_SetLayerUseChunkCache(int argCount, VMValue* args, Uint32 threadID) {
+	CHECK_ARGCOUNT(2);
+	int index = GET_ARG(0, GetInteger);
+	int useChunkCache = !!GET_ARG(1, GetInteger);
+	CHECK_SCENE_LAYER_INDEX(index);
+	CHECK_IS_TILE_LAYER(index);
+	TileLayer* layer = (TileLayer*)Scene::Layers[index];
+	if (!useChunkCache) {
+		layer->DeleteTileChunks();
+	}
+	layer->UseChunkCache = useChunkCache;
+	return NULL_VAL;
+}
 /***
  * Scene.SetLayerScroll
  * \desc Sets the scroll values of the layer. (Horizontal Parallax = Up/Down values, Vertical Parallax = Left/Right values)
@@ -18841,11 +19370,16 @@ int _Thread_RunEvent(void* op) {
 	//     return 0;
 	// }
 
+	PROFILE_THREAD("Script Thread");
+
 	thread->Push(callbackVal);
 	for (int i = 0; i < bundle->ArgCount; i++) {
 		thread->Push(args[i]);
 	}
+
+	PROFILE_BEGIN("Thread.RunEvent");
 	thread->RunValue(callbackVal, bundle->ArgCount);
+	PROFILE_END();
 
 	free(bundle);
 
@@ -19747,6 +20281,34 @@ VMValue View_SetUseSoftwareRenderer(int argCount, VMValue* args, Uint32 threadID
 	Scene::Views[view_index].Software = !!usedswrend;
 	return NULL_VAL;
 }
+/***
+ * View.IsUsingIndexedFramebuffer
+ * \desc Gets whether the specified camera renders into an indexed framebuffer.
+ * \param viewIndex (integer): Index of the view.
+ * \return boolean Returns a boolean value.
+ * \ns View
+ */
+VMValue View_IsUsingIndexedFramebuffer(int argCount, VMValue* args, Uint32 threadID) {
+	CHECK_ARGCOUNT(1);
+	int view_index = GET_ARG(0, GetInteger);
+	CHECK_VIEW_INDEX();
+	return INTEGER_VAL((int)Scene::Views[view_index].UseIndexedFramebuffer);
+}
+/***
+ * View.SetUseIndexedFramebuffer
+ * \desc Sets the specified camera to render into an 8-bit indexed framebuffer, which is converted to colors once the view is done rendering. Only has an effect on views using the software renderer while palettes are enabled. Sprites and tile layers using indexed textures are drawn into it directly; other drawing operations are drawn on top of it.
+ * \param viewIndex (integer): Index of the view.
+ * \param useIndexedFramebuffer (boolean): Whether to use an indexed framebuffer.
+ * \ns View
+ */
+VMValue View_SetUseIndexedFramebuffer(int argCount, VMValue* args, Uint32 threadID) {
+	CHECK_ARGCOUNT(2);
+	int view_index = GET_ARG(0, GetInteger);
+	int useIndexed = GET_ARG(1, GetInteger);
+	CHECK_VIEW_INDEX();
+	Scene::Views[view_index].SetIndexedFramebufferEnabled(!!useIndexed);
+	return NULL_VAL;
+}
 /***
  * View.SetUsePerspective
  * \desc
@@ -20479,6 +21041,12 @@ They require the Game SDK library to be present.
 	DEF_NATIVE(Application, UseFixedTimestep);
 	DEF_NATIVE(Application, GetFPS);
 	DEF_NATIVE(Application, ShowFPSCounter);
+	DEF_NATIVE(Application, GetMemoryUsage);
+	DEF_NATIVE(Application, GetMemoryStats);
+	DEF_NATIVE(Application, DumpMemoryStats);
+	DEF_NATIVE(Application, CaptureProfile);
+	DEF_NATIVE(Application, GetFrameStats);
+	DEF_NATIVE(Application, SetFrameBudget);
 	DEF_NATIVE(Application, GetKeyBind);
 	DEF_NATIVE(Application, SetKeyBind);
 	DEF_NATIVE(Application, GetGameTitle);
@@ -21096,6 +21664,10 @@ Draw provides functions to draw images, sprites, and textures; as well as primit
 	DEF_NATIVE(Draw, Text);
 	DEF_NATIVE(Draw, TextWrapped);
 	DEF_NATIVE(Draw, TextEllipsis);
+	DEF_NATIVE(Draw, CreateTextLayout);
+	DEF_NATIVE(Draw, TextLayout);
+	DEF_NATIVE(Draw, MeasureTextLayout);
+	DEF_NATIVE(Draw, DeleteTextLayout);
 	DEF_NATIVE(Draw, Glyph);
 	DEF_NATIVE(Draw, TextArray);
 	DEF_NATIVE(Draw, SetBlendColor);
@@ -22070,6 +22642,17 @@ This is preferred over <ref Math>'s random functions if you require consistency,
 	DEF_NATIVE(Resources, LoadMusic);
 	DEF_NATIVE(Resources, LoadSound);
 	DEF_NATIVE(Resources, LoadVideo);
+	DEF_NATIVE(Resources, LoadImageAsync);
+	DEF_NATIVE(Resources, LoadModelAsync);
+	DEF_NATIVE(Resources, LoadMusicAsync);
+	DEF_NATIVE(Resources, LoadSoundAsync);
+	DEF_NATIVE(Resources, LoadSpriteAsync);
+	DEF_NATIVE(Resources, IsLoadComplete);
+	DEF_NATIVE(Resources, GetLoadResult);
+	DEF_NATIVE(Resources, WaitForLoad);
+	DEF_NATIVE(Resources, GetLoadProgress);
+	DEF_NATIVE(Resources, GetPendingLoadCount);
+	DEF_NATIVE(Resources, SetLoadBudget);
 	DEF_NATIVE(Resources, FileExists);
 	DEF_NATIVE(Resources, ReadAllText);
 
@@ -22104,6 +22687,10 @@ Some layer-related functions can only be used with layers of type <ref LAYERTYPE
 	DEF_NATIVE(Scene, AreTileCollisionsLoaded);
 	DEF_NATIVE(Scene, AddTileset);
 	DEF_NATIVE(Scene, Restart);
+	DEF_NATIVE(Scene, SaveSnapshot);
+	DEF_NATIVE(Scene, RestoreSnapshot);
+	DEF_NATIVE(Scene, DeleteSnapshot);
+	DEF_NATIVE(Scene, GetSnapshotSize);
 	DEF_NATIVE(Scene, PropertyExists);
 	DEF_NATIVE(Scene, GetProperty);
 	DEF_NATIVE(Scene, GetLayerCount);
@@ -22198,6 +22785,7 @@ Some layer-related functions can only be used with layers of type <ref LAYERTYPE
 	DEF_NATIVE(Scene, SetLayerOpacity);
 	DEF_NATIVE(Scene, SetLayerShader);
 	DEF_NATIVE(Scene, SetLayerUsePaletteIndexLines);
+	DEF_NATIVE(Scene, SetLayerUseChunkCache);
 	DEF_NATIVE(Scene, SetLayerScroll);
 	DEF_NATIVE(Scene, SetLayerHorizontalParallaxFactor);
 	DEF_NATIVE(Scene, SetLayerVerticalParallaxFactor);
@@ -22777,6 +23365,8 @@ Some layer-related functions can only be used with layers of type <ref LAYERTYPE
 	DEF_NATIVE(View, GetShader);
 	DEF_NATIVE(View, IsUsingSoftwareRenderer);
 	DEF_NATIVE(View, SetUseSoftwareRenderer);
+	DEF_NATIVE(View, IsUsingIndexedFramebuffer);
+	DEF_NATIVE(View, SetUseIndexedFramebuffer);
 	DEF_NATIVE(View, SetUsePerspective);
 	DEF_NATIVE(View, IsEnabled);
 	DEF_NATIVE(View, SetEnabled);
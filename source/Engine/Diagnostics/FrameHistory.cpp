@@ -0,0 +1,358 @@
+#include <Engine/Diagnostics/FrameHistory.h>
+
+#include <Engine/Application.h>
+#include <Engine/Bytecode/GarbageCollector.h>
+#include <Engine/Diagnostics/Clock.h>
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Memory.h>
+#include <Engine/Filesystem/Path.h>
+#include <Engine/IO/FileStream.h>
+#include <Engine/Scene.h>
+
+vector<FrameRecord> FrameHistory::Records;
+size_t FrameHistory::NextRecord = 0;
+size_t FrameHistory::RecordCount = 0;
+Uint32 FrameHistory::FrameCounter = 0;
+
+Uint32 FrameHistory::Buckets[FRAME_HISTORY_BUCKET_COUNT];
+double FrameHistory::BucketMax[FRAME_HISTORY_BUCKET_COUNT];
+Uint32 FrameHistory::TotalFrames = 0;
+double FrameHistory::TotalTime = 0.0;
+double FrameHistory::MaxTime = 0.0;
+
+int FrameHistory::SpikeFramesLeft = 0;
+Uint32 FrameHistory::SpikeFrame = 0;
+double FrameHistory::SpikeTime = 0.0;
+double FrameHistory::LastSpikeDumpTime = -1.0;
+
+double FrameHistory::SpikeBudget = 0.0;
+int FrameHistory::SpikeFrames = FRAME_HISTORY_DEFAULT_SPIKE_FRAMES;
+double FrameHistory::SpikeCooldown = 5000.0;
+Uint32 FrameHistory::SpikeCount = 0;
+
+// Keeps the last `length` frames. The ring always has room for the frames on
+// both sides of a spike.
+void FrameHistory::Init(size_t length) {
+	if (SpikeFrames < 0) {
+		SpikeFrames = 0;
+	}
+
+	size_t minimum = (size_t)SpikeFrames * 2 + 1;
+	if (length < minimum) {
+		length = minimum;
+	}
+	if (Records.size() == length) {
+		return;
+	}
+
+	Records.assign(length, FrameRecord());
+	NextRecord = 0;
+	RecordCount = 0;
+	SpikeFramesLeft = 0;
+}
+
+// Returns the record from `age` frames ago, where 0 is the latest one.
+FrameRecord* FrameHistory::GetRecord(size_t age) {
+	if (age >= RecordCount) {
+		return nullptr;
+	}
+
+	size_t length = Records.size();
+	return &Records[(NextRecord + length - 1 - age) % length];
+}
+
+// Called once a frame is done. This is only a copy of some counters, unless
+// a spike has to be written out.
+void FrameHistory::Record() {
+	if (Records.empty()) {
+		Init(FRAME_HISTORY_DEFAULT_LENGTH);
+	}
+
+	FrameRecord& record = Records[NextRecord];
+	record.Frame = ++FrameCounter;
+	record.Time = Clock::GetTicks();
+	record.FrameTime = Application::Metrics.Frame.Time;
+
+	size_t numPhases = Application::AllMetrics.size();
+	for (size_t i = 0; i < FRAME_HISTORY_MAX_PHASES; i++) {
+		record.PhaseTimes[i] = i < numPhases ? Application::AllMetrics[i]->Time : 0.0;
+	}
+
+	record.GCTime = GarbageCollector::PauseTime;
+	GarbageCollector::PauseTime = 0.0;
+
+	record.Allocations = Memory::GetFrameAllocationCount();
+	record.MemoryUsage = Memory::MemoryUsage;
+	record.EntityCount = Scene::ObjectCount;
+
+	NextRecord = (NextRecord + 1) % Records.size();
+	if (RecordCount < Records.size()) {
+		RecordCount++;
+	}
+
+	int bucket = (int)(record.FrameTime / FRAME_HISTORY_BUCKET_WIDTH);
+	if (bucket >= FRAME_HISTORY_BUCKET_COUNT) {
+		bucket = FRAME_HISTORY_BUCKET_COUNT - 1;
+	}
+	else if (bucket < 0) {
+		bucket = 0;
+	}
+	Buckets[bucket]++;
+	if (record.FrameTime > BucketMax[bucket]) {
+		BucketMax[bucket] = record.FrameTime;
+	}
+	TotalFrames++;
+	TotalTime += record.FrameTime;
+	if (record.FrameTime > MaxTime) {
+		MaxTime = record.FrameTime;
+	}
+
+	bool isSpike = SpikeBudget > 0.0 && record.FrameTime > SpikeBudget;
+	if (isSpike) {
+		SpikeCount++;
+	}
+
+	// Spikes that happen while the frames after one are being waited on end
+	// up in the same file.
+	if (SpikeFramesLeft > 0) {
+		if (--SpikeFramesLeft == 0) {
+			DumpSpike();
+		}
+	}
+	else if (isSpike &&
+		(LastSpikeDumpTime < 0.0 || record.Time - LastSpikeDumpTime >= SpikeCooldown)) {
+		SpikeFrame = record.Frame;
+		SpikeTime = record.FrameTime;
+		SpikeFramesLeft = SpikeFrames;
+		if (SpikeFramesLeft == 0) {
+			DumpSpike();
+		}
+	}
+}
+
+void FrameHistory::DumpSpike() {
+	LastSpikeDumpTime = Clock::GetTicks();
+
+	const char* identifier = Application::GetGameIdentifier();
+	if (identifier == nullptr) {
+		identifier = "hatch";
+	}
+
+	time_t timeInfo;
+	time(&timeInfo);
+
+	char timeString[64];
+	strftime(timeString, sizeof timeString, "%Y-%m-%d-%H-%M-%S", localtime(&timeInfo));
+
+	char filename[MAX_FILENAME_LENGTH];
+	snprintf(filename,
+		sizeof filename,
+		"%s-spike-%s-%u.csv",
+		identifier,
+		timeString,
+		SpikeFrame);
+
+	std::string path;
+	if (!Path::FromLocation(filename, PathLocation::LOGFILE, path, true, false) ||
+		path.size() == 0) {
+		path = filename;
+	}
+
+	size_t count = (size_t)SpikeFrames * 2 + 1;
+	if (DumpFrames(path.c_str(), count)) {
+		Log::Print(Log::LOG_WARN,
+			"Frame %u took %.3f ms (budget %.3f ms); wrote the frames around it to \"%s\".",
+			SpikeFrame,
+			SpikeTime,
+			SpikeBudget,
+			path.c_str());
+	}
+}
+
+// Writes the last `count` frames to a CSV file, oldest first.
+bool FrameHistory::DumpFrames(const char* filename, size_t count) {
+	if (count > RecordCount) {
+		count = RecordCount;
+	}
+
+	Stream* stream = FileStream::New(filename, FileStream::WRITE_ACCESS);
+	if (!stream) {
+		Log::Print(Log::LOG_ERROR, "Couldn't open \"%s\" for writing!", filename);
+		return false;
+	}
+
+	size_t numPhases = Application::AllMetrics.size();
+	if (numPhases > FRAME_HISTORY_MAX_PHASES) {
+		numPhases = FRAME_HISTORY_MAX_PHASES;
+	}
+
+	std::string out = "frame,time_ms,frame_ms";
+	for (size_t i = 0; i < numPhases; i++) {
+		const char* name = Application::AllMetrics[i]->Name;
+		out += ",\"";
+		out += name ? name : "";
+		out += "\"";
+	}
+	out += ",gc_ms,allocations,memory_bytes,entities,over_budget\n";
+
+	char line[64];
+	for (size_t age = count; age-- > 0;) {
+		FrameRecord* record = GetRecord(age);
+
+		snprintf(line,
+			sizeof line,
+			"%u,%.3f,%.3f",
+			record->Frame,
+			record->Time,
+			record->FrameTime);
+		out += line;
+
+		for (size_t i = 0; i < numPhases; i++) {
+			snprintf(line, sizeof line, ",%.3f", record->PhaseTimes[i]);
+			out += line;
+		}
+
+		snprintf(line,
+			sizeof line,
+			",%.3f,%u,%zu,%d,%d\n",
+			record->GCTime,
+			record->Allocations,
+			record->MemoryUsage,
+			record->EntityCount,
+			SpikeBudget > 0.0 && record->FrameTime > SpikeBudget);
+		out += line;
+	}
+
+	stream->WriteBytes((void*)out.data(), out.size());
+	stream->Close();
+	return true;
+}
+
+// Exact percentiles of the frames that are still in the history.
+FrameStats FrameHistory::GetRecentStats() {
+	FrameStats stats = {};
+	if (RecordCount == 0) {
+		return stats;
+	}
+
+	vector<double> times(RecordCount);
+	double total = 0.0;
+	for (size_t i = 0; i < RecordCount; i++) {
+		times[i] = GetRecord(i)->FrameTime;
+		total += times[i];
+	}
+	std::sort(times.begin(), times.end());
+
+	size_t n = times.size();
+	stats.Frames = (Uint32)n;
+	stats.Average = total / n;
+	stats.P50 = times[(size_t)ceil(n * 0.50) - 1];
+	stats.P95 = times[(size_t)ceil(n * 0.95) - 1];
+	stats.P99 = times[(size_t)ceil(n * 0.99) - 1];
+	stats.Max = times[n - 1];
+	return stats;
+}
+
+// Percentiles of the whole run, to within FRAME_HISTORY_BUCKET_WIDTH. These
+// are the slowest frame in the bucket the percentile falls in.
+double FrameHistory::GetBucketPercentile(double percentile) {
+	Uint32 target = (Uint32)ceil(TotalFrames * percentile);
+	Uint32 seen = 0;
+	for (int i = 0; i < FRAME_HISTORY_BUCKET_COUNT; i++) {
+		seen += Buckets[i];
+		if (seen >= target) {
+			return BucketMax[i];
+		}
+	}
+	return MaxTime;
+}
+FrameStats FrameHistory::GetRunStats() {
+	FrameStats stats = {};
+	if (TotalFrames == 0) {
+		return stats;
+	}
+
+	stats.Frames = TotalFrames;
+	stats.Average = TotalTime / TotalFrames;
+	stats.P50 = GetBucketPercentile(0.50);
+	stats.P95 = GetBucketPercentile(0.95);
+	stats.P99 = GetBucketPercentile(0.99);
+	stats.Max = MaxTime;
+	return stats;
+}
+
+static void AppendStats(std::string& out, const char* name, FrameStats& stats) {
+	char text[256];
+	snprintf(text,
+		sizeof text,
+		"\"%s\":{\"frames\":%u,\"average\":%.3f,\"p50\":%.3f,\"p95\":%.3f,"
+		"\"p99\":%.3f,\"max\":%.3f}",
+		name,
+		stats.Frames,
+		stats.Average,
+		stats.P50,
+		stats.P95,
+		stats.P99,
+		stats.Max);
+	out += text;
+}
+
+// Writes the frame time percentiles as JSON, for soak tests to pick up.
+bool FrameHistory::WriteSummary(const char* filename) {
+	Stream* stream = FileStream::New(filename, FileStream::WRITE_ACCESS);
+	if (!stream) {
+		Log::Print(Log::LOG_ERROR, "Couldn't open \"%s\" for writing!", filename);
+		return false;
+	}
+
+	FrameStats run = GetRunStats();
+	FrameStats recent = GetRecentStats();
+
+	std::string out = "{";
+	AppendStats(out, "run", run);
+	out += ",";
+	AppendStats(out, "recent", recent);
+
+	char text[128];
+	snprintf(text,
+		sizeof text,
+		",\"budget\":%.3f,\"spikes\":%u}\n",
+		SpikeBudget,
+		SpikeCount);
+	out += text;
+
+	stream->WriteBytes((void*)out.data(), out.size());
+	stream->Close();
+	return true;
+}
+
+void FrameHistory::LogSummary() {
+	FrameStats run = GetRunStats();
+	if (run.Frames == 0) {
+		return;
+	}
+
+	Log::Print(Log::LOG_INFO,
+		"Frame times over %u frames: average %.3f ms, p50 %.1f ms, p95 %.1f ms, "
+		"p99 %.1f ms, max %.3f ms",
+		run.Frames,
+		run.Average,
+		run.P50,
+		run.P95,
+		run.P99,
+		run.Max);
+	if (SpikeBudget > 0.0) {
+		Log::Print(Log::LOG_INFO,
+			"%u frame(s) went over the %.3f ms budget.",
+			SpikeCount,
+			SpikeBudget);
+	}
+}
+
+void FrameHistory::Dispose() {
+	Records.clear();
+	Records.shrink_to_fit();
+	NextRecord = 0;
+	RecordCount = 0;
+	SpikeFramesLeft = 0;
+}
@@ -0,0 +1,73 @@
+#ifndef ENGINE_DIAGNOSTICS_FRAMEHISTORY_H
+#define ENGINE_DIAGNOSTICS_FRAMEHISTORY_H
+
+#include <Engine/Includes/Standard.h>
+
+#define FRAME_HISTORY_DEFAULT_LENGTH 600
+#define FRAME_HISTORY_DEFAULT_SPIKE_FRAMES 60
+#define FRAME_HISTORY_MAX_PHASES 16
+
+// Frame times for the whole run are counted in buckets this wide, in
+// milliseconds; anything past the last bucket goes into it.
+#define FRAME_HISTORY_BUCKET_WIDTH 0.1
+#define FRAME_HISTORY_BUCKET_COUNT 2000
+
+struct FrameRecord {
+	Uint32 Frame;
+	double Time;
+	double FrameTime;
+	double PhaseTimes[FRAME_HISTORY_MAX_PHASES];
+	double GCTime;
+	Uint32 Allocations;
+	size_t MemoryUsage;
+	int EntityCount;
+};
+
+struct FrameStats {
+	Uint32 Frames;
+	double Average;
+	double P50;
+	double P95;
+	double P99;
+	double Max;
+};
+
+class FrameHistory {
+private:
+	static vector<FrameRecord> Records;
+	static size_t NextRecord;
+	static size_t RecordCount;
+	static Uint32 FrameCounter;
+
+	static Uint32 Buckets[FRAME_HISTORY_BUCKET_COUNT];
+	static double BucketMax[FRAME_HISTORY_BUCKET_COUNT];
+	static Uint32 TotalFrames;
+	static double TotalTime;
+	static double MaxTime;
+
+	static int SpikeFramesLeft;
+	static Uint32 SpikeFrame;
+	static double SpikeTime;
+	static double LastSpikeDumpTime;
+
+	static FrameRecord* GetRecord(size_t age);
+	static double GetBucketPercentile(double percentile);
+	static void DumpSpike();
+
+public:
+	static double SpikeBudget;
+	static int SpikeFrames;
+	static double SpikeCooldown;
+	static Uint32 SpikeCount;
+
+	static void Init(size_t length);
+	static void Record();
+	static FrameStats GetRecentStats();
+	static FrameStats GetRunStats();
+	static bool DumpFrames(const char* filename, size_t count);
+	static bool WriteSummary(const char* filename);
+	static void LogSummary();
+	static void Dispose();
+};
+
+#endif /* ENGINE_DIAGNOSTICS_FRAMEHISTORY_H */
@@ -19,7 +19,22 @@ extern "C" {
 #include <android/log.h>
 #endif
 
+#if defined(LINUX) || defined(MACOSX) || defined(ANDROID)
+#define LOG_CRASH_SIGNALS
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+#ifdef WIN32
+#include <io.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <stdarg.h>
+#include <thread>
 
 #define DEFAULT_LOG_FILENAME TARGET_NAME ".log"
 
@@ -27,15 +42,139 @@ int Log::LogLevel = -2;
 bool Log::WriteToFile = true;
 FILE* Log::File = nullptr;
 bool Log::Initialized = false;
-char* Log::Buffer = nullptr;
-size_t Log::BufferSize = 0;
 
 #if WIN32 || LINUX
 #define USING_COLOR_CODES 1
 #endif
 
+// Messages are formatted on the calling thread and handed to a writer thread,
+// which does the actual (slow) console and file output in batches.
+struct LogRecord {
+	int Severity;
+	bool Simple;
+	double Time;
+	size_t Capacity;
+	char* Text;
+};
+
+// Most messages fit in this much space, so formatting them takes one
+// allocation.
+#define LOG_RECORD_TEXT_SIZE 256
+
+// How many messages can be waiting for the writer. Once it's full, callers
+// write their messages themselves until the writer catches up.
+#define LOG_QUEUE_SIZE 8192
+
+// How often the writer wakes up on its own, in milliseconds. It's only woken
+// up early when the queue is filling up, since waking it costs the caller a
+// system call.
+#define LOG_WRITER_POLL_INTERVAL 10
+#define LOG_WRITER_WAKE_THRESHOLD (LOG_QUEUE_SIZE / 4)
+
+// A message that keeps repeating is summarized at most this often, in
+// seconds.
+#define LOG_REPEAT_REPORT_INTERVAL 1.0
+
+// Bounded multi-producer, single-consumer queue, the same as
+// AudioCommandQueue. Only the writer pops, and only while holding WriteLock.
+struct LogQueueCell {
+	std::atomic<size_t> Sequence;
+	LogRecord* Record;
+};
+static LogQueueCell QueueCells[LOG_QUEUE_SIZE];
+static std::atomic<size_t> EnqueuePos{0};
+static std::atomic<size_t> DequeuePos{0};
+static std::atomic<size_t> Pending{0};
+
+// Serializes everything that writes output.
+static std::mutex WriteLock;
+
+static std::thread* Writer = nullptr;
+static std::atomic<bool> WriterRunning{false};
+static std::atomic<bool> WriterWaiting{false};
+static std::mutex WakeLock;
+static std::condition_variable WakeSignal;
+
+static std::chrono::steady_clock::time_point StartTime;
+
+// Set once the program is crashing. From then on the queue is only read, by
+// the crash handler, so the writer stops popping and freeing records.
+static std::atomic<bool> Crashing{false};
+
+// The descriptors the crash handler writes to directly.
+static int CrashStdoutDescriptor = -1;
+static int CrashFileDescriptor = -1;
+
+// The last message written, so that it isn't written over and over again.
+static int LastSeverity = 0;
+static std::string LastText;
+static int RepeatCount = 0;
+static double RepeatReportTime = 0.0;
+
+static bool QueuePush(LogRecord* record) {
+	LogQueueCell* cell;
+	size_t pos = EnqueuePos.load(std::memory_order_relaxed);
+	for (;;) {
+		cell = &QueueCells[pos % LOG_QUEUE_SIZE];
+		size_t sequence = cell->Sequence.load(std::memory_order_acquire);
+		intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+		if (diff == 0) {
+			if (EnqueuePos.compare_exchange_weak(
+				    pos, pos + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		}
+		else if (diff < 0) {
+			// Full.
+			return false;
+		}
+		else {
+			pos = EnqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	cell->Record = record;
+	cell->Sequence.store(pos + 1, std::memory_order_release);
+	return true;
+}
+static LogRecord* QueuePop() {
+	size_t pos = DequeuePos.load(std::memory_order_relaxed);
+	LogQueueCell* cell = &QueueCells[pos % LOG_QUEUE_SIZE];
+	size_t sequence = cell->Sequence.load(std::memory_order_acquire);
+	if (sequence != pos + 1) {
+		return nullptr;
+	}
+
+	LogRecord* record = cell->Record;
+	cell->Sequence.store(pos + LOG_QUEUE_SIZE, std::memory_order_release);
+	DequeuePos.store(pos + 1, std::memory_order_relaxed);
+	return record;
+}
+
 void Log::Init() {
+	if (Initialized) {
+		return;
+	}
+
+	for (size_t i = 0; i < LOG_QUEUE_SIZE; i++) {
+		QueueCells[i].Sequence.store(i, std::memory_order_relaxed);
+	}
+
+	StartTime = std::chrono::steady_clock::now();
+	CrashStdoutDescriptor = fileno(stdout);
+
 	Initialized = true;
+
+	WriterRunning = true;
+	Writer = new (std::nothrow) std::thread(Log::WriterThread);
+	if (!Writer) {
+		WriterRunning = false;
+	}
+
+	// Whatever is still queued gets written even if Close is never
+	// called, or if the program crashes.
+	atexit(Log::Close);
+	InstallCrashHandler();
 }
 
 void Log::OpenFile(const char* filename) {
@@ -62,7 +201,11 @@ void Log::OpenFile(const char* filename) {
 	if (pathIsValid) {
 		Log::Print(Log::LOG_VERBOSE, "Log file: %s", logFilename);
 
+		std::lock_guard<std::mutex> lock(WriteLock);
 		File = fopen(logFilename, "w");
+		if (File) {
+			CrashFileDescriptor = fileno(File);
+		}
 	}
 
 	if (!File) {
@@ -75,84 +218,401 @@ void Log::SetLogLevel(int sev) {
 	Log::LogLevel = sev;
 }
 
+void Log::StopWriter() {
+	if (!Writer) {
+		return;
+	}
+
+	WriterRunning = false;
+	WakeSignal.notify_one();
+
+	Writer->join();
+	delete Writer;
+	Writer = nullptr;
+}
+
+// Writes everything that's been queued so far.
+void Log::Flush() {
+	if (!Initialized) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(WriteLock);
+	Drain();
+	ReportRepeats();
+	fflush(stdout);
+	if (File) {
+		fflush(File);
+	}
+}
+
+static const char* GetSeverityText(int sev) {
+	switch (sev) {
+	case Log::LOG_VERBOSE:
+		return "  VERBOSE: ";
+	case Log::LOG_INFO:
+		return "     INFO: ";
+	case Log::LOG_WARN:
+		return "  WARNING: ";
+	case Log::LOG_ERROR:
+		return "    ERROR: ";
+	case Log::LOG_IMPORTANT:
+		return "IMPORTANT: ";
+	case Log::LOG_FATAL:
+		return "    FATAL: ";
+	case Log::LOG_API:
+		return "      API: ";
+	}
+	return "";
+}
+
+static void CrashWrite(int fd, const char* text, size_t length) {
+	while (length > 0) {
+#ifdef WIN32
+		int written = _write(fd, text, (unsigned)length);
+#else
+		ssize_t written = write(fd, text, length);
+#endif
+		if (written <= 0) {
+			return;
+		}
+		text += written;
+		length -= written;
+	}
+}
+
+// Formats a record's time the way WriteRecord does ("[%10.3f] "), without
+// going through snprintf.
+static size_t FormatCrashStamp(char* stamp, double time) {
+	Uint64 millis = time > 0.0 ? (Uint64)(time * 1000.0 + 0.5) : 0;
+
+	char digits[24];
+	size_t numDigits = 0;
+	do {
+		digits[numDigits++] = '0' + (millis % 10);
+		millis /= 10;
+	} while (millis > 0 || numDigits < 4);
+
+	size_t length = 0;
+	stamp[length++] = '[';
+	for (size_t i = numDigits + 1; i < 10; i++) {
+		stamp[length++] = ' ';
+	}
+	for (size_t i = numDigits; i > 3; i--) {
+		stamp[length++] = digits[i - 1];
+	}
+	stamp[length++] = '.';
+	for (size_t i = 3; i > 0; i--) {
+		stamp[length++] = digits[i - 1];
+	}
+	stamp[length++] = ']';
+	stamp[length++] = ' ';
+	return length;
+}
+
+// Writes whatever is still queued when the program is crashing. This runs in
+// a signal handler, possibly while the crashing thread holds WriteLock or is
+// inside malloc or stdio, so it takes no locks, allocates and frees nothing,
+// and writes the queued records straight to the file descriptors. Output
+// still sitting in stdio's buffers isn't flushed, since that isn't safe here.
+void Log::FlushOnCrash() {
+	if (!Initialized || Crashing.exchange(true)) {
+		return;
+	}
+
+	int stdoutDescriptor = CrashStdoutDescriptor;
+	int fileDescriptor = CrashFileDescriptor;
+
+	size_t end = EnqueuePos.load(std::memory_order_acquire);
+	for (size_t pos = DequeuePos.load(std::memory_order_acquire); pos != end; pos++) {
+		LogQueueCell* cell = &QueueCells[pos % LOG_QUEUE_SIZE];
+		if (cell->Sequence.load(std::memory_order_acquire) != pos + 1) {
+			// Already written, or still being pushed.
+			continue;
+		}
+
+		LogRecord* record = cell->Record;
+		size_t textLength = strlen(record->Text);
+		if (record->Simple) {
+			if (stdoutDescriptor >= 0) {
+				CrashWrite(stdoutDescriptor, record->Text, textLength);
+			}
+			if (fileDescriptor >= 0) {
+				CrashWrite(fileDescriptor, record->Text, textLength);
+			}
+			continue;
+		}
+
+		const char* severityText = GetSeverityText(record->Severity);
+		size_t severityLength = strlen(severityText);
+
+		if (stdoutDescriptor >= 0) {
+			CrashWrite(stdoutDescriptor, severityText, severityLength);
+			CrashWrite(stdoutDescriptor, record->Text, textLength);
+			CrashWrite(stdoutDescriptor, "\n", 1);
+		}
+
+		if (fileDescriptor >= 0) {
+			char stamp[32];
+			size_t stampLength = FormatCrashStamp(stamp, record->Time);
+			CrashWrite(fileDescriptor, stamp, stampLength);
+			CrashWrite(fileDescriptor, severityText, severityLength);
+			CrashWrite(fileDescriptor, record->Text, textLength);
+			CrashWrite(fileDescriptor, "\n", 1);
+		}
+	}
+}
+
+#if defined(LOG_CRASH_SIGNALS)
+static const int CrashSignals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+#define NUM_CRASH_SIGNALS (sizeof(CrashSignals) / sizeof(CrashSignals[0]))
+static struct sigaction PreviousCrashActions[NUM_CRASH_SIGNALS];
+
+static void HandleCrashSignal(int sig) {
+	Log::FlushOnCrash();
+
+	// Whatever handled the signal before gets it now.
+	for (size_t i = 0; i < NUM_CRASH_SIGNALS; i++) {
+		if (CrashSignals[i] == sig) {
+			sigaction(sig, &PreviousCrashActions[i], nullptr);
+			break;
+		}
+	}
+	raise(sig);
+}
+#elif defined(WIN32)
+static LPTOP_LEVEL_EXCEPTION_FILTER PreviousExceptionFilter = NULL;
+
+static LONG WINAPI HandleUnhandledException(EXCEPTION_POINTERS* info) {
+	Log::FlushOnCrash();
+
+	if (PreviousExceptionFilter) {
+		return PreviousExceptionFilter(info);
+	}
+	return EXCEPTION_CONTINUE_SEARCH;
+}
+#endif
+
+void Log::InstallCrashHandler() {
+#if defined(LOG_CRASH_SIGNALS)
+	struct sigaction action;
+	memset(&action, 0, sizeof action);
+	action.sa_handler = HandleCrashSignal;
+	sigemptyset(&action.sa_mask);
+
+	for (size_t i = 0; i < NUM_CRASH_SIGNALS; i++) {
+		sigaction(CrashSignals[i], &action, &PreviousCrashActions[i]);
+	}
+#elif defined(WIN32)
+	PreviousExceptionFilter = SetUnhandledExceptionFilter(HandleUnhandledException);
+#endif
+}
+
 void Log::Close() {
+	if (!Initialized) {
+		return;
+	}
+
+	StopWriter();
+	Flush();
+
+	std::lock_guard<std::mutex> lock(WriteLock);
 	if (File) {
+		CrashFileDescriptor = -1;
 		fclose(File);
 		File = nullptr;
 	}
-	free(Buffer);
 }
 
-bool Log::ResizeBuffer(int written_chars) {
-	BufferSize = written_chars + 1024;
-	Buffer = (char*)realloc(Buffer, BufferSize * sizeof(char));
+void Log::WriterThread() {
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(WakeLock);
+			WriterWaiting = true;
+			if (Pending < LOG_WRITER_WAKE_THRESHOLD && WriterRunning) {
+				WakeSignal.wait_for(
+					lock, std::chrono::milliseconds(LOG_WRITER_POLL_INTERVAL));
+			}
+			WriterWaiting = false;
+		}
 
-	// If the reallocation failed, try again with a smaller buffer
-	// size
-	if (Buffer == nullptr) {
-		BufferSize = 1024;
-		Buffer = (char*)realloc(Buffer, BufferSize * sizeof(char));
+		if (!WriterRunning) {
+			break;
+		}
 
-		// If that failed too, just give up.
-		if (!Buffer) {
-			return false;
+		std::lock_guard<std::mutex> lock(WriteLock);
+		Drain();
+	}
+}
+
+LogRecord* Log::CreateRecord(int sev, bool simple, const char* format, va_list args) {
+	LogRecord* record = (LogRecord*)malloc(sizeof(LogRecord) + LOG_RECORD_TEXT_SIZE);
+	if (!record) {
+		return nullptr;
+	}
+
+	record->Severity = sev;
+	record->Simple = simple;
+	record->Capacity = LOG_RECORD_TEXT_SIZE;
+	record->Text = (char*)(record + 1);
+
+	va_list argsCopy;
+	va_copy(argsCopy, args);
+	int written_chars = vsnprintf(record->Text, record->Capacity, format, argsCopy);
+	va_end(argsCopy);
+
+	if (written_chars <= 0) {
+		free(record);
+		return nullptr;
+	}
+	else if ((size_t)written_chars >= record->Capacity) {
+		LogRecord* bigger =
+			(LogRecord*)realloc(record, sizeof(LogRecord) + written_chars + 1);
+		if (!bigger) {
+			free(record);
+			return nullptr;
 		}
+
+		record = bigger;
+		record->Capacity = written_chars + 1;
+		record->Text = (char*)(record + 1);
+
+		va_copy(argsCopy, args);
+		vsnprintf(record->Text, record->Capacity, format, argsCopy);
+		va_end(argsCopy);
 	}
 
-	return true;
+	record->Time = std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime)
+			       .count();
+
+	return record;
 }
 
-void Log::Print(int sev, const char* format, ...) {
-	if (!Initialized) {
-		return;
+void Log::Submit(LogRecord* record) {
+	// Errors, important and fatal messages are written right away, since
+	// they're the ones most likely to come right before a crash. So is output
+	// from PrintSimple, which is used for prompts.
+	bool immediate = record->Severity >= LOG_ERROR || record->Simple;
+
+	if (WriterRunning && !immediate) {
+		if (QueuePush(record)) {
+			if (++Pending >= LOG_WRITER_WAKE_THRESHOLD && WriterWaiting) {
+				WakeSignal.notify_one();
+			}
+			return;
+		}
 	}
 
-#ifdef USING_COLOR_CODES
-	int ColorCode = 0;
-#endif
+	// Anything queued before this is written first, to keep the order.
+	std::lock_guard<std::mutex> lock(WriteLock);
+	Drain();
+	WriteRecord(record);
+	free(record);
+
+	fflush(stdout);
+	if (File) {
+		fflush(File);
+	}
+}
+
+// Must be called with WriteLock held.
+void Log::Drain() {
+	bool wroteAny = false;
+
+	LogRecord* record;
+	while (!Crashing && (record = QueuePop()) != nullptr) {
+		Pending--;
+		WriteRecord(record);
+		// The crash handler may be reading it.
+		if (!Crashing) {
+			free(record);
+		}
+		wroteAny = true;
+	}
+
+	if (wroteAny) {
+		fflush(stdout);
+		if (File) {
+			fflush(File);
+		}
+	}
+}
 
-	if (sev < Log::LogLevel) {
+void Log::ReportRepeats() {
+	if (RepeatCount == 0) {
 		return;
 	}
 
-	const char* severityText = NULL;
+	char text[64];
+	snprintf(text, sizeof text, "(Last message repeated %d more time(s).)", RepeatCount);
+	WriteText(LastSeverity, "", text, false);
 
-	va_list args;
-	va_start(args, format);
-	int written_chars = vsnprintf(Buffer, BufferSize, format, args);
-	va_end(args);
+	RepeatCount = 0;
+}
 
-	if (written_chars <= 0) {
+void Log::WriteRecord(LogRecord* record) {
+	if (record->Simple) {
+		WriteText(record->Severity, "", record->Text, true);
 		return;
 	}
-	else if (written_chars + 1 >= BufferSize) {
-		if (!ResizeBuffer(written_chars)) {
-			return;
+
+	if (record->Severity == LastSeverity && LastText == record->Text) {
+		if (RepeatCount == 0) {
+			RepeatReportTime = record->Time + LOG_REPEAT_REPORT_INTERVAL;
 		}
+		RepeatCount++;
 
-		va_start(args, format);
-		vsnprintf(Buffer, BufferSize, format, args);
-		va_end(args);
+		if (record->Time >= RepeatReportTime) {
+			ReportRepeats();
+		}
+		return;
 	}
 
+	ReportRepeats();
+
+	LastSeverity = record->Severity;
+	LastText = record->Text;
+
+	// The time is only formatted here, off the calling thread.
+	char stamp[32];
+	snprintf(stamp, sizeof stamp, "[%10.3f] ", record->Time);
+
+	WriteText(record->Severity, stamp, record->Text, false);
+}
+
+void Log::WriteText(int sev, const char* stamp, const char* text, bool simple) {
+	if (simple) {
+		printf("%s", text);
+		if (File) {
+			fprintf(File, "%s", text);
+		}
+		return;
+	}
+
+#ifdef USING_COLOR_CODES
+	int ColorCode = 0;
+#endif
+
+	const char* severityText = NULL;
+
 #if defined(ANDROID)
 	switch (sev) {
 	case LOG_VERBOSE:
-		__android_log_print(ANDROID_LOG_VERBOSE, TARGET_NAME, "%s", Buffer);
+		__android_log_print(ANDROID_LOG_VERBOSE, TARGET_NAME, "%s", text);
 		return;
 	case LOG_INFO:
 	case LOG_IMPORTANT:
 	case LOG_API:
-		__android_log_print(ANDROID_LOG_INFO, TARGET_NAME, "%s", Buffer);
+		__android_log_print(ANDROID_LOG_INFO, TARGET_NAME, "%s", text);
 		return;
 	case LOG_WARN:
-		__android_log_print(ANDROID_LOG_WARN, TARGET_NAME, "%s", Buffer);
+		__android_log_print(ANDROID_LOG_WARN, TARGET_NAME, "%s", text);
 		return;
 	case LOG_ERROR:
-		__android_log_print(ANDROID_LOG_ERROR, TARGET_NAME, "%s", Buffer);
+		__android_log_print(ANDROID_LOG_ERROR, TARGET_NAME, "%s", text);
 		return;
 	case LOG_FATAL:
-		__android_log_print(ANDROID_LOG_FATAL, TARGET_NAME, "%s", Buffer);
+		__android_log_print(ANDROID_LOG_FATAL, TARGET_NAME, "%s", text);
 		return;
 	}
 #endif
@@ -210,33 +670,11 @@ void Log::Print(int sev, const char* format, ...) {
 	printf("\x1b[%d;1m", ColorCode);
 #endif
 
-	switch (sev) {
-	case LOG_VERBOSE:
-		severityText = "  VERBOSE: ";
-		break;
-	case LOG_INFO:
-		severityText = "     INFO: ";
-		break;
-	case LOG_WARN:
-		severityText = "  WARNING: ";
-		break;
-	case LOG_ERROR:
-		severityText = "    ERROR: ";
-		break;
-	case LOG_IMPORTANT:
-		severityText = "IMPORTANT: ";
-		break;
-	case LOG_FATAL:
-		severityText = "    FATAL: ";
-		break;
-	case LOG_API:
-		severityText = "      API: ";
-		break;
-	}
+	severityText = GetSeverityText(sev);
 
 	printf("%s", severityText);
 	if (File) {
-		fprintf(File, "%s", severityText);
+		fprintf(File, "%s%s", stamp, severityText);
 	}
 
 #if WIN32
@@ -246,37 +684,35 @@ void Log::Print(int sev, const char* format, ...) {
 	printf("\x1b[0m");
 #endif
 
-	printf("%s\n", Buffer);
-	fflush(stdout);
+	printf("%s\n", text);
 
 	if (File) {
-		fprintf(File, "%s\n", Buffer);
+		fprintf(File, "%s\n", text);
 	}
 }
 
-void Log::PrintSimple(const char* format, ...) {
+void Log::Print(int sev, const char* format, ...) {
+	if (!Initialized || sev < Log::LogLevel) {
+		return;
+	}
+
 	va_list args;
 	va_start(args, format);
-	int written_chars = vsnprintf(Buffer, BufferSize, format, args);
+	LogRecord* record = CreateRecord(sev, false, format, args);
 	va_end(args);
 
-	if (written_chars <= 0) {
-		return;
-	}
-	else if (written_chars + 1 >= BufferSize) {
-		if (!ResizeBuffer(written_chars)) {
-			return;
-		}
-
-		va_start(args, format);
-		vsnprintf(Buffer, BufferSize, format, args);
-		va_end(args);
+	if (record) {
+		Submit(record);
 	}
+}
 
-	printf("%s", Buffer);
-	fflush(stdout);
+void Log::PrintSimple(const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	LogRecord* record = CreateRecord(LOG_INFO, true, format, args);
+	va_end(args);
 
-	if (File) {
-		fprintf(File, "%s", Buffer);
+	if (record) {
+		Submit(record);
 	}
 }
@@ -3,14 +3,22 @@
 
 #include <Engine/Includes/Standard.h>
 
+struct LogRecord;
+
 class Log {
 private:
 	static FILE* File;
 	static bool Initialized;
-	static char* Buffer;
-	static size_t BufferSize;
 
-	static bool ResizeBuffer(int written_chars);
+	static LogRecord* CreateRecord(int sev, bool simple, const char* format, va_list args);
+	static void Submit(LogRecord* record);
+	static void Drain();
+	static void WriteRecord(LogRecord* record);
+	static void WriteText(int sev, const char* stamp, const char* text, bool simple);
+	static void ReportRepeats();
+	static void WriterThread();
+	static void StopWriter();
+	static void InstallCrashHandler();
 
 public:
 	enum LogLevels {
@@ -27,6 +35,8 @@ public:
 
 	static void Init();
 	static void OpenFile(const char* filename);
+	static void Flush();
+	static void FlushOnCrash();
 	static void Close();
 	static void SetLogLevel(int sev);
 	static void Print(int sev, const char* format, ...);
@@ -1,12 +1,111 @@
 #include <Engine/Diagnostics/Log.h>
 #include <Engine/Diagnostics/Memory.h>
 
-vector<void*> Memory::TrackedMemory;
-vector<size_t> Memory::TrackedSizes;
-vector<const char*> Memory::TrackedMemoryNames;
+#include <mutex>
+
 size_t Memory::MemoryUsage = 0;
 bool Memory::IsTracking = false;
 
+#ifdef DEBUG
+struct TrackedAllocation {
+	size_t Size;
+	const char* Name;
+	MemoryTagStats* Tag;
+};
+
+// Resources can be decoded on other threads, which allocate too.
+static std::recursive_mutex TrackingLock;
+
+static std::unordered_map<void*, TrackedAllocation> TrackedMemory;
+static void* LastTracked = nullptr;
+static Uint32 FrameAllocations = 0;
+
+// Tags are looked up by the address of their name first, since that's
+// almost always a string literal. The same name can live at more than one
+// address, so the tags themselves are keyed by the name's contents.
+static std::unordered_map<const char*, MemoryTagStats*> TagsByAddress;
+static std::map<std::string, MemoryTagStats*> TagsByName;
+
+#define UNTAGGED_NAME "(untagged)"
+
+static MemoryTagStats* GetTag(const char* name) {
+	const char* key = name ? name : UNTAGGED_NAME;
+
+	std::unordered_map<const char*, MemoryTagStats*>::iterator it = TagsByAddress.find(key);
+	if (it != TagsByAddress.end() && it->second->Name == key) {
+		return it->second;
+	}
+
+	MemoryTagStats*& tag = TagsByName[key];
+	if (!tag) {
+		tag = new MemoryTagStats();
+		tag->Name = key;
+	}
+
+	TagsByAddress[key] = tag;
+	return tag;
+}
+static void AddToTag(MemoryTagStats* tag, size_t size) {
+	tag->LiveBytes += size;
+	tag->LiveCount++;
+	if (tag->LiveBytes > tag->PeakBytes) {
+		tag->PeakBytes = tag->LiveBytes;
+	}
+}
+static void RemoveFromTag(MemoryTagStats* tag, size_t size) {
+	tag->LiveBytes -= size;
+	tag->LiveCount--;
+}
+
+static void AddTracked(void* pointer, size_t size, const char* name) {
+	MemoryTagStats* tag = GetTag(name);
+	tag->TotalAllocations++;
+	tag->FrameAllocations++;
+	AddToTag(tag, size);
+	FrameAllocations++;
+
+	TrackedMemory[pointer] = {size, name, tag};
+	LastTracked = pointer;
+
+	Memory::MemoryUsage += size;
+}
+static void RemoveTracked(std::unordered_map<void*, TrackedAllocation>::iterator it) {
+	RemoveFromTag(it->second.Tag, it->second.Size);
+	Memory::MemoryUsage -= it->second.Size;
+
+	if (LastTracked == it->first) {
+		LastTracked = nullptr;
+	}
+
+	TrackedMemory.erase(it);
+}
+// Resizing a block doesn't count as a new allocation.
+static void MoveTracked(std::unordered_map<void*, TrackedAllocation>::iterator it,
+	void* pointer,
+	size_t size) {
+	TrackedAllocation allocation = it->second;
+	RemoveTracked(it);
+
+	allocation.Size = size;
+	AddToTag(allocation.Tag, size);
+	Memory::MemoryUsage += size;
+
+	TrackedMemory[pointer] = allocation;
+	LastTracked = pointer;
+}
+static void Retag(TrackedAllocation& allocation, size_t size, const char* name) {
+	RemoveFromTag(allocation.Tag, allocation.Size);
+	Memory::MemoryUsage -= allocation.Size;
+
+	allocation.Size = size;
+	allocation.Name = name;
+	allocation.Tag = GetTag(name);
+
+	AddToTag(allocation.Tag, size);
+	Memory::MemoryUsage += size;
+}
+#endif
+
 void Memory::Memset4(void* dst, Uint32 val, size_t dwords) {
 #if defined(__GNUC__) && defined(i386)
 	int u0, u1, u2;
@@ -43,12 +142,9 @@ void* Memory::Malloc(size_t size) {
 	void* mem = malloc(size);
 #ifdef DEBUG
 	if (Memory::IsTracking) {
+		std::lock_guard<std::recursive_mutex> lock(TrackingLock);
 		if (mem) {
-			MemoryUsage += size;
-
-			TrackedMemory.push_back(mem);
-			TrackedSizes.push_back(size);
-			TrackedMemoryNames.push_back(NULL);
+			AddTracked(mem, size, NULL);
 		}
 		else {
 			Log::Print(Log::LOG_ERROR, "Could not allocate memory for Malloc!");
@@ -61,12 +157,9 @@ void* Memory::Calloc(size_t count, size_t size) {
 	void* mem = calloc(count, size);
 #ifdef DEBUG
 	if (Memory::IsTracking) {
+		std::lock_guard<std::recursive_mutex> lock(TrackingLock);
 		if (mem) {
-			MemoryUsage += count * size;
-
-			TrackedMemory.push_back(mem);
-			TrackedSizes.push_back(count * size);
-			TrackedMemoryNames.push_back(NULL);
+			AddTracked(mem, count * size, NULL);
 		}
 		else {
 			Log::Print(Log::LOG_ERROR, "Could not allocate memory for Calloc!");
@@ -79,15 +172,15 @@ void* Memory::Realloc(void* pointer, size_t size) {
 	void* mem = realloc(pointer, size);
 #ifdef DEBUG
 	if (Memory::IsTracking) {
+		std::lock_guard<std::recursive_mutex> lock(TrackingLock);
 		if (mem) {
-			for (Uint32 i = 0; i < TrackedMemory.size(); i++) {
-				if (TrackedMemory[i] == pointer) {
-					MemoryUsage += size - TrackedSizes[i];
-
-					TrackedMemory[i] = mem;
-					TrackedSizes[i] = size;
-					return mem;
-				}
+			std::unordered_map<void*, TrackedAllocation>::iterator it =
+				TrackedMemory.find(pointer);
+			if (it != TrackedMemory.end()) {
+				MoveTracked(it, mem, size);
+			}
+			else if (!pointer) {
+				AddTracked(mem, size, NULL);
 			}
 		}
 		else {
@@ -102,12 +195,9 @@ void* Memory::TrackedMalloc(const char* identifier, size_t size) {
 	void* mem = malloc(size);
 #ifdef DEBUG
 	if (Memory::IsTracking) {
+		std::lock_guard<std::recursive_mutex> lock(TrackingLock);
 		if (mem) {
-			MemoryUsage += size;
-
-			TrackedMemory.push_back(mem);
-			TrackedSizes.push_back(size);
-			TrackedMemoryNames.push_back(identifier);
+			AddTracked(mem, size, identifier);
 		}
 		else {
 			Log::Print(Log::LOG_ERROR, "Could not allocate memory for TrackedMalloc!");
@@ -120,12 +210,9 @@ void* Memory::TrackedCalloc(const char* identifier, size_t count, size_t size) {
 	void* mem = calloc(count, size);
 #ifdef DEBUG
 	if (Memory::IsTracking) {
+		std::lock_guard<std::recursive_mutex> lock(TrackingLock);
 		if (mem) {
-			MemoryUsage += count * size;
-
-			TrackedMemory.push_back(mem);
-			TrackedSizes.push_back(count * size);
-			TrackedMemoryNames.push_back(identifier);
+			AddTracked(mem, count * size, identifier);
 		}
 		else {
 			Log::Print(Log::LOG_ERROR, "Could not allocate memory for TrackedCalloc!");
@@ -137,11 +224,10 @@ void* Memory::TrackedCalloc(const char* identifier, size_t count, size_t size) {
 void Memory::Track(void* pointer, const char* identifier) {
 #ifdef DEBUG
 	if (Memory::IsTracking) {
-		for (Uint32 i = 0; i < TrackedMemory.size(); i++) {
-			if (TrackedMemory[i] == pointer) {
-				TrackedMemoryNames[i] = identifier;
-				return;
-			}
+		std::lock_guard<std::recursive_mutex> lock(TrackingLock);
+		std::unordered_map<void*, TrackedAllocation>::iterator it = TrackedMemory.find(pointer);
+		if (it != TrackedMemory.end()) {
+			Retag(it->second, it->second.Size, identifier);
 		}
 	}
 #endif
@@ -149,62 +235,43 @@ void Memory::Track(void* pointer, const char* identifier) {
 void Memory::Track(void* pointer, size_t size, const char* identifier) {
 #ifdef DEBUG
 	if (Memory::IsTracking) {
-		for (Uint32 i = 0; i < TrackedMemory.size(); i++) {
-			if (TrackedMemory[i] == pointer) {
-				TrackedSizes[i] = size;
-				TrackedMemoryNames[i] = identifier;
-				return;
-			}
+		std::lock_guard<std::recursive_mutex> lock(TrackingLock);
+		std::unordered_map<void*, TrackedAllocation>::iterator it = TrackedMemory.find(pointer);
+		if (it != TrackedMemory.end()) {
+			Retag(it->second, size, identifier);
+			return;
 		}
 
-		TrackedMemory.push_back(pointer);
-		TrackedSizes.push_back(size);
-		TrackedMemoryNames.push_back(identifier);
+		AddTracked(pointer, size, identifier);
 	}
 #endif
 }
 void Memory::TrackLast(const char* identifier) {
 #ifdef DEBUG
 	if (Memory::IsTracking) {
-		if (TrackedMemoryNames.size() == 0) {
-			return;
+		std::lock_guard<std::recursive_mutex> lock(TrackingLock);
+		std::unordered_map<void*, TrackedAllocation>::iterator it =
+			TrackedMemory.find(LastTracked);
+		if (it != TrackedMemory.end()) {
+			Retag(it->second, it->second.Size, identifier);
 		}
-		TrackedMemoryNames[TrackedMemoryNames.size() - 1] = identifier;
 	}
 #endif
 }
 void Memory::Free(void* pointer) {
+	if (!pointer) {
+		return;
+	}
 #ifdef DEBUG
 	if (Memory::IsTracking) {
-		for (Uint32 i = 0; i < TrackedMemory.size(); i++) {
-			if (TrackedMemory[i] == pointer) {
-				// 32-bit
-				size_t ptr_size = sizeof(void*);
-				if (ptr_size == 4) {
-					size_t* debug = (size_t*)TrackedMemory[i];
-					for (size_t d = 0, dSz = TrackedSizes[i] / ptr_size;
-						d < dSz;
-						d++) {
-						debug[d] = 0xCDCDCDCDU;
-					}
-				}
-				// 64-bit
-				else if (ptr_size == 8) {
-					size_t* debug = (size_t*)TrackedMemory[i];
-					for (size_t d = 0, dSz = TrackedSizes[i] / ptr_size;
-						d < dSz;
-						d++) {
-						debug[d] = 0xCDCDCDCDCDCDCDCDU;
-					}
-				}
-				break;
-			}
+		std::lock_guard<std::recursive_mutex> lock(TrackingLock);
+		std::unordered_map<void*, TrackedAllocation>::iterator it = TrackedMemory.find(pointer);
+		if (it != TrackedMemory.end()) {
+			// Fill freed memory with a recognizable pattern.
+			memset(pointer, 0xCD, it->second.Size);
+			RemoveTracked(it);
 		}
 	}
-	Memory::Remove(pointer);
-	if (!pointer) {
-		return;
-	}
 #endif
 
 	free(pointer);
@@ -215,17 +282,10 @@ void Memory::Remove(void* pointer) {
 	}
 #ifdef DEBUG
 	if (Memory::IsTracking) {
-		for (Uint32 i = 0; i < TrackedMemory.size(); i++) {
-			if (TrackedMemory[i] == pointer) {
-				MemoryUsage -= TrackedSizes[i];
-				// printf("TrackedSizes[i]: %zu\n",
-				// TrackedSizes[i]);
-
-				TrackedMemoryNames.erase(TrackedMemoryNames.begin() + i);
-				TrackedMemory.erase(TrackedMemory.begin() + i);
-				TrackedSizes.erase(TrackedSizes.begin() + i);
-				return;
-			}
+		std::lock_guard<std::recursive_mutex> lock(TrackingLock);
+		std::unordered_map<void*, TrackedAllocation>::iterator it = TrackedMemory.find(pointer);
+		if (it != TrackedMemory.end()) {
+			RemoveTracked(it);
 		}
 	}
 #endif
@@ -234,31 +294,96 @@ void Memory::Remove(void* pointer) {
 const char* Memory::GetName(void* pointer) {
 #ifdef DEBUG
 	if (Memory::IsTracking) {
-		for (Uint32 i = 0; i < TrackedMemory.size(); i++) {
-			if (TrackedMemory[i] == pointer) {
-				return TrackedMemoryNames[i];
-			}
+		std::lock_guard<std::recursive_mutex> lock(TrackingLock);
+		std::unordered_map<void*, TrackedAllocation>::iterator it = TrackedMemory.find(pointer);
+		if (it != TrackedMemory.end()) {
+			return it->second.Name;
 		}
 	}
 #endif
 	return NULL;
 }
 
+size_t Memory::GetAllocationCount() {
+#ifdef DEBUG
+	std::lock_guard<std::recursive_mutex> lock(TrackingLock);
+	return TrackedMemory.size();
+#else
+	return 0;
+#endif
+}
+// Returns a copy of every tag's totals, with the ones using the most memory
+// first.
+vector<MemoryTagStats> Memory::GetTagStats() {
+	vector<MemoryTagStats> stats;
+#ifdef DEBUG
+	std::lock_guard<std::recursive_mutex> lock(TrackingLock);
+	for (std::map<std::string, MemoryTagStats*>::iterator it = TagsByName.begin();
+		it != TagsByName.end();
+		it++) {
+		stats.push_back(*it->second);
+	}
+
+	std::stable_sort(stats.begin(),
+		stats.end(),
+		[](const MemoryTagStats& a, const MemoryTagStats& b) {
+			return a.LiveBytes > b.LiveBytes;
+		});
+#endif
+	return stats;
+}
+// Returns how many tracked allocations were made since the frame began.
+Uint32 Memory::GetFrameAllocationCount() {
+#ifdef DEBUG
+	return FrameAllocations;
+#else
+	return 0;
+#endif
+}
+void Memory::EndFrame() {
+#ifdef DEBUG
+	if (Memory::IsTracking) {
+		std::lock_guard<std::recursive_mutex> lock(TrackingLock);
+		FrameAllocations = 0;
+		for (std::map<std::string, MemoryTagStats*>::iterator it = TagsByName.begin();
+			it != TagsByName.end();
+			it++) {
+			it->second->LastFrameAllocations = it->second->FrameAllocations;
+			it->second->FrameAllocations = 0;
+		}
+	}
+#endif
+}
+
 void Memory::ClearTrackedMemory() {
 #ifdef DEBUG
-	for (Uint32 i = 0; i < TrackedMemory.size(); i++) {
-		Memory::Free(TrackedMemory[i]);
+	std::lock_guard<std::recursive_mutex> lock(TrackingLock);
+	for (std::unordered_map<void*, TrackedAllocation>::iterator it = TrackedMemory.begin();
+		it != TrackedMemory.end();
+		it++) {
+		free(it->first);
 	}
-	TrackedMemoryNames.clear();
 	TrackedMemory.clear();
-	TrackedSizes.clear();
+	LastTracked = nullptr;
+	MemoryUsage = 0;
+
+	for (std::map<std::string, MemoryTagStats*>::iterator it = TagsByName.begin();
+		it != TagsByName.end();
+		it++) {
+		delete it->second;
+	}
+	TagsByName.clear();
+	TagsByAddress.clear();
 #endif
 }
 size_t Memory::CheckLeak() {
 	size_t total = 0;
 #ifdef DEBUG
-	for (Uint32 i = 0; i < TrackedMemory.size(); i++) {
-		total += TrackedSizes[i];
+	std::lock_guard<std::recursive_mutex> lock(TrackingLock);
+	for (std::unordered_map<void*, TrackedAllocation>::iterator it = TrackedMemory.begin();
+		it != TrackedMemory.end();
+		it++) {
+		total += it->second.Size;
 	}
 #endif
 	return total;
@@ -266,17 +391,21 @@ size_t Memory::CheckLeak() {
 void Memory::PrintLeak() {
 #ifdef DEBUG
 	if (Memory::IsTracking) {
+		std::lock_guard<std::recursive_mutex> lock(TrackingLock);
 		size_t total = 0;
 		Log::Print(Log::LOG_VERBOSE,
 			"Printing unfreed memory... (%u count)",
 			TrackedMemory.size());
-		for (Uint32 i = 0; i < TrackedMemory.size(); i++) {
+		for (std::unordered_map<void*, TrackedAllocation>::iterator it =
+				TrackedMemory.begin();
+			it != TrackedMemory.end();
+			it++) {
 			Log::Print(Log::LOG_VERBOSE,
 				" : %p [%u bytes] (%s)",
-				TrackedMemory[i],
-				TrackedSizes[i],
-				TrackedMemoryNames[i] ? TrackedMemoryNames[i] : "no name");
-			total += TrackedSizes[i];
+				it->first,
+				it->second.Size,
+				it->second.Name ? it->second.Name : "no name");
+			total += it->second.Size;
 		}
 		Log::Print(Log::LOG_VERBOSE,
 			"Total: %u bytes (%.3f MB)",
@@ -3,12 +3,18 @@
 
 #include <Engine/Includes/Standard.h>
 
-class Memory {
-private:
-	static vector<void*> TrackedMemory;
-	static vector<size_t> TrackedSizes;
-	static vector<const char*> TrackedMemoryNames;
+// Totals for every tracked allocation that shares a name.
+struct MemoryTagStats {
+	std::string Name;
+	size_t LiveBytes = 0;
+	size_t PeakBytes = 0;
+	size_t LiveCount = 0;
+	Uint64 TotalAllocations = 0;
+	Uint32 FrameAllocations = 0;
+	Uint32 LastFrameAllocations = 0;
+};
 
+class Memory {
 public:
 	static size_t MemoryUsage;
 	static bool IsTracking;
@@ -25,6 +31,10 @@ public:
 	static void Free(void* pointer);
 	static void Remove(void* pointer);
 	static const char* GetName(void* pointer);
+	static size_t GetAllocationCount();
+	static Uint32 GetFrameAllocationCount();
+	static vector<MemoryTagStats> GetTagStats();
+	static void EndFrame();
 	static void ClearTrackedMemory();
 	static size_t CheckLeak();
 	static void PrintLeak();
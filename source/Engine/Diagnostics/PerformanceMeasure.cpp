@@ -1,5 +1,6 @@
 #include <Engine/Diagnostics/Clock.h>
 #include <Engine/Diagnostics/PerformanceMeasure.h>
+#include <Engine/Diagnostics/Profiler.h>
 
 PerformanceMeasure::PerformanceMeasure(const char* name,
 	float r,
@@ -41,15 +42,27 @@ void PerformanceMeasure::Reset() {
 	Time = 0.0;
 }
 void PerformanceMeasure::Begin() {
+	if (Name) {
+		PROFILE_BEGIN(Name);
+	}
+
 	StartTime = Clock::GetTicks();
 }
 void PerformanceMeasure::End() {
 	EndTime = Clock::GetTicks();
 
+	if (Name) {
+		PROFILE_END();
+	}
+
 	Time = EndTime - StartTime;
 }
 void PerformanceMeasure::Accumulate() {
 	EndTime = Clock::GetTicks();
 
+	if (Name) {
+		PROFILE_END();
+	}
+
 	Time += EndTime - StartTime;
 }
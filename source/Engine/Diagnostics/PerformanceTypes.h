@@ -6,6 +6,7 @@
 struct ApplicationMetrics {
 	PerformanceMeasure Event;
 	PerformanceMeasure AfterScene;
+	PerformanceMeasure ResourceLoading;
 	PerformanceMeasure Poll;
 	PerformanceMeasure Update;
 	PerformanceMeasure Clear;
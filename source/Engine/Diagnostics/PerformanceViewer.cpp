@@ -183,8 +183,24 @@ void PerformanceViewer::DrawDetailed(Font* font) {
 	snprintf(textBuffer, sizeof textBuffer, "Overdelay: %.3f ms", Application::GetOverdelay());
 	Graphics::SetBlendColor(1.0, 1.0, 1.0, 1.0);
 	Graphics::DrawText(font, textBuffer, textX, textY, &textParams);
+	listY += 20.0;
 	Graphics::Restore();
 
+	// Draw batching
+	if (Graphics::LastFrameDrawCommands) {
+		Graphics::Save();
+		Graphics::Translate(infoPadding - 24.0, listY, 0.0);
+		Graphics::Scale(0.6, 0.6, 1.0);
+		snprintf(textBuffer,
+			sizeof textBuffer,
+			"Draw Calls: %u (%u commands)",
+			Graphics::LastFrameDrawCalls,
+			Graphics::LastFrameDrawCommands);
+		Graphics::SetBlendColor(1.0, 1.0, 1.0, 1.0);
+		Graphics::DrawText(font, textBuffer, textX, textY, &textParams);
+		Graphics::Restore();
+	}
+
 	listY += 50.0;
 
 	if (Memory::IsTracking) {
@@ -0,0 +1,376 @@
+#include <Engine/Diagnostics/Clock.h>
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Memory.h>
+#include <Engine/Diagnostics/Profiler.h>
+#include <Engine/IO/FileStream.h>
+#include <Engine/Utilities/StringUtils.h>
+
+#include <atomic>
+#include <mutex>
+
+// Zones are only recorded while a capture is running. Each thread writes the
+// zones it finishes into its own ring buffer, so recording one never takes a
+// lock; the buffers are only read when the capture is exported.
+struct ProfilerEvent {
+	const char* Name;
+	double Start;
+	double End;
+	int Arg;
+	Uint16 Depth;
+	char Detail[PROFILER_DETAIL_LENGTH];
+};
+
+struct ProfilerOpenZone {
+	const char* Name;
+	double Start;
+	int Arg;
+	char Detail[PROFILER_DETAIL_LENGTH];
+};
+
+struct ProfilerThread {
+	int ID;
+	char Name[32];
+	std::atomic<bool> Exited{false};
+
+	// Only the owning thread writes these. Count is published after an event
+	// is written, so that the exporting thread sees whole events.
+	ProfilerEvent* Events = nullptr;
+	std::atomic<Uint32> Count{0};
+
+	Uint32 Depth = 0;
+	ProfilerOpenZone Stack[PROFILER_MAX_DEPTH];
+};
+
+// Marks the thread's buffer as no longer being written to when the thread
+// exits, so that it can be freed.
+struct ProfilerThreadHandle {
+	ProfilerThread* Thread = nullptr;
+
+	~ProfilerThreadHandle() {
+		if (Thread) {
+			Thread->Exited = true;
+		}
+	}
+};
+
+static thread_local ProfilerThreadHandle CurrentThread;
+
+static std::mutex RegistryLock;
+static vector<ProfilerThread*> Threads;
+static int NextThreadID = 1;
+
+static std::atomic<bool> Capturing{false};
+
+int Profiler::FrameNumber = 0;
+int Profiler::CaptureStartFrame = -1;
+int Profiler::CaptureEndFrame = -1;
+double Profiler::CaptureStartTime = 0.0;
+double Profiler::CaptureEndTime = 0.0;
+std::string Profiler::CaptureFilename;
+
+static void FreeExitedThreads() {
+	std::lock_guard<std::mutex> lock(RegistryLock);
+	for (size_t i = 0; i < Threads.size();) {
+		ProfilerThread* thread = Threads[i];
+		if (thread->Exited) {
+			Memory::Free(thread->Events);
+			delete thread;
+			Threads.erase(Threads.begin() + i);
+		}
+		else {
+			i++;
+		}
+	}
+}
+
+ProfilerThread* Profiler::GetThread() {
+	ProfilerThread* thread = CurrentThread.Thread;
+	if (thread) {
+		return thread;
+	}
+
+	thread = new ProfilerThread();
+	thread->Name[0] = '\0';
+
+	std::lock_guard<std::mutex> lock(RegistryLock);
+	thread->ID = NextThreadID++;
+	Threads.push_back(thread);
+
+	CurrentThread.Thread = thread;
+	return thread;
+}
+
+void Profiler::SetThreadName(const char* name) {
+	ProfilerThread* thread = GetThread();
+	if (thread->Name[0] == '\0') {
+		StringUtils::Copy(thread->Name, name, sizeof thread->Name);
+	}
+}
+
+void Profiler::Begin(const char* name, int arg, const char* detail) {
+	if (!Capturing.load(std::memory_order_relaxed)) {
+		return;
+	}
+
+	ProfilerThread* thread = GetThread();
+	if (!thread->Events) {
+		thread->Events = (ProfilerEvent*)Memory::TrackedMalloc(
+			"Profiler::Events", PROFILER_BUFFER_SIZE * sizeof(ProfilerEvent));
+		if (!thread->Events) {
+			return;
+		}
+	}
+
+	// Zones nested deeper than this are still counted, so that their ends
+	// match up, but aren't recorded.
+	if (thread->Depth < PROFILER_MAX_DEPTH) {
+		ProfilerOpenZone& zone = thread->Stack[thread->Depth];
+		zone.Name = name;
+		zone.Arg = arg;
+		if (detail) {
+			// Keep the end of long details, since those are usually paths.
+			size_t length = strlen(detail);
+			if (length >= sizeof zone.Detail) {
+				detail += length - (sizeof zone.Detail - 1);
+			}
+			StringUtils::Copy(zone.Detail, detail, sizeof zone.Detail);
+		}
+		else {
+			zone.Detail[0] = '\0';
+		}
+		zone.Start = Clock::GetTicks();
+	}
+	thread->Depth++;
+}
+void Profiler::BeginZone(const char* name) {
+	Begin(name, PROFILER_NO_ARG, nullptr);
+}
+void Profiler::BeginZone(const char* name, int arg) {
+	Begin(name, arg, nullptr);
+}
+void Profiler::BeginZone(const char* name, const char* detail) {
+	Begin(name, PROFILER_NO_ARG, detail);
+}
+// Zones that began before the capture did were never pushed, so ending them
+// does nothing. Zones that began during the capture are still recorded if
+// they end after it, since they overlap it.
+void Profiler::EndZone() {
+	ProfilerThread* thread = CurrentThread.Thread;
+	if (!thread || thread->Depth == 0) {
+		return;
+	}
+
+	thread->Depth--;
+	if (thread->Depth >= PROFILER_MAX_DEPTH) {
+		return;
+	}
+
+	ProfilerOpenZone& zone = thread->Stack[thread->Depth];
+	Uint32 index = thread->Count.load(std::memory_order_relaxed);
+	ProfilerEvent& event = thread->Events[index & (PROFILER_BUFFER_SIZE - 1)];
+	event.Name = zone.Name;
+	event.Start = zone.Start;
+	event.End = Clock::GetTicks();
+	event.Arg = zone.Arg;
+	event.Depth = (Uint16)thread->Depth;
+	memcpy(event.Detail, zone.Detail, sizeof event.Detail);
+	thread->Count.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::BeginFrame() {
+	FrameNumber++;
+
+	if (CaptureStartFrame != -1 && FrameNumber == CaptureStartFrame) {
+		CaptureStartTime = Clock::GetTicks();
+		Capturing = true;
+
+		Log::Print(Log::LOG_INFO,
+			"Profiler capture started (frames %d to %d).",
+			CaptureStartFrame,
+			CaptureEndFrame);
+	}
+
+	BeginZone("Frame", FrameNumber);
+}
+void Profiler::EndFrame() {
+	EndZone();
+
+	if (Capturing && FrameNumber >= CaptureEndFrame) {
+		StopCapture();
+	}
+}
+
+// Starts recording `startFrame` frames from now, for `frameCount` frames, and
+// exports the capture to `filename` once it's done.
+bool Profiler::StartCapture(int startFrame, int frameCount, const char* filename) {
+#ifdef ENABLE_PROFILER
+	if (Capturing || CaptureStartFrame != -1) {
+		Log::Print(Log::LOG_WARN, "A profiler capture is already in progress.");
+		return false;
+	}
+	if (startFrame < 0) {
+		startFrame = 0;
+	}
+	if (frameCount < 1) {
+		frameCount = 1;
+	}
+
+	// Buffers of threads that have exited since the last capture are no
+	// longer needed.
+	FreeExitedThreads();
+
+	CaptureFilename = filename;
+	CaptureStartFrame = FrameNumber + 1 + startFrame;
+	CaptureEndFrame = CaptureStartFrame + frameCount - 1;
+	return true;
+#else
+	Log::Print(Log::LOG_WARN,
+		"Can't capture \"%s\": the profiler was not enabled in this build.",
+		filename);
+	return false;
+#endif
+}
+bool Profiler::IsCapturing() {
+	return Capturing || CaptureStartFrame != -1;
+}
+void Profiler::StopCapture() {
+	CaptureEndTime = Clock::GetTicks();
+	Capturing = false;
+	CaptureStartFrame = -1;
+
+	if (Export(CaptureFilename.c_str())) {
+		Log::Print(Log::LOG_INFO, "Profiler capture written to \"%s\".", CaptureFilename.c_str());
+	}
+}
+
+static void WriteJSONString(std::string& out, const char* text) {
+	out += '"';
+	for (const char* c = text; *c; c++) {
+		switch (*c) {
+		case '"':
+			out += "\\\"";
+			break;
+		case '\\':
+			out += "\\\\";
+			break;
+		default:
+			if ((Uint8)*c < 0x20) {
+				char escaped[8];
+				snprintf(escaped, sizeof escaped, "\\u%04x", *c);
+				out += escaped;
+			}
+			else {
+				out += *c;
+			}
+			break;
+		}
+	}
+	out += '"';
+}
+
+// Writes the capture in the Chrome Trace Event format, which can be opened in
+// chrome://tracing or Perfetto. Zones with a detail are named by it, and use
+// their zone name as the category.
+bool Profiler::Export(const char* filename) {
+	Stream* stream = FileStream::New(filename, FileStream::WRITE_ACCESS);
+	if (!stream) {
+		Log::Print(Log::LOG_ERROR, "Couldn't open \"%s\" for writing!", filename);
+		return false;
+	}
+
+	std::string out;
+	out.reserve(0x100000);
+	out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+	char line[128];
+	bool first = true;
+
+	std::lock_guard<std::mutex> lock(RegistryLock);
+	for (size_t t = 0; t < Threads.size(); t++) {
+		ProfilerThread* thread = Threads[t];
+
+		if (!first) {
+			out += ",\n";
+		}
+		first = false;
+
+		snprintf(line,
+			sizeof line,
+			"{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":",
+			thread->ID);
+		out += line;
+		if (thread->Name[0]) {
+			WriteJSONString(out, thread->Name);
+		}
+		else {
+			snprintf(line, sizeof line, "\"Thread %d\"", thread->ID);
+			out += line;
+		}
+		out += "}}";
+
+		if (!thread->Events) {
+			continue;
+		}
+
+		// A thread can still finish the zones it had open when the capture
+		// stopped, so if its buffer wrapped around, the oldest few events may
+		// be getting overwritten.
+		Uint32 count = thread->Count.load(std::memory_order_acquire);
+		Uint32 start = 0;
+		if (count > PROFILER_BUFFER_SIZE) {
+			start = count - PROFILER_BUFFER_SIZE + PROFILER_MAX_DEPTH * 2;
+		}
+
+		for (Uint32 i = start; i < count; i++) {
+			ProfilerEvent& event = thread->Events[i & (PROFILER_BUFFER_SIZE - 1)];
+			if (event.End < CaptureStartTime || event.Start > CaptureEndTime) {
+				continue;
+			}
+
+			double ts = (event.Start - CaptureStartTime) * 1000.0;
+			double dur = (event.End - event.Start) * 1000.0;
+
+			out += ",\n{\"ph\":\"X\",\"name\":";
+			if (event.Detail[0]) {
+				WriteJSONString(out, event.Detail);
+				out += ",\"cat\":";
+				WriteJSONString(out, event.Name);
+			}
+			else {
+				WriteJSONString(out, event.Name);
+				out += ",\"cat\":\"engine\"";
+			}
+
+			snprintf(line,
+				sizeof line,
+				",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+				thread->ID,
+				ts,
+				dur);
+			out += line;
+
+			if (event.Arg != PROFILER_NO_ARG) {
+				snprintf(line, sizeof line, ",\"args\":{\"value\":%d}", event.Arg);
+				out += line;
+			}
+			out += '}';
+		}
+	}
+
+	out += "\n]}\n";
+
+	stream->WriteBytes((void*)out.data(), out.size());
+	stream->Close();
+	return true;
+}
+
+// Writes out a capture that was still running. Buffers of threads that are
+// still alive are left alone, since they may yet be written to.
+void Profiler::Dispose() {
+	if (Capturing) {
+		StopCapture();
+	}
+	CaptureStartFrame = -1;
+
+	FreeExitedThreads();
+}
@@ -0,0 +1,85 @@
+#ifndef ENGINE_DIAGNOSTICS_PROFILER_H
+#define ENGINE_DIAGNOSTICS_PROFILER_H
+
+#include <Engine/Includes/Standard.h>
+
+// How many finished zones each thread keeps. Must be a power of two.
+#define PROFILER_BUFFER_SIZE 0x10000
+#define PROFILER_MAX_DEPTH 64
+#define PROFILER_DETAIL_LENGTH 32
+#define PROFILER_NO_ARG INT_MIN
+
+struct ProfilerThread;
+
+class Profiler {
+private:
+	static int FrameNumber;
+	static int CaptureStartFrame;
+	static int CaptureEndFrame;
+	static double CaptureStartTime;
+	static double CaptureEndTime;
+	static std::string CaptureFilename;
+
+	static ProfilerThread* GetThread();
+	static void Begin(const char* name, int arg, const char* detail);
+	static void StopCapture();
+
+public:
+	static void SetThreadName(const char* name);
+	static void BeginZone(const char* name);
+	static void BeginZone(const char* name, int arg);
+	static void BeginZone(const char* name, const char* detail);
+	static void EndZone();
+
+	static void BeginFrame();
+	static void EndFrame();
+
+	static bool StartCapture(int startFrame, int frameCount, const char* filename);
+	static bool IsCapturing();
+	static bool Export(const char* filename);
+	static void Dispose();
+};
+
+// Begins a zone that ends when the enclosing scope does.
+class ProfilerZone {
+public:
+	ProfilerZone(const char* name) {
+		Profiler::BeginZone(name);
+	}
+	ProfilerZone(const char* name, int arg) {
+		Profiler::BeginZone(name, arg);
+	}
+	ProfilerZone(const char* name, const char* detail) {
+		Profiler::BeginZone(name, detail);
+	}
+	~ProfilerZone() {
+		Profiler::EndZone();
+	}
+};
+
+#define PROFILER_CONCAT_(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_(a, b)
+
+// Zone names must be string literals (or otherwise outlive the capture);
+// details are copied.
+#ifdef ENABLE_PROFILER
+#define PROFILE_ZONE(name) ProfilerZone PROFILER_CONCAT(_profilerZone, __LINE__)(name)
+#define PROFILE_ZONE_ARG(name, arg) \
+	ProfilerZone PROFILER_CONCAT(_profilerZone, __LINE__)(name, (int)(arg))
+#define PROFILE_ZONE_DETAIL(name, detail) \
+	ProfilerZone PROFILER_CONCAT(_profilerZone, __LINE__)(name, (const char*)(detail))
+#define PROFILE_BEGIN(name) Profiler::BeginZone(name)
+#define PROFILE_BEGIN_ARG(name, arg) Profiler::BeginZone(name, (int)(arg))
+#define PROFILE_END() Profiler::EndZone()
+#define PROFILE_THREAD(name) Profiler::SetThreadName(name)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_ZONE_ARG(name, arg)
+#define PROFILE_ZONE_DETAIL(name, detail)
+#define PROFILE_BEGIN(name)
+#define PROFILE_BEGIN_ARG(name, arg)
+#define PROFILE_END()
+#define PROFILE_THREAD(name)
+#endif
+
+#endif /* ENGINE_DIAGNOSTICS_PROFILER_H */
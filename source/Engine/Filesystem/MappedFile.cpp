@@ -0,0 +1,125 @@
+#include <Engine/Filesystem/MappedFile.h>
+
+#include <Engine/Diagnostics/Log.h>
+
+#if WIN32
+#include <windows.h>
+#define MAPPED_FILE_SUPPORTED
+#elif defined(LINUX) || defined(MACOSX) || defined(ANDROID)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPED_FILE_SUPPORTED
+#endif
+
+bool MappedFile::Enabled = true;
+
+MappedFile::MappedFile() {
+	References.store(1);
+}
+MappedFile::~MappedFile() {
+#if WIN32
+	if (Data) {
+		UnmapViewOfFile(Data);
+	}
+	if (Handle) {
+		CloseHandle((HANDLE)Handle);
+	}
+#elif defined(MAPPED_FILE_SUPPORTED)
+	if (Data) {
+		munmap(Data, Size);
+	}
+#endif
+}
+
+bool MappedFile::IsSupported() {
+#ifdef MAPPED_FILE_SUPPORTED
+	return true;
+#else
+	return false;
+#endif
+}
+
+// Returns nullptr if the platform can't map files, or if this one couldn't
+// be mapped; callers then read the file as usual.
+MappedFile* MappedFile::Open(const char* path) {
+	if (!Enabled || path == nullptr) {
+		return nullptr;
+	}
+
+#if WIN32
+	HANDLE file = CreateFileA(path,
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		NULL,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL,
+		NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return nullptr;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(file);
+		return nullptr;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (mapping == NULL) {
+		return nullptr;
+	}
+
+	void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data == NULL) {
+		CloseHandle(mapping);
+		return nullptr;
+	}
+
+	MappedFile* mappedFile = new MappedFile();
+	mappedFile->Handle = (void*)mapping;
+	mappedFile->Data = (Uint8*)data;
+	mappedFile->Size = (size_t)fileSize.QuadPart;
+	return mappedFile;
+#elif defined(MAPPED_FILE_SUPPORTED)
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return nullptr;
+	}
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode) || fileStat.st_size == 0) {
+		close(fd);
+		return nullptr;
+	}
+
+	size_t size = (size_t)fileStat.st_size;
+	void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		Log::Print(Log::LOG_VERBOSE, "Could not map \"%s\" into memory", path);
+		return nullptr;
+	}
+
+	MappedFile* mappedFile = new MappedFile();
+	mappedFile->Data = (Uint8*)data;
+	mappedFile->Size = size;
+	return mappedFile;
+#else
+	return nullptr;
+#endif
+}
+
+bool MappedFile::IsShared() {
+	return References.load() > 1;
+}
+void MappedFile::AddRef() {
+	References.fetch_add(1);
+}
+void MappedFile::Release() {
+	if (References.fetch_sub(1) == 1) {
+		delete this;
+	}
+}
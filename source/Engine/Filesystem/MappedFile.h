@@ -0,0 +1,34 @@
+#ifndef ENGINE_FILESYSTEM_MAPPEDFILE_H
+#define ENGINE_FILESYSTEM_MAPPEDFILE_H
+
+#include <Engine/Includes/Standard.h>
+
+#include <atomic>
+
+// Files smaller than this are cheaper to just read.
+#define MAPPED_FILE_MIN_SIZE 0x10000
+
+// A read-only view of a whole file. The mapping is reference counted, so
+// streams reading from it keep it alive after whoever opened it lets go.
+class MappedFile {
+private:
+	std::atomic<int> References;
+	void* Handle = nullptr;
+
+	MappedFile();
+	~MappedFile();
+
+public:
+	Uint8* Data = nullptr;
+	size_t Size = 0;
+
+	static bool Enabled;
+
+	static bool IsSupported();
+	static MappedFile* Open(const char* path);
+	bool IsShared();
+	void AddRef();
+	void Release();
+};
+
+#endif /* ENGINE_FILESYSTEM_MAPPEDFILE_H */
@@ -132,6 +132,37 @@ bool FileSystemVFS::ReadFile(const char* filename, Uint8** out, size_t* size) {
 	return true;
 }
 
+bool FileSystemVFS::MapFile(const char* filename,
+	Uint8** out,
+	size_t* size,
+	MappedFile** mapping) {
+	if (!IsReadable() || IsWritable()) {
+		return false;
+	}
+
+	char resourcePath[MAX_RESOURCE_PATH_LENGTH];
+	if (!GetPath(filename, resourcePath, sizeof resourcePath)) {
+		return false;
+	}
+
+	// Small files aren't worth a mapping of their own.
+	VFSEntry* entry = FindFile(filename);
+	if (entry == nullptr || entry->Size < MAPPED_FILE_MIN_SIZE) {
+		return false;
+	}
+
+	MappedFile* mappedFile = MappedFile::Open(resourcePath);
+	if (mappedFile == nullptr) {
+		return false;
+	}
+
+	*out = mappedFile->Data;
+	*size = mappedFile->Size;
+	*mapping = mappedFile;
+
+	return true;
+}
+
 bool FileSystemVFS::PutFile(const char* filename, VFSEntry* entry) {
 	if (!IsWritable()) {
 		return false;
@@ -2,19 +2,19 @@
 
 #include <Engine/Diagnostics/Log.h>
 #include <Engine/Diagnostics/Memory.h>
+#include <Engine/Filesystem/File.h>
 #include <Engine/Hashing/CRC32.h>
+#include <Engine/IO/Compression/ChunkedZLibStream.h>
 #include <Engine/IO/Compression/ZLibStream.h>
 #include <Engine/IO/MemoryStream.h>
 #include <Engine/Utilities/StringUtils.h>
 
-#define MAGIC_HATCH_SIZE 5
-
 char MAGIC_HATCH[MAGIC_HATCH_SIZE] = {0x48, 0x41, 0x54, 0x43, 0x48}; // HATCH
 
 #define ENTRY_NAME_LENGTH 8
 
 bool HatchVFS::Open(Stream* stream) {
-	Uint16 fileCount;
+	Uint32 fileCount;
 	Uint8 magicHATCH[MAGIC_HATCH_SIZE];
 	stream->ReadBytes(magicHATCH, MAGIC_HATCH_SIZE);
 	if (memcmp(magicHATCH, MAGIC_HATCH, MAGIC_HATCH_SIZE)) {
@@ -29,12 +29,19 @@ bool HatchVFS::Open(Stream* stream) {
 	}
 
 	// Uint8 major, minor, pad;
+	Uint8 major = stream->ReadByte();
 	stream->ReadByte();
 	stream->ReadByte();
-	stream->ReadByte();
 
-	fileCount = stream->ReadUInt16();
-	for (int i = 0; i < fileCount; i++) {
+	// Version 2 widened the file count.
+	if (major >= HATCH_VERSION_LARGE) {
+		fileCount = stream->ReadUInt32();
+	}
+	else {
+		fileCount = stream->ReadUInt16();
+	}
+
+	for (Uint32 i = 0; i < fileCount; i++) {
 		Uint32 crc32 = stream->ReadUInt32();
 		Uint64 offset = stream->ReadUInt64();
 		Uint64 size = stream->ReadUInt64();
@@ -45,9 +52,12 @@ bool HatchVFS::Open(Stream* stream) {
 		if (size != compressedSize) {
 			entryFlags |= VFSE_COMPRESSED;
 		}
-		if (dataFlag == 2) {
+		if (dataFlag & HATCH_DATA_ENCRYPTED) {
 			entryFlags |= VFSE_ENCRYPTED;
 		}
+		if (dataFlag & HATCH_DATA_CHUNKED) {
+			entryFlags |= VFSE_COMPRESSED | VFSE_CHUNKED;
+		}
 
 		char entryName[ENTRY_NAME_LENGTH + 1];
 		snprintf(entryName, ENTRY_NAME_LENGTH + 1, "%08x", crc32);
@@ -74,6 +84,48 @@ bool HatchVFS::Open(Stream* stream) {
 	return true;
 }
 
+// Maps the archive this VFS was opened from, so that entries stored as-is
+// can be handed out without being read into memory. Only done for read-only
+// mounts, since repacking rewrites the file in place. The path is also kept
+// for streams that need their own handle to the file.
+void HatchVFS::MapArchive(const char* path) {
+	ArchivePath = std::string(path);
+
+	if (!Opened || Mapping != nullptr || IsWritable()) {
+		return;
+	}
+
+	Mapping = MappedFile::Open(path);
+	if (Mapping) {
+		Log::Print(Log::LOG_VERBOSE,
+			"Mapped HATCH file \"%s\" (%u KB)",
+			path,
+			(unsigned)(Mapping->Size / 1024));
+	}
+}
+
+void HatchVFS::ReleaseMapping() {
+	if (Mapping) {
+		Mapping->Release();
+		Mapping = nullptr;
+	}
+}
+
+// Returns where the entry's bytes are in the mapping, or nullptr if the
+// archive isn't mapped.
+Uint8* HatchVFS::GetMappedEntryData(VFSEntry* entry) {
+	if (Mapping == nullptr) {
+		return nullptr;
+	}
+
+	Uint64 size = (entry->FileFlags & VFSE_COMPRESSED) ? entry->CompressedSize : entry->Size;
+	if (entry->Offset > Mapping->Size || size > Mapping->Size - entry->Offset) {
+		return nullptr;
+	}
+
+	return Mapping->Data + entry->Offset;
+}
+
 std::string HatchVFS::TransformFilename(const char* filename) {
 	char transformedFilename[ENTRY_NAME_LENGTH + 1];
 
@@ -165,56 +217,162 @@ void HatchVFS::CryptoXOR(Uint8* data, size_t size, Uint32 filenameHash, bool dec
 	}
 }
 
+// Reads the entry's bytes exactly as they are in the file.
+bool HatchVFS::ReadFileData(VFSEntry* entry, Uint8* memory, size_t size) {
+	Uint8* mapped = GetMappedEntryData(entry);
+	if (mapped) {
+		memcpy(memory, mapped, size);
+		return true;
+	}
+
+	StreamPtr->Seek(entry->Offset);
+	return StreamPtr->ReadBytes(memory, size) == size;
+}
+
 bool HatchVFS::ReadEntryData(VFSEntry* entry, Uint8* memory, size_t memSize) {
 	size_t copyLength = entry->Size;
 	if (copyLength > memSize) {
 		copyLength = memSize;
 	}
 
-	StreamPtr->Seek(entry->Offset);
-	StreamPtr->ReadBytes(memory, copyLength);
-
-	// Decrypt it if it's encrypted
-	if (entry->Flags & VFSE_ENCRYPTED) {
-		// Get decryption hash from filename
-		Uint32 hash = 0;
-
+	// Get decryption hash from filename
+	Uint32 hash = 0;
+	if (entry->FileFlags & VFSE_ENCRYPTED) {
 		// Result doesn't need to be checked because it's guaranteed to be valid.
 		StringUtils::HexToUint32(&hash, entry->Name.c_str());
-
-		CryptoXOR(memory, copyLength, hash, true);
 	}
 
-	// Decompress it if it's compressed
-	if (entry->Flags & VFSE_COMPRESSED) {
-		Uint8* compressedMemory = (Uint8*)Memory::Malloc(entry->CompressedSize);
-		if (!compressedMemory) {
-			Memory::Free(memory);
+	// Stored entries can be read straight into the destination
+	if (!(entry->FileFlags & VFSE_COMPRESSED)) {
+		if (!ReadFileData(entry, memory, copyLength)) {
 			return false;
 		}
 
-		size_t compressedCopyLength = entry->CompressedSize;
-		if (compressedCopyLength > entry->Size) {
-			compressedCopyLength = entry->Size;
+		if (entry->FileFlags & VFSE_ENCRYPTED) {
+			CryptoXOR(memory, copyLength, hash, true);
 		}
-		memcpy(compressedMemory, memory, compressedCopyLength);
-
-		Uint8* srcData = memory;
-		size_t srcSize = (size_t)entry->Size;
-		Uint8* destData = compressedMemory;
-		size_t destSize = (size_t)entry->CompressedSize;
-		if (destSize > copyLength) {
-			destSize = copyLength;
+
+		return true;
+	}
+
+	size_t fileSize = (size_t)entry->CompressedSize;
+
+	// Unencrypted data can be decompressed straight out of the mapping
+	Uint8* fileData = nullptr;
+	if (!(entry->FileFlags & VFSE_ENCRYPTED)) {
+		fileData = GetMappedEntryData(entry);
+	}
+
+	Uint8* fileMemory = nullptr;
+	if (fileData == nullptr) {
+		fileMemory = (Uint8*)Memory::Malloc(fileSize);
+		if (!fileMemory) {
+			return false;
 		}
 
-		if (!ZLibStream::Decompress(srcData, srcSize, destData, destSize)) {
-			Memory::Free(memory);
+		if (!ReadFileData(entry, fileMemory, fileSize)) {
+			Memory::Free(fileMemory);
 			return false;
 		}
 
-		Memory::Free(compressedMemory);
+		// Encryption is applied after compression, so undo it first
+		if (entry->FileFlags & VFSE_ENCRYPTED) {
+			CryptoXOR(fileMemory, fileSize, hash, true);
+		}
+
+		fileData = fileMemory;
+	}
+
+	bool success;
+	if (!(entry->FileFlags & VFSE_CHUNKED)) {
+		success = ZLibStream::Decompress(memory, copyLength, fileData, fileSize);
+	}
+	else if (copyLength == entry->Size) {
+		success = ChunkedZLibStream::Decompress(memory, copyLength, fileData, fileSize);
+	}
+	else {
+		// Only part of the entry was asked for
+		ChunkedZLibStream* stream =
+			ChunkedZLibStream::New(fileData, fileSize, (size_t)entry->Size, nullptr);
+		success = stream != nullptr && stream->ReadBytes(memory, copyLength) == copyLength;
+		if (stream) {
+			stream->Close();
+		}
+	}
+
+	Memory::Free(fileMemory);
+
+	return success;
+}
+
+// Opens chunked entries as a stream that decodes only the chunks it reads.
+// The stream doesn't share anything with this VFS other than the mapping,
+// so it can be read from any thread and outlive the mount.
+Stream* HatchVFS::OpenSeekableStream(const char* filename) {
+	if (!IsReadable() || IsWritable()) {
+		return nullptr;
+	}
+
+	VFSEntry* entry = FindFile(filename);
+	if (entry == nullptr || entry->CachedData != nullptr) {
+		return nullptr;
+	}
+
+	// Encrypted data has to be decrypted from the start of the entry.
+	if ((entry->FileFlags & (VFSE_CHUNKED | VFSE_ENCRYPTED)) != VFSE_CHUNKED) {
+		return nullptr;
+	}
+
+	Uint8* data = GetMappedEntryData(entry);
+	if (data) {
+		return ChunkedZLibStream::New(
+			data, (size_t)entry->CompressedSize, (size_t)entry->Size, Mapping);
+	}
+
+	// Without a mapping, the stream reads from its own handle to the file.
+	if (ArchivePath.empty()) {
+		return nullptr;
+	}
+
+	Stream* source = File::Open(ArchivePath.c_str(), File::READ_ACCESS);
+	if (!source) {
+		return nullptr;
+	}
+
+	return ChunkedZLibStream::New(
+		source, entry->Offset, entry->CompressedSize, (size_t)entry->Size);
+}
+
+bool HatchVFS::MapFile(const char* filename,
+	Uint8** out,
+	size_t* size,
+	MappedFile** mapping) {
+	if (!IsReadable() || IsWritable()) {
+		return false;
+	}
+
+	VFSEntry* entry = FindFile(filename);
+	if (entry == nullptr || entry->CachedData != nullptr) {
+		return false;
+	}
+
+	// Compressed and encrypted entries have to be decoded into their own
+	// buffer, so only stored entries can point into the mapping.
+	if (entry->FileFlags & (VFSE_COMPRESSED | VFSE_ENCRYPTED)) {
+		return false;
+	}
+
+	Uint8* data = GetMappedEntryData(entry);
+	if (data == nullptr) {
+		return false;
 	}
 
+	Mapping->AddRef();
+
+	*out = data;
+	*size = entry->Size;
+	*mapping = Mapping;
+
 	return true;
 }
 
@@ -281,13 +439,42 @@ bool HatchVFS::Flush() {
 
 	bool success = false;
 
+	// The file is about to be rewritten, so nothing may still be reading
+	// from the mapping.
+	if (Mapping) {
+		if (Mapping->IsShared()) {
+			Log::Print(Log::LOG_ERROR,
+				"Cannot repack HATCH file while its mapped entries are in use!");
+			return false;
+		}
+
+		ReleaseMapping();
+	}
+
+	// Older builds can't read more than 65535 entries, or chunked entries,
+	// so only use the newer version when either is needed.
+	Uint8 version = HATCH_VERSION_ORIGINAL;
+	if (NumEntries > 0xFFFF) {
+		version = HATCH_VERSION_LARGE;
+	}
+
+	for (VFSEntryMap::iterator it = Entries.begin(); it != Entries.end(); it++) {
+		if ((it->second->Flags & VFSE_COMPRESSED) && (it->second->Flags & VFSE_CHUNKED)) {
+			version = HATCH_VERSION_LARGE;
+		}
+	}
+
 	// Calculate total length of all files and headers
-	size_t totalSize = 10 + (32 * NumEntries);
+	size_t headerSize = version >= HATCH_VERSION_LARGE ? 12 : 10;
+	size_t totalSize = headerSize + (HATCH_TOC_ENTRY_SIZE * NumEntries);
 
 	for (VFSEntryMap::iterator it = Entries.begin(); it != Entries.end(); it++) {
 		totalSize += it->second->CompressedSize;
 	}
 
+	// What each entry ends up taking in the file
+	std::vector<size_t> writtenSizes(NumEntries);
+
 	// Begin writing
 	MemoryStream* out = MemoryStream::New(totalSize);
 	if (out == nullptr) {
@@ -299,14 +486,19 @@ bool HatchVFS::Flush() {
 	out->WriteBytes(MAGIC_HATCH, MAGIC_HATCH_SIZE);
 
 	// Write version
-	out->WriteByte(0x01);
+	out->WriteByte(version);
 	out->WriteByte(0x00);
 	out->WriteByte(0x00);
 
 	// Write number of files
-	out->WriteUInt16(NumEntries);
+	if (version >= HATCH_VERSION_LARGE) {
+		out->WriteUInt32(NumEntries);
+	}
+	else {
+		out->WriteUInt16(NumEntries);
+	}
 
-	size_t tocEnd = out->Position() + (32 * NumEntries);
+	size_t tocEnd = out->Position() + (HATCH_TOC_ENTRY_SIZE * NumEntries);
 	size_t offsetGLOB = 0;
 
 	for (size_t i = 0; i < NumEntries; i++) {
@@ -340,6 +532,7 @@ bool HatchVFS::Flush() {
 				Log::Print(Log::LOG_ERROR,
 					"Could not read entry %s!",
 					entry->Name.c_str());
+				Memory::Free(memory);
 				out->Close();
 				return false;
 			}
@@ -348,10 +541,21 @@ bool HatchVFS::Flush() {
 			shouldFreeData = true;
 		}
 
-		// The only flag that matters.
-		Uint8 dataType = (entry->Flags & VFSE_ENCRYPTED) ? 2 : 0;
+		// Unchanged entries keep the flags they have in the file.
+		Uint8 dataFlags = cachedData != nullptr ? entry->Flags : entry->FileFlags;
+		Uint32 dataType = 0;
+		if (dataFlags & VFSE_ENCRYPTED) {
+			dataType |= HATCH_DATA_ENCRYPTED;
+		}
 
 		size_t compressedSize = entry->Size;
+		if (cachedData == nullptr && (entry->FileFlags & VFSE_COMPRESSED)) {
+			compressedSize = entry->CompressedSize;
+
+			if (entry->FileFlags & VFSE_CHUNKED) {
+				dataType |= HATCH_DATA_CHUNKED;
+			}
+		}
 
 		// Entry needs to be rewritten
 		if (cachedData != nullptr) {
@@ -362,11 +566,28 @@ bool HatchVFS::Flush() {
 				void* compressed = nullptr;
 				size_t compSize = 0;
 
-				if (ZLibStream::Compress(
-					    cachedData, entry->Size, &compressed, &compSize)) {
+				bool chunked = (entry->Flags & VFSE_CHUNKED) != 0;
+				bool didCompress;
+				if (chunked) {
+					didCompress = ChunkedZLibStream::Compress(cachedData,
+						entry->Size,
+						CHUNKED_ZLIB_DEFAULT_CHUNK_SIZE,
+						&compressed,
+						&compSize);
+				}
+				else {
+					didCompress = ZLibStream::Compress(
+						cachedData, entry->Size, &compressed, &compSize);
+				}
+
+				if (didCompress) {
 					cachedDataInFile = (Uint8*)compressed;
 					compressedSize = compSize;
 					shouldFreeDataInFile = true;
+
+					if (chunked) {
+						dataType |= HATCH_DATA_CHUNKED;
+					}
 				}
 				else {
 					Log::Print(Log::LOG_ERROR,
@@ -408,7 +629,7 @@ bool HatchVFS::Flush() {
 
 				if (!didEncrypt) {
 					// Reset data flag so that the entry is not saved as encrypted
-					dataType = 0;
+					dataType &= ~HATCH_DATA_ENCRYPTED;
 
 					Log::Print(Log::LOG_ERROR,
 						"Could not encrypt entry %s!",
@@ -435,7 +656,7 @@ bool HatchVFS::Flush() {
 			// Note that this should be the entry's old offset,
 			// not the current one that will be written.
 			StreamPtr->Seek(entry->Offset);
-			StreamPtr->CopyTo(out, entry->Size);
+			StreamPtr->CopyTo(out, compressedSize);
 		}
 		else {
 			// Write the data that was created for this entry.
@@ -451,6 +672,7 @@ bool HatchVFS::Flush() {
 			Memory::Free(cachedDataInFile);
 		}
 
+		writtenSizes[i] = compressedSize;
 		offsetGLOB += compressedSize;
 	}
 
@@ -488,8 +710,9 @@ bool HatchVFS::Flush() {
 
 			entry->FileFlags = entry->Flags;
 			entry->Offset = tocEnd + offsetGLOB;
+			entry->CompressedSize = writtenSizes[i];
 
-			offsetGLOB += entry->CompressedSize;
+			offsetGLOB += writtenSizes[i];
 
 			entry->DeleteCache();
 		}
@@ -511,6 +734,8 @@ void HatchVFS::Close() {
 	}
 
 	ArchiveVFS::Close();
+
+	ReleaseMapping();
 }
 
 HatchVFS::~HatchVFS() {
@@ -3,10 +3,29 @@
 
 #include <Engine/Filesystem/VFS/ArchiveVFS.h>
 
+#define MAGIC_HATCH_SIZE 5
+
+extern char MAGIC_HATCH[MAGIC_HATCH_SIZE];
+
+// Archives are written as version 1 whenever they can be, so that older
+// builds can still read them.
+#define HATCH_VERSION_ORIGINAL 1
+#define HATCH_VERSION_LARGE 2
+
+#define HATCH_DATA_ENCRYPTED 2
+#define HATCH_DATA_CHUNKED 4
+
+#define HATCH_TOC_ENTRY_SIZE 32
+
 class HatchVFS : public ArchiveVFS {
 private:
 	Stream* StreamPtr = nullptr;
+	MappedFile* Mapping = nullptr;
+	std::string ArchivePath;
 
+	Uint8* GetMappedEntryData(VFSEntry* entry);
+	bool ReadFileData(VFSEntry* entry, Uint8* memory, size_t size);
+	void ReleaseMapping();
 	static void CryptoXOR(Uint8* data, size_t size, Uint32 filenameHash, bool decrypt);
 
 protected:
@@ -17,11 +36,15 @@ public:
 	virtual ~HatchVFS();
 
 	bool Open(Stream* stream);
+	void MapArchive(const char* path);
 
 	virtual std::string TransformFilename(const char* filename);
 	virtual bool SupportsCompression();
 	virtual bool SupportsEncryption();
 	virtual bool ReadEntryData(VFSEntry* entry, Uint8* memory, size_t memSize);
+	virtual bool
+	MapFile(const char* filename, Uint8** out, size_t* size, MappedFile** mapping);
+	virtual Stream* OpenSeekableStream(const char* filename);
 	virtual bool PutFile(const char* filename, VFSEntry* entry);
 	virtual bool EraseFile(const char* filename);
 	virtual VFSEnumeration EnumerateFiles(const char* path, VFSEnumerationOptions options);
@@ -7,6 +7,7 @@
 
 #define VFSE_COMPRESSED 1
 #define VFSE_ENCRYPTED 2
+#define VFSE_CHUNKED 4
 
 class VFSEntry {
 public:
@@ -55,6 +55,22 @@ VFSEntry* VFSProvider::FindFile(const char* filename) {
 bool VFSProvider::ReadFile(const char* filename, Uint8** out, size_t* size) {
 	return false;
 }
+// Like ReadFile, but points *out straight into a read-only mapping of the
+// file instead of copying it. The caller must release *mapping once it's
+// done with the data. Providers that can't do this return false, and the
+// caller falls back to ReadFile.
+bool VFSProvider::MapFile(const char* filename,
+	Uint8** out,
+	size_t* size,
+	MappedFile** mapping) {
+	return false;
+}
+// Opens a stream that reads the file on demand, instead of all at once. It's
+// owned by the caller, who closes it with Close(), rather than by the VFS.
+// Providers that can't do this for the file return nullptr.
+Stream* VFSProvider::OpenSeekableStream(const char* filename) {
+	return nullptr;
+}
 
 bool VFSProvider::PutFile(const char* filename, VFSEntry* entry) {
 	return false;
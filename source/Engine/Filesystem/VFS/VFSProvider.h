@@ -1,6 +1,7 @@
 #ifndef ENGINE_FILESYSTEM_VFS_VFSPROVIDER_H
 #define ENGINE_FILESYSTEM_VFS_VFSPROVIDER_H
 
+#include <Engine/Filesystem/MappedFile.h>
 #include <Engine/Filesystem/VFS/VFSEntry.h>
 
 #include <Engine/IO/Stream.h>
@@ -64,6 +65,9 @@ public:
 	virtual bool IsEmpty();
 	virtual bool HasFile(const char* filename);
 	virtual bool ReadFile(const char* filename, Uint8** out, size_t* size);
+	virtual bool
+	MapFile(const char* filename, Uint8** out, size_t* size, MappedFile** mapping);
+	virtual Stream* OpenSeekableStream(const char* filename);
 	virtual bool PutFile(const char* filename, VFSEntry* entry);
 	virtual bool EraseFile(const char* filename);
 	virtual VFSEnumeration EnumerateFiles(const char* path, VFSEnumerationOptions options);
@@ -69,6 +69,7 @@ VFSMountStatus VirtualFileSystem::Mount(const char* name,
 		case VFSType::HATCH: {
 			HatchVFS* hatchVfs = new HatchVFS(flags);
 			hatchVfs->Open(stream);
+			hatchVfs->MapArchive(filename);
 			vfs = hatchVfs;
 			break;
 		}
@@ -132,6 +133,37 @@ bool VirtualFileSystem::LoadFile(const char* filename, Uint8** out, size_t* size
 
 	return false;
 }
+// Loads the file from the first mount that has it, avoiding a copy where the
+// mount allows: either *stream is set to a stream that reads the file on
+// demand, or *out points into *mapping, or *out is a buffer the caller frees.
+bool VirtualFileSystem::LoadFile(const char* filename,
+	Uint8** out,
+	size_t* size,
+	MappedFile** mapping,
+	Stream** stream) {
+	*mapping = nullptr;
+	*stream = nullptr;
+
+	for (size_t i = 0; i < LoadedVFS.size(); i++) {
+		VFSMount& mount = LoadedVFS[i];
+		VFSProvider* vfs = mount.VFSPtr;
+		const char* mountFilename = GetFilename(mount, filename);
+
+		*stream = vfs->OpenSeekableStream(mountFilename);
+		if (*stream) {
+			*size = (*stream)->Length();
+			return true;
+		}
+		if (vfs->MapFile(mountFilename, out, size, mapping)) {
+			return true;
+		}
+		if (vfs->ReadFile(mountFilename, out, size)) {
+			return true;
+		}
+	}
+
+	return false;
+}
 bool VirtualFileSystem::FileExists(const char* filename) {
 	for (size_t i = 0; i < LoadedVFS.size(); i++) {
 		VFSMount& mount = LoadedVFS[i];
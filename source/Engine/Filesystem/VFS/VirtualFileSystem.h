@@ -44,6 +44,11 @@ public:
 	const char* GetFilename(VFSMount mount, const char* filename);
 
 	bool LoadFile(const char* filename, Uint8** out, size_t* size);
+	bool LoadFile(const char* filename,
+		Uint8** out,
+		size_t* size,
+		MappedFile** mapping,
+		Stream** stream);
 	bool FileExists(const char* filename);
 
 	Stream* OpenReadStream(const char* filename);
@@ -6,6 +6,9 @@
 #include <Engine/Math/Math.h>
 
 #include <Engine/Rendering/Software/SoftwareRenderer.h>
+#include <Engine/Rendering/Software/TileRasterizer.h>
+#include <Engine/Rendering/SpriteAtlas.h>
+#include <Engine/Rendering/TextLayout.h>
 #ifdef USING_OPENGL
 #include <Engine/Rendering/GL/GLRenderer.h>
 #endif
@@ -27,6 +30,7 @@ int Graphics::FontDPI = 1;
 bool Graphics::SupportsShaders = false;
 bool Graphics::SupportsBatching = false;
 bool Graphics::LayerTileBufferingEnabled = true;
+bool Graphics::DrawBatchingEnabled = true;
 bool Graphics::TextureBlend = false;
 bool Graphics::TextureInterpolate = false;
 Uint32 Graphics::PreferredPixelFormat = PixelFormat_RGBA8888;
@@ -101,6 +105,12 @@ bool Graphics::UseSoftwareRenderer = false;
 bool Graphics::UseIntegerRotation = false;
 
 unsigned Graphics::CurrentFrame = 0;
+Uint32 Graphics::SpriteTextureSwitches = 0;
+Uint32 Graphics::LastFrameSpriteTextureSwitches = 0;
+Uint32 Graphics::DrawCommands = 0;
+Uint32 Graphics::DrawCalls = 0;
+Uint32 Graphics::LastFrameDrawCommands = 0;
+Uint32 Graphics::LastFrameDrawCalls = 0;
 
 GraphicsFunctions Graphics::Internal;
 GraphicsFunctions* Graphics::GfxFunctions = &Graphics::Internal;
@@ -261,6 +271,9 @@ void Graphics::Reset() {
 void Graphics::Dispose() {
 	Graphics::UnloadData();
 
+	TextLayoutCache::Dispose();
+	TileRasterizer::Dispose();
+
 	for (Texture *texture = Graphics::TextureHead, *next; texture != NULL; texture = next) {
 		next = texture->Next;
 		Graphics::DisposeTexture(texture);
@@ -291,6 +304,7 @@ void Graphics::UnloadData() {
 		Graphics::DeleteScene3D(i);
 	}
 
+	SpriteAtlas::Dispose();
 	Graphics::DeleteSpriteSheetMap();
 }
 void Graphics::DeleteShaders() {
@@ -381,11 +395,24 @@ int Graphics::LockTexture(Texture* texture, void** pixels, int* pitch) {
 	}
 	return Graphics::GfxFunctions->LockTexture(texture, pixels, pitch);
 }
+// If `src` is given, `pixels` only holds that rectangle of the texture, with
+// `pitch` bytes between its rows.
 int Graphics::UpdateTexture(Texture* texture, SDL_Rect* src, void* pixels, int pitch) {
-	if (texture->Pixels != pixels) {
+	if (src) {
+		if (texture->Pixels && texture->Pixels != pixels) {
+			size_t bpp = Texture::GetFormatBytesPerPixel(texture->Format);
+			Uint8* dest = (Uint8*)texture->Pixels + src->y * texture->Pitch + src->x * bpp;
+			for (int y = 0; y < src->h; y++) {
+				memcpy(dest + y * texture->Pitch, (Uint8*)pixels + y * pitch, src->w * bpp);
+			}
+		}
+	}
+	else if (texture->Pixels != pixels) {
 		memcpy(texture->Pixels, pixels, pitch * texture->Height);
 	}
 
+	void* rectPixels = nullptr;
+
 	if (texture->DriverPixelData || texture->Format != texture->DriverFormat) {
 		Uint32 inputPixelsX = 0;
 		Uint32 inputPixelsY = 0;
@@ -407,7 +434,7 @@ int Graphics::UpdateTexture(Texture* texture, SDL_Rect* src, void* pixels, int p
 
 		Texture::Convert(pixels,
 			texture->Format,
-			texture->Pitch,
+			src ? pitch : texture->Pitch,
 			0,
 			0,
 			texture->DriverPixelData,
@@ -419,10 +446,32 @@ int Graphics::UpdateTexture(Texture* texture, SDL_Rect* src, void* pixels, int p
 			inputPixelsH);
 
 		pixels = texture->DriverPixelData;
+
+		// The renderers expect the rectangle's rows to be next to each other.
+		if (src) {
+			rectPixels = Memory::Malloc(inputPixelsW * inputPixelsH * bpp);
+			Texture::Convert(texture->DriverPixelData,
+				texture->DriverFormat,
+				texture->Width * bpp,
+				inputPixelsX,
+				inputPixelsY,
+				rectPixels,
+				texture->DriverFormat,
+				inputPixelsW * bpp,
+				0,
+				0,
+				inputPixelsW,
+				inputPixelsH);
+
+			pixels = rectPixels;
+			pitch = inputPixelsW * bpp;
+		}
 	}
 
 	int result = Graphics::GfxFunctions->UpdateTexture(texture, src, pixels, pitch);
 
+	Memory::Free(rectPixels);
+
 	if (!texture->KeepDriverPixelsResident()) {
 		Memory::Free(texture->DriverPixelData);
 		texture->DriverPixelData = nullptr;
@@ -623,6 +672,20 @@ void Graphics::DeleteSpriteSheetMap() {
 
 	Graphics::SpriteSheetTextureMap.clear();
 }
+void Graphics::CountSpriteTextureSwitch(ISprite* sprite, int animation, int frame) {
+	static Texture* lastTexture = nullptr;
+
+	int sheetNumber = sprite->Animations[animation].Frames[frame].SheetNumber;
+	if (sheetNumber < 0 || sheetNumber >= (int)sprite->Spritesheets.size()) {
+		return;
+	}
+
+	Texture* texture = sprite->Spritesheets[sheetNumber];
+	if (texture != lastTexture) {
+		Graphics::SpriteTextureSwitches++;
+		lastTexture = texture;
+	}
+}
 
 Uint32 Graphics::CreateVertexBuffer(Uint32 maxVertices, int unloadPolicy) {
 	Uint32 idx = 0xFFFFFFFF;
@@ -726,6 +789,12 @@ void Graphics::Clear() {
 void Graphics::Present() {
 	Graphics::GfxFunctions->Present();
 	Graphics::CurrentFrame++;
+	Graphics::LastFrameSpriteTextureSwitches = Graphics::SpriteTextureSwitches;
+	Graphics::SpriteTextureSwitches = 0;
+	Graphics::LastFrameDrawCommands = Graphics::DrawCommands;
+	Graphics::LastFrameDrawCalls = Graphics::DrawCalls;
+	Graphics::DrawCommands = 0;
+	Graphics::DrawCalls = 0;
 }
 
 void Graphics::SoftwareStart(int viewIndex) {
@@ -1431,6 +1500,7 @@ void Graphics::DrawSprite(ISprite* sprite,
 			paletteID = PALETTE_INDEX_TABLE_ID;
 		}
 
+		Graphics::CountSpriteTextureSwitch(sprite, animation, frame);
 		Graphics::GfxFunctions->DrawSprite(
 			sprite, animation, frame, x, y, flipX, flipY, scaleW, scaleH, rotation, paletteID);
 	}
@@ -1455,6 +1525,7 @@ void Graphics::DrawSpritePart(ISprite* sprite,
 			paletteID = PALETTE_INDEX_TABLE_ID;
 		}
 
+		Graphics::CountSpriteTextureSwitch(sprite, animation, frame);
 		Graphics::GfxFunctions->DrawSpritePart(sprite,
 			animation,
 			frame,
@@ -1532,23 +1603,6 @@ void Graphics::DrawSpritePart(ISprite* sprite,
 		paletteID);
 }
 
-std::vector<Uint32> Graphics::GetTextCodepoints(Font* font, const char* text) {
-	std::vector<Uint32> codepoints = StringUtils::GetCodepoints(text);
-
-	std::vector<Uint32> output;
-	output.reserve(codepoints.size());
-
-	for (size_t i = 0; i < codepoints.size(); i++) {
-		Uint32 codepoint = codepoints[i];
-		if (codepoint != (Uint32)-1 && (char)codepoint == '\n' || (char)codepoint == ' ' ||
-			(font->IsValidCodepoint(codepoint) && font->RequestGlyph(codepoint))) {
-			output.push_back(codepoint);
-		}
-	}
-
-	return output;
-}
-
 void Graphics::DrawGlyph(Font* font,
 	Uint32 codepoint,
 	float x,
@@ -1579,27 +1633,6 @@ void Graphics::DrawGlyph(Font* font,
 		paletteID);
 }
 
-void Graphics::DrawEllipsis(Font* font,
-	float x,
-	float y,
-	float scale,
-	float glyphScale,
-	float ascent,
-	int paletteID) {
-	if (font->HasGlyph(ELLIPSIS_CODE_POINT) && font->RequestGlyph(ELLIPSIS_CODE_POINT)) {
-		DrawGlyph(font, ELLIPSIS_CODE_POINT, x, y, scale, glyphScale, ascent);
-	}
-	else if (font->HasGlyph(FULL_STOP_CODE_POINT) && font->RequestGlyph(FULL_STOP_CODE_POINT)) {
-		float currX = x;
-
-		for (size_t i = 0; i < 3; i++) {
-			DrawGlyph(font, 0x002E, currX, y, scale, glyphScale, ascent, paletteID);
-
-			currX += font->Glyphs[FULL_STOP_CODE_POINT].Advance * scale;
-		}
-	}
-}
-
 void Graphics::DrawEllipsisLegacy(ISprite* sprite,
 	float x,
 	float y,
@@ -1633,54 +1666,9 @@ void Graphics::DrawText(Font* font,
 	float y,
 	TextDrawParams* params,
 	int paletteID) {
-	// Obtain codepoints and check if the font needs to be updated
-	std::vector<Uint32> codepoints = GetTextCodepoints(font, text);
-
-	size_t numCodepoints = codepoints.size();
-	if (numCodepoints == 0) {
-		return;
-	}
-
-	font->Update();
-
-	if (font->Sprite == nullptr || font->Sprite->Spritesheets.size() == 0) {
-		return;
-	}
-
-	// Draw the codepoints
-	float currX = x;
-	float currY = y;
-
-	float ascent = params->Ascent;
-	float descent = params->Descent;
-	float leading = params->Leading;
-
-	float scale = params->FontSize / font->Size;
-	float xyScale = scale / font->Oversampling;
-
-	bool texBlend = Graphics::TextureBlend;
-	Graphics::TextureBlend = true;
-
-	for (size_t i = 0; i < numCodepoints; i++) {
-		Uint32 codepoint = codepoints[i];
-		if (codepoint == '\n') {
-			currX = x;
-			currY += (ascent - descent + leading) * scale;
-			continue;
-		}
-		else if (codepoint == ' ') {
-			currX += font->SpaceWidth * scale;
-			continue;
-		}
-
-		FontGlyph& glyph = font->Glyphs[codepoint];
+	TextLayout* layout = TextLayoutCache::Get(font, text, params, false);
 
-		DrawGlyph(font, codepoint, currX, currY, scale, xyScale, ascent, paletteID);
-
-		currX += glyph.Advance * scale;
-	}
-
-	Graphics::TextureBlend = texBlend;
+	layout->Draw(x, y, paletteID);
 }
 void Graphics::DrawTextWrapped(Font* font,
 	const char* text,
@@ -1688,177 +1676,9 @@ void Graphics::DrawTextWrapped(Font* font,
 	float y,
 	TextDrawParams* params,
 	int paletteID) {
-	// Obtain codepoints and check if the font needs to be updated
-	std::vector<Uint32> codepoints = GetTextCodepoints(font, text);
-
-	size_t numCodepoints = codepoints.size();
-	if (numCodepoints == 0) {
-		return;
-	}
-
-	font->Update();
-
-	if (font->Sprite == nullptr || font->Sprite->Spritesheets.size() == 0) {
-		return;
-	}
-
-	// Draw the codepoints
-	float currX = x;
-	float currY = y;
-
-	float ascent = params->Ascent;
-	float descent = params->Descent;
-	float leading = params->Leading;
-
-	float scale = params->FontSize / font->Size;
-	float xyScale = scale / font->Oversampling;
-
-	bool texBlend = Graphics::TextureBlend;
-	Graphics::TextureBlend = true;
-
-	int word = 0;
-	int lineNo = 1;
-
-	Uint32* codepointsData = codepoints.data();
-	Uint32* linestart = codepointsData;
-	Uint32* wordstart = codepointsData;
-	Uint32* codepointsEnd = codepointsData + numCodepoints;
+	TextLayout* layout = TextLayoutCache::Get(font, text, params, true);
 
-	float ellipsisWidth = 0.0;
-
-	bool drawEllipsis = params->Flags & TEXTDRAW_ELLIPSIS;
-	if (drawEllipsis) {
-		// Load correct ellipsis glyph
-		if (font->HasGlyph(ELLIPSIS_CODE_POINT)) {
-			drawEllipsis = font->RequestGlyph(ELLIPSIS_CODE_POINT);
-		}
-		else if (font->HasGlyph(FULL_STOP_CODE_POINT)) {
-			drawEllipsis = font->RequestGlyph(FULL_STOP_CODE_POINT);
-		}
-		else {
-			drawEllipsis = false;
-		}
-
-		if (drawEllipsis) {
-			ellipsisWidth = font->GetEllipsisWidth() * scale;
-		}
-	}
-
-	for (size_t i = 0; i < numCodepoints; i++) {
-		Uint32* codepointsPtr = (codepointsData + i);
-		Uint32 codepoint = *codepointsPtr;
-
-		bool isLineBreak = codepoint == 0x000A;
-
-		if ((codepointsPtr != wordstart && codepoint == 0x0020) || isLineBreak) {
-			bool canLineBreak = isLineBreak;
-			if (!canLineBreak && word > 0) {
-				float lineWidth = 0.0f;
-
-				for (Uint32* o = linestart; o < codepointsPtr; o++) {
-					float advance = (*o == 0x0020) ? font->SpaceWidth
-								       : font->Glyphs[*o].Advance;
-					lineWidth += advance * scale;
-				}
-
-				canLineBreak = lineWidth > params->MaxWidth;
-			}
-
-			Uint32* start = isLineBreak ? (codepointsPtr + 1) : wordstart;
-			Uint32* end = isLineBreak ? codepointsPtr : (wordstart - 1);
-
-			if (canLineBreak) {
-				bool isLastLine =
-					params->MaxLines > 0 && lineNo == params->MaxLines;
-
-				currX = x;
-
-				for (Uint32* o = linestart; o < end; o++) {
-					float advance = (*o == 0x0020) ? font->SpaceWidth
-								       : font->Glyphs[*o].Advance;
-
-					advance *= scale;
-
-					// Draw ellipsis if the text no longer fits
-					if (isLastLine && drawEllipsis &&
-						(currX - x) + advance >
-							params->MaxWidth - ellipsisWidth) {
-						Graphics::DrawEllipsis(font,
-							currX,
-							currY,
-							scale,
-							xyScale,
-							ascent,
-							paletteID);
-						Graphics::TextureBlend = texBlend;
-						return;
-					}
-
-					if (*o != 0x0020) {
-						DrawGlyph(font,
-							*o,
-							currX,
-							currY,
-							scale,
-							xyScale,
-							ascent,
-							paletteID);
-					}
-
-					currX += advance;
-				}
-
-				if (isLastLine) {
-					// Draw ellipsis if the text no longer fits AND there is still space
-					if (drawEllipsis &&
-						(currX - x) < params->MaxWidth - ellipsisWidth) {
-						Graphics::DrawEllipsis(font,
-							currX,
-							currY,
-							scale,
-							xyScale,
-							ascent,
-							paletteID);
-					}
-
-					Graphics::TextureBlend = texBlend;
-					return;
-				}
-
-				lineNo++;
-				linestart = start;
-
-				currY += (ascent - descent + leading) * scale;
-			}
-
-			wordstart = codepointsPtr + 1;
-			word++;
-		}
-	}
-
-	// Draw the remaining line
-	currX = x;
-
-	for (Uint32* o = linestart; o < codepointsEnd; o++) {
-		float advance = (*o == 0x0020) ? font->SpaceWidth : font->Glyphs[*o].Advance;
-
-		advance *= scale;
-
-		// Draw ellipsis if the text no longer fits
-		if (drawEllipsis && (currX - x) + advance > params->MaxWidth - ellipsisWidth) {
-			Graphics::DrawEllipsis(
-				font, currX, currY, scale, xyScale, ascent, paletteID);
-			break;
-		}
-
-		if (*o != 0x0020 && *o != 0x000A) {
-			DrawGlyph(font, *o, currX, currY, scale, xyScale, ascent, paletteID);
-		}
-
-		currX += advance;
-	}
-
-	Graphics::TextureBlend = texBlend;
+	layout->Draw(x, y, paletteID);
 }
 void Graphics::DrawTextEllipsis(Font* font,
 	const char* text,
@@ -1909,174 +1729,20 @@ void Graphics::MeasureText(Font* font,
 	TextDrawParams* params,
 	float& maxW,
 	float& maxH) {
-	// Obtain codepoints and check if the font needs to be updated
-	std::vector<Uint32> codepoints = GetTextCodepoints(font, text);
-
-	size_t numCodepoints = codepoints.size();
-	if (numCodepoints == 0) {
-		return;
-	}
-
-	font->Update();
+	TextLayout* layout = TextLayoutCache::Get(font, text, params, false);
 
-	float currX = 0.0f;
-	float currY = 0.0f;
-
-	float ascent = params->Ascent;
-	float descent = params->Descent;
-	float leading = params->Leading;
-
-	float scale = params->FontSize / font->Size;
-	float xyScale = scale / font->Oversampling;
-
-	for (size_t i = 0; i < numCodepoints; i++) {
-		float glyphY = 0.0f;
-
-		Uint32 codepoint = codepoints[i];
-		if (codepoint == '\n') {
-			currX = 0.0f;
-			currY += (ascent - descent + leading) * scale;
-		}
-		else if (codepoint == ' ') {
-			currX += font->SpaceWidth * scale;
-		}
-		else {
-			FontGlyph& glyph = font->Glyphs[codepoint];
-
-			currX += glyph.Advance * scale;
-			glyphY += (ascent * scale) + (glyph.OffsetY * xyScale) +
-				(glyph.Height * xyScale);
-		}
-
-		if (currX > maxW) {
-			maxW = currX;
-		}
-		if (currY + glyphY > maxH) {
-			maxH = currY + glyphY;
-		}
-	}
+	maxW = std::max(maxW, layout->Width);
+	maxH = std::max(maxH, layout->Height);
 }
 void Graphics::MeasureTextWrapped(Font* font,
 	const char* text,
 	TextDrawParams* params,
 	float& maxW,
 	float& maxH) {
-	// Obtain codepoints and check if the font needs to be updated
-	std::vector<Uint32> codepoints = GetTextCodepoints(font, text);
-
-	size_t numCodepoints = codepoints.size();
-	if (numCodepoints == 0) {
-		return;
-	}
-
-	font->Update();
-
-	float currX = 0.0f;
-	float currY = 0.0f;
-
-	float ascent = params->Ascent;
-	float descent = params->Descent;
-	float leading = params->Leading;
-
-	float scale = params->FontSize / font->Size;
-	float xyScale = scale / font->Oversampling;
-
-	int word = 0;
-	int lineNo = 1;
-
-	Uint32* codepointsData = codepoints.data();
-	Uint32* linestart = codepointsData;
-	Uint32* wordstart = codepointsData;
-	Uint32* codepointsEnd = codepointsData + numCodepoints;
-
-	for (size_t i = 0; i < numCodepoints; i++) {
-		Uint32* codepointsPtr = (codepointsData + i);
-		Uint32 codepoint = *codepointsPtr;
-
-		bool isLineBreak = codepoint == 0x000A;
-
-		if ((codepointsPtr != wordstart && codepoint == 0x0020) || isLineBreak) {
-			bool canLineBreak = isLineBreak;
-			if (!canLineBreak && word > 0) {
-				float lineWidth = 0.0f;
-
-				for (Uint32* o = linestart; o < codepointsPtr; o++) {
-					float advance = (*o == 0x0020) ? font->SpaceWidth
-								       : font->Glyphs[*o].Advance;
-					lineWidth += advance * scale;
-				}
-
-				canLineBreak = lineWidth > params->MaxWidth;
-			}
-
-			Uint32* start = isLineBreak ? (codepointsPtr + 1) : wordstart;
-			Uint32* end = isLineBreak ? codepointsPtr : (wordstart - 1);
-
-			if (canLineBreak) {
-				currX = 0.0f;
-
-				for (Uint32* o = linestart; o < end; o++) {
-					float glyphY = 0.0f;
-
-					if (*o == 0x0020) {
-						currX += font->SpaceWidth * scale;
-					}
-					else {
-						FontGlyph& glyph = font->Glyphs[*o];
-
-						currX += glyph.Advance * scale;
-						glyphY += (ascent * scale) +
-							(glyph.OffsetY * xyScale) +
-							(glyph.Height * xyScale);
-					}
-
-					if (currX > maxW) {
-						maxW = currX;
-					}
-					if (currY + glyphY > maxH) {
-						maxH = currY + glyphY;
-					}
-				}
-
-				if (params->MaxLines > 0 && lineNo == params->MaxLines) {
-					return;
-				}
-
-				lineNo++;
-				linestart = start;
-
-				currY += (ascent - descent + leading) * scale;
-			}
+	TextLayout* layout = TextLayoutCache::Get(font, text, params, true);
 
-			wordstart = codepointsPtr + 1;
-			word++;
-		}
-	}
-
-	// Measure the remaining line
-	currX = 0.0f;
-
-	for (Uint32* o = linestart; o < codepointsEnd; o++) {
-		float glyphY = 0.0f;
-
-		if (*o == 0x0020) {
-			currX += font->SpaceWidth * scale;
-		}
-		else {
-			FontGlyph& glyph = font->Glyphs[*o];
-
-			currX += glyph.Advance * scale;
-			glyphY += (ascent * scale) + (glyph.OffsetY * xyScale) +
-				(glyph.Height * xyScale);
-		}
-
-		if (currX > maxW) {
-			maxW = currX;
-		}
-		if (currY + glyphY > maxH) {
-			maxH = currY + glyphY;
-		}
-	}
+	maxW = std::max(maxW, layout->Width);
+	maxH = std::max(maxH, layout->Height);
 }
 
 // Those are the old text drawing functions. They do not handle UTF-8!
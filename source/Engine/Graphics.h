@@ -32,9 +32,9 @@ class Graphics {
 private:
 	static void InitCapabilities();
 	static void DeleteSpriteSheetMap();
+	static void CountSpriteTextureSwitch(ISprite* sprite, int animation, int frame);
 	static void DeleteShaders();
 	static void DeleteVertexBuffers();
-	static std::vector<Uint32> GetTextCodepoints(Font* font, const char* text);
 	static Sint64 CalcHorizontalParallaxPosition(TileLayer* layer,
 		float viewX,
 		float constant,
@@ -61,6 +61,7 @@ public:
 	static bool SupportsShaders;
 	static bool SupportsBatching;
 	static bool LayerTileBufferingEnabled;
+	static bool DrawBatchingEnabled;
 	static bool TextureBlend;
 	static bool TextureInterpolate;
 	static Uint32 PreferredPixelFormat;
@@ -118,6 +119,12 @@ public:
 	static bool UseSoftwareRenderer;
 	static bool UseIntegerRotation;
 	static unsigned CurrentFrame;
+	static Uint32 SpriteTextureSwitches;
+	static Uint32 LastFrameSpriteTextureSwitches;
+	static Uint32 DrawCommands;
+	static Uint32 DrawCalls;
+	static Uint32 LastFrameDrawCommands;
+	static Uint32 LastFrameDrawCalls;
 	// Rendering functions
 	static GraphicsFunctions Internal;
 	static GraphicsFunctions* GfxFunctions;
@@ -333,13 +340,6 @@ public:
 		float glyphScale,
 		float ascent,
 		int paletteID = 0);
-	static void DrawEllipsis(Font* font,
-		float x,
-		float y,
-		float scale,
-		float glyphScale,
-		float ascent,
-		int paletteID = 0);
 	static void DrawEllipsisLegacy(ISprite* sprite,
 		float x,
 		float y,
@@ -0,0 +1,399 @@
+#include <Engine/IO/Compression/ChunkedZLibStream.h>
+
+#undef min
+#undef max
+
+#define MINIZ_HEADER_FILE_ONLY
+#include <Libraries/miniz.h>
+
+#define CHUNKED_ZLIB_HEADER_SIZE 8
+
+static size_t GetChunkCount(size_t decodedSize, size_t chunkSize) {
+	return (decodedSize + chunkSize - 1) / chunkSize;
+}
+
+// Checks that the offset table describes chunks laid out in order, after the
+// table itself, and without running past the end of the encoded data.
+static bool ValidateChunkOffsets(const Uint64* offsets, Uint32 chunkCount, Uint64 dataSize) {
+	Uint64 tableEnd = CHUNKED_ZLIB_HEADER_SIZE + ((Uint64)chunkCount + 1) * sizeof(Uint64);
+	if (offsets[0] < tableEnd) {
+		return false;
+	}
+
+	for (Uint32 i = 0; i < chunkCount; i++) {
+		if (offsets[i + 1] < offsets[i]) {
+			return false;
+		}
+	}
+
+	return offsets[chunkCount] <= dataSize;
+}
+
+ChunkedZLibStream::ChunkedZLibStream() {
+	for (int i = 0; i < CHUNKED_ZLIB_CACHE_SLOTS; i++) {
+		Cache[i].Index = 0;
+		Cache[i].LastUsed = 0;
+		Cache[i].Data = nullptr;
+	}
+}
+
+// The stream keeps its own reference to the mapping, if there is one.
+ChunkedZLibStream* ChunkedZLibStream::New(const Uint8* data,
+	size_t dataSize,
+	size_t decodedSize,
+	MappedFile* mapping) {
+	ChunkedZLibStream* stream = new (std::nothrow) ChunkedZLibStream;
+	if (!stream) {
+		return NULL;
+	}
+
+	stream->SourceData = data;
+	stream->SourceSize = dataSize;
+	stream->DecodedSize = decodedSize;
+
+	if (mapping) {
+		mapping->AddRef();
+		stream->SourceMapping = mapping;
+	}
+
+	if (!data || !stream->ReadHeader()) {
+		stream->Close();
+		return NULL;
+	}
+
+	return stream;
+}
+// Takes ownership of the source stream, which must not be read from
+// anywhere else while this stream is open.
+ChunkedZLibStream*
+ChunkedZLibStream::New(Stream* source, Uint64 offset, Uint64 dataSize, size_t decodedSize) {
+	ChunkedZLibStream* stream = new (std::nothrow) ChunkedZLibStream;
+	if (!stream) {
+		if (source) {
+			source->Close();
+		}
+		return NULL;
+	}
+
+	stream->SourceStream = source;
+	stream->SourceOffset = offset;
+	stream->SourceSize = dataSize;
+	stream->DecodedSize = decodedSize;
+
+	if (!source || !stream->ReadHeader()) {
+		stream->Close();
+		return NULL;
+	}
+
+	return stream;
+}
+
+bool ChunkedZLibStream::ReadSource(Uint64 offset, void* dest, size_t size) {
+	if (offset > SourceSize || size > SourceSize - offset) {
+		return false;
+	}
+
+	if (SourceData) {
+		memcpy(dest, SourceData + offset, size);
+		return true;
+	}
+
+	SourceStream->Seek(SourceOffset + offset);
+	return SourceStream->ReadBytes(dest, size) == size;
+}
+// Returns a pointer to the encoded bytes, which is either straight into the
+// source memory or into a buffer that's only valid until the next call.
+const Uint8* ChunkedZLibStream::GetSource(Uint64 offset, size_t size) {
+	if (SourceData) {
+		if (offset > SourceSize || size > SourceSize - offset) {
+			return nullptr;
+		}
+		return SourceData + offset;
+	}
+
+	if (size > ReadBufferSize) {
+		Uint8* buffer = (Uint8*)Memory::Realloc(ReadBuffer, size);
+		if (!buffer) {
+			return nullptr;
+		}
+		ReadBuffer = buffer;
+		ReadBufferSize = size;
+	}
+
+	if (!ReadSource(offset, ReadBuffer, size)) {
+		return nullptr;
+	}
+
+	return ReadBuffer;
+}
+
+bool ChunkedZLibStream::ReadHeader() {
+	Uint32 header[2];
+	if (!ReadSource(0, header, sizeof header)) {
+		return false;
+	}
+
+	ChunkSize = FROM_LE32(header[0]);
+	ChunkCount = FROM_LE32(header[1]);
+	if (ChunkSize == 0 || ChunkCount != GetChunkCount(DecodedSize, ChunkSize)) {
+		return false;
+	}
+
+	size_t numOffsets = (size_t)ChunkCount + 1;
+	ChunkOffsets = (Uint64*)Memory::Malloc(numOffsets * sizeof(Uint64));
+	if (!ChunkOffsets ||
+		!ReadSource(CHUNKED_ZLIB_HEADER_SIZE, ChunkOffsets, numOffsets * sizeof(Uint64))) {
+		return false;
+	}
+
+	for (size_t i = 0; i < numOffsets; i++) {
+		ChunkOffsets[i] = FROM_LE64(ChunkOffsets[i]);
+	}
+
+	return ValidateChunkOffsets(ChunkOffsets, ChunkCount, SourceSize);
+}
+
+bool ChunkedZLibStream::DecodeChunk(Uint8* dest,
+	size_t destSize,
+	const Uint8* src,
+	size_t srcSize) {
+	if (srcSize == destSize) {
+		memcpy(dest, src, destSize);
+		return true;
+	}
+
+	mz_ulong outSize = (mz_ulong)destSize;
+	if (uncompress(dest, &outSize, src, (mz_ulong)srcSize) != Z_OK) {
+		return false;
+	}
+
+	return outSize == destSize;
+}
+
+// Decoded chunks are kept in a handful of slots, and the least recently used
+// one gets replaced, so reading back and forth around a chunk boundary
+// doesn't decode the same chunks over and over.
+Uint8* ChunkedZLibStream::GetChunk(Uint32 index) {
+	CachedChunk* slot = nullptr;
+	for (int i = 0; i < CHUNKED_ZLIB_CACHE_SLOTS; i++) {
+		CachedChunk* cached = &Cache[i];
+		if (cached->Data && cached->Index == index) {
+			cached->LastUsed = ++UseCounter;
+			return cached->Data;
+		}
+
+		// Prefer an empty slot, then the least recently used one.
+		if (slot == nullptr || (slot->Data && !cached->Data) ||
+			(slot->Data && cached->LastUsed < slot->LastUsed)) {
+			slot = cached;
+		}
+	}
+
+	if (!slot->Data) {
+		slot->Data = (Uint8*)Memory::Malloc(ChunkSize);
+		if (!slot->Data) {
+			return nullptr;
+		}
+	}
+
+	size_t decodedSize = ChunkSize;
+	if ((size_t)index * ChunkSize + decodedSize > DecodedSize) {
+		decodedSize = DecodedSize - (size_t)index * ChunkSize;
+	}
+
+	size_t encodedSize = (size_t)(ChunkOffsets[index + 1] - ChunkOffsets[index]);
+	const Uint8* encoded = GetSource(ChunkOffsets[index], encodedSize);
+	if (!encoded || !DecodeChunk(slot->Data, decodedSize, encoded, encodedSize)) {
+		Memory::Free(slot->Data);
+		slot->Data = nullptr;
+		return nullptr;
+	}
+
+	slot->Index = index;
+	slot->LastUsed = ++UseCounter;
+
+	return slot->Data;
+}
+
+bool ChunkedZLibStream::Compress(void* src,
+	size_t srcLen,
+	size_t chunkSize,
+	void** dst,
+	size_t* dstLen) {
+	if (chunkSize == 0 || chunkSize > 0xFFFFFFFF) {
+		return false;
+	}
+
+	size_t chunkCount = GetChunkCount(srcLen, chunkSize);
+	if (chunkCount > 0xFFFFFFFF) {
+		return false;
+	}
+
+	size_t tableEnd = CHUNKED_ZLIB_HEADER_SIZE + (chunkCount + 1) * sizeof(Uint64);
+	size_t capacity = tableEnd + chunkCount * (size_t)compressBound((mz_ulong)chunkSize);
+
+	Uint8* out = (Uint8*)Memory::Malloc(capacity);
+	if (!out) {
+		return false;
+	}
+
+	Uint32* header = (Uint32*)out;
+	header[0] = TO_LE32((Uint32)chunkSize);
+	header[1] = TO_LE32((Uint32)chunkCount);
+
+	Uint64* offsets = (Uint64*)(out + CHUNKED_ZLIB_HEADER_SIZE);
+	size_t position = tableEnd;
+
+	for (size_t i = 0; i < chunkCount; i++) {
+		Uint8* chunk = (Uint8*)src + i * chunkSize;
+		size_t length = chunkSize;
+		if (i * chunkSize + length > srcLen) {
+			length = srcLen - i * chunkSize;
+		}
+
+		offsets[i] = TO_LE64((Uint64)position);
+
+		// Chunks that don't get any smaller are stored as they are. This
+		// also keeps a compressed chunk from being mistaken for a stored one.
+		mz_ulong compressedLength = (mz_ulong)(capacity - position);
+		int result = compress2(out + position,
+			&compressedLength,
+			chunk,
+			(mz_ulong)length,
+			MZ_DEFAULT_COMPRESSION);
+		if (result != Z_OK || compressedLength >= length) {
+			memcpy(out + position, chunk, length);
+			compressedLength = (mz_ulong)length;
+		}
+
+		position += compressedLength;
+	}
+
+	offsets[chunkCount] = TO_LE64((Uint64)position);
+
+	Uint8* shrunk = (Uint8*)Memory::Realloc(out, position);
+	if (shrunk) {
+		out = shrunk;
+	}
+
+	*dst = out;
+	*dstLen = position;
+
+	return true;
+}
+// dstLen must be the full decoded size.
+bool ChunkedZLibStream::Decompress(void* dst, size_t dstLen, const void* src, size_t srcLen) {
+	if (dstLen == 0) {
+		return true;
+	}
+
+	ChunkedZLibStream* stream = ChunkedZLibStream::New((const Uint8*)src, srcLen, dstLen, NULL);
+	if (!stream) {
+		return false;
+	}
+
+	// Whole chunks are decoded straight into the destination. Only the
+	// last chunk can be shorter, and it always ends exactly at dstLen.
+	bool success = true;
+	Uint8* out = (Uint8*)dst;
+	for (Uint32 i = 0; i < stream->ChunkCount && success; i++) {
+		size_t start = (size_t)i * stream->ChunkSize;
+		size_t length = stream->ChunkSize;
+		if (start + length > dstLen) {
+			length = dstLen - start;
+		}
+
+		size_t encodedSize = (size_t)(stream->ChunkOffsets[i + 1] - stream->ChunkOffsets[i]);
+		success = DecodeChunk(
+			out + start, length, stream->SourceData + stream->ChunkOffsets[i], encodedSize);
+	}
+
+	stream->Close();
+
+	return success;
+}
+
+bool ChunkedZLibStream::IsReadable() {
+	return true;
+}
+bool ChunkedZLibStream::IsWritable() {
+	return false;
+}
+bool ChunkedZLibStream::MakeReadable(bool readable) {
+	return readable;
+}
+bool ChunkedZLibStream::MakeWritable(bool writable) {
+	return !writable;
+}
+
+void ChunkedZLibStream::Close() {
+	for (int i = 0; i < CHUNKED_ZLIB_CACHE_SLOTS; i++) {
+		Memory::Free(Cache[i].Data);
+		Cache[i].Data = nullptr;
+	}
+
+	Memory::Free(ChunkOffsets);
+	Memory::Free(ReadBuffer);
+	ChunkOffsets = nullptr;
+	ReadBuffer = nullptr;
+
+	if (SourceMapping) {
+		SourceMapping->Release();
+		SourceMapping = nullptr;
+	}
+	if (SourceStream) {
+		SourceStream->Close();
+		SourceStream = nullptr;
+	}
+
+	Stream::Close();
+}
+void ChunkedZLibStream::Seek(Sint64 offset) {
+	Cursor = offset;
+}
+void ChunkedZLibStream::SeekEnd(Sint64 offset) {
+	Cursor = DecodedSize + offset;
+}
+void ChunkedZLibStream::Skip(Sint64 offset) {
+	Cursor += offset;
+}
+size_t ChunkedZLibStream::Position() {
+	return Cursor;
+}
+size_t ChunkedZLibStream::Length() {
+	return DecodedSize;
+}
+
+size_t ChunkedZLibStream::ReadBytes(void* data, size_t n) {
+	if (Cursor >= DecodedSize) {
+		return 0;
+	}
+	if (n > DecodedSize - Cursor) {
+		n = DecodedSize - Cursor;
+	}
+
+	Uint8* out = (Uint8*)data;
+	size_t total = 0;
+	while (total < n) {
+		Uint32 index = (Uint32)(Cursor / ChunkSize);
+		size_t offsetInChunk = Cursor % ChunkSize;
+		size_t length = ChunkSize - offsetInChunk;
+		if (length > n - total) {
+			length = n - total;
+		}
+
+		Uint8* chunk = GetChunk(index);
+		if (!chunk) {
+			break;
+		}
+
+		memcpy(out + total, chunk + offsetInChunk, length);
+		total += length;
+		Cursor += length;
+	}
+
+	return total;
+}
+size_t ChunkedZLibStream::WriteBytes(void* data, size_t n) {
+	return 0;
+}
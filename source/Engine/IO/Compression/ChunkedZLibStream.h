@@ -0,0 +1,73 @@
+#ifndef ENGINE_IO_COMPRESSION_CHUNKEDZLIBSTREAM_H
+#define ENGINE_IO_COMPRESSION_CHUNKEDZLIBSTREAM_H
+
+#include <Engine/Filesystem/MappedFile.h>
+#include <Engine/IO/Stream.h>
+#include <Engine/Includes/Standard.h>
+
+#define CHUNKED_ZLIB_DEFAULT_CHUNK_SIZE 0x10000
+#define CHUNKED_ZLIB_CACHE_SLOTS 4
+
+// Reads data that was compressed in independent, fixed-size chunks, so that
+// seeking only ever decodes the chunks that are actually read.
+//
+// The encoded data starts with the chunk size and count (both Uint32),
+// followed by count + 1 Uint64 offsets into the encoded data, where chunk i
+// spans from offset i up to offset i + 1. A chunk that is exactly as long as
+// its decoded size is stored as-is; anything else is a zlib stream.
+class ChunkedZLibStream : public Stream {
+private:
+	struct CachedChunk {
+		Uint32 Index;
+		Uint32 LastUsed;
+		Uint8* Data;
+	};
+
+	const Uint8* SourceData = nullptr;
+	MappedFile* SourceMapping = nullptr;
+	Stream* SourceStream = nullptr;
+	Uint64 SourceOffset = 0;
+	Uint64 SourceSize = 0;
+
+	Uint32 ChunkSize = 0;
+	Uint32 ChunkCount = 0;
+	Uint64* ChunkOffsets = nullptr;
+	Uint8* ReadBuffer = nullptr;
+	size_t ReadBufferSize = 0;
+
+	CachedChunk Cache[CHUNKED_ZLIB_CACHE_SLOTS];
+	Uint32 UseCounter = 0;
+
+	size_t Cursor = 0;
+	size_t DecodedSize = 0;
+
+	ChunkedZLibStream();
+	bool ReadSource(Uint64 offset, void* dest, size_t size);
+	const Uint8* GetSource(Uint64 offset, size_t size);
+	bool ReadHeader();
+	Uint8* GetChunk(Uint32 index);
+	static bool DecodeChunk(Uint8* dest, size_t destSize, const Uint8* src, size_t srcSize);
+
+public:
+	static ChunkedZLibStream*
+	New(const Uint8* data, size_t dataSize, size_t decodedSize, MappedFile* mapping);
+	static ChunkedZLibStream*
+	New(Stream* source, Uint64 offset, Uint64 dataSize, size_t decodedSize);
+	static bool
+	Compress(void* src, size_t srcLen, size_t chunkSize, void** dst, size_t* dstLen);
+	static bool Decompress(void* dst, size_t dstLen, const void* src, size_t srcLen);
+	bool IsReadable();
+	bool IsWritable();
+	bool MakeReadable(bool readable);
+	bool MakeWritable(bool writable);
+	void Close();
+	void Seek(Sint64 offset);
+	void SeekEnd(Sint64 offset);
+	void Skip(Sint64 offset);
+	size_t Position();
+	size_t Length();
+	size_t ReadBytes(void* data, size_t n);
+	size_t WriteBytes(void* data, size_t n);
+};
+
+#endif /* ENGINE_IO_COMPRESSION_CHUNKEDZLIBSTREAM_H */
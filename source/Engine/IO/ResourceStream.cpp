@@ -12,7 +12,11 @@ ResourceStream* ResourceStream::New(const char* filename) {
 		goto FREE;
 	}
 
-	if (!ResourceManager::LoadResource(filename, &stream->pointer_start, &stream->size)) {
+	if (!ResourceManager::LoadResource(filename,
+		    &stream->pointer_start,
+		    &stream->size,
+		    &stream->Mapping,
+		    &stream->Source)) {
 		goto FREE;
 	}
 
@@ -39,19 +43,46 @@ bool ResourceStream::MakeWritable(bool writable) {
 }
 
 void ResourceStream::Close() {
-	Memory::Free(pointer_start);
+	// Mapped resources point into the mapping rather than owning a copy,
+	// and resources read on demand don't have a buffer at all.
+	if (Source) {
+		Source->Close();
+		Source = NULL;
+	}
+	else if (Mapping) {
+		Mapping->Release();
+		Mapping = NULL;
+	}
+	else {
+		Memory::Free(pointer_start);
+	}
 	Stream::Close();
 }
 void ResourceStream::Seek(Sint64 offset) {
+	if (Source) {
+		Source->Seek(offset);
+		return;
+	}
 	pointer = pointer_start + offset;
 }
 void ResourceStream::SeekEnd(Sint64 offset) {
+	if (Source) {
+		Source->SeekEnd(offset);
+		return;
+	}
 	pointer = pointer_start + size + offset;
 }
 void ResourceStream::Skip(Sint64 offset) {
+	if (Source) {
+		Source->Skip(offset);
+		return;
+	}
 	pointer = pointer + offset;
 }
 size_t ResourceStream::Position() {
+	if (Source) {
+		return Source->Position();
+	}
 	return pointer - pointer_start;
 }
 size_t ResourceStream::Length() {
@@ -59,6 +90,9 @@ size_t ResourceStream::Length() {
 }
 
 size_t ResourceStream::ReadBytes(void* data, size_t n) {
+	if (Source) {
+		return Source->ReadBytes(data, n);
+	}
 	if (n > size - Position()) {
 		n = size - Position();
 	}
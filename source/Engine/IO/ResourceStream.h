@@ -1,6 +1,7 @@
 #ifndef ENGINE_IO_RESOURCESTREAM_H
 #define ENGINE_IO_RESOURCESTREAM_H
 
+#include <Engine/Filesystem/MappedFile.h>
 #include <Engine/IO/Stream.h>
 #include <Engine/Includes/Standard.h>
 
@@ -9,6 +10,8 @@ public:
 	Uint8* pointer = NULL;
 	Uint8* pointer_start = NULL;
 	size_t size = 0;
+	MappedFile* Mapping = NULL;
+	Stream* Source = NULL;
 
 	static ResourceStream* New(const char* filename);
 	bool IsReadable();
@@ -15,30 +15,44 @@ Serializer::Serializer(Stream* stream) {
 	ChunkList.clear();
 	StringList.clear();
 }
+Serializer::~Serializer() {
+	Memory::Free(Buffer);
+	Memory::Free(TextBuffer);
+}
+
+void Serializer::GrowBuffer(size_t size) {
+	size_t capacity = BufferCapacity ? BufferCapacity : 0x1000;
+	while (capacity - BufferLength < size) {
+		capacity *= 2;
+	}
+
+	Buffer = (Uint8*)Memory::Realloc(Buffer, capacity);
+	BufferCapacity = capacity;
+}
 
 void Serializer::WriteValue(VMValue val) {
 	switch (val.Type) {
 	case VAL_DECIMAL:
 	case VAL_LINKED_DECIMAL: {
 		float d = AS_DECIMAL(val);
-		StreamPtr->WriteByte(Serializer::VAL_TYPE_DECIMAL);
-		StreamPtr->WriteFloat(d);
+		WriteByte(Serializer::VAL_TYPE_DECIMAL);
+		WriteFloat(d);
 		return;
 	}
 	case VAL_INTEGER:
 	case VAL_LINKED_INTEGER: {
 		int i = AS_INTEGER(val);
-		StreamPtr->WriteByte(Serializer::VAL_TYPE_INTEGER);
-		StreamPtr->WriteInt64(i);
+		WriteByte(Serializer::VAL_TYPE_INTEGER);
+		WriteInt64(i);
 		return;
 	}
 	case VAL_HITBOX: {
 		Sint16* hitbox = AS_HITBOX(val);
-		StreamPtr->WriteByte(Serializer::VAL_TYPE_HITBOX);
-		StreamPtr->WriteInt16(hitbox[HITBOX_LEFT]);
-		StreamPtr->WriteInt16(hitbox[HITBOX_TOP]);
-		StreamPtr->WriteInt16(hitbox[HITBOX_RIGHT]);
-		StreamPtr->WriteInt16(hitbox[HITBOX_BOTTOM]);
+		WriteByte(Serializer::VAL_TYPE_HITBOX);
+		WriteInt16(hitbox[HITBOX_LEFT]);
+		WriteInt16(hitbox[HITBOX_TOP]);
+		WriteInt16(hitbox[HITBOX_RIGHT]);
+		WriteInt16(hitbox[HITBOX_BOTTOM]);
 		return;
 	}
 	case VAL_OBJECT: {
@@ -49,17 +63,17 @@ void Serializer::WriteValue(VMValue val) {
 			case OBJ_STRING:
 			case OBJ_ARRAY:
 			case OBJ_MAP:
-				StreamPtr->WriteByte(Serializer::VAL_TYPE_OBJECT);
-				StreamPtr->WriteUInt32(objectID);
+				WriteByte(Serializer::VAL_TYPE_OBJECT);
+				WriteUInt32(objectID);
 				return;
 			default:
-				StreamPtr->WriteByte(Serializer::VAL_TYPE_NULL);
+				WriteByte(Serializer::VAL_TYPE_NULL);
 				return;
 			}
 		}
 	}
 	default:
-		StreamPtr->WriteByte(Serializer::VAL_TYPE_NULL);
+		WriteByte(Serializer::VAL_TYPE_NULL);
 		return;
 	}
 }
@@ -70,7 +84,7 @@ void Serializer::WriteObject(Obj* obj) {
 		WriteObjectPreamble(Serializer::OBJ_TYPE_STRING);
 
 		ObjString* string = (ObjString*)obj;
-		StreamPtr->WriteUInt32(GetUniqueStringID(string->Chars, string->Length));
+		WriteUInt32(GetUniqueStringID(string->Chars, string->Length));
 		break;
 	}
 	case OBJ_ARRAY: {
@@ -78,7 +92,7 @@ void Serializer::WriteObject(Obj* obj) {
 
 		ObjArray* array = (ObjArray*)obj;
 		size_t sz = array->Values->size();
-		StreamPtr->WriteUInt32(sz);
+		WriteUInt32(sz);
 
 		for (size_t i = 0; i < sz; i++) {
 			VMValue arrayVal = (*array->Values)[i];
@@ -90,7 +104,7 @@ void Serializer::WriteObject(Obj* obj) {
 		WriteObjectPreamble(Serializer::OBJ_TYPE_MAP);
 
 		ObjMap* map = (ObjMap*)obj;
-		StreamPtr->WriteUInt32(map->Keys->Count());
+		WriteUInt32(map->Keys->Count());
 		map->Keys->WithAll([this](Uint32 hash, VMValue mapKey) -> void {
 			WriteValue(mapKey);
 		});
@@ -112,7 +126,7 @@ void Serializer::WriteObject(Obj* obj) {
 void Serializer::WriteObjectsChunk() {
 	BeginChunk(Serializer::CHUNK_OBJS);
 
-	StreamPtr->WriteUInt32(ObjList.size());
+	WriteUInt32(ObjList.size());
 
 	for (size_t i = 0; i < ObjList.size(); i++) {
 		WriteObject(ObjList[i]);
@@ -125,12 +139,12 @@ void Serializer::WriteObjectsChunk() {
 void Serializer::WriteTextChunk() {
 	BeginChunk(Serializer::CHUNK_TEXT);
 
-	StreamPtr->WriteUInt32(StringList.size());
+	WriteUInt32(StringList.size());
 
 	for (size_t i = 0; i < StringList.size(); i++) {
 		Uint32 length = StringList[i].Length;
-		StreamPtr->WriteUInt32(length);
-		StreamPtr->WriteBytes(StringList[i].Chars, length);
+		WriteUInt32(length);
+		WriteBytes(StringList[i].Chars, length);
 	}
 
 	FinishChunk();
@@ -140,8 +154,9 @@ void Serializer::WriteTextChunk() {
 }
 
 Uint32 Serializer::GetUniqueObjectID(Obj* obj) {
-	if (ObjToID.count(obj)) {
-		return ObjToID[obj];
+	auto it = ObjToID.find(obj);
+	if (it != ObjToID.end()) {
+		return it->second;
 	}
 
 	return 0xFFFFFFFF;
@@ -149,16 +164,16 @@ Uint32 Serializer::GetUniqueObjectID(Obj* obj) {
 
 void Serializer::BeginChunk(Uint32 type) {
 	CurrentChunkType = type;
-	StoredChunkPos = StreamPtr->Position();
+	StoredChunkPos = Position();
 }
 
 void Serializer::FinishChunk() {
 	LastChunk.Type = CurrentChunkType;
 	LastChunk.Offset = StoredChunkPos;
-	LastChunk.Size = StreamPtr->Position() - StoredChunkPos;
+	LastChunk.Size = Position() - StoredChunkPos;
 
 	// Write end marker
-	StreamPtr->WriteByte(Serializer::END);
+	WriteByte(Serializer::END);
 }
 
 void Serializer::AddChunkToList() {
@@ -166,18 +181,15 @@ void Serializer::AddChunkToList() {
 }
 
 void Serializer::WriteObjectPreamble(Uint8 type) {
-	StreamPtr->WriteByte(type);
-	StreamPtr->WriteUInt32(0); // To be patched in later
+	WriteByte(type);
+	WriteUInt32(0); // To be patched in later
 
-	StoredStreamPos = StreamPtr->Position();
+	StoredStreamPos = Position();
 }
 
 void Serializer::PatchObjectSize() {
-	size_t curPos = StreamPtr->Position();
-	size_t size = curPos - StoredStreamPos;
-	StreamPtr->Seek(StoredStreamPos - 4);
-	StreamPtr->WriteUInt32(size);
-	StreamPtr->Seek(curPos);
+	size_t size = Position() - StoredStreamPos;
+	PatchUInt32(StoredStreamPos - 4, size);
 }
 
 void Serializer::AddUniqueString(char* chars, size_t length) {
@@ -185,10 +197,9 @@ void Serializer::AddUniqueString(char* chars, size_t length) {
 		return;
 	}
 
-	for (size_t i = 0; i < StringList.size(); i++) {
-		if (StringList[i].Length == length && !memcmp(StringList[i].Chars, chars, length)) {
-			return;
-		}
+	auto result = StringToID.try_emplace(std::string_view(chars, length), StringList.size());
+	if (!result.second) {
+		return;
 	}
 
 	Serializer::String str;
@@ -198,77 +209,99 @@ void Serializer::AddUniqueString(char* chars, size_t length) {
 }
 
 Uint32 Serializer::GetUniqueStringID(char* chars, size_t length) {
-	for (size_t i = 0; i < StringList.size(); i++) {
-		if (StringList[i].Length == length && !memcmp(StringList[i].Chars, chars, length)) {
-			return (Uint32)i;
-		}
+	auto it = StringToID.find(std::string_view(chars, length));
+	if (it != StringToID.end()) {
+		return it->second;
 	}
 
 	return 0xFFFFFFFF;
 }
 
-void Serializer::AddUniqueObject(Obj* obj) {
-	if (ObjToID.count(obj) || ObjList.size() >= 0xFFFFFFFF) {
-		return;
-	}
+// Objects are numbered in the order a depth-first walk of the graph reaches
+// them. The walk uses its own stack, so deeply nested values can't overflow
+// the native one; children are pushed in reverse so that they're visited in
+// the same order they're written in.
+void Serializer::AddUniqueObject(Obj* root) {
+	WorkStack.clear();
+	WorkStack.push_back(root);
 
-	ObjToID[obj] = ObjList.size();
-	ObjList.push_back(obj);
+	while (WorkStack.size()) {
+		Obj* obj = WorkStack.back();
+		WorkStack.pop_back();
 
-	switch (obj->Type) {
-	case OBJ_STRING: {
-		ObjString* string = (ObjString*)obj;
-		AddUniqueString(string->Chars, string->Length);
-		return;
-	}
-	case OBJ_ARRAY: {
-		ObjArray* array = (ObjArray*)obj;
-		for (size_t i = 0; i < array->Values->size(); i++) {
-			VMValue arrayVal = (*array->Values)[i];
-			if (IS_OBJECT(arrayVal)) {
-				AddUniqueObject(AS_OBJECT(arrayVal));
-			}
+		if (ObjList.size() >= 0xFFFFFFFF) {
+			break;
 		}
-		return;
-	}
-	case OBJ_MAP: {
-		ObjMap* map = (ObjMap*)obj;
-		map->Keys->WithAll([this](Uint32, VMValue mapKey) -> void {
-			if (IS_OBJECT(mapKey)) {
-				AddUniqueObject(AS_OBJECT(mapKey));
-			}
-		});
-		map->Values->WithAll([this](Uint32, VMValue mapVal) -> void {
-			if (IS_OBJECT(mapVal)) {
-				AddUniqueObject(AS_OBJECT(mapVal));
+		if (!ObjToID.try_emplace(obj, (Uint32)ObjList.size()).second) {
+			continue;
+		}
+
+		ObjList.push_back(obj);
+
+		switch (obj->Type) {
+		case OBJ_STRING: {
+			ObjString* string = (ObjString*)obj;
+			AddUniqueString(string->Chars, string->Length);
+			break;
+		}
+		case OBJ_ARRAY: {
+			ObjArray* array = (ObjArray*)obj;
+			for (size_t i = array->Values->size(); i-- > 0;) {
+				VMValue arrayVal = (*array->Values)[i];
+				if (IS_OBJECT(arrayVal)) {
+					WorkStack.push_back(AS_OBJECT(arrayVal));
+				}
 			}
-		});
-		return;
-	}
-	default:
-		return;
+			break;
+		}
+		case OBJ_MAP: {
+			ObjMap* map = (ObjMap*)obj;
+			size_t first = WorkStack.size();
+			map->Keys->WithAll([this](Uint32, VMValue mapKey) -> void {
+				if (IS_OBJECT(mapKey)) {
+					WorkStack.push_back(AS_OBJECT(mapKey));
+				}
+			});
+			map->Values->WithAll([this](Uint32, VMValue mapVal) -> void {
+				if (IS_OBJECT(mapVal)) {
+					WorkStack.push_back(AS_OBJECT(mapVal));
+				}
+			});
+			std::reverse(WorkStack.begin() + first, WorkStack.end());
+			break;
+		}
+		default:
+			break;
+		}
 	}
 }
 
 void Serializer::Store(VMValue val) {
-	// Write header
-	StreamPtr->WriteUInt32(Serializer::Magic);
-	StreamPtr->WriteUInt32(CurrentVersion);
-
-	// We're gonna patch this later.
-	size_t chunkAddrPos = StreamPtr->Position();
-	StreamPtr->WriteUInt32(0);
+	BasePosition = StreamPtr->Position();
+	BufferLength = 0;
 
 	// See if we can add this value as an object
 	if (IS_OBJECT(val)) {
 		AddUniqueObject(AS_OBJECT(val));
 	}
 
+	// Most objects take up a few dozen bytes, so this usually saves growing
+	// the buffer more than once or twice.
+	GrowBuffer(ObjList.size() * 32 + 64);
+
+	// Write header
+	WriteUInt32(Serializer::Magic);
+	WriteUInt32(CurrentVersion);
+
+	// We're gonna patch this later.
+	size_t chunkAddrPos = Position();
+	WriteUInt32(0);
+
 	// Write the value
 	WriteValue(val);
 
 	// End marker
-	StreamPtr->WriteByte(Serializer::END);
+	WriteByte(Serializer::END);
 
 	// Write the objects chunk, if there are objects
 	if (ObjList.size()) {
@@ -282,70 +315,80 @@ void Serializer::Store(VMValue val) {
 	}
 
 	// Write the chunk list
-	size_t chunkListPos = StreamPtr->Position();
+	size_t chunkListPos = Position();
 
 	Uint32 numChunks = ChunkList.size();
 
-	StreamPtr->WriteUInt32(numChunks);
+	WriteUInt32(numChunks);
 
 	for (Uint32 i = 0; i < numChunks; i++) {
-		StreamPtr->WriteUInt32BE(ChunkList[i].Type);
-		StreamPtr->WriteUInt32(ChunkList[i].Offset);
-		StreamPtr->WriteUInt32(ChunkList[i].Size);
+		WriteUInt32BE(ChunkList[i].Type);
+		WriteUInt32(ChunkList[i].Offset);
+		WriteUInt32(ChunkList[i].Size);
 	}
 
 	// Write a pointer to the chunk list
-	size_t curPos = StreamPtr->Position();
-	StreamPtr->Seek(chunkAddrPos);
-	StreamPtr->WriteUInt32(chunkListPos);
-	StreamPtr->Seek(curPos);
+	PatchUInt32(chunkAddrPos, chunkListPos);
 
 	// Done here
-	StreamPtr->WriteByte(Serializer::END);
+	WriteByte(Serializer::END);
+	StreamPtr->WriteBytes(Buffer, BufferLength);
+
 	ObjToID.clear();
 	ObjList.clear();
+	StringToID.clear();
+	StringList.clear();
+	ChunkList.clear();
 }
 
+// Creates each object before any of them are read, since values can refer to
+// objects that come later in the chunk. Arrays and maps get room for as many
+// entries as they're stored with.
 void Serializer::GetObject() {
-	Uint8 type = StreamPtr->ReadByte();
-	Uint32 size = StreamPtr->ReadUInt32();
+	Uint8 type = Reader->ReadByte();
+	Uint32 size = Reader->ReadUInt32();
+	size_t end = Reader->Position() + size;
 	switch (type) {
 	case Serializer::OBJ_TYPE_STRING: {
-		Uint32 stringID = StreamPtr->ReadUInt32();
+		Uint32 stringID = Reader->ReadUInt32();
 		if (stringID >= StringList.size()) {
 			Log::Print(Log::LOG_ERROR, "Attempted to read an invalid string ID!");
-			return;
+			ObjList.push_back(nullptr);
 		}
 		else if (StringList[stringID].Chars == nullptr) {
 			ObjList.push_back(nullptr);
-			return;
 		}
-
-		Uint32 length = StringList[stringID].Length;
-		char* chars = (char*)Memory::Malloc(length + 1);
-		if (!chars) {
-			ObjList.push_back(nullptr);
-			return;
+		else {
+			// TakeString frees the copy if the text was already interned.
+			Uint32 length = StringList[stringID].Length;
+			char* chars = (char*)Memory::Malloc(length + 1);
+			if (chars) {
+				memcpy(chars, StringList[stringID].Chars, length + 1);
+				ObjList.push_back((Obj*)TakeString(chars, length));
+			}
+			else {
+				ObjList.push_back(nullptr);
+			}
 		}
-
-		memcpy(chars, StringList[stringID].Chars, length);
-		chars[length] = '\0'; // Ensure it's NULL-terminated
-
-		ObjString* string = TakeString(chars, length);
-		ObjList.push_back((Obj*)string);
-		return;
+		break;
 	}
 	case Serializer::OBJ_TYPE_ARRAY: {
+		// Every value takes up at least a byte, which keeps a corrupt count
+		// from reserving more than the data could hold.
+		Uint32 count = size >= 4 ? Reader->ReadUInt32() : 0;
 		ObjArray* array = NewArray();
+		array->Values->reserve(std::min(count, size));
 		ObjList.push_back((Obj*)array);
-		StreamPtr->Skip(size);
-		return;
+		break;
 	}
 	case Serializer::OBJ_TYPE_MAP: {
+		Uint32 count = size >= 4 ? Reader->ReadUInt32() : 0;
+		count = std::min(count, size / 2);
 		ObjMap* map = NewMap();
+		map->Keys->Reserve(count);
+		map->Values->Reserve(count);
 		ObjList.push_back((Obj*)map);
-		StreamPtr->Skip(size);
-		return;
+		break;
 	}
 	default:
 		if (type == OBJ_TYPE_UNIMPLEMENTED) {
@@ -356,43 +399,53 @@ void Serializer::GetObject() {
 				Log::LOG_ERROR, "Attempted to deserialize an invalid object type!");
 		}
 		ObjList.push_back(nullptr);
-		StreamPtr->Skip(size);
-		return;
+		break;
 	}
+
+	Reader->Seek(end);
 }
 
 void Serializer::ReadObject(Obj* obj) {
-	Uint8 type = StreamPtr->ReadByte();
-	Uint32 size = StreamPtr->ReadUInt32();
+	Uint8 type = Reader->ReadByte();
+	Uint32 size = Reader->ReadUInt32();
+	size_t end = Reader->Position() + size;
+	if (obj == nullptr) {
+		Reader->Seek(end);
+		return;
+	}
+
 	switch (type) {
 	case Serializer::OBJ_TYPE_ARRAY: {
-		Uint32 sz = StreamPtr->ReadUInt32();
+		Uint32 sz = Reader->ReadUInt32();
 		ObjArray* array = (ObjArray*)obj;
 		for (Uint32 i = 0; i < sz; i++) {
 			array->Values->push_back(ReadValue());
 		}
-		return;
+		break;
 	}
 	case Serializer::OBJ_TYPE_MAP: {
-		std::vector<VMValue> keys;
-
-		Uint32 count = StreamPtr->ReadUInt32();
+		Uint32 count = Reader->ReadUInt32();
 
 		if (CurrentVersion == 0x00000001) {
 			// Version 1 writes the amount of values separately from the amount of keys.
 			// Version 2 and newer writes just the amount of keys.
-			StreamPtr->ReadUInt32();
+			Reader->ReadUInt32();
 		}
 
 		ObjMap* map = (ObjMap*)obj;
 
+		// The values are stored in the same order as their keys, so the
+		// hashes of the keys are kept until the values are read.
+		KeyHashes.clear();
+		KeyHashes.reserve(std::min(count, size));
+
 		// Read the keys
 		for (Uint32 i = 0; i < count; i++) {
 			VMValue mapKey = NULL_VAL;
 
 			// Version 1 serializes keys as strings.
 			if (CurrentVersion == 0x00000001) {
-				Uint32 stringID = StreamPtr->ReadUInt32();
+				Uint32 stringID = Reader->ReadUInt32();
 				if (stringID >= StringList.size()) {
 					Log::Print(
 						Log::LOG_ERROR, "Attempted to read an invalid string ID!");
@@ -409,7 +462,7 @@ void Serializer::ReadObject(Obj* obj) {
 
 			Uint32 keyHash = Value::Hash(mapKey);
 			map->Keys->Put(keyHash, mapKey);
-			keys.push_back(mapKey);
+			KeyHashes.push_back(keyHash);
 		}
 
 		// Read the values
@@ -417,39 +470,39 @@ void Serializer::ReadObject(Obj* obj) {
 			if (CurrentVersion == 0x00000001) {
 				// Version 1 writes the hash this value belongs to.
 				// Not needed anymore because the keys get re-hashed.
-				StreamPtr->ReadUInt32();
+				Reader->ReadUInt32();
 			}
 
 			VMValue value = ReadValue();
-			Uint32 keyHash = Value::Hash(keys[i]);
-			map->Values->Put(keyHash, value);
+			map->Values->Put(KeyHashes[i], value);
 		}
-		return;
+		break;
 	}
 	default:
-		StreamPtr->Skip(size);
-		return;
+		break;
 	}
+
+	Reader->Seek(end);
 }
 
 VMValue Serializer::ReadValue() {
-	Uint8 type = StreamPtr->ReadByte();
+	Uint8 type = Reader->ReadByte();
 	switch (type) {
 	case Serializer::VAL_TYPE_INTEGER:
-		return INTEGER_VAL((int)StreamPtr->ReadInt64());
+		return INTEGER_VAL((int)Reader->ReadInt64());
 	case Serializer::VAL_TYPE_DECIMAL:
-		return DECIMAL_VAL(StreamPtr->ReadFloat());
+		return DECIMAL_VAL(Reader->ReadFloat());
 	case Serializer::VAL_TYPE_HITBOX: {
-		Sint16 left = StreamPtr->ReadInt16();
-		Sint16 top = StreamPtr->ReadInt16();
-		Sint16 right = StreamPtr->ReadInt16();
-		Sint16 bottom = StreamPtr->ReadInt16();
+		Sint16 left = Reader->ReadInt16();
+		Sint16 top = Reader->ReadInt16();
+		Sint16 right = Reader->ReadInt16();
+		Sint16 bottom = Reader->ReadInt16();
 		return HITBOX_VAL(left, top, right, bottom);
 	}
 	case Serializer::VAL_TYPE_NULL:
 		break;
 	case Serializer::VAL_TYPE_OBJECT: {
-		Uint32 objectID = StreamPtr->ReadUInt32();
+		Uint32 objectID = Reader->ReadUInt32();
 		if (objectID >= ObjList.size()) {
 			Log::Print(Log::LOG_ERROR, "Attempted to read an invalid object ID!");
 		}
@@ -470,82 +523,100 @@ VMValue Serializer::ReadValue() {
 
 bool Serializer::ReadObjectsChunk() {
 	// Read the object count
-	Uint32 count = StreamPtr->ReadUInt32();
+	Uint32 count = Reader->ReadUInt32();
 	if (!count) {
-		return StreamPtr->ReadByte() == Serializer::END;
+		return Reader->ReadByte() == Serializer::END;
 	}
 
-	// Read the objects, if there are any
-	size_t objListPos = StreamPtr->Position();
+	// Every object takes up at least five bytes.
+	ObjList.reserve(std::min((size_t)count, Reader->Remaining() / 5));
+
+	// Create the objects
+	size_t objListPos = Reader->Position();
 	for (Uint32 i = 0; i < count; i++) {
 		GetObject();
 	}
 
 	// Check for the end of chunk marker
-	if (StreamPtr->ReadByte() != Serializer::END) {
+	if (Reader->ReadByte() != Serializer::END) {
 		return false;
 	}
 
 	// Deserialize the objects (for real!)
-	StreamPtr->Seek(objListPos);
+	Reader->Seek(objListPos);
 	for (Uint32 i = 0; i < count; i++) {
 		ReadObject(ObjList[i]);
 	}
 
 	// Check for the end of chunk marker (again!)
-	return StreamPtr->ReadByte() == Serializer::END;
+	return Reader->ReadByte() == Serializer::END;
 }
 
-bool Serializer::ReadTextChunk() {
+// All of the text goes into a single block. The chunk is always big enough
+// for it, since each string's length takes up more room than its terminator.
+bool Serializer::ReadTextChunk(size_t size) {
+	size = std::min(size, Reader->Remaining());
+
+	Memory::Free(TextBuffer);
+	TextBuffer = (char*)Memory::Malloc(size + 1);
+
+	size_t used = 0;
+
 	// Read the count
-	Uint32 count = StreamPtr->ReadUInt32();
+	Uint32 count = Reader->ReadUInt32();
 
 	// Read the text, if there's any
 	for (Uint32 i = 0; i < count; i++) {
 		Serializer::String str;
-		str.Length = StreamPtr->ReadUInt32();
-		str.Chars = (char*)Memory::Calloc(str.Length, sizeof(char));
-		if (str.Chars) {
-			StreamPtr->ReadBytes(str.Chars, str.Length);
+		str.Length = Reader->ReadUInt32();
+		if (TextBuffer && str.Length < size + 1 - used) {
+			str.Chars = TextBuffer + used;
+			Reader->ReadBytes(str.Chars, str.Length);
+			str.Chars[str.Length] = '\0';
+			used += str.Length + 1;
 		}
 		else {
-			StreamPtr->Skip(str.Length);
+			str.Chars = nullptr;
+			Reader->Skip(str.Length);
 		}
 		StringList.push_back(str);
 	}
 
 	// Check for the end of chunk marker
-	return StreamPtr->ReadByte() == Serializer::END;
+	return Reader->ReadByte() == Serializer::END;
 }
 
 VMValue Serializer::Retrieve() {
-	Uint32 magic = StreamPtr->ReadUInt32();
+	StreamReader reader(StreamPtr);
+	Reader = &reader;
+
+	Uint32 magic = Reader->ReadUInt32();
 	if (magic != Serializer::Magic) {
 		Log::Print(Log::LOG_ERROR, "Invalid magic!");
 		return NULL_VAL;
 	}
 
-	CurrentVersion = StreamPtr->ReadUInt32();
+	CurrentVersion = Reader->ReadUInt32();
 	if (CurrentVersion > Serializer::Version) {
 		Log::Print(Log::LOG_ERROR, "Invalid version!");
 		return NULL_VAL;
 	}
 
 	// Read the pointer to the chunk list
-	size_t chunkListPos = StreamPtr->ReadUInt32();
+	size_t chunkListPos = Reader->ReadUInt32();
 
 	// Store where we were before
-	size_t startPos = StreamPtr->Position();
+	size_t startPos = Reader->Position();
 
 	// Seek to the chunk list, and read it
-	StreamPtr->Seek(chunkListPos);
+	Reader->Seek(chunkListPos);
 
-	Uint32 numChunks = StreamPtr->ReadUInt32();
+	Uint32 numChunks = Reader->ReadUInt32();
 	for (Uint32 i = 0; i < numChunks; i++) {
 		Serializer::Chunk chunk;
-		chunk.Type = StreamPtr->ReadUInt32BE();
-		chunk.Offset = StreamPtr->ReadUInt32();
-		chunk.Size = StreamPtr->ReadUInt32();
+		chunk.Type = Reader->ReadUInt32BE();
+		chunk.Offset = Reader->ReadUInt32();
+		chunk.Size = Reader->ReadUInt32();
 		ChunkList.push_back(chunk);
 	}
 
@@ -558,14 +629,14 @@ VMValue Serializer::Retrieve() {
 		Uint8* typeArr = (Uint8*)(&type);
 		bool success = false;
 
-		StreamPtr->Seek((size_t)offset);
+		Reader->Seek((size_t)offset);
 
 		switch (type) {
 		case Serializer::CHUNK_OBJS:
 			success = Serializer::ReadObjectsChunk();
 			break;
 		case Serializer::CHUNK_TEXT:
-			success = Serializer::ReadTextChunk();
+			success = Serializer::ReadTextChunk(chunk.Size);
 			break;
 		default:
 			Log::Print(Log::LOG_WARN,
@@ -584,7 +655,7 @@ VMValue Serializer::Retrieve() {
 	}
 
 	// Seek back, so that we can read the value now
-	StreamPtr->Seek(startPos);
+	Reader->Seek(startPos);
 
 	// Read the value
 	VMValue returnValue = ReadValue();
@@ -592,15 +663,16 @@ VMValue Serializer::Retrieve() {
 	// Check for the EOF marker
 	// (Although it doesn't really matter at this point, but it can
 	// catch a malformed data stream)
-	if (StreamPtr->ReadByte() != Serializer::END) {
+	if (Reader->ReadByte() != Serializer::END) {
 		Log::Print(Log::LOG_ERROR,
 			"Did not read end of file marker where it was expected to be!");
 	}
 
 	// Free all text strings
-	for (size_t i = 0; i < StringList.size(); i++) {
-		Memory::Free(StringList[i].Chars);
-	}
+	Memory::Free(TextBuffer);
+	TextBuffer = nullptr;
+	StringList.clear();
 
+	Reader = nullptr;
 	return returnValue;
 }
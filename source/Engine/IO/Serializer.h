@@ -2,7 +2,9 @@
 #define ENGINE_IO_SERIALIZER_H
 
 #include <Engine/Bytecode/Types.h>
+#include <Engine/IO/StreamReader.h>
 #include <Engine/Includes/Standard.h>
+#include <Libraries/ankerl/unordered_dense.h>
 
 class Serializer {
 private:
@@ -22,11 +24,68 @@ private:
 	void GetObject();
 	void ReadObject(Obj* obj);
 	VMValue ReadValue();
+	bool ReadObjectsChunk();
+	bool ReadTextChunk(size_t size);
+
+	// Everything Store writes goes into this buffer first, and is handed to
+	// the stream in one write once it's done.
+	Uint8* Buffer = nullptr;
+	size_t BufferLength = 0;
+	size_t BufferCapacity = 0;
+	size_t BasePosition = 0;
+
+	void GrowBuffer(size_t size);
+	template<typename T> inline void WriteData(T data) {
+		if (BufferCapacity - BufferLength < sizeof(T)) {
+			GrowBuffer(sizeof(T));
+		}
+		memcpy(Buffer + BufferLength, &data, sizeof(T));
+		BufferLength += sizeof(T);
+	}
+	inline void WriteBytes(const void* data, size_t n) {
+		if (BufferCapacity - BufferLength < n) {
+			GrowBuffer(n);
+		}
+		memcpy(Buffer + BufferLength, data, n);
+		BufferLength += n;
+	}
+	inline void WriteByte(Uint8 data) {
+		WriteData<Uint8>(data);
+	}
+	inline void WriteInt16(Sint16 data) {
+		WriteData<Uint16>(TO_LE16((Uint16)data));
+	}
+	inline void WriteUInt32(Uint32 data) {
+		WriteData<Uint32>(TO_LE32(data));
+	}
+	inline void WriteUInt32BE(Uint32 data) {
+		WriteData<Uint32>(TO_BE32(data));
+	}
+	inline void WriteInt64(Sint64 data) {
+		WriteData<Uint64>(TO_LE64((Uint64)data));
+	}
+	inline void WriteFloat(float data) {
+		WriteData<float>(TO_LE32F(data));
+	}
+	inline void PatchUInt32(size_t position, Uint32 data) {
+		data = TO_LE32(data);
+		memcpy(Buffer + (position - BasePosition), &data, sizeof(data));
+	}
+	inline size_t Position() {
+		return BasePosition + BufferLength;
+	}
+
+	// Retrieve reads through this, so that reading a value doesn't cost a
+	// virtual call per field.
+	StreamReader* Reader = nullptr;
+	char* TextBuffer = nullptr;
+	std::vector<Uint32> KeyHashes;
+	std::vector<Obj*> WorkStack;
 
 	Uint32 CurrentVersion;
 
 public:
-	std::map<Obj*, Uint32> ObjToID;
+	ankerl::unordered_dense::map<Obj*, Uint32> ObjToID;
 	std::vector<Obj*> ObjList;
 	Stream* StreamPtr;
 	size_t StoredStreamPos;
@@ -44,6 +103,7 @@ public:
 		char* Chars;
 	};
 	std::vector<Serializer::String> StringList;
+	ankerl::unordered_dense::map<std::string_view, Uint32> StringToID;
 	enum { CHUNK_OBJS = MAGIC_BE32("OBJS"), CHUNK_TEXT = MAGIC_BE32("TEXT") };
 	enum {
 		VAL_TYPE_NULL,
@@ -58,9 +118,8 @@ public:
 	static Uint32 Version;
 
 	Serializer(Stream* stream);
+	~Serializer();
 	void Store(VMValue val);
-	bool ReadObjectsChunk();
-	bool ReadTextChunk();
 	VMValue Retrieve();
 };
 
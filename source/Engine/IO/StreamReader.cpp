@@ -0,0 +1,348 @@
+#include <Engine/IO/StreamReader.h>
+
+#include <Engine/IO/Compression/ZLibStream.h>
+#include <Engine/IO/MemoryStream.h>
+#include <Engine/IO/ResourceStream.h>
+
+#if HATCH_BIG_ENDIAN
+#define READ_ARRAY_MACRO(type, convert) \
+	size_t read = ReadBytes(out, count * sizeof(type)) / sizeof(type); \
+	for (size_t i = 0; i < read; i++) { \
+		out[i] = convert(out[i]); \
+	} \
+	return read;
+#else
+#define READ_ARRAY_MACRO(type, convert) return ReadBytes(out, count * sizeof(type)) / sizeof(type);
+#endif
+
+StreamReader::StreamReader(Stream* source) {
+	Init(source, STREAM_READER_BUFFER_SIZE);
+}
+StreamReader::StreamReader(Stream* source, size_t bufferSize) {
+	Init(source, bufferSize);
+}
+StreamReader::~StreamReader() {
+	Sync();
+	Memory::Free(Buffer);
+}
+
+void StreamReader::Init(Stream* source, size_t bufferSize) {
+	Source = source;
+	if (!Source) {
+		return;
+	}
+
+	// Streams that are already in memory are read in place.
+	Uint8* data = nullptr;
+	Uint8* cursor = nullptr;
+	size_t size = 0;
+
+	MemoryStream* memoryStream = dynamic_cast<MemoryStream*>(Source);
+	ResourceStream* resourceStream = dynamic_cast<ResourceStream*>(Source);
+	if (memoryStream) {
+		data = memoryStream->pointer_start;
+		cursor = memoryStream->pointer;
+		size = memoryStream->size;
+	}
+	else if (resourceStream && !resourceStream->Source) {
+		data = resourceStream->pointer_start;
+		cursor = resourceStream->pointer;
+		size = resourceStream->size;
+	}
+
+	if (data) {
+		Direct = true;
+		Start = data;
+		End = data + size;
+		Current = cursor < Start ? Start : (cursor > End ? End : cursor);
+		return;
+	}
+
+	if (bufferSize) {
+		Buffer = (Uint8*)Memory::TrackedMalloc("StreamReader::Buffer", bufferSize);
+		if (Buffer) {
+			BufferSize = bufferSize;
+		}
+	}
+
+	WindowPosition = Source->Position();
+	Start = Current = End = Buffer;
+}
+
+// Makes at least `minimum` bytes readable from the window, if the source has
+// them and they fit in the buffer. Whatever was left of the window is kept.
+bool StreamReader::Fill(size_t minimum) {
+	size_t available = End - Current;
+	if (available >= minimum) {
+		return true;
+	}
+	if (Direct || !Source || minimum > BufferSize) {
+		return false;
+	}
+
+	size_t position = Position();
+	if (available && Current != Buffer) {
+		memmove(Buffer, Current, available);
+	}
+
+	WindowPosition = position;
+	Start = Current = Buffer;
+	End = Buffer + available;
+
+	while ((size_t)(End - Current) < minimum) {
+		size_t read = Source->ReadBytes(Buffer + (End - Start), BufferSize - (End - Start));
+		if (read == 0) {
+			break;
+		}
+		End += read;
+	}
+
+	return (size_t)(End - Current) >= minimum;
+}
+
+size_t StreamReader::ReadSlow(void* data, size_t n) {
+	Uint8* dest = (Uint8*)data;
+	size_t total = End - Current;
+	if (total > n) {
+		total = n;
+	}
+	if (total) {
+		memcpy(dest, Current, total);
+		Current += total;
+	}
+
+	size_t remaining = n - total;
+	if (remaining && !Direct && Source) {
+		if (remaining >= BufferSize) {
+			// Big reads go straight into the destination.
+			size_t position = Position();
+			size_t read = 0;
+			while (read < remaining) {
+				size_t got = Source->ReadBytes(dest + total + read, remaining - read);
+				if (got == 0) {
+					break;
+				}
+				read += got;
+			}
+			total += read;
+
+			WindowPosition = position + read;
+			Start = Current = End = Buffer;
+		}
+		else {
+			Fill(remaining);
+
+			size_t read = End - Current;
+			if (read > remaining) {
+				read = remaining;
+			}
+			memcpy(dest + total, Current, read);
+			Current += read;
+			total += read;
+		}
+	}
+
+	// Same as Stream, a short read leaves the rest of the value zeroed.
+	if (total < n) {
+		memset(dest + total, 0, n - total);
+	}
+
+	return total;
+}
+
+Stream* StreamReader::GetStream() {
+	return Source;
+}
+bool StreamReader::IsDirect() {
+	return Direct;
+}
+
+// Moves the source stream to where the reader is.
+void StreamReader::Sync() {
+	if (!Source) {
+		return;
+	}
+
+	size_t position = Position();
+	Source->Seek(position);
+
+	if (!Direct) {
+		WindowPosition = position;
+		Start = Current = End = Buffer;
+	}
+}
+void StreamReader::Close() {
+	if (Source) {
+		Source->Close();
+		Source = nullptr;
+	}
+
+	Memory::Free(Buffer);
+	Buffer = nullptr;
+	BufferSize = 0;
+	Direct = false;
+	Start = Current = End = nullptr;
+	WindowPosition = 0;
+}
+
+void StreamReader::Seek(Sint64 offset) {
+	if (offset < 0) {
+		offset = 0;
+	}
+
+	size_t position = (size_t)offset;
+	if (position >= WindowPosition && position - WindowPosition <= (size_t)(End - Start)) {
+		Current = Start + (position - WindowPosition);
+		return;
+	}
+
+	if (Direct) {
+		Current = End;
+		return;
+	}
+	if (!Source) {
+		return;
+	}
+
+	Source->Seek(offset);
+	WindowPosition = Source->Position();
+	Start = Current = End = Buffer;
+}
+void StreamReader::SeekEnd(Sint64 offset) {
+	Seek((Sint64)Length() + offset);
+}
+void StreamReader::Skip(Sint64 offset) {
+	Seek((Sint64)Position() + offset);
+}
+size_t StreamReader::Length() {
+	if (Direct) {
+		return End - Start;
+	}
+
+	return Source ? Source->Length() : 0;
+}
+
+size_t StreamReader::ReadUInt16Array(Uint16* out, size_t count) {
+	READ_ARRAY_MACRO(Uint16, FROM_LE16);
+}
+size_t StreamReader::ReadInt16Array(Sint16* out, size_t count) {
+	READ_ARRAY_MACRO(Sint16, (Sint16)FROM_LE16);
+}
+size_t StreamReader::ReadUInt32Array(Uint32* out, size_t count) {
+	READ_ARRAY_MACRO(Uint32, FROM_LE32);
+}
+size_t StreamReader::ReadInt32Array(Sint32* out, size_t count) {
+	READ_ARRAY_MACRO(Sint32, (Sint32)FROM_LE32);
+}
+size_t StreamReader::ReadFloatArray(float* out, size_t count) {
+	READ_ARRAY_MACRO(float, FROM_LE32F);
+}
+
+// Reads up to and including the delimiter, which is kept in the string just
+// like Stream::ReadLine and Stream::ReadString do. Each byte is only looked
+// at once.
+char* StreamReader::ReadDelimited(bool stopAtNewline, const char* tag) {
+	char* data = nullptr;
+	size_t size = 0;
+
+	while (Current < End || Fill(1)) {
+		const Uint8* found = nullptr;
+		if (stopAtNewline) {
+			for (const Uint8* ptr = Current; ptr < End; ptr++) {
+				if (*ptr == '\n' || *ptr == '\0') {
+					found = ptr;
+					break;
+				}
+			}
+		}
+		else {
+			found = (const Uint8*)memchr(Current, '\0', End - Current);
+		}
+
+		const Uint8* stop = found ? found + 1 : End;
+		size_t length = stop - Current;
+
+		if (!data) {
+			data = (char*)Memory::TrackedMalloc(tag, length + 1);
+		}
+		else {
+			data = (char*)Memory::Realloc(data, size + length + 1);
+		}
+
+		memcpy(data + size, Current, length);
+		size += length;
+		Current = stop;
+
+		if (found) {
+			break;
+		}
+	}
+
+	if (!data) {
+		data = (char*)Memory::TrackedMalloc(tag, 1);
+	}
+
+	data[size] = 0;
+
+	return data;
+}
+char* StreamReader::ReadLine() {
+	return ReadDelimited(true, "StreamReader::ReadLine");
+}
+char* StreamReader::ReadString() {
+	return ReadDelimited(false, "StreamReader::ReadString");
+}
+void StreamReader::SkipString() {
+	while (Current < End || Fill(1)) {
+		const Uint8* found = (const Uint8*)memchr(Current, '\0', End - Current);
+		if (found) {
+			Current = found + 1;
+			return;
+		}
+
+		Current = End;
+	}
+}
+char* StreamReader::ReadHeaderedString() {
+	Uint8 size = ReadByte();
+
+	char* data = (char*)Memory::TrackedMalloc("StreamReader::ReadHeaderedString", size + 1);
+	if (size > 0) {
+		ReadBytes(data, size);
+	}
+	data[size] = 0;
+
+	return data;
+}
+
+// If the compressed data is already in the window, it's inflated from there
+// instead of being copied out first.
+Uint32 StreamReader::ReadCompressed(void* out) {
+	Uint32 compressed_size = ReadUInt32() - 4;
+	Uint32 uncompressed_size = ReadUInt32BE();
+
+	Inflate(out, uncompressed_size, compressed_size);
+
+	return uncompressed_size;
+}
+Uint32 StreamReader::ReadCompressed(void* out, size_t outSz) {
+	Uint32 compressed_size = ReadUInt32() - 4;
+	ReadUInt32BE(); // uncompressed_size
+
+	Inflate(out, outSz, compressed_size);
+
+	return (Uint32)outSz;
+}
+void StreamReader::Inflate(void* out, size_t outSz, size_t compressedSize) {
+	if (Fill(compressedSize)) {
+		ZLibStream::Decompress(out, outSz, (void*)Current, compressedSize);
+		Current += compressedSize;
+		return;
+	}
+
+	void* buffer = Memory::Malloc(compressedSize);
+	ReadBytes(buffer, compressedSize);
+
+	ZLibStream::Decompress(out, outSz, buffer, compressedSize);
+	Memory::Free(buffer);
+}
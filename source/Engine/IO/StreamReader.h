@@ -0,0 +1,133 @@
+#ifndef ENGINE_IO_STREAMREADER_H
+#define ENGINE_IO_STREAMREADER_H
+
+#include <Engine/IO/Stream.h>
+#include <Engine/Includes/Standard.h>
+
+#define STREAM_READER_BUFFER_SIZE 0x4000
+
+// Reads from a Stream through a window of bytes, so that small reads are a
+// bounds check and a pointer bump instead of a virtual call each.
+//
+// Streams that already hold all of their data in memory (MemoryStream, and
+// ResourceStream when it isn't backed by another stream) are read in place;
+// anything else is read through a buffer. The source stream's position is
+// only brought up to date by Sync, Close, or when the reader is destroyed.
+class StreamReader {
+private:
+	Stream* Source = nullptr;
+	Uint8* Buffer = nullptr;
+	size_t BufferSize = 0;
+
+	// The window of readable bytes, and where it starts in the source.
+	const Uint8* Start = nullptr;
+	const Uint8* Current = nullptr;
+	const Uint8* End = nullptr;
+	size_t WindowPosition = 0;
+
+	bool Direct = false;
+
+	void Init(Stream* source, size_t bufferSize);
+	bool Fill(size_t minimum);
+	size_t ReadSlow(void* data, size_t n);
+	char* ReadDelimited(bool stopAtNewline, const char* tag);
+	void Inflate(void* out, size_t outSz, size_t compressedSize);
+
+	template<typename T> inline T ReadValue() {
+		T data = {};
+		if ((size_t)(End - Current) >= sizeof(T)) {
+			memcpy(&data, Current, sizeof(T));
+			Current += sizeof(T);
+		}
+		else {
+			ReadSlow(&data, sizeof(T));
+		}
+		return data;
+	}
+
+public:
+	StreamReader(Stream* source);
+	StreamReader(Stream* source, size_t bufferSize);
+	~StreamReader();
+
+	Stream* GetStream();
+	bool IsDirect();
+	void Sync();
+	void Close();
+
+	void Seek(Sint64 offset);
+	void SeekEnd(Sint64 offset);
+	void Skip(Sint64 offset);
+	size_t Length();
+	inline size_t Position() {
+		return WindowPosition + (size_t)(Current - Start);
+	}
+	inline size_t Remaining() {
+		size_t length = Length();
+		size_t position = Position();
+		return position < length ? length - position : 0;
+	}
+
+	inline size_t ReadBytes(void* data, size_t n) {
+		if ((size_t)(End - Current) >= n) {
+			memcpy(data, Current, n);
+			Current += n;
+			return n;
+		}
+		return ReadSlow(data, n);
+	}
+	inline Uint8 ReadByte() {
+		if (Current < End) {
+			return *Current++;
+		}
+		return ReadValue<Uint8>();
+	}
+	inline Uint16 ReadUInt16() {
+		return FROM_LE16(ReadValue<Uint16>());
+	}
+	inline Uint16 ReadUInt16BE() {
+		return FROM_BE16(ReadValue<Uint16>());
+	}
+	inline Uint32 ReadUInt32() {
+		return FROM_LE32(ReadValue<Uint32>());
+	}
+	inline Uint32 ReadUInt32BE() {
+		return FROM_BE32(ReadValue<Uint32>());
+	}
+	inline Uint64 ReadUInt64() {
+		return FROM_LE64(ReadValue<Uint64>());
+	}
+	inline Sint16 ReadInt16() {
+		return (Sint16)FROM_LE16(ReadValue<Uint16>());
+	}
+	inline Sint16 ReadInt16BE() {
+		return (Sint16)FROM_BE16(ReadValue<Uint16>());
+	}
+	inline Sint32 ReadInt32() {
+		return (Sint32)FROM_LE32(ReadValue<Uint32>());
+	}
+	inline Sint32 ReadInt32BE() {
+		return (Sint32)FROM_BE32(ReadValue<Uint32>());
+	}
+	inline Sint64 ReadInt64() {
+		return (Sint64)FROM_LE64(ReadValue<Uint64>());
+	}
+	inline float ReadFloat() {
+		return FROM_LE32F(ReadValue<float>());
+	}
+
+	size_t ReadUInt16Array(Uint16* out, size_t count);
+	size_t ReadInt16Array(Sint16* out, size_t count);
+	size_t ReadUInt32Array(Uint32* out, size_t count);
+	size_t ReadInt32Array(Sint32* out, size_t count);
+	size_t ReadFloatArray(float* out, size_t count);
+
+	char* ReadLine();
+	char* ReadString();
+	void SkipString();
+	char* ReadHeaderedString();
+	Uint32 ReadCompressed(void* out);
+	Uint32 ReadCompressed(void* out, size_t outSz);
+};
+
+#endif /* ENGINE_IO_STREAMREADER_H */
@@ -28,6 +28,7 @@ public:
 	}
 
 	size_t Count() { return Data.size(); }
+	void Reserve(size_t count) { Data.reserve(count); }
 
 	void Put(Uint32 hash, T data) {
 		Data[hash] = data;
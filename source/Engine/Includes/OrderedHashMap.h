@@ -11,6 +11,11 @@ public:
 
 	OrderedHashMap<T>(Uint32 (*hashFunc)(const void*, size_t) = nullptr, int capacity = 16) : HashMap<T>(hashFunc, capacity) {}
 
+	void Reserve(size_t count) {
+		HashMap<T>::Reserve(count);
+		Keys.reserve(count);
+	}
+
 	void Put(Uint32 hash, T data) {
 		if (!HashMap<T>::Exists(hash)) {
 			Keys.push_back(hash);
@@ -9,6 +9,7 @@
 #include <Engine/Diagnostics/Clock.h>
 #include <Engine/Diagnostics/Log.h>
 #include <Engine/Diagnostics/Memory.h>
+#include <Engine/Diagnostics/Profiler.h>
 
 enum DecoderIndex { KIT_VIDEO_DEC = 0, KIT_AUDIO_DEC, KIT_SUBTITLE_DEC, KIT_DEC_COUNT };
 enum DecoderRunReturn {
@@ -97,6 +98,8 @@ int MediaPlayer::DemuxAllStreams(MediaPlayer* player) {
 	return DEMUXER_KEEP_READING;
 }
 int MediaPlayer::RunAllDecoders(MediaPlayer* player) {
+	PROFILE_ZONE("MediaPlayer::RunAllDecoders");
+
 	int got;
 	bool has_room = true;
 
@@ -145,6 +148,8 @@ int MediaPlayer::DecoderThreadFunc(void* ptr) {
 	bool is_running = true;
 	bool is_playing = true;
 
+	PROFILE_THREAD("Media Decoder");
+
 	while (is_running) {
 		if (player->State == KIT_CLOSED) {
 			is_running = false;
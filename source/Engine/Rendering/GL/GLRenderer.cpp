@@ -69,6 +69,20 @@ struct GL_TextureBatchState {
 	std::vector<GL_AnimFrameVert> Data;
 };
 
+struct GL_DrawBatchState {
+	Texture* TexturePtr;
+	int PaletteID;
+	int ViewIndex;
+	Matrix4x4 ViewMatrix;
+	float BlendColors[4];
+	float TintColors[4];
+	int TintMode;
+	bool UseTinting;
+	bool TextureBlend;
+	bool Flushing;
+	std::vector<GL_AnimFrameVert> Data;
+};
+
 struct GL_VertexBufferEntry {
 	float X, Y, Z;
 	float TextureU, TextureV;
@@ -144,7 +158,11 @@ int GL_CurrentTextureUnit = 0;
 bool GL_TextureBatchingEnabled = false;
 GL_TextureBatchState GL_CurrentTextureBatch;
 
+GL_DrawBatchState GL_CurrentDrawBatch;
+int GL_BlendFactors[4] = {-1, -1, -1, -1};
+
 void GL_PrepareScreenTexture();
+void GL_FlushDrawBatch();
 void GL_MakeYUVShader();
 
 #ifdef HAVE_GL_PERFSTATS
@@ -600,6 +618,8 @@ void GL_CheckPaletteUpdate() {
 	}
 }
 void GL_Predraw(Texture* texture, int paletteID = 0, bool useVertexColors = false) {
+	GL_FlushDrawBatch();
+
 	GL_SetTexture(texture, paletteID, useVertexColors);
 	GL_CheckPaletteUpdate();
 
@@ -680,6 +700,200 @@ void GL_DrawTextureBuffered(GLuint buffer, int offset, int flip) {
 	glDrawArrays(GL_TRIANGLE_STRIP, flip << 2, 4);
 	CHECK_GL();
 }
+
+// Draw batching
+// Quads drawn with the same texture, palette and shading state are merged
+// into a single vertex batch. Their vertices are transformed by the model
+// matrix on the CPU, so consecutive quads can share a draw call no matter
+// where they were placed. The batch is flushed before anything that could
+// observe or change the state it was recorded with, which keeps draws in
+// the order they were submitted.
+bool GL_CanBatchDraw(Texture* texture) {
+	if (!Graphics::DrawBatchingEnabled || GL_TextureBatchingEnabled ||
+		GL_CurrentDrawBatch.Flushing || GL_UserShaderActive()) {
+		return false;
+	}
+
+	// The transformed quad must still be a flat 2D shape.
+	float* m = Graphics::ModelMatrix->Values;
+	if (m[2] != 0.0f || m[3] != 0.0f || m[6] != 0.0f || m[7] != 0.0f || m[14] != 0.0f ||
+		m[15] != 1.0f) {
+		return false;
+	}
+
+	if (texture) {
+#ifdef GL_HAVE_YUV
+		GL_TextureData* textureData = (GL_TextureData*)texture->DriverData;
+		if (textureData && textureData->YUV) {
+			return false;
+		}
+#endif
+
+		// A pending palette upload must happen before this quad is drawn,
+		// but after every quad already in the batch.
+		if (texture->Format == TextureFormat_INDEXED && Graphics::UsePalettes &&
+			(Graphics::PaletteUpdated || Graphics::PaletteIndexLinesUpdated)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+bool GL_DrawBatchMatches(Texture* texture, int paletteID) {
+	GL_DrawBatchState* batch = &GL_CurrentDrawBatch;
+
+	if (batch->TexturePtr != texture || batch->PaletteID != paletteID ||
+		batch->ViewIndex != Scene::ViewCurrent ||
+		batch->TextureBlend != Graphics::TextureBlend ||
+		batch->UseTinting != Graphics::UseTinting) {
+		return false;
+	}
+
+	if (memcmp(batch->BlendColors, Graphics::BlendColors, sizeof(float) * 4)) {
+		return false;
+	}
+
+	if (Graphics::UseTinting &&
+		(batch->TintMode != Graphics::TintMode ||
+			memcmp(batch->TintColors, Graphics::TintColors, sizeof(float) * 4))) {
+		return false;
+	}
+
+	return !memcmp(
+		batch->ViewMatrix.Values, Graphics::ViewMatrix->Values, sizeof(float) * 16);
+}
+void GL_FlushDrawBatch() {
+	GL_DrawBatchState* batch = &GL_CurrentDrawBatch;
+	if (batch->Flushing || batch->Data.size() == 0) {
+		return;
+	}
+
+	batch->Flushing = true;
+
+	// Restore the state the batch was recorded with.
+	float blendColors[4];
+	float tintColors[4];
+	memcpy(blendColors, Graphics::BlendColors, sizeof(blendColors));
+	memcpy(tintColors, Graphics::TintColors, sizeof(tintColors));
+	int tintMode = Graphics::TintMode;
+	bool useTinting = Graphics::UseTinting;
+	bool textureBlend = Graphics::TextureBlend;
+	int viewIndex = Scene::ViewCurrent;
+	Matrix4x4* viewMatrix = Graphics::ViewMatrix;
+	Matrix4x4* modelMatrix = Graphics::ModelMatrix;
+
+	memcpy(Graphics::BlendColors, batch->BlendColors, sizeof(blendColors));
+	memcpy(Graphics::TintColors, batch->TintColors, sizeof(tintColors));
+	Graphics::TintMode = batch->TintMode;
+	Graphics::UseTinting = batch->UseTinting;
+	Graphics::TextureBlend = batch->TextureBlend;
+	Scene::ViewCurrent = batch->ViewIndex;
+	Graphics::ViewMatrix = &batch->ViewMatrix;
+
+	Matrix4x4 identity;
+	Matrix4x4::Identity(&identity);
+	Graphics::ModelMatrix = &identity;
+
+	// Any palette change still pending was made after these quads were
+	// submitted, so they are drawn with the palette already on the GPU.
+	bool paletteUpdated = Graphics::PaletteUpdated;
+	bool paletteIndexLinesUpdated = Graphics::PaletteIndexLinesUpdated;
+	Graphics::PaletteUpdated = false;
+	Graphics::PaletteIndexLinesUpdated = false;
+
+	GL_Predraw(batch->TexturePtr, batch->PaletteID, false);
+
+	void* data = batch->Data.data();
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glVertexAttribPointer(GLRenderer::CurrentShader->LocPosition,
+		2,
+		GL_FLOAT,
+		GL_FALSE,
+		sizeof(GL_AnimFrameVert),
+		data);
+	if (batch->TexturePtr) {
+		glVertexAttribPointer(GLRenderer::CurrentShader->LocTexCoord,
+			2,
+			GL_FLOAT,
+			GL_FALSE,
+			sizeof(GL_AnimFrameVert),
+			(char*)data + offsetof(GL_AnimFrameVert, u));
+	}
+
+	glDrawArrays(GL_TRIANGLES, 0, batch->Data.size());
+	CHECK_GL();
+
+	Graphics::DrawCalls++;
+
+	Graphics::PaletteUpdated |= paletteUpdated;
+	Graphics::PaletteIndexLinesUpdated |= paletteIndexLinesUpdated;
+
+	memcpy(Graphics::BlendColors, blendColors, sizeof(blendColors));
+	memcpy(Graphics::TintColors, tintColors, sizeof(tintColors));
+	Graphics::TintMode = tintMode;
+	Graphics::UseTinting = useTinting;
+	Graphics::TextureBlend = textureBlend;
+	Scene::ViewCurrent = viewIndex;
+	Graphics::ViewMatrix = viewMatrix;
+	Graphics::ModelMatrix = modelMatrix;
+
+	batch->Data.clear();
+	batch->Flushing = false;
+}
+bool GL_BatchDrawQuad(Texture* texture,
+	int paletteID,
+	float x0,
+	float y0,
+	float x1,
+	float y1,
+	float u0,
+	float v0,
+	float u1,
+	float v1) {
+	if (!GL_CanBatchDraw(texture)) {
+		return false;
+	}
+
+	GL_DrawBatchState* batch = &GL_CurrentDrawBatch;
+	if (batch->Data.size() && !GL_DrawBatchMatches(texture, paletteID)) {
+		GL_FlushDrawBatch();
+	}
+
+	if (batch->Data.size() == 0) {
+		batch->TexturePtr = texture;
+		batch->PaletteID = paletteID;
+		batch->ViewIndex = Scene::ViewCurrent;
+		memcpy(batch->BlendColors, Graphics::BlendColors, sizeof(float) * 4);
+		memcpy(batch->TintColors, Graphics::TintColors, sizeof(float) * 4);
+		batch->TintMode = Graphics::TintMode;
+		batch->UseTinting = Graphics::UseTinting;
+		batch->TextureBlend = Graphics::TextureBlend;
+		Matrix4x4::Copy(&batch->ViewMatrix, Graphics::ViewMatrix);
+	}
+
+	float* m = Graphics::ModelMatrix->Values;
+	float ax0 = m[0] * x0 + m[12], ay0 = m[1] * x0 + m[13];
+	float ax1 = m[0] * x1 + m[12], ay1 = m[1] * x1 + m[13];
+	float bx0 = m[4] * y0, by0 = m[5] * y0;
+	float bx1 = m[4] * y1, by1 = m[5] * y1;
+
+	GL_AnimFrameVert v[4];
+	v[0] = GL_AnimFrameVert{ax0 + bx0, ay0 + by0, u0, v0};
+	v[1] = GL_AnimFrameVert{ax1 + bx0, ay1 + by0, u1, v0};
+	v[2] = GL_AnimFrameVert{ax0 + bx1, ay0 + by1, u0, v1};
+	v[3] = GL_AnimFrameVert{ax1 + bx1, ay1 + by1, u1, v1};
+
+	batch->Data.push_back(v[0]);
+	batch->Data.push_back(v[1]);
+	batch->Data.push_back(v[2]);
+
+	batch->Data.push_back(v[1]);
+	batch->Data.push_back(v[2]);
+	batch->Data.push_back(v[3]);
+
+	return true;
+}
 void GL_DrawTexture(Texture* texture,
 	float sx,
 	float sy,
@@ -690,6 +904,22 @@ void GL_DrawTexture(Texture* texture,
 	float w,
 	float h,
 	int paletteID = 0) {
+	Graphics::DrawCommands++;
+
+	if (texture) {
+		float u0 = 0.0f, v0 = 0.0f, u1 = 1.0f, v1 = 1.0f;
+		if (sx >= 0.0) {
+			u0 = sx / texture->Width;
+			v0 = sy / texture->Height;
+			u1 = (sx + sw) / texture->Width;
+			v1 = (sy + sh) / texture->Height;
+		}
+
+		if (GL_BatchDrawQuad(texture, paletteID, x, y, x + w, y + h, u0, v0, u1, v1)) {
+			return;
+		}
+	}
+
 	GL_Predraw(texture, paletteID);
 
 	GL_Vec2 v[4];
@@ -720,6 +950,8 @@ void GL_DrawTexture(Texture* texture,
 
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 	CHECK_GL();
+
+	Graphics::DrawCalls++;
 }
 GLenum GL_GetBlendFactorFromHatchEnum(int factor) {
 	switch (factor) {
@@ -868,10 +1100,8 @@ void GL_PrepareVertexBufferUpdate(Scene3D* scene, VertexBuffer* vertexBuffer, Ui
 			face->Depth = (Sint64)((depth * 0x10000) / face->NumVertices);
 		}
 
-		qsort(vertexBuffer->FaceInfoBuffer,
-			vertexBuffer->FaceCount,
-			sizeof(FaceInfo),
-			PolygonRenderer::FaceSortFunction);
+		PolygonRenderer::SortFaces(
+			vertexBuffer->FaceInfoBuffer, vertexBuffer->FaceCount);
 	}
 }
 void GL_DeleteVertexIndexList(GL_VertexBuffer* driverData) {
@@ -1679,6 +1909,9 @@ void GLRenderer::SetGraphicsFunctions() {
 	Graphics::Internal.SetDepthTesting = GLRenderer::SetDepthTesting;
 }
 void GLRenderer::Dispose() {
+	GL_CurrentDrawBatch.Data.clear();
+	GL_CurrentDrawBatch.Data.shrink_to_fit();
+
 	glDeleteBuffers(1, &BufferCircleFill);
 	glDeleteBuffers(1, &BufferCircleStroke);
 	glDeleteBuffers(1, &BufferSquareFill);
@@ -2038,6 +2271,8 @@ int GLRenderer::LockTexture(Texture* texture, void** pixels, int* pitch) {
 	return 0;
 }
 int GLRenderer::UpdateTexture(Texture* texture, SDL_Rect* src, void* pixels, int pitch) {
+	GL_FlushDrawBatch();
+
 	Uint32 inputPixelsX = 0;
 	Uint32 inputPixelsY = 0;
 	Uint32 inputPixelsW = texture->Width;
@@ -2072,6 +2307,8 @@ int GLRenderer::UpdateTextureYUV(Texture* texture,
 	int pitchU,
 	void* pixelsV,
 	int pitchV) {
+	GL_FlushDrawBatch();
+
 #ifdef GL_HAVE_YUV
 	int inputPixelsX = 0;
 	int inputPixelsY = 0;
@@ -2143,6 +2380,8 @@ void GLRenderer::CopyTexturePixels(Texture* dest,
 	int srcY,
 	int srcWidth,
 	int srcHeight) {
+	GL_FlushDrawBatch();
+
 	GL_TextureData* destTextureData = (GL_TextureData*)dest->DriverData;
 	GL_TextureData* srcTextureData = (GL_TextureData*)src->DriverData;
 
@@ -2251,6 +2490,8 @@ GLenum GL_GetTextureMagFilterMode(int filterMode) {
 	}
 }
 void GLRenderer::SetTextureMinFilter(Texture* texture, int filterMode) {
+	GL_FlushDrawBatch();
+
 	GL_TextureData* textureData = (GL_TextureData*)texture->DriverData;
 
 	GLenum textureFilter = GL_GetTextureMinFilterMode(filterMode);
@@ -2259,6 +2500,8 @@ void GLRenderer::SetTextureMinFilter(Texture* texture, int filterMode) {
 	glTexParameteri(textureData->TextureTarget, GL_TEXTURE_MIN_FILTER, textureFilter);
 }
 void GLRenderer::SetTextureMagFilter(Texture* texture, int filterMode) {
+	GL_FlushDrawBatch();
+
 	GL_TextureData* textureData = (GL_TextureData*)texture->DriverData;
 
 	GLenum textureFilter = GL_GetTextureMagFilterMode(filterMode);
@@ -2268,6 +2511,8 @@ void GLRenderer::SetTextureMagFilter(Texture* texture, int filterMode) {
 }
 void GLRenderer::UnlockTexture(Texture* texture) {}
 void GLRenderer::DisposeTexture(Texture* texture) {
+	GL_FlushDrawBatch();
+
 	GL_TextureData* textureData = (GL_TextureData*)texture->DriverData;
 	if (!textureData) {
 		return;
@@ -2311,6 +2556,8 @@ void GLRenderer::DisposeTexture(Texture* texture) {
 
 // Viewport and view-related functions
 bool GLRenderer::SetRenderTarget(Texture* texture) {
+	GL_FlushDrawBatch();
+
 	if (texture == NULL) {
 		glBindFramebuffer(GL_FRAMEBUFFER, DefaultFramebuffer);
 
@@ -2335,6 +2582,8 @@ bool GLRenderer::SetRenderTarget(Texture* texture) {
 	return true;
 }
 void GLRenderer::ReadFramebuffer(void* pixels, int x, int y, int width, int height) {
+	GL_FlushDrawBatch();
+
 	glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
 
 	if (Graphics::CurrentRenderTarget) {
@@ -2413,6 +2662,8 @@ void GLRenderer::UpdateWindowSize(int width, int height) {
 	GLRenderer::UpdateViewport();
 }
 void GLRenderer::UpdateViewport() {
+	GL_FlushDrawBatch();
+
 	Viewport* vp = &Graphics::CurrentViewport;
 	if (Graphics::CurrentRenderTarget) {
 		glViewport(vp->X * RetinaScale,
@@ -2434,6 +2685,8 @@ void GLRenderer::UpdateViewport() {
 	GLRenderer::UpdateProjectionMatrix();
 }
 void GLRenderer::UpdateClipRect() {
+	GL_FlushDrawBatch();
+
 	ClipArea clip = Graphics::CurrentClip;
 	if (Graphics::CurrentClip.Enabled) {
 		Viewport view = Graphics::CurrentViewport;
@@ -2471,6 +2724,8 @@ void GLRenderer::UpdateClipRect() {
 	}
 }
 void GLRenderer::UpdateOrtho(float left, float top, float right, float bottom) {
+	GL_FlushDrawBatch();
+
 	Matrix4x4::Ortho(Scene::Views[Scene::ViewCurrent].ProjectionMatrix,
 		left,
 		right,
@@ -2480,6 +2735,8 @@ void GLRenderer::UpdateOrtho(float left, float top, float right, float bottom) {
 		500.0f);
 }
 void GLRenderer::UpdatePerspective(float fovy, float aspect, float nearv, float farv) {
+	GL_FlushDrawBatch();
+
 	Matrix4x4* matrix = Scene::Views[Scene::ViewCurrent].ProjectionMatrix;
 
 	MakePerspectiveMatrix(matrix, fovy, nearv, farv, aspect);
@@ -2523,6 +2780,8 @@ Shader* GLRenderer::CreateShader() {
 	return new GLShader();
 }
 void GLRenderer::SetUserShader(Shader* shaderPtr) {
+	GL_FlushDrawBatch();
+
 	GLShader* shader = (GLShader*)shaderPtr;
 	if (shader == nullptr) {
 		GL_PrepareShader(nullptr);
@@ -2552,6 +2811,8 @@ void GLRenderer::BindTexture(Texture* texture, int textureUnit) {
 	BindTexture(textureID, textureUnit);
 }
 void GLRenderer::BindTexture(int textureID, int textureUnit) {
+	GL_FlushDrawBatch();
+
 	SetTextureUnit(textureUnit);
 	glBindTexture(GL_TEXTURE_2D, textureID);
 }
@@ -2583,12 +2844,16 @@ int GLRenderer::GetCurrentProgram() {
 	return 0;
 }
 void GLRenderer::SetCurrentProgram(int program) {
+	GL_FlushDrawBatch();
+
 	glUseProgram(program);
 	CHECK_GL();
 }
 
 // Filter-related functions
 void GLRenderer::SetFilter(int filter) {
+	GL_FlushDrawBatch();
+
 	CurrentFilter = filter;
 }
 
@@ -2612,6 +2877,8 @@ void GLRenderer::UpdatePaletteIndexTable(Texture* texture) {
 
 // These guys
 void GLRenderer::Clear() {
+	GL_FlushDrawBatch();
+
 	GLenum bits = GL_COLOR_BUFFER_BIT;
 
 	if (Graphics::StencilEnabled) {
@@ -2631,6 +2898,8 @@ void GLRenderer::Clear() {
 	glClear(bits);
 }
 void GLRenderer::Present() {
+	GL_FlushDrawBatch();
+
 	SDL_GL_SwapWindow(Application::Window);
 	CHECK_GL();
 }
@@ -2638,6 +2907,20 @@ void GLRenderer::Present() {
 // Draw mode setting functions
 void GLRenderer::SetBlendColor(float r, float g, float b, float a) {}
 void GLRenderer::SetBlendMode(int srcC, int dstC, int srcA, int dstA) {
+	// Scripts tend to set the blend mode before every draw; don't break
+	// the current batch if it didn't actually change.
+	if (GL_BlendFactors[0] == srcC && GL_BlendFactors[1] == dstC &&
+		GL_BlendFactors[2] == srcA && GL_BlendFactors[3] == dstA) {
+		return;
+	}
+
+	GL_FlushDrawBatch();
+
+	GL_BlendFactors[0] = srcC;
+	GL_BlendFactors[1] = dstC;
+	GL_BlendFactors[2] = srcA;
+	GL_BlendFactors[3] = dstA;
+
 	glBlendFuncSeparate(GL_GetBlendFactorFromHatchEnum(srcC),
 		GL_GetBlendFactorFromHatchEnum(dstC),
 		GL_GetBlendFactorFromHatchEnum(srcA),
@@ -2652,6 +2935,8 @@ void GLRenderer::SetLineWidth(float n) {
 
 // Stencil functions
 void GLRenderer::SetStencilEnabled(bool enabled) {
+	GL_FlushDrawBatch();
+
 	if (enabled) {
 		glEnable(GL_STENCIL_TEST);
 	}
@@ -2660,6 +2945,8 @@ void GLRenderer::SetStencilEnabled(bool enabled) {
 	}
 }
 void GLRenderer::SetStencilTestFunc(int stencilTest) {
+	GL_FlushDrawBatch();
+
 	GLenum funcTest = GL_ALWAYS;
 
 	switch (stencilTest) {
@@ -2720,6 +3007,8 @@ GLenum GL_StencilOpToEnum(int stencilOp) {
 	return GL_KEEP;
 }
 void GLRenderer::SetStencilPassFunc(int stencilOp) {
+	GL_FlushDrawBatch();
+
 	GLenum opPass = GL_StencilOpToEnum(stencilOp);
 
 	if (opPass != GL_StencilOpPass) {
@@ -2729,6 +3018,8 @@ void GLRenderer::SetStencilPassFunc(int stencilOp) {
 	}
 }
 void GLRenderer::SetStencilFailFunc(int stencilOp) {
+	GL_FlushDrawBatch();
+
 	GLenum opFail = GL_StencilOpToEnum(stencilOp);
 
 	if (opFail != GL_StencilOpFail) {
@@ -2738,6 +3029,8 @@ void GLRenderer::SetStencilFailFunc(int stencilOp) {
 	}
 }
 void GLRenderer::SetStencilValue(int value) {
+	GL_FlushDrawBatch();
+
 	if (value != GL_StencilValue) {
 		GL_StencilValue = value;
 
@@ -2745,6 +3038,8 @@ void GLRenderer::SetStencilValue(int value) {
 	}
 }
 void GLRenderer::SetStencilMask(int mask) {
+	GL_FlushDrawBatch();
+
 	if (mask != GL_StencilMask) {
 		GL_StencilMask = mask;
 
@@ -2752,6 +3047,8 @@ void GLRenderer::SetStencilMask(int mask) {
 	}
 }
 void GLRenderer::ClearStencil() {
+	GL_FlushDrawBatch();
+
 	glClear(GL_STENCIL_BUFFER_BIT);
 }
 
@@ -2759,6 +3056,7 @@ void GLRenderer::ClearStencil() {
 void GLRenderer::StrokeLine(float x1, float y1, float x2, float y2) {
 #ifdef GL_SUPPORTS_SMOOTHING
 	if (Graphics::SmoothStroke) {
+		GL_FlushDrawBatch();
 		glEnable(GL_LINE_SMOOTH);
 	}
 #endif
@@ -2787,6 +3085,7 @@ void GLRenderer::StrokeLine(float x1, float y1, float x2, float y2) {
 void GLRenderer::StrokeCircle(float x, float y, float rad, float thickness) {
 #ifdef GL_SUPPORTS_SMOOTHING
 	if (Graphics::SmoothStroke) {
+		GL_FlushDrawBatch();
 		glEnable(GL_LINE_SMOOTH);
 	}
 #endif
@@ -2855,6 +3154,7 @@ void GLRenderer::StrokeRectangle(float x, float y, float w, float h) {
 void GLRenderer::FillCircle(float x, float y, float rad) {
 #ifdef GL_SUPPORTS_SMOOTHING
 	if (Graphics::SmoothFill) {
+		GL_FlushDrawBatch();
 		glEnable(GL_POLYGON_SMOOTH);
 	}
 #endif
@@ -2879,6 +3179,7 @@ void GLRenderer::FillCircle(float x, float y, float rad) {
 void GLRenderer::FillEllipse(float x, float y, float w, float h) {
 #ifdef GL_SUPPORTS_SMOOTHING
 	if (Graphics::SmoothFill) {
+		GL_FlushDrawBatch();
 		glEnable(GL_POLYGON_SMOOTH);
 	}
 #endif
@@ -2901,8 +3202,16 @@ void GLRenderer::FillEllipse(float x, float y, float w, float h) {
 #endif
 }
 void GLRenderer::FillRectangle(float x, float y, float w, float h) {
+	Graphics::DrawCommands++;
+
+	if (!Graphics::SmoothFill &&
+		GL_BatchDrawQuad(nullptr, 0, x, y, x + w, y + h, 0.0f, 0.0f, 0.0f, 0.0f)) {
+		return;
+	}
+
 #ifdef GL_SUPPORTS_SMOOTHING
 	if (Graphics::SmoothFill) {
+		GL_FlushDrawBatch();
 		glEnable(GL_POLYGON_SMOOTH);
 	}
 #endif
@@ -2919,6 +3228,8 @@ void GLRenderer::FillRectangle(float x, float y, float w, float h) {
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 	CHECK_GL();
 
+	Graphics::DrawCalls++;
+
 #ifdef GL_SUPPORTS_SMOOTHING
 	if (Graphics::SmoothFill) {
 		glDisable(GL_POLYGON_SMOOTH);
@@ -2928,6 +3239,7 @@ void GLRenderer::FillRectangle(float x, float y, float w, float h) {
 void GLRenderer::FillTriangle(float x1, float y1, float x2, float y2, float x3, float y3) {
 #ifdef GL_SUPPORTS_SMOOTHING
 	if (Graphics::SmoothFill) {
+		GL_FlushDrawBatch();
 		glEnable(GL_POLYGON_SMOOTH);
 	}
 #endif
@@ -2952,6 +3264,7 @@ void GLRenderer::FillTriangle(float x1, float y1, float x2, float y2, float x3,
 void GLRenderer::FillTriangleBlend(float* xc, float* yc, int* colors) {
 #ifdef GL_SUPPORTS_SMOOTHING
 	if (Graphics::SmoothFill) {
+		GL_FlushDrawBatch();
 		glEnable(GL_POLYGON_SMOOTH);
 	}
 #endif
@@ -2988,6 +3301,7 @@ void GLRenderer::FillTriangleBlend(float* xc, float* yc, int* colors) {
 void GLRenderer::FillQuad(float* xc, float* yc) {
 #ifdef GL_SUPPORTS_SMOOTHING
 	if (Graphics::SmoothFill) {
+		GL_FlushDrawBatch();
 		glEnable(GL_POLYGON_SMOOTH);
 	}
 #endif
@@ -3016,6 +3330,7 @@ void GLRenderer::FillQuad(float* xc, float* yc) {
 void GLRenderer::FillQuadBlend(float* xc, float* yc, int* colors) {
 #ifdef GL_SUPPORTS_SMOOTHING
 	if (Graphics::SmoothFill) {
+		GL_FlushDrawBatch();
 		glEnable(GL_POLYGON_SMOOTH);
 	}
 #endif
@@ -3060,6 +3375,7 @@ void GLRenderer::DrawTriangle(Texture* texture,
 	int* colors) {
 #ifdef GL_SUPPORTS_SMOOTHING
 	if (Graphics::SmoothFill) {
+		GL_FlushDrawBatch();
 		glEnable(GL_POLYGON_SMOOTH);
 	}
 #endif
@@ -3110,6 +3426,7 @@ void GLRenderer::DrawQuad(Texture* texture,
 	int* colors) {
 #ifdef GL_SUPPORTS_SMOOTHING
 	if (Graphics::SmoothFill) {
+		GL_FlushDrawBatch();
 		glEnable(GL_POLYGON_SMOOTH);
 	}
 #endif
@@ -3229,9 +3546,35 @@ void GLRenderer::DrawSprite(ISprite* sprite,
 	Graphics::Scale(scaleW, scaleH, 0.0f);
 
 	Texture* texture = sprite->Spritesheets[animframe.SheetNumber];
-	GL_Predraw(texture, paletteID);
-	GL_SetSpriteData(texture, animframe.X, animframe.Y, animframe.Width, animframe.Height);
-	GL_DrawTextureBuffered(sprite->ID, animframe.BufferOffset, ((int)flipY << 1) | (int)flipX);
+
+	Graphics::DrawCommands++;
+
+	bool batched = false;
+	if (texture) {
+		float fX = flipX ? -1.0f : 1.0f;
+		float fY = flipY ? -1.0f : 1.0f;
+
+		batched = GL_BatchDrawQuad(texture,
+			paletteID,
+			fX * animframe.OffsetX,
+			fY * animframe.OffsetY,
+			fX * (animframe.OffsetX + animframe.Width),
+			fY * (animframe.OffsetY + animframe.Height),
+			animframe.X / (float)texture->Width,
+			animframe.Y / (float)texture->Height,
+			(animframe.X + animframe.Width) / (float)texture->Width,
+			(animframe.Y + animframe.Height) / (float)texture->Height);
+	}
+
+	if (!batched) {
+		GL_Predraw(texture, paletteID);
+		GL_SetSpriteData(
+			texture, animframe.X, animframe.Y, animframe.Width, animframe.Height);
+		GL_DrawTextureBuffered(
+			sprite->ID, animframe.BufferOffset, ((int)flipY << 1) | (int)flipX);
+
+		Graphics::DrawCalls++;
+	}
 
 	Graphics::Restore();
 }
@@ -3564,6 +3907,8 @@ void GLRenderer::ClearScene3D(Uint32 sceneIndex) {
 	driverData->Changed = true;
 }
 void GLRenderer::DrawScene3D(Uint32 sceneIndex, Uint32 drawMode) {
+	GL_FlushDrawBatch();
+
 	if (sceneIndex < 0 || sceneIndex >= MAX_3D_SCENES) {
 		return;
 	}
@@ -3600,6 +3945,7 @@ void GLRenderer::DrawScene3D(Uint32 sceneIndex, Uint32 drawMode) {
 
 #ifdef GL_SUPPORTS_SMOOTHING
 	if (Graphics::SmoothFill) {
+		GL_FlushDrawBatch();
 		glEnable(GL_POLYGON_SMOOTH);
 	}
 #endif
@@ -4331,6 +4677,8 @@ void GLRenderer::RefreshLayerTileAnimations(TileLayer* layer) {
 }
 
 void GLRenderer::SetDepthTesting(bool enable) {
+	GL_FlushDrawBatch();
+
 	if (UseDepthTesting) {
 		if (enable) {
 			glEnable(GL_DEPTH_TEST);
@@ -5,10 +5,79 @@
 #include <Engine/Rendering/PolygonRenderer.h>
 #include <Engine/Rendering/Texture.h>
 
-int PolygonRenderer::FaceSortFunction(const void* a, const void* b) {
-	const FaceInfo* faceA = (const FaceInfo*)a;
-	const FaceInfo* faceB = (const FaceInfo*)b;
-	return faceB->Depth - faceA->Depth;
+static vector<Uint32> FaceSortKeys;
+static vector<Uint32> FaceSortIndices;
+static vector<FaceInfo> FaceSortScratch;
+
+void PolygonRenderer::SortFaces(FaceInfo* faces, Uint32 count) {
+	if (count < 2) {
+		return;
+	}
+
+	// Faces are sorted back to front, so the key is the depth mapped
+	// to an unsigned integer with its order reversed.
+	FaceSortKeys.resize(count * 2);
+	FaceSortIndices.resize(count * 2);
+
+	Uint32* keys = FaceSortKeys.data();
+	Uint32* indices = FaceSortIndices.data();
+	Uint32* keysOut = keys + count;
+	Uint32* indicesOut = indices + count;
+
+	Uint32 histogram[4][256];
+	memset(histogram, 0, sizeof histogram);
+
+	for (Uint32 i = 0; i < count; i++) {
+		Uint32 key = ~((Uint32)faces[i].Depth ^ 0x80000000U);
+		keys[i] = key;
+		indices[i] = i;
+		histogram[0][key & 0xFF]++;
+		histogram[1][(key >> 8) & 0xFF]++;
+		histogram[2][(key >> 16) & 0xFF]++;
+		histogram[3][key >> 24]++;
+	}
+
+	// LSD radix sort, one byte per pass. Each pass is stable, so faces
+	// at the same depth keep their submission order.
+	bool sorted = false;
+	for (int pass = 0; pass < 4; pass++) {
+		Uint32 shift = pass * 8;
+		Uint32* counts = histogram[pass];
+
+		// Every key has the same byte here, so this pass would not
+		// change the order.
+		if (counts[(keys[0] >> shift) & 0xFF] == count) {
+			continue;
+		}
+
+		Uint32 offset = 0;
+		for (int b = 0; b < 256; b++) {
+			Uint32 c = counts[b];
+			counts[b] = offset;
+			offset += c;
+		}
+
+		for (Uint32 i = 0; i < count; i++) {
+			Uint32 dest = counts[(keys[i] >> shift) & 0xFF]++;
+			keysOut[dest] = keys[i];
+			indicesOut[dest] = indices[i];
+		}
+
+		std::swap(keys, keysOut);
+		std::swap(indices, indicesOut);
+		sorted = true;
+	}
+
+	if (!sorted) {
+		return;
+	}
+
+	FaceSortScratch.resize(count);
+	FaceInfo* scratch = FaceSortScratch.data();
+	for (Uint32 i = 0; i < count; i++) {
+		scratch[i] = faces[indices[i]];
+	}
+	memcpy(faces, scratch, count * sizeof(FaceInfo));
 }
 
 void PolygonRenderer::BuildFrustumPlanes(float nearClippingPlane, float farClippingPlane) {
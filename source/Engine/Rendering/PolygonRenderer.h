@@ -27,7 +27,7 @@ public:
 	int NumFrustumPlanes = 0;
 	Frustum ViewFrustum[NUM_FRUSTUM_PLANES];
 
-	static int FaceSortFunction(const void* a, const void* b);
+	static void SortFaces(FaceInfo* faces, Uint32 count);
 	void BuildFrustumPlanes(float nearClippingPlane, float farClippingPlane);
 	bool SetBuffers();
 	void
@@ -9,9 +9,9 @@ bool PolygonRasterizer::DepthTest = false;
 size_t PolygonRasterizer::DepthBufferSize = 0;
 Uint32* PolygonRasterizer::DepthBuffer = NULL;
 
-bool PolygonRasterizer::UseDepthBuffer = false;
+thread_local bool PolygonRasterizer::UseDepthBuffer = false;
 
-bool PolygonRasterizer::UseFog = false;
+thread_local bool PolygonRasterizer::UseFog = false;
 float PolygonRasterizer::FogStart = 0.0f;
 float PolygonRasterizer::FogEnd = 1.0f;
 float PolygonRasterizer::FogDensity = 1.0f;
@@ -180,8 +180,6 @@ Uint32 DoColorTint(Uint32 color, Uint32 colorMult) {
 		multTableAt, \
 		multSubTableAt)
 
-Contour* ContourField = SoftwareRenderer::ContourBuffer;
-
 template<typename T>
 static void GetPolygonBounds(T* positions, int count, int& minVal, int& maxVal) {
 	minVal = INT_MAX;
@@ -210,6 +208,10 @@ static void GetPolygonBounds(T* positions, int count, int& minVal, int& maxVal)
 		dst_y2 = (int)Graphics::CurrentRenderTarget->Height; \
 	if (dst_y1 < 0) \
 		dst_y1 = 0; \
+	if (dst_y2 > Scanline::RowEnd) \
+		dst_y2 = Scanline::RowEnd; \
+	if (dst_y1 < Scanline::RowStart) \
+		dst_y1 = Scanline::RowStart; \
 	if (dst_y2 < 0 || dst_y1 >= dst_y2) \
 	return
 
@@ -265,7 +267,7 @@ void PolygonRasterizer::DrawBasic(Vector2* positions,
 	if (!Graphics::StencilEnabled &&
 		((blendFlag & (BlendFlag_MODE_MASK | BlendFlag_TINT_BIT)) == BlendFlag_OPAQUE)) {
 		for (int dst_y = dst_y1; dst_y < dst_y2; dst_y++) {
-			Contour contour = ContourField[dst_y];
+			Contour contour = Scanline::Contours[dst_y];
 			if (contour.MaxX < contour.MinX) {
 				dst_strideY += dstStride;
 				continue;
@@ -279,7 +281,7 @@ void PolygonRasterizer::DrawBasic(Vector2* positions,
 	}
 	else {
 		for (int dst_y = dst_y1; dst_y < dst_y2; dst_y++) {
-			Contour contour = ContourField[dst_y];
+			Contour contour = Scanline::Contours[dst_y];
 			if (contour.MaxX < contour.MinX) {
 				dst_strideY += dstStride;
 				continue;
@@ -356,7 +358,7 @@ void PolygonRasterizer::DrawBasicBlend(Vector2* positions,
 	int* multSubTableAt = &SoftwareRenderer::MultSubTable[opacity << 8];
 	int dst_strideY = dst_y1 * dstStride;
 	for (int dst_y = dst_y1; dst_y < dst_y2; dst_y++) {
-		Contour contour = ContourField[dst_y];
+		Contour contour = Scanline::Contours[dst_y];
 		contLen = contour.MaxX - contour.MinX;
 		if (contLen <= 0) {
 			dst_strideY += dstStride;
@@ -439,7 +441,7 @@ void PolygonRasterizer::DrawShaded(Vector3* positions,
 
 #define DRAW_POLYGONSHADED(pixelRead) \
 	for (int dst_y = dst_y1; dst_y < dst_y2; dst_y++) { \
-		Contour contour = ContourField[dst_y]; \
+		Contour contour = Scanline::Contours[dst_y]; \
 		contLen = contour.MaxX - contour.MinX; \
 		if (contLen <= 0) { \
 			dst_strideY += dstStride; \
@@ -452,7 +454,7 @@ void PolygonRasterizer::DrawShaded(Vector3* positions,
 	}
 #define DRAW_POLYGONSHADED_FOG(pixelRead) \
 	for (int dst_y = dst_y1; dst_y < dst_y2; dst_y++) { \
-		Contour contour = ContourField[dst_y]; \
+		Contour contour = Scanline::Contours[dst_y]; \
 		contLen = contour.MaxX - contour.MinX; \
 		if (contLen <= 0) { \
 			dst_strideY += dstStride; \
@@ -564,7 +566,7 @@ void PolygonRasterizer::DrawBlendShaded(Vector3* positions,
 
 #define DRAW_POLYGONBLENDSHADED(pixelRead) \
 	for (int dst_y = dst_y1; dst_y < dst_y2; dst_y++) { \
-		Contour contour = ContourField[dst_y]; \
+		Contour contour = Scanline::Contours[dst_y]; \
 		contLen = contour.MaxX - contour.MinX; \
 		if (contLen <= 0) { \
 			dst_strideY += dstStride; \
@@ -716,7 +718,7 @@ void PolygonRasterizer::DrawAffine(Texture* texture,
 
 #define DRAW_POLYGONAFFINE(placePixelMacro, dpR, dpW) \
 	for (int dst_y = dst_y1; dst_y < dst_y2; dst_y++) { \
-		Contour contour = ContourField[dst_y]; \
+		Contour contour = Scanline::Contours[dst_y]; \
 		contLen = contour.MaxX - contour.MinX; \
 		if (contLen <= 0) { \
 			dst_strideY += dstStride; \
@@ -886,7 +888,7 @@ void PolygonRasterizer::DrawBlendAffine(Texture* texture,
 
 #define DRAW_POLYGONBLENDAFFINE(placePixelMacro, dpR, dpW) \
 	for (int dst_y = dst_y1; dst_y < dst_y2; dst_y++) { \
-		Contour contour = ContourField[dst_y]; \
+		Contour contour = Scanline::Contours[dst_y]; \
 		contLen = contour.MaxX - contour.MinX; \
 		if (contLen <= 0) { \
 			dst_strideY += dstStride; \
@@ -1122,7 +1124,7 @@ void PolygonRasterizer::DrawPerspective(Texture* texture,
 
 #define DRAW_POLYGONPERSP(placePixelMacro, dpR, dpW) \
 	for (int dst_y = dst_y1; dst_y < dst_y2; dst_y++) { \
-		Contour contour = ContourField[dst_y]; \
+		Contour contour = Scanline::Contours[dst_y]; \
 		contLen = contour.MapRight - contour.MapLeft; \
 		if (contLen <= 0) { \
 			dst_strideY += dstStride; \
@@ -1279,7 +1281,7 @@ void PolygonRasterizer::DrawBlendPerspective(Texture* texture,
 
 #define DRAW_POLYGONBLENDPERSP(placePixelMacro, dpR, dpW) \
 	for (int dst_y = dst_y1; dst_y < dst_y2; dst_y++) { \
-		Contour contour = ContourField[dst_y]; \
+		Contour contour = Scanline::Contours[dst_y]; \
 		contLen = contour.MapRight - contour.MapLeft; \
 		if (contLen <= 0) { \
 			dst_strideY += dstStride; \
@@ -1397,7 +1399,7 @@ void PolygonRasterizer::DrawDepth(Vector3* positions,
 
 #define DRAW_POLYGONDEPTH(pixelRead) \
 	for (int dst_y = dst_y1; dst_y < dst_y2; dst_y++) { \
-		Contour contour = ContourField[dst_y]; \
+		Contour contour = Scanline::Contours[dst_y]; \
 		contLen = contour.MaxX - contour.MinX; \
 		if (contLen <= 0) { \
 			dst_strideY += dstStride; \
@@ -1519,7 +1521,7 @@ void PolygonRasterizer::DrawBlendDepth(Vector3* positions,
 
 #define DRAW_POLYGONBLENDDEPTH(pixelRead) \
 	for (int dst_y = dst_y1; dst_y < dst_y2; dst_y++) { \
-		Contour contour = ContourField[dst_y]; \
+		Contour contour = Scanline::Contours[dst_y]; \
 		contLen = contour.MaxX - contour.MinX; \
 		if (contLen <= 0) { \
 			dst_strideY += dstStride; \
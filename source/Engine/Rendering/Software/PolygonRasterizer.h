@@ -11,8 +11,8 @@ public:
 	static bool DepthTest;
 	static size_t DepthBufferSize;
 	static Uint32* DepthBuffer;
-	static bool UseDepthBuffer;
-	static bool UseFog;
+	static thread_local bool UseDepthBuffer;
+	static thread_local bool UseFog;
 	static float FogStart;
 	static float FogEnd;
 	static float FogDensity;
@@ -2,6 +2,10 @@
 #include <Engine/Rendering/Software/Scanline.h>
 #include <Engine/Rendering/Software/SoftwareRenderer.h>
 
+thread_local Contour* Scanline::Contours = SoftwareRenderer::ContourBuffer;
+thread_local int Scanline::RowStart = 0;
+thread_local int Scanline::RowEnd = MAX_FRAMEBUFFER_HEIGHT;
+
 #define GET_SCANLINE_CLIP_BOUNDS(x1, y1, x2, y2) \
 	if (Graphics::CurrentClip.Enabled) { \
 		x1 = Graphics::CurrentClip.X; \
@@ -24,11 +28,15 @@
 		y1 = 0; \
 		x2 = (int)Graphics::CurrentRenderTarget->Width; \
 		y2 = (int)Graphics::CurrentRenderTarget->Height; \
-	}
+	} \
+	if (y1 < Scanline::RowStart) \
+		y1 = Scanline::RowStart; \
+	if (y2 > Scanline::RowEnd) \
+	y2 = Scanline::RowEnd
 
 void Scanline::Prepare(int y1, int y2) {
 	int scanLineCount = y2 - y1;
-	Contour* contourPtr = &SoftwareRenderer::ContourBuffer[y1];
+	Contour* contourPtr = &Contours[y1];
 	while (scanLineCount--) {
 		contourPtr->MinX = INT_MAX;
 		contourPtr->MaxX = INT_MIN;
@@ -74,7 +82,7 @@ void Scanline::Process(int x1, int y1, int x2, int y2) {
 		yStart = 0;
 	}
 
-	Contour* contour = &SoftwareRenderer::ContourBuffer[yStart];
+	Contour* contour = &Contours[yStart];
 	if (yStart < yEndBound) {
 		int lineHeight = yEndBound - yStart;
 		while (lineHeight--) {
@@ -165,7 +173,7 @@ void Scanline::Process(int color1, int color2, int x1, int y1, int x2, int y2) {
 		yStart = 0;
 	}
 
-	Contour* contour = &SoftwareRenderer::ContourBuffer[yStart];
+	Contour* contour = &Contours[yStart];
 	if (yStart < yEndBound) {
 		int lineHeight = yEndBound - yStart;
 		while (lineHeight--) {
@@ -261,7 +269,7 @@ void Scanline::ProcessDepth(int x1, int y1, int z1, int x2, int y2, int z2) {
 		yStart = 0;
 	}
 
-	Contour* contour = &SoftwareRenderer::ContourBuffer[yStart];
+	Contour* contour = &Contours[yStart];
 	if (yStart < yEndBound) {
 		int lineHeight = yEndBound - yStart;
 		while (lineHeight--) {
@@ -379,7 +387,7 @@ void Scanline::ProcessDepth(int color1,
 		yStart = 0;
 	}
 
-	Contour* contour = &SoftwareRenderer::ContourBuffer[yStart];
+	Contour* contour = &Contours[yStart];
 	if (yStart < yEndBound) {
 		int lineHeight = yEndBound - yStart;
 		while (lineHeight--) {
@@ -505,7 +513,7 @@ void Scanline::ProcessUVAffine(Vector2 uv1,
 		yStart = 0;
 	}
 
-	Contour* contour = &SoftwareRenderer::ContourBuffer[yStart];
+	Contour* contour = &Contours[yStart];
 	if (yStart < yEndBound) {
 		int lineHeight = yEndBound - yStart;
 		while (lineHeight--) {
@@ -654,7 +662,7 @@ void Scanline::ProcessUVAffine(int color1,
 		yStart = 0;
 	}
 
-	Contour* contour = &SoftwareRenderer::ContourBuffer[yStart];
+	Contour* contour = &Contours[yStart];
 	if (yStart < yEndBound) {
 		int lineHeight = yEndBound - yStart;
 		while (lineHeight--) {
@@ -788,7 +796,7 @@ void Scanline::ProcessUV(Vector2 uv1, Vector2 uv2, int x1, int y1, int z1, int x
 		yStart = 0;
 	}
 
-	Contour* contour = &SoftwareRenderer::ContourBuffer[yStart];
+	Contour* contour = &Contours[yStart];
 	if (yStart < yEndBound) {
 		int lineHeight = yEndBound - yStart;
 		while (lineHeight--) {
@@ -944,7 +952,7 @@ void Scanline::ProcessUV(int color1,
 		yStart = 0;
 	}
 
-	Contour* contour = &SoftwareRenderer::ContourBuffer[yStart];
+	Contour* contour = &Contours[yStart];
 	if (yStart < yEndBound) {
 		int lineHeight = yEndBound - yStart;
 		while (lineHeight--) {
@@ -4,10 +4,17 @@
 #include <Engine/Includes/Standard.h>
 #include <Engine/Rendering/3D.h>
 #include <Engine/Rendering/Material.h>
+#include <Engine/Rendering/Software/Contour.h>
 #include <Engine/Rendering/Texture.h>
 
 class Scanline {
 public:
+	// Each thread that rasterizes polygons walks edges into its own contour
+	// buffer, and only fills the rows between RowStart and RowEnd.
+	static thread_local Contour* Contours;
+	static thread_local int RowStart;
+	static thread_local int RowEnd;
+
 	static void Prepare(int y1, int y2);
 	static void Process(int x1, int y1, int x2, int y2);
 	static void Process(int color1, int color2, int x1, int y1, int x2, int y2);
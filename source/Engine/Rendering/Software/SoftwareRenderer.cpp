@@ -5,14 +5,22 @@
 #include <Engine/Rendering/Software/PolygonRasterizer.h>
 #include <Engine/Rendering/Software/SoftwareEnums.h>
 #include <Engine/Rendering/Software/SoftwareRenderer.h>
+#include <Engine/Rendering/Software/TileRasterizer.h>
 
 #include <Engine/Diagnostics/Log.h>
 #include <Engine/Diagnostics/Memory.h>
+#include <Engine/Hashing/FNV1A.h>
 #include <Engine/IO/ResourceStream.h>
 
 #include <Engine/Bytecode/ScriptManager.h>
 #include <Engine/Bytecode/Types.h>
 
+#if !HATCH_BIG_ENDIAN && \
+	(defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define SOFTWARE_RENDERER_SSE2
+#include <emmintrin.h>
+#endif
+
 #if HATCH_BIG_ENDIAN
 #define GET_R(color) ((color >> 24) & 0xFF)
 #define GET_G(color) ((color >> 8) & 0xFF)
@@ -47,8 +55,10 @@ Uint8 ColG;
 Uint8 ColB;
 Uint32 ColRGB;
 
-PixelFunction CurrentPixelFunction = NULL;
-TintFunction CurrentTintFunction = NULL;
+// Polygons can be rasterized by several threads at once (see TileRasterizer),
+// and each of them picks its own pixel and tint functions.
+thread_local PixelFunction CurrentPixelFunction = NULL;
+thread_local TintFunction CurrentTintFunction = NULL;
 
 Uint8 StencilValue = 0x00;
 Uint8 StencilMask = 0xFF;
@@ -192,6 +202,183 @@ void SoftwareRenderer::SetGraphicsFunctions() {
 }
 void SoftwareRenderer::Dispose() {}
 
+// Indexed framebuffer
+#define INDEXED_BLEND_OPACITY_LEVELS 16
+#define INDEXED_INVERSE_UNRESOLVED 0xFFFF
+
+static Uint32 IndexedPaletteHash = 0;
+static bool IndexedFramebufferActive = false;
+static Uint16 IndexedInverseTable[0x8000];
+static Uint8* IndexedBlendTables[BlendFlag_SUBTRACT + 1][INDEXED_BLEND_OPACITY_LEVELS];
+
+static void ResetIndexedBlendTables() {
+	for (int mode = 0; mode <= BlendFlag_SUBTRACT; mode++) {
+		for (int level = 0; level < INDEXED_BLEND_OPACITY_LEVELS; level++) {
+			Memory::Free(IndexedBlendTables[mode][level]);
+			IndexedBlendTables[mode][level] = nullptr;
+		}
+	}
+
+	memset(IndexedInverseTable, 0xFF, sizeof(IndexedInverseTable));
+}
+static void UpdateIndexedPalette() {
+	// Blending in an indexed framebuffer is resolved against the
+	// first palette, so everything built from it must be thrown away
+	// when it changes.
+	Uint32 hash =
+		FNV1A::EncryptData(Graphics::PaletteColors[0], sizeof(Graphics::PaletteColors[0]));
+	if (hash != IndexedPaletteHash) {
+		IndexedPaletteHash = hash;
+		ResetIndexedBlendTables();
+	}
+}
+static Uint8 FindNearestPaletteIndex(int r, int g, int b) {
+	int key = ((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3);
+	if (IndexedInverseTable[key] != INDEXED_INVERSE_UNRESOLVED) {
+		return (Uint8)IndexedInverseTable[key];
+	}
+
+	// Match against the center of the 5-bit cell, so that the result
+	// doesn't depend on which color in the cell was asked for first.
+	r = (r & 0xF8) | 4;
+	g = (g & 0xF8) | 4;
+	b = (b & 0xF8) | 4;
+
+	Uint32* palette = Graphics::PaletteColors[0];
+	int bestIndex = 0;
+	int bestDistance = 0x7FFFFFFF;
+	for (int i = 0; i < 0x100; i++) {
+		int dr = (int)GET_R(palette[i]) - r;
+		int dg = (int)GET_G(palette[i]) - g;
+		int db = (int)GET_B(palette[i]) - b;
+		int distance = dr * dr + dg * dg + db * db;
+		if (distance < bestDistance) {
+			bestDistance = distance;
+			bestIndex = i;
+			if (distance == 0) {
+				break;
+			}
+		}
+	}
+
+	IndexedInverseTable[key] = bestIndex;
+	return (Uint8)bestIndex;
+}
+static Uint8* GetIndexedBlendTable(int blendFlag, int opacity) {
+	int mode = blendFlag & BlendFlag_MODE_MASK;
+	int level = opacity >> 4;
+	if (IndexedBlendTables[mode][level]) {
+		return IndexedBlendTables[mode][level];
+	}
+
+	Uint8* table = (Uint8*)Memory::TrackedMalloc("SoftwareRenderer::IndexedBlendTable", 0x10000);
+	Uint32* palette = Graphics::PaletteColors[0];
+	int amount = (level << 4) | 0xF;
+
+	// Indexed by (source index << 8) | destination index.
+	for (int src = 0; src < 0x100; src++) {
+		int srcR = GET_R(palette[src]);
+		int srcG = GET_G(palette[src]);
+		int srcB = GET_B(palette[src]);
+		for (int dst = 0; dst < 0x100; dst++) {
+			int r = GET_R(palette[dst]);
+			int g = GET_G(palette[dst]);
+			int b = GET_B(palette[dst]);
+			switch (mode) {
+			case BlendFlag_TRANSPARENT:
+				r += ((srcR - r) * amount) / 0xFF;
+				g += ((srcG - g) * amount) / 0xFF;
+				b += ((srcB - b) * amount) / 0xFF;
+				break;
+			case BlendFlag_ADDITIVE:
+				r = std::min(r + (srcR * amount) / 0xFF, 0xFF);
+				g = std::min(g + (srcG * amount) / 0xFF, 0xFF);
+				b = std::min(b + (srcB * amount) / 0xFF, 0xFF);
+				break;
+			case BlendFlag_SUBTRACT:
+				r = std::max(r - (srcR * amount) / 0xFF, 0);
+				g = std::max(g - (srcG * amount) / 0xFF, 0);
+				b = std::max(b - (srcB * amount) / 0xFF, 0);
+				break;
+			}
+			table[(src << 8) | dst] = FindNearestPaletteIndex(r, g, b);
+		}
+	}
+
+	IndexedBlendTables[mode][level] = table;
+	return table;
+}
+static View* GetIndexedFramebufferView() {
+	View* view = Graphics::CurrentView;
+	if (!Graphics::UsePalettes || view == nullptr || !view->UseIndexedFramebuffer ||
+		view->IndexedFramebuffer == nullptr) {
+		return nullptr;
+	}
+
+	// Draws into any other render target don't involve the view's buffer.
+	if (Graphics::CurrentRenderTarget == nullptr ||
+		Graphics::CurrentRenderTarget != view->DrawTarget) {
+		return nullptr;
+	}
+
+	return view;
+}
+static Uint8* GetIndexedFramebuffer() {
+	if (!IndexedFramebufferActive) {
+		return nullptr;
+	}
+
+	View* view = GetIndexedFramebufferView();
+	if (view == nullptr) {
+		return nullptr;
+	}
+
+	return view->IndexedFramebuffer;
+}
+static bool CanDrawIndexed(int blendFlag, int paletteID) {
+	// Indices are expanded with the first palette, so anything drawn
+	// with another palette (or with palette index lines) can't be.
+	if (paletteID != 0) {
+		return false;
+	}
+	if (blendFlag & (BlendFlag_TINT_BIT | BlendFlag_FILTER_BIT)) {
+		return false;
+	}
+	if ((blendFlag & BlendFlag_MODE_MASK) > BlendFlag_SUBTRACT) {
+		return false;
+	}
+	if (DotMaskH || DotMaskV || Graphics::StencilEnabled) {
+		return false;
+	}
+
+	return true;
+}
+static void ExpandIndexedFramebuffer(View* view) {
+	Texture* target = Graphics::CurrentRenderTarget;
+	Uint8* srcPx = view->IndexedFramebuffer;
+	Uint32* dstPx = (Uint32*)target->Pixels;
+	Uint32 width = target->Width;
+	Uint32 height = target->Height;
+	if ((size_t)width * height > view->IndexedFramebufferSize) {
+		return;
+	}
+
+	Uint32* palette = Graphics::PaletteColors[0];
+	size_t count = (size_t)width * height;
+	for (size_t i = 0; i < count; i++) {
+		dstPx[i] = palette[srcPx[i]];
+	}
+}
+// Must be called before anything is drawn into the view's RGBA target.
+// The indexed image is expanded into it, and the rest of the frame is
+// drawn in RGBA, so that draws stay in the order they were made in.
+static void ResolveIndexedFramebuffer() {
+	if (GetIndexedFramebuffer()) {
+		ExpandIndexedFramebuffer(Graphics::CurrentView);
+		IndexedFramebufferActive = false;
+	}
+}
+
 void SoftwareRenderer::RenderStart(int viewIndex) {
 	for (int i = 0; i < MAX_PALETTE_COUNT; i++) {
 		Graphics::PaletteColors[i][0] &= 0xFFFFFF;
@@ -201,8 +388,20 @@ void SoftwareRenderer::RenderStart(int viewIndex) {
 	if (view->UseStencil) {
 		view->ReallocStencil();
 	}
+
+	// Every frame starts out drawing indices, on top of whatever was
+	// drawn indexed in the previous one.
+	IndexedFramebufferActive = false;
+	if (view->UseIndexedFramebuffer && Graphics::UsePalettes) {
+		view->ReallocIndexedFramebuffer();
+		UpdateIndexedPalette();
+		IndexedFramebufferActive = GetIndexedFramebufferView() != nullptr;
+	}
+}
+void SoftwareRenderer::RenderEnd(int viewIndex) {
+	ResolveIndexedFramebuffer();
+	IndexedFramebufferActive = false;
 }
-void SoftwareRenderer::RenderEnd(int viewIndex) {}
 
 // Texture management functions
 Texture*
@@ -343,6 +542,12 @@ void SoftwareRenderer::Clear() {
 
 	memset(dstPx, 0, Graphics::CurrentRenderTarget->Pitch * Graphics::CurrentRenderTarget->Height);
 
+	// Both images are empty now, so drawing indices can resume.
+	if (GetIndexedFramebufferView()) {
+		Graphics::CurrentView->ClearIndexedFramebuffer();
+		IndexedFramebufferActive = true;
+	}
+
 	ClearStencil();
 }
 void SoftwareRenderer::Present() {}
@@ -986,6 +1191,8 @@ void SoftwareRenderer::BindScene3D(Uint32 sceneIndex) {
 	}
 }
 void SoftwareRenderer::DrawScene3D(Uint32 sceneIndex, Uint32 drawMode) {
+	ResolveIndexedFramebuffer();
+
 	if (sceneIndex < 0 || sceneIndex >= MAX_3D_SCENES) {
 		return;
 	}
@@ -1068,10 +1275,8 @@ void SoftwareRenderer::DrawScene3D(Uint32 sceneIndex, Uint32 drawMode) {
 
 	// Sort face infos by depth
 	if (sortFaces) {
-		qsort(vertexBuffer->FaceInfoBuffer,
-			vertexBuffer->FaceCount,
-			sizeof(FaceInfo),
-			PolygonRenderer::FaceSortFunction);
+		PolygonRenderer::SortFaces(
+			vertexBuffer->FaceInfoBuffer, vertexBuffer->FaceCount);
 	}
 
 	// sas
@@ -1130,6 +1335,10 @@ void SoftwareRenderer::DrawScene3D(Uint32 sceneIndex, Uint32 drawMode) {
 		switch (faceInfoPtr->DrawMode & DrawMode_FillTypeMask) {
 		// Lines, Solid Colored
 		case DrawMode_LINES:
+			// Lines are stroked right away, so the polygons before them are
+			// drawn first.
+			TileRasterizer::Flush();
+
 			vertexCountPerFaceMinus1 = faceInfoPtr->NumVertices - 1;
 			vertexFirst = &vertexBuffer->Vertices[faceInfoPtr->VerticesStartIndex];
 			vertex = vertexFirst;
@@ -1191,6 +1400,8 @@ void SoftwareRenderer::DrawScene3D(Uint32 sceneIndex, Uint32 drawMode) {
 		case DrawMode_LINES | DrawMode_FLAT_LIGHTING:
 		// Lines, Smooth Shading
 		case DrawMode_LINES | DrawMode_SMOOTH_LIGHTING: {
+			TileRasterizer::Flush();
+
 			vertexCount = faceInfoPtr->NumVertices;
 			vertexCountPerFaceMinus1 = vertexCount - 1;
 			vertexFirst = &vertexBuffer->Vertices[faceInfoPtr->VerticesStartIndex];
@@ -1307,17 +1518,21 @@ void SoftwareRenderer::DrawScene3D(Uint32 sceneIndex, Uint32 drawMode) {
 
 			if (texturePtr) {
 				if (!doAffineMapping) {
-					PolygonRasterizer::DrawPerspective(texturePtr,
+					TileRasterizer::AddFace(RASTER_FACE_PERSPECTIVE,
+						texturePtr,
 						polygonVertex,
 						polygonUV,
+						nullptr,
 						vertexFirst->Color,
 						vertexCount,
 						blendState);
 				}
 				else {
-					PolygonRasterizer::DrawAffine(texturePtr,
+					TileRasterizer::AddFace(RASTER_FACE_AFFINE,
+						texturePtr,
 						polygonVertex,
 						polygonUV,
+						nullptr,
 						vertexFirst->Color,
 						vertexCount,
 						blendState);
@@ -1325,13 +1540,21 @@ void SoftwareRenderer::DrawScene3D(Uint32 sceneIndex, Uint32 drawMode) {
 			}
 			else {
 				if (useDepthBuffer) {
-					PolygonRasterizer::DrawDepth(polygonVertex,
+					TileRasterizer::AddFace(RASTER_FACE_DEPTH,
+						nullptr,
+						polygonVertex,
+						nullptr,
+						nullptr,
 						vertexFirst->Color,
 						vertexCount,
 						blendState);
 				}
 				else {
-					PolygonRasterizer::DrawShaded(polygonVertex,
+					TileRasterizer::AddFace(RASTER_FACE_SHADED,
+						nullptr,
+						polygonVertex,
+						nullptr,
+						nullptr,
 						vertexFirst->Color,
 						vertexCount,
 						blendState);
@@ -1398,17 +1621,21 @@ void SoftwareRenderer::DrawScene3D(Uint32 sceneIndex, Uint32 drawMode) {
 
 			if (texturePtr) {
 				if (!doAffineMapping) {
-					PolygonRasterizer::DrawPerspective(texturePtr,
+					TileRasterizer::AddFace(RASTER_FACE_PERSPECTIVE,
+						texturePtr,
 						polygonVertex,
 						polygonUV,
+						nullptr,
 						color,
 						vertexCount,
 						blendState);
 				}
 				else {
-					PolygonRasterizer::DrawAffine(texturePtr,
+					TileRasterizer::AddFace(RASTER_FACE_AFFINE,
+						texturePtr,
 						polygonVertex,
 						polygonUV,
+						nullptr,
 						color,
 						vertexCount,
 						blendState);
@@ -1416,12 +1643,24 @@ void SoftwareRenderer::DrawScene3D(Uint32 sceneIndex, Uint32 drawMode) {
 			}
 			else {
 				if (useDepthBuffer) {
-					PolygonRasterizer::DrawDepth(
-						polygonVertex, color, vertexCount, blendState);
+					TileRasterizer::AddFace(RASTER_FACE_DEPTH,
+						nullptr,
+						polygonVertex,
+						nullptr,
+						nullptr,
+						color,
+						vertexCount,
+						blendState);
 				}
 				else {
-					PolygonRasterizer::DrawShaded(
-						polygonVertex, color, vertexCount, blendState);
+					TileRasterizer::AddFace(RASTER_FACE_SHADED,
+						nullptr,
+						polygonVertex,
+						nullptr,
+						nullptr,
+						color,
+						vertexCount,
+						blendState);
 				}
 			}
 
@@ -1490,32 +1729,44 @@ void SoftwareRenderer::DrawScene3D(Uint32 sceneIndex, Uint32 drawMode) {
 
 			if (texturePtr) {
 				if (!doAffineMapping) {
-					PolygonRasterizer::DrawBlendPerspective(texturePtr,
+					TileRasterizer::AddFace(RASTER_FACE_BLEND_PERSPECTIVE,
+						texturePtr,
 						polygonVertex,
 						polygonUV,
 						polygonVertColor,
+						0,
 						vertexCount,
 						blendState);
 				}
 				else {
-					PolygonRasterizer::DrawBlendAffine(texturePtr,
+					TileRasterizer::AddFace(RASTER_FACE_BLEND_AFFINE,
+						texturePtr,
 						polygonVertex,
 						polygonUV,
 						polygonVertColor,
+						0,
 						vertexCount,
 						blendState);
 				}
 			}
 			else {
 				if (useDepthBuffer) {
-					PolygonRasterizer::DrawBlendDepth(polygonVertex,
+					TileRasterizer::AddFace(RASTER_FACE_BLEND_DEPTH,
+						nullptr,
+						polygonVertex,
+						nullptr,
 						polygonVertColor,
+						0,
 						vertexCount,
 						blendState);
 				}
 				else {
-					PolygonRasterizer::DrawBlendShaded(polygonVertex,
+					TileRasterizer::AddFace(RASTER_FACE_BLEND_SHADED,
+						nullptr,
+						polygonVertex,
+						nullptr,
 						polygonVertColor,
+						0,
 						vertexCount,
 						blendState);
 				}
@@ -1526,6 +1777,8 @@ void SoftwareRenderer::DrawScene3D(Uint32 sceneIndex, Uint32 drawMode) {
 		}
 	}
 
+	TileRasterizer::Flush();
+
 #undef SET_BLENDFLAG_AND_OPACITY
 
 #undef PROJECT_X
@@ -1753,6 +2006,8 @@ static void DoLineStrokeBounded(int dst_x1,
 
 void SoftwareRenderer::SetLineWidth(float n) {}
 void SoftwareRenderer::StrokeLine(float x1, float y1, float x2, float y2) {
+	ResolveIndexedFramebuffer();
+
 	int x = 0, y = 0;
 	Uint32* dstPx = (Uint32*)Graphics::CurrentRenderTarget->Pixels;
 	Uint32 dstStride = Graphics::CurrentRenderTarget->Width;
@@ -1944,6 +2199,8 @@ void SoftwareRenderer::RasterizeEllipse(int ccx,
 #undef DRAW_POINT
 }
 void SoftwareRenderer::StrokeCircle(float x, float y, float rad, float thickness) {
+	ResolveIndexedFramebuffer();
+
 	View* currentView = Graphics::CurrentView;
 	if (!currentView) {
 		return;
@@ -2249,6 +2506,8 @@ void SoftwareRenderer::StrokeThickCircle(float x, float y, float rad, float thic
 }
 void SoftwareRenderer::StrokeEllipse(float x, float y, float w, float h) {}
 void SoftwareRenderer::StrokeRectangle(float x, float y, float w, float h) {
+	ResolveIndexedFramebuffer();
+
 	Uint32* dstPx = (Uint32*)Graphics::CurrentRenderTarget->Pixels;
 	Uint32 dstStride = Graphics::CurrentRenderTarget->Width;
 
@@ -2373,6 +2632,8 @@ void SoftwareRenderer::StrokeRectangle(float x, float y, float w, float h) {
 }
 
 void SoftwareRenderer::FillCircle(float x, float y, float rad) {
+	ResolveIndexedFramebuffer();
+
 	Uint32* dstPx = (Uint32*)Graphics::CurrentRenderTarget->Pixels;
 	Uint32 dstStride = Graphics::CurrentRenderTarget->Width;
 
@@ -2498,6 +2759,8 @@ void SoftwareRenderer::FillEllipse(float x, float y, float w, float h) {
 	// TODO
 }
 void SoftwareRenderer::FillRectangle(float x, float y, float w, float h) {
+	ResolveIndexedFramebuffer();
+
 	Uint32* dstPx = (Uint32*)Graphics::CurrentRenderTarget->Pixels;
 	Uint32 dstStride = Graphics::CurrentRenderTarget->Width;
 
@@ -2590,6 +2853,8 @@ void SoftwareRenderer::FillRectangle(float x, float y, float w, float h) {
 	}
 }
 void SoftwareRenderer::FillTriangle(float x1, float y1, float x2, float y2, float x3, float y3) {
+	ResolveIndexedFramebuffer();
+
 	View* currentView = Graphics::CurrentView;
 	if (!currentView) {
 		return;
@@ -2630,6 +2895,8 @@ void SoftwareRenderer::FillTriangle(float x1, float y1, float x2, float y2, floa
 	PolygonRasterizer::DrawBasic(vectors, ColRGB, 3, blendState);
 }
 void SoftwareRenderer::FillTriangleBlend(float* xc, float* yc, int* colors) {
+	ResolveIndexedFramebuffer();
+
 	View* currentView = Graphics::CurrentView;
 	if (!currentView) {
 		return;
@@ -2680,6 +2947,8 @@ void SoftwareRenderer::FillTriangleBlend(float* xc, float* yc, int* colors) {
 	PolygonRasterizer::DrawBasicBlend(vectors, colors, 3, blendState);
 }
 void SoftwareRenderer::FillQuad(float* xc, float* yc) {
+	ResolveIndexedFramebuffer();
+
 	View* currentView = Graphics::CurrentView;
 	if (!currentView) {
 		return;
@@ -2733,6 +3002,8 @@ void SoftwareRenderer::FillQuad(float* xc, float* yc) {
 	PolygonRasterizer::DrawBasic(vectors, ColRGB, 4, blendState);
 }
 void SoftwareRenderer::FillQuadBlend(float* xc, float* yc, int* colors) {
+	ResolveIndexedFramebuffer();
+
 	View* currentView = Graphics::CurrentView;
 	if (!currentView) {
 		return;
@@ -2813,6 +3084,8 @@ void SoftwareRenderer::DrawShapeTextured(Texture* texturePtr,
 	int* pc,
 	float* pu,
 	float* pv) {
+	ResolveIndexedFramebuffer();
+
 	View* currentView = Graphics::CurrentView;
 	if (!currentView) {
 		return;
@@ -2885,6 +3158,57 @@ void SoftwareRenderer::DrawShapeTextured(Texture* texturePtr,
 	}
 }
 
+static void DrawSpriteImageIndexed(Uint8* dstPx,
+	Uint32 dstStride,
+	Uint32* srcPx,
+	Uint32 srcStride,
+	int src_x1,
+	int src_y1,
+	int src_x2,
+	int src_y2,
+	int dst_x1,
+	int dst_y1,
+	int dst_x2,
+	int dst_y2,
+	int flipFlag,
+	int blendFlag,
+	int opacity) {
+	Uint8* blendTable = nullptr;
+	if ((blendFlag & BlendFlag_MODE_MASK) != BlendFlag_OPAQUE) {
+		blendTable = GetIndexedBlendTable(blendFlag, opacity);
+	}
+
+	int srcStepX = (flipFlag & 1) ? -1 : 1;
+	int srcStepY = (flipFlag & 2) ? -(int)srcStride : (int)srcStride;
+	Uint32* srcPxLine = srcPx + ((flipFlag & 2) ? src_y2 : src_y1) * srcStride +
+		((flipFlag & 1) ? src_x2 : src_x1);
+	Uint8* dstPxLine = dstPx + dst_y1 * dstStride;
+
+	// The palette is only used to tell which indices are transparent;
+	// colors are resolved when the framebuffer is expanded.
+	Uint32* index = Graphics::PaletteColors[0];
+
+	for (int dst_y = dst_y1; dst_y < dst_y2;
+		dst_y++, srcPxLine += srcStepY, dstPxLine += dstStride) {
+		Uint32* color = srcPxLine;
+		if (blendTable) {
+			for (int dst_x = dst_x1; dst_x < dst_x2; dst_x++, color += srcStepX) {
+				Uint32 c = *color & 0xFF;
+				if (c && (index[c] & 0xFF000000U)) {
+					dstPxLine[dst_x] = blendTable[(c << 8) | dstPxLine[dst_x]];
+				}
+			}
+		}
+		else {
+			for (int dst_x = dst_x1; dst_x < dst_x2; dst_x++, color += srcStepX) {
+				Uint32 c = *color & 0xFF;
+				if (c && (index[c] & 0xFF000000U)) {
+					dstPxLine[dst_x] = (Uint8)c;
+				}
+			}
+		}
+	}
+}
 void DrawSpriteImage(Texture* texture,
 	int x,
 	int y,
@@ -2953,6 +3277,29 @@ void DrawSpriteImage(Texture* texture,
 		return;
 	}
 
+	Uint8* indexedPx = GetIndexedFramebuffer();
+	if (indexedPx && Graphics::UsePalettes && texture->Format == TextureFormat_INDEXED &&
+		!SoftwareRenderer::UseSpriteDeform && CanDrawIndexed(blendFlag, paletteID)) {
+		DrawSpriteImageIndexed(indexedPx,
+			dstStride,
+			srcPx,
+			srcStride,
+			src_x1,
+			src_y1,
+			src_x2,
+			src_y2,
+			dst_x1,
+			dst_y1,
+			dst_x2,
+			dst_y2,
+			flipFlag,
+			blendFlag,
+			opacity);
+		return;
+	}
+
+	ResolveIndexedFramebuffer();
+
 #define DEFORM_X \
 	{ \
 		dst_x += *deformValues; \
@@ -3151,6 +3498,8 @@ void DrawSpriteImageTransformed(Texture* texture,
 	int rotation,
 	int paletteID,
 	BlendState blendState) {
+	ResolveIndexedFramebuffer();
+
 	Uint32* srcPx = SoftwareRenderer::GetTextureData(texture);
 	Uint32 srcStride = texture->Width;
 
@@ -4440,6 +4789,543 @@ void SoftwareRenderer::DrawTileLayer_HorizontalParallax(TileLayer* layer, View*
 	}
 }
 void SoftwareRenderer::DrawTileLayer_VerticalParallax(TileLayer* layer, View* currentView) {}
+// Chunk cache
+static bool CanUseChunkCache(TileLayer* layer) {
+	if (!layer->UseChunkCache || layer->UsingCustomScanlineFunction) {
+		return false;
+	}
+
+	if (Graphics::UsePaletteIndexLines && layer->UsePaletteIndexLines) {
+		return false;
+	}
+
+	if (Scene::ShowTileCollisionFlag && (layer->Flags & SceneLayer::FLAGS_COLLIDEABLE)) {
+		return false;
+	}
+
+	return layer->Width > 0 && layer->Height > 0;
+}
+static Uint32 GetTileChunkPaletteHash() {
+	if (!Graphics::UsePalettes) {
+		return 0;
+	}
+
+	Uint32 hash = FNV1A::EncryptData(nullptr, 0);
+	for (size_t i = 0; i < Scene::Tilesets.size(); i++) {
+		unsigned paletteID = Scene::Tilesets[i].PaletteID;
+		hash = FNV1A::EncryptData(&paletteID, sizeof(paletteID), hash);
+		hash = FNV1A::EncryptData(
+			Graphics::PaletteColors[paletteID], sizeof(Graphics::PaletteColors[0]), hash);
+	}
+
+	return hash;
+}
+static void BuildTileChunk(TileLayer* layer, int chunkX, int chunkY) {
+	int tileWidth = Scene::TileWidth;
+	int tileHeight = Scene::TileHeight;
+	int chunkWidth = TILE_CHUNK_SIZE * tileWidth;
+	int chunkHeight = TILE_CHUNK_SIZE * tileHeight;
+	int chunkIndex = chunkX + chunkY * layer->TileChunksX;
+	LayerTileChunk* chunk = &layer->TileChunks[chunkIndex];
+
+	if (!chunk->Pixels) {
+		// Make room by evicting the least recently drawn chunks.
+		while (layer->NumAllocatedTileChunks >= MAX_TILE_CHUNKS_PER_LAYER &&
+			layer->TileChunkLRUTail != -1) {
+			layer->FreeTileChunk(layer->TileChunkLRUTail);
+		}
+
+		chunk->Pixels = (Uint32*)Memory::TrackedMalloc(
+			"TileLayer::TileChunks", chunkWidth * chunkHeight * sizeof(Uint32));
+		chunk->RowFlags = (Uint8*)Memory::TrackedMalloc("TileLayer::TileChunks", chunkHeight);
+		layer->NumAllocatedTileChunks++;
+	}
+
+	memset(chunk->Pixels, 0, chunkWidth * chunkHeight * sizeof(Uint32));
+
+	chunk->HasAnimatedTiles = false;
+
+	for (int ty = 0; ty < TILE_CHUNK_SIZE; ty++) {
+		int tileY = chunkY * TILE_CHUNK_SIZE + ty;
+		if (tileY >= layer->Height) {
+			break;
+		}
+
+		for (int tx = 0; tx < TILE_CHUNK_SIZE; tx++) {
+			int tileX = chunkX * TILE_CHUNK_SIZE + tx;
+			if (tileX >= layer->Width) {
+				break;
+			}
+
+			Uint32 tile = layer->Tiles[tileX + (tileY << layer->WidthInBits)];
+			int tileID = tile & TILE_IDENT_MASK;
+			if (tileID == Scene::EmptyTile || (size_t)tileID >= Scene::TileSpriteInfos.size()) {
+				continue;
+			}
+
+			TileSpriteInfo& info = Scene::TileSpriteInfos[tileID];
+			if (info.IsAnimated) {
+				chunk->HasAnimatedTiles = true;
+			}
+
+			AnimFrame& frameStr =
+				info.Sprite->Animations[info.AnimationIndex].Frames[info.FrameIndex];
+			Texture* texture = info.Sprite->Spritesheets[frameStr.SheetNumber];
+			Uint32 srcStride = texture->Width;
+			Uint32* srcPx = SoftwareRenderer::GetTextureData(texture) + frameStr.X +
+				frameStr.Y * srcStride;
+			bool isPaletted = Graphics::UsePalettes && texture->Format == TextureFormat_INDEXED;
+			Uint32* index = Graphics::PaletteColors[Scene::Tilesets[info.TilesetID].PaletteID];
+			bool flipX = !!(tile & TILE_FLIPX_MASK);
+			bool flipY = !!(tile & TILE_FLIPY_MASK);
+
+			Uint32* dstPx = chunk->Pixels + (ty * tileHeight * chunkWidth) + (tx * tileWidth);
+			for (int y = 0; y < tileHeight; y++, dstPx += chunkWidth) {
+				Uint32* color = &srcPx[(flipY ? tileHeight - 1 - y : y) * srcStride];
+				for (int x = 0; x < tileWidth; x++) {
+					Uint32 c = color[flipX ? tileWidth - 1 - x : x];
+					if (isPaletted) {
+						c = c ? index[c] : 0;
+					}
+					dstPx[x] = (c & 0xFF000000U) ? c : 0;
+				}
+			}
+		}
+	}
+
+	// Opaque rows can be copied straight into the framebuffer.
+	Uint32* row = chunk->Pixels;
+	for (int y = 0; y < chunkHeight; y++, row += chunkWidth) {
+		int visible = 0;
+		for (int x = 0; x < chunkWidth; x++) {
+			if (row[x]) {
+				visible++;
+			}
+		}
+
+		Uint8 flags = 0;
+		if (visible) {
+			flags |= LayerTileChunk::ROW_VISIBLE;
+		}
+		if (visible == chunkWidth) {
+			flags |= LayerTileChunk::ROW_OPAQUE;
+		}
+		chunk->RowFlags[y] = flags;
+	}
+
+	chunk->Dirty = false;
+}
+#if defined(SOFTWARE_RENDERER_SSE2)
+// These composite four chunk pixels at a time, leaving empty (zero) pixels
+// alone, and return how many pixels they handled. They give the same results
+// as PixelNoFiltSetOpaque, PixelNoFiltSetTransparent and PixelNoFiltSetAdditive.
+static int CopyTileChunkSpanSSE2(Uint32* dst, Uint32* src, int count) {
+	const __m128i zero = _mm_setzero_si128();
+
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+		__m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+		__m128i empty = _mm_cmpeq_epi32(s, zero);
+		d = _mm_or_si128(_mm_and_si128(empty, d), _mm_andnot_si128(empty, s));
+		_mm_storeu_si128((__m128i*)(dst + i), d);
+	}
+	return i;
+}
+static int BlendTileChunkSpanSSE2(Uint32* dst, Uint32* src, int count, int opacity, bool add) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i opaque = _mm_set1_epi32((int)0xFF000000U);
+	const __m128i srcAlpha = _mm_set1_epi16(opacity);
+	const __m128i dstAlpha = _mm_set1_epi16(opacity ^ 0xFF);
+
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+		__m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+		__m128i empty = _mm_cmpeq_epi32(s, zero);
+
+		// (opacity * channel) >> 8, like MultTable
+		__m128i sLo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), srcAlpha), 8);
+		__m128i sHi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), srcAlpha), 8);
+
+		__m128i blended;
+		if (add) {
+			blended = _mm_adds_epu8(_mm_packus_epi16(sLo, sHi), d);
+		}
+		else {
+			__m128i dLo =
+				_mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), dstAlpha), 8);
+			__m128i dHi =
+				_mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), dstAlpha), 8);
+			blended = _mm_packus_epi16(_mm_add_epi16(sLo, dLo), _mm_add_epi16(sHi, dHi));
+		}
+		blended = _mm_or_si128(blended, opaque);
+
+		d = _mm_or_si128(_mm_and_si128(empty, d), _mm_andnot_si128(empty, blended));
+		_mm_storeu_si128((__m128i*)(dst + i), d);
+	}
+	return i;
+}
+#endif
+static void CompositeTileChunkSpan(Uint32* dst,
+	Uint32* src,
+	int count,
+	PixelFunction pixelFunction,
+	BlendState& blendState,
+	int* multTableAt,
+	int* multSubTableAt) {
+	int i = 0;
+#if defined(SOFTWARE_RENDERER_SSE2)
+	if (pixelFunction == SoftwareRenderer::PixelNoFiltSetOpaque) {
+		i = CopyTileChunkSpanSSE2(dst, src, count);
+	}
+	else if (pixelFunction == SoftwareRenderer::PixelNoFiltSetTransparent) {
+		i = BlendTileChunkSpanSSE2(dst, src, count, blendState.Opacity, false);
+	}
+	else if (pixelFunction == SoftwareRenderer::PixelNoFiltSetAdditive) {
+		i = BlendTileChunkSpanSSE2(dst, src, count, blendState.Opacity, true);
+	}
+#endif
+	for (; i < count; i++) {
+		if (src[i]) {
+			pixelFunction(&src[i], &dst[i], blendState, multTableAt, multSubTableAt);
+		}
+	}
+}
+void SoftwareRenderer::DrawTileLayer_ChunkCache(TileLayer* layer, View* currentView) {
+	int dst_x1 = 0;
+	int dst_y1 = 0;
+	int dst_x2 = (int)Graphics::CurrentRenderTarget->Width;
+	int dst_y2 = (int)Graphics::CurrentRenderTarget->Height;
+
+	Uint32* dstPx = (Uint32*)Graphics::CurrentRenderTarget->Pixels;
+	Uint32 dstStride = Graphics::CurrentRenderTarget->Width;
+
+	int clip_x1, clip_y1, clip_x2, clip_y2;
+	GetClipRegion(clip_x1, clip_y1, clip_x2, clip_y2);
+	if (!CheckClipRegion(clip_x1, clip_y1, clip_x2, clip_y2)) {
+		return;
+	}
+
+	if (dst_x1 < clip_x1) {
+		dst_x1 = clip_x1;
+	}
+	if (dst_y1 < clip_y1) {
+		dst_y1 = clip_y1;
+	}
+	if (dst_x2 > clip_x2) {
+		dst_x2 = clip_x2;
+	}
+	if (dst_y2 > clip_y2) {
+		dst_y2 = clip_y2;
+	}
+
+	if (dst_x2 < 0 || dst_y2 < 0 || dst_x1 >= dst_x2 || dst_y1 >= dst_y2) {
+		return;
+	}
+
+	BlendState blendState = GetBlendState();
+
+	if (!Graphics::TextureBlend) {
+		blendState.Mode = BlendMode_NORMAL;
+		blendState.Opacity = 0xFF;
+	}
+
+	if (!AlterBlendState(blendState)) {
+		return;
+	}
+
+	int blendFlag = blendState.Mode;
+	int opacity = blendState.Opacity;
+	if (blendFlag & (BlendFlag_TINT_BIT | BlendFlag_FILTER_BIT)) {
+		SetTintFunction(blendFlag);
+	}
+
+	int* multTableAt = &MultTable[opacity << 8];
+	int* multSubTableAt = &MultSubTable[opacity << 8];
+
+	PixelFunction pixelFunction = GetPixelFunction(blendFlag);
+	bool canCopyRows = pixelFunction == PixelNoFiltSetOpaque;
+
+	// The layer might have been resized since the chunks were made.
+	if (layer->TileChunksX != (layer->Width + TILE_CHUNK_SIZE - 1) / TILE_CHUNK_SIZE ||
+		layer->TileChunksY != (layer->Height + TILE_CHUNK_SIZE - 1) / TILE_CHUNK_SIZE) {
+		layer->InitTileChunks();
+	}
+
+	// Chunks hold resolved colors, so they must be rebuilt if the palettes
+	// they were built with changed.
+	Uint32 paletteHash = GetTileChunkPaletteHash();
+	if (paletteHash != layer->TileChunkPaletteHash) {
+		layer->InvalidateTileChunks();
+		layer->TileChunkPaletteHash = paletteHash;
+	}
+
+	int chunkWidth = TILE_CHUNK_SIZE * Scene::TileWidth;
+	int chunkHeight = TILE_CHUNK_SIZE * Scene::TileHeight;
+	Sint64 layerWidthInPixels = layer->Width * Scene::TileWidth;
+	Sint64 layerHeightInPixels = layer->Height * Scene::TileHeight;
+	bool repeatX = layer->Flags & SceneLayer::FLAGS_REPEAT_X;
+
+	TileScanLine* tScanLine = &Graphics::TileScanLineBuffer[dst_y1];
+	Uint32* dstPxLine = dstPx + dst_y1 * dstStride;
+	for (int dst_y = dst_y1; dst_y < dst_y2; dst_y++, tScanLine++, dstPxLine += dstStride) {
+		Sint64 srcX = tScanLine->SrcX >> 16;
+		Sint64 srcY = tScanLine->SrcY >> 16;
+		if (srcY < 0 || srcY >= layerHeightInPixels) {
+			continue;
+		}
+
+		if (repeatX) {
+			srcX %= layerWidthInPixels;
+			if (srcX < 0) {
+				srcX += layerWidthInPixels;
+			}
+		}
+
+		int chunkY = srcY / chunkHeight;
+		int chunkRow = srcY - (chunkY * chunkHeight);
+		LayerTileChunk* chunkRowStart = &layer->TileChunks[chunkY * layer->TileChunksX];
+
+		int dst_x = dst_x1;
+		while (dst_x < dst_x2) {
+			if (srcX >= layerWidthInPixels) {
+				if (!repeatX) {
+					break;
+				}
+				srcX -= layerWidthInPixels;
+			}
+			if (srcX < 0) {
+				Sint64 skip = std::min(-srcX, (Sint64)(dst_x2 - dst_x));
+				dst_x += skip;
+				srcX += skip;
+				continue;
+			}
+
+			int chunkX = srcX / chunkWidth;
+			int chunkCol = srcX - (chunkX * chunkWidth);
+			int count = chunkWidth - chunkCol;
+			if (count > dst_x2 - dst_x) {
+				count = dst_x2 - dst_x;
+			}
+			if (count > layerWidthInPixels - srcX) {
+				count = layerWidthInPixels - srcX;
+			}
+
+			LayerTileChunk* chunk = &chunkRowStart[chunkX];
+			if (chunk->Dirty) {
+				BuildTileChunk(layer, chunkX, chunkY);
+			}
+			layer->TouchTileChunk(chunkX + chunkY * layer->TileChunksX);
+
+			Uint8 rowFlags = chunk->RowFlags[chunkRow];
+			if (rowFlags & LayerTileChunk::ROW_VISIBLE) {
+				Uint32* color = &chunk->Pixels[chunkRow * chunkWidth + chunkCol];
+				Uint32* dst = &dstPxLine[dst_x];
+				if (canCopyRows && (rowFlags & LayerTileChunk::ROW_OPAQUE)) {
+					memcpy(dst, color, count * sizeof(Uint32));
+				}
+				else {
+					CompositeTileChunkSpan(dst,
+						color,
+						count,
+						pixelFunction,
+						blendState,
+						multTableAt,
+						multSubTableAt);
+				}
+			}
+
+			dst_x += count;
+			srcX += count;
+		}
+	}
+}
+// Indexed tile layers
+static bool CanDrawTileLayerIndexed(TileLayer* layer) {
+	if (!GetIndexedFramebuffer() || layer->UsingCustomScanlineFunction) {
+		return false;
+	}
+
+	if (Scene::ShowTileCollisionFlag && (layer->Flags & SceneLayer::FLAGS_COLLIDEABLE)) {
+		return false;
+	}
+
+	BlendState blendState = SoftwareRenderer::GetBlendState();
+	if (!Graphics::TextureBlend) {
+		blendState.Mode = BlendMode_NORMAL;
+		blendState.Opacity = 0xFF;
+	}
+	if (SoftwareRenderer::AlterBlendState(blendState) && !CanDrawIndexed(blendState.Mode, 0)) {
+		return false;
+	}
+
+	if (Graphics::UsePaletteIndexLines && layer->UsePaletteIndexLines) {
+		return false;
+	}
+	for (size_t i = 0; i < Scene::Tilesets.size(); i++) {
+		if (Scene::Tilesets[i].PaletteID != 0) {
+			return false;
+		}
+	}
+
+	for (size_t i = 0; i < Scene::TileSpriteInfos.size(); i++) {
+		TileSpriteInfo& info = Scene::TileSpriteInfos[i];
+		AnimFrame& frameStr =
+			info.Sprite->Animations[info.AnimationIndex].Frames[info.FrameIndex];
+		Texture* texture = info.Sprite->Spritesheets[frameStr.SheetNumber];
+		if (texture->Format != TextureFormat_INDEXED) {
+			return false;
+		}
+	}
+
+	return layer->Width > 0 && layer->Height > 0;
+}
+void SoftwareRenderer::DrawTileLayer_Indexed(TileLayer* layer, View* currentView) {
+	static vector<Uint32> srcStrides;
+	static vector<Uint32*> tileSources;
+	srcStrides.clear();
+	tileSources.clear();
+
+	Uint8* dstPx = GetIndexedFramebuffer();
+	if (!dstPx) {
+		return;
+	}
+
+	int dst_x1 = 0;
+	int dst_y1 = 0;
+	int dst_x2 = (int)Graphics::CurrentRenderTarget->Width;
+	int dst_y2 = (int)Graphics::CurrentRenderTarget->Height;
+	Uint32 dstStride = Graphics::CurrentRenderTarget->Width;
+
+	int clip_x1, clip_y1, clip_x2, clip_y2;
+	GetClipRegion(clip_x1, clip_y1, clip_x2, clip_y2);
+	if (!CheckClipRegion(clip_x1, clip_y1, clip_x2, clip_y2)) {
+		return;
+	}
+
+	if (dst_x1 < clip_x1) {
+		dst_x1 = clip_x1;
+	}
+	if (dst_y1 < clip_y1) {
+		dst_y1 = clip_y1;
+	}
+	if (dst_x2 > clip_x2) {
+		dst_x2 = clip_x2;
+	}
+	if (dst_y2 > clip_y2) {
+		dst_y2 = clip_y2;
+	}
+
+	if (dst_x2 < 0 || dst_y2 < 0 || dst_x1 >= dst_x2 || dst_y1 >= dst_y2) {
+		return;
+	}
+
+	BlendState blendState = GetBlendState();
+
+	if (!Graphics::TextureBlend) {
+		blendState.Mode = BlendMode_NORMAL;
+		blendState.Opacity = 0xFF;
+	}
+
+	if (!AlterBlendState(blendState)) {
+		return;
+	}
+
+	Uint8* blendTable = nullptr;
+	if ((blendState.Mode & BlendFlag_MODE_MASK) != BlendFlag_OPAQUE) {
+		blendTable = GetIndexedBlendTable(blendState.Mode, blendState.Opacity);
+	}
+
+	for (size_t i = 0; i < Scene::TileSpriteInfos.size(); i++) {
+		TileSpriteInfo& info = Scene::TileSpriteInfos[i];
+		AnimFrame& frameStr =
+			info.Sprite->Animations[info.AnimationIndex].Frames[info.FrameIndex];
+		Texture* texture = info.Sprite->Spritesheets[frameStr.SheetNumber];
+		Uint32* texturePixelData = SoftwareRenderer::GetTextureData(texture);
+		srcStrides.push_back(texture->Width);
+		tileSources.push_back(
+			(&(texturePixelData)[frameStr.X + frameStr.Y * texture->Width]));
+	}
+
+	int tileWidth = Scene::TileWidth;
+	int tileHeight = Scene::TileHeight;
+	Sint64 layerWidthInPixels = layer->Width * tileWidth;
+	Sint64 layerHeightInPixels = layer->Height * tileHeight;
+	bool repeatX = layer->Flags & SceneLayer::FLAGS_REPEAT_X;
+	Uint32* index = Graphics::PaletteColors[0];
+
+	TileScanLine* tScanLine = &Graphics::TileScanLineBuffer[dst_y1];
+	Uint8* dstPxLine = dstPx + dst_y1 * dstStride;
+	for (int dst_y = dst_y1; dst_y < dst_y2; dst_y++, tScanLine++, dstPxLine += dstStride) {
+		Sint64 srcX = tScanLine->SrcX >> 16;
+		Sint64 srcY = tScanLine->SrcY >> 16;
+		if (srcY < 0 || srcY >= layerHeightInPixels) {
+			continue;
+		}
+
+		if (repeatX) {
+			srcX %= layerWidthInPixels;
+			if (srcX < 0) {
+				srcX += layerWidthInPixels;
+			}
+		}
+
+		int tileY = srcY / tileHeight;
+		int tileRow = srcY - (tileY * tileHeight);
+		Uint32* tileRowStart = &layer->Tiles[tileY << layer->WidthInBits];
+
+		int dst_x = dst_x1;
+		while (dst_x < dst_x2) {
+			if (srcX >= layerWidthInPixels) {
+				if (!repeatX) {
+					break;
+				}
+				srcX -= layerWidthInPixels;
+			}
+			if (srcX < 0) {
+				Sint64 skip = std::min(-srcX, (Sint64)(dst_x2 - dst_x));
+				dst_x += skip;
+				srcX += skip;
+				continue;
+			}
+
+			int tileX = srcX / tileWidth;
+			int tileCol = srcX - (tileX * tileWidth);
+			int count = tileWidth - tileCol;
+			if (count > dst_x2 - dst_x) {
+				count = dst_x2 - dst_x;
+			}
+
+			Uint32 tile = tileRowStart[tileX];
+			int tileID = tile & TILE_IDENT_MASK;
+			if (tileID != Scene::EmptyTile && (size_t)tileID < tileSources.size()) {
+				int srcTX = tileCol;
+				int srcTY = tileRow;
+				int srcStepX = 1;
+				if (tile & TILE_FLIPX_MASK) {
+					srcTX = tileWidth - 1 - srcTX;
+					srcStepX = -1;
+				}
+				if (tile & TILE_FLIPY_MASK) {
+					srcTY = tileHeight - 1 - srcTY;
+				}
+
+				Uint32* color = &tileSources[tileID][srcTX + srcTY * srcStrides[tileID]];
+				Uint8* dst = &dstPxLine[dst_x];
+				for (int i = 0; i < count; i++, color += srcStepX) {
+					Uint32 c = *color & 0xFF;
+					if (c && (index[c] & 0xFF000000U)) {
+						dst[i] = blendTable ? blendTable[(c << 8) | dst[i]] : (Uint8)c;
+					}
+				}
+			}
+
+			dst_x += count;
+			srcX += count;
+		}
+	}
+}
 void SoftwareRenderer::DrawTileLayer_CustomTileScanLines(TileLayer* layer, View* currentView) {
 	static vector<Uint32> srcStrides;
 	static vector<Uint32*> tileSources;
@@ -5193,18 +6079,32 @@ void SoftwareRenderer::DrawTileLayer(TileLayer* layer, int layerIndex, View* cur
 			srcY += iScaleY;
 		}
 
+		ResolveIndexedFramebuffer();
 		SoftwareRenderer::DrawTileLayer_CustomTileScanLines(layer, currentView);
 		return;
 	}
 
 	switch (layer->DrawBehavior) {
 	case DrawBehavior_HorizontalParallax:
-		SoftwareRenderer::DrawTileLayer_HorizontalParallax(layer, currentView);
+		if (CanDrawTileLayerIndexed(layer)) {
+			SoftwareRenderer::DrawTileLayer_Indexed(layer, currentView);
+			break;
+		}
+
+		ResolveIndexedFramebuffer();
+		if (CanUseChunkCache(layer)) {
+			SoftwareRenderer::DrawTileLayer_ChunkCache(layer, currentView);
+		}
+		else {
+			SoftwareRenderer::DrawTileLayer_HorizontalParallax(layer, currentView);
+		}
 		break;
 	case DrawBehavior_VerticalParallax:
+		ResolveIndexedFramebuffer();
 		SoftwareRenderer::DrawTileLayer_VerticalParallax(layer, currentView);
 		break;
 	case DrawBehavior_CustomTileScanLines:
+		ResolveIndexedFramebuffer();
 		SoftwareRenderer::DrawTileLayer_CustomTileScanLines(layer, currentView);
 		break;
 	}
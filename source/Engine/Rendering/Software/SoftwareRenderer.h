@@ -278,6 +278,8 @@ public:
 		int paletteID);
 	static void DrawTileLayer_HorizontalParallax(TileLayer* layer, View* currentView);
 	static void DrawTileLayer_VerticalParallax(TileLayer* layer, View* currentView);
+	static void DrawTileLayer_ChunkCache(TileLayer* layer, View* currentView);
+	static void DrawTileLayer_Indexed(TileLayer* layer, View* currentView);
 	static void DrawTileLayer_CustomTileScanLines(TileLayer* layer, View* currentView);
 	static void DrawTileLayer_CustomTileScanLines_Opaque(TileLayer* layer, View* currentView);
 	static void DrawTileLayer_CustomTileScanLines_16x16(TileLayer* layer, View* currentView);
@@ -0,0 +1,330 @@
+#include <Engine/Rendering/Software/TileRasterizer.h>
+
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Memory.h>
+#include <Engine/Diagnostics/Profiler.h>
+#include <Engine/Graphics.h>
+#include <Engine/Rendering/Software/PolygonRasterizer.h>
+#include <Engine/Rendering/Software/Scanline.h>
+
+SDL_Thread* TileRasterizer::Threads[TILE_RASTERIZER_MAX_THREADS];
+Contour* TileRasterizer::ThreadContours[TILE_RASTERIZER_MAX_THREADS];
+int TileRasterizer::NumThreads = 0;
+SDL_sem* TileRasterizer::WorkSignal = NULL;
+SDL_sem* TileRasterizer::DoneSignal = NULL;
+bool TileRasterizer::Initialized = false;
+bool TileRasterizer::Running = false;
+vector<RasterFace> TileRasterizer::Faces;
+vector<Vector3> TileRasterizer::Positions;
+vector<Vector2> TileRasterizer::UVs;
+vector<int> TileRasterizer::Colors;
+vector<vector<Uint32>> TileRasterizer::Bins;
+int TileRasterizer::NumTiles = 0;
+int TileRasterizer::TileHeight = 0;
+SDL_atomic_t TileRasterizer::NextTile;
+
+int TileRasterizer::ThreadCount = -1;
+
+void TileRasterizer::Init() {
+	if (Initialized) {
+		return;
+	}
+
+	Initialized = true;
+
+	// Leave a core for the main thread, which rasterizes tiles too.
+	int threadCount = ThreadCount;
+	if (threadCount < 0) {
+		threadCount = SDL_GetCPUCount() - 1;
+	}
+	if (threadCount > TILE_RASTERIZER_MAX_THREADS) {
+		threadCount = TILE_RASTERIZER_MAX_THREADS;
+	}
+	if (threadCount < 1) {
+		return;
+	}
+
+	WorkSignal = SDL_CreateSemaphore(0);
+	DoneSignal = SDL_CreateSemaphore(0);
+	if (WorkSignal == NULL || DoneSignal == NULL) {
+		Log::Print(Log::LOG_ERROR,
+			"Unable to create the tile rasterizer semaphores: %s",
+			SDL_GetError());
+		Dispose();
+		Initialized = true;
+		return;
+	}
+
+	Running = true;
+
+	NumThreads = 0;
+	for (int i = 0; i < threadCount; i++) {
+		Contour* contours =
+			(Contour*)Memory::Malloc(MAX_FRAMEBUFFER_HEIGHT * sizeof(Contour));
+		if (contours == NULL) {
+			break;
+		}
+
+		SDL_Thread* thread = SDL_CreateThread(
+			TileRasterizer::ThreadFunc, "TileRasterizer::ThreadFunc", contours);
+		if (thread == NULL) {
+			Log::Print(Log::LOG_ERROR,
+				"Unable to create a tile rasterizer thread: %s",
+				SDL_GetError());
+			Memory::Free(contours);
+			break;
+		}
+		ThreadContours[NumThreads] = contours;
+		Threads[NumThreads++] = thread;
+	}
+
+	if (NumThreads == 0) {
+		Dispose();
+		Initialized = true;
+	}
+}
+
+int TileRasterizer::ThreadFunc(void* data) {
+	PROFILE_THREAD("Tile Rasterizer");
+
+	Scanline::Contours = (Contour*)data;
+
+	while (true) {
+		SDL_SemWait(WorkSignal);
+		if (!Running) {
+			break;
+		}
+
+		DrawTiles();
+
+		SDL_SemPost(DoneSignal);
+	}
+
+	return 0;
+}
+
+void TileRasterizer::DrawFace(RasterFace* face) {
+	Vector3* positions = &Positions[face->VerticesStartIndex];
+	Vector2* uvs = &UVs[face->VerticesStartIndex];
+	int* colors = &Colors[face->VerticesStartIndex];
+
+	PolygonRasterizer::SetUseDepthBuffer(face->UseDepthBuffer);
+	PolygonRasterizer::SetUseFog(face->UseFog);
+
+	switch (face->Type) {
+	case RASTER_FACE_SHADED:
+		PolygonRasterizer::DrawShaded(
+			positions, face->Color, face->NumVertices, face->Blend);
+		break;
+	case RASTER_FACE_DEPTH:
+		PolygonRasterizer::DrawDepth(
+			positions, face->Color, face->NumVertices, face->Blend);
+		break;
+	case RASTER_FACE_AFFINE:
+		PolygonRasterizer::DrawAffine(face->TexturePtr,
+			positions,
+			uvs,
+			face->Color,
+			face->NumVertices,
+			face->Blend);
+		break;
+	case RASTER_FACE_PERSPECTIVE:
+		PolygonRasterizer::DrawPerspective(face->TexturePtr,
+			positions,
+			uvs,
+			face->Color,
+			face->NumVertices,
+			face->Blend);
+		break;
+	case RASTER_FACE_BLEND_SHADED:
+		PolygonRasterizer::DrawBlendShaded(
+			positions, colors, face->NumVertices, face->Blend);
+		break;
+	case RASTER_FACE_BLEND_DEPTH:
+		PolygonRasterizer::DrawBlendDepth(
+			positions, colors, face->NumVertices, face->Blend);
+		break;
+	case RASTER_FACE_BLEND_AFFINE:
+		PolygonRasterizer::DrawBlendAffine(face->TexturePtr,
+			positions,
+			uvs,
+			colors,
+			face->NumVertices,
+			face->Blend);
+		break;
+	case RASTER_FACE_BLEND_PERSPECTIVE:
+		PolygonRasterizer::DrawBlendPerspective(face->TexturePtr,
+			positions,
+			uvs,
+			colors,
+			face->NumVertices,
+			face->Blend);
+		break;
+	}
+}
+
+// Runs on the main thread and on every worker. Each tile's faces are drawn
+// in the order they were added, so painter's order holds within the tile.
+void TileRasterizer::DrawTiles() {
+	while (true) {
+		int tile = SDL_AtomicAdd(&NextTile, 1);
+		if (tile >= NumTiles) {
+			break;
+		}
+
+		Scanline::RowStart = tile * TileHeight;
+		Scanline::RowEnd = Scanline::RowStart + TileHeight;
+
+		vector<Uint32>& bin = Bins[tile];
+		for (size_t i = 0; i < bin.size(); i++) {
+			DrawFace(&Faces[bin[i]]);
+		}
+	}
+
+	Scanline::RowStart = 0;
+	Scanline::RowEnd = MAX_FRAMEBUFFER_HEIGHT;
+}
+
+// Queues a polygon that would otherwise have been drawn right away through
+// PolygonRasterizer. The depth buffer and fog state in effect at this point
+// are drawn with it.
+void TileRasterizer::AddFace(Uint8 type,
+	Texture* texture,
+	Vector3* positions,
+	Vector2* uvs,
+	int* colors,
+	Uint32 color,
+	int count,
+	BlendState blendState) {
+	RasterFace face;
+	face.Type = type;
+	face.UseDepthBuffer = PolygonRasterizer::UseDepthBuffer;
+	face.UseFog = PolygonRasterizer::UseFog;
+	face.NumVertices = count;
+	face.VerticesStartIndex = Positions.size();
+	face.MinY = INT_MAX;
+	face.MaxY = INT_MIN;
+	face.TexturePtr = texture;
+	face.Color = color;
+	face.Blend = blendState;
+
+	for (int i = 0; i < count; i++) {
+		int y = positions[i].Y >> 16;
+		if (face.MinY > y) {
+			face.MinY = y;
+		}
+		if (face.MaxY < y) {
+			face.MaxY = y;
+		}
+
+		Positions.push_back(positions[i]);
+		UVs.push_back(uvs ? uvs[i] : Vector2{0, 0});
+		Colors.push_back(colors ? colors[i] : (int)color);
+	}
+
+	Faces.push_back(face);
+}
+
+// Draws every queued face. Large scenes are split into full-width tiles of
+// rows: the scanline rasterizer already works a row at a time, so a tile only
+// has to clip the rows it fills, and every span in it comes out exactly as it
+// would on a single thread.
+void TileRasterizer::Flush() {
+	if (Faces.empty()) {
+		return;
+	}
+
+	Init();
+
+	Texture* target = Graphics::CurrentRenderTarget;
+	int height = target ? (int)target->Height : 0;
+	if (height > MAX_FRAMEBUFFER_HEIGHT) {
+		height = MAX_FRAMEBUFFER_HEIGHT;
+	}
+
+	if (NumThreads == 0 || Faces.size() < TILE_RASTERIZER_MIN_FACES ||
+		height < TILE_RASTERIZER_MIN_TILE_HEIGHT * 2) {
+		for (size_t i = 0; i < Faces.size(); i++) {
+			DrawFace(&Faces[i]);
+		}
+	}
+	else {
+		PROFILE_ZONE("Tile Rasterizer");
+
+		int tileCount = (NumThreads + 1) * TILE_RASTERIZER_TILES_PER_THREAD;
+		TileHeight = (height + tileCount - 1) / tileCount;
+		if (TileHeight < TILE_RASTERIZER_MIN_TILE_HEIGHT) {
+			TileHeight = TILE_RASTERIZER_MIN_TILE_HEIGHT;
+		}
+		NumTiles = (height + TileHeight - 1) / TileHeight;
+
+		if (Bins.size() < (size_t)NumTiles) {
+			Bins.resize(NumTiles);
+		}
+		for (int i = 0; i < NumTiles; i++) {
+			Bins[i].clear();
+		}
+
+		for (size_t i = 0; i < Faces.size(); i++) {
+			RasterFace* face = &Faces[i];
+			if (face->MaxY <= 0 || face->MinY >= height || face->MinY >= face->MaxY) {
+				continue;
+			}
+
+			int first = face->MinY < 0 ? 0 : face->MinY / TileHeight;
+			int last = face->MaxY > height ? NumTiles - 1 : (face->MaxY - 1) / TileHeight;
+			for (int tile = first; tile <= last; tile++) {
+				Bins[tile].push_back((Uint32)i);
+			}
+		}
+
+		SDL_AtomicSet(&NextTile, 0);
+		for (int i = 0; i < NumThreads; i++) {
+			SDL_SemPost(WorkSignal);
+		}
+
+		DrawTiles();
+
+		for (int i = 0; i < NumThreads; i++) {
+			SDL_SemWait(DoneSignal);
+		}
+	}
+
+	Faces.clear();
+	Positions.clear();
+	UVs.clear();
+	Colors.clear();
+}
+
+void TileRasterizer::Dispose() {
+	if (Running) {
+		Running = false;
+		for (int i = 0; i < NumThreads; i++) {
+			SDL_SemPost(WorkSignal);
+		}
+		for (int i = 0; i < NumThreads; i++) {
+			SDL_WaitThread(Threads[i], NULL);
+			Threads[i] = NULL;
+			Memory::Free(ThreadContours[i]);
+			ThreadContours[i] = NULL;
+		}
+	}
+	NumThreads = 0;
+
+	if (WorkSignal) {
+		SDL_DestroySemaphore(WorkSignal);
+		WorkSignal = NULL;
+	}
+	if (DoneSignal) {
+		SDL_DestroySemaphore(DoneSignal);
+		DoneSignal = NULL;
+	}
+
+	Faces.clear();
+	Positions.clear();
+	UVs.clear();
+	Colors.clear();
+	Bins.clear();
+
+	Initialized = false;
+}
@@ -0,0 +1,84 @@
+#ifndef ENGINE_RENDERING_SOFTWARE_TILERASTERIZER_H
+#define ENGINE_RENDERING_SOFTWARE_TILERASTERIZER_H
+
+#include <Engine/Includes/Standard.h>
+#include <Engine/Includes/StandardSDL2.h>
+#include <Engine/Rendering/3D.h>
+#include <Engine/Rendering/Software/Contour.h>
+#include <Engine/Rendering/Texture.h>
+
+#define TILE_RASTERIZER_MAX_THREADS 8
+
+// Scenes with fewer faces than this are drawn on the calling thread.
+#define TILE_RASTERIZER_MIN_FACES 64
+
+// Screen tiles are never shorter than this many rows.
+#define TILE_RASTERIZER_MIN_TILE_HEIGHT 16
+
+// How many tiles each thread gets, so a thread stuck with a busy tile
+// doesn't hold up the rest.
+#define TILE_RASTERIZER_TILES_PER_THREAD 4
+
+enum RasterFaceType {
+	RASTER_FACE_SHADED,
+	RASTER_FACE_DEPTH,
+	RASTER_FACE_AFFINE,
+	RASTER_FACE_PERSPECTIVE,
+	RASTER_FACE_BLEND_SHADED,
+	RASTER_FACE_BLEND_DEPTH,
+	RASTER_FACE_BLEND_AFFINE,
+	RASTER_FACE_BLEND_PERSPECTIVE
+};
+
+struct RasterFace {
+	Uint8 Type;
+	bool UseDepthBuffer;
+	bool UseFog;
+	int NumVertices;
+	size_t VerticesStartIndex;
+	int MinY;
+	int MaxY;
+	Texture* TexturePtr;
+	Uint32 Color;
+	BlendState Blend;
+};
+
+class TileRasterizer {
+private:
+	static SDL_Thread* Threads[TILE_RASTERIZER_MAX_THREADS];
+	static Contour* ThreadContours[TILE_RASTERIZER_MAX_THREADS];
+	static int NumThreads;
+	static SDL_sem* WorkSignal;
+	static SDL_sem* DoneSignal;
+	static bool Initialized;
+	static bool Running;
+	static vector<RasterFace> Faces;
+	static vector<Vector3> Positions;
+	static vector<Vector2> UVs;
+	static vector<int> Colors;
+	static vector<vector<Uint32>> Bins;
+	static int NumTiles;
+	static int TileHeight;
+	static SDL_atomic_t NextTile;
+
+	static int ThreadFunc(void* data);
+	static void DrawFace(RasterFace* face);
+	static void DrawTiles();
+
+public:
+	static int ThreadCount;
+
+	static void Init();
+	static void AddFace(Uint8 type,
+		Texture* texture,
+		Vector3* positions,
+		Vector2* uvs,
+		int* colors,
+		Uint32 color,
+		int count,
+		BlendState blendState);
+	static void Flush();
+	static void Dispose();
+};
+
+#endif /* ENGINE_RENDERING_SOFTWARE_TILERASTERIZER_H */
@@ -0,0 +1,634 @@
+#include <Engine/Rendering/SpriteAtlas.h>
+
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Memory.h>
+#include <Engine/Graphics.h>
+#include <Engine/Hashing/FNV1A.h>
+#include <Engine/Rendering/TextureReference.h>
+
+#include <Libraries/stb_rect_pack.h>
+
+bool SpriteAtlas::Enabled = false;
+int SpriteAtlas::PageSize = SPRITE_ATLAS_DEFAULT_PAGE_SIZE;
+vector<SpriteAtlasPage*> SpriteAtlas::Pages;
+
+static Uint32 NextPageID = 0;
+
+Uint32 SpriteAtlas::GetPaletteHash(Texture* texture) {
+	if (texture->PaletteColors == nullptr || texture->NumPaletteColors == 0) {
+		return 0;
+	}
+
+	return FNV1A::EncryptData(
+		texture->PaletteColors, texture->NumPaletteColors * sizeof(Uint32));
+}
+
+// The atlas holds one reference to each page's texture, and every sprite
+// packed into the page holds another. Once only the atlas' own reference
+// is left, nothing can draw from the page anymore.
+bool SpriteAtlas::IsPageAlive(SpriteAtlasPage* page) {
+	if (Graphics::SpriteSheetTextureMap.count(page->Name) == 0) {
+		return false;
+	}
+
+	return Graphics::SpriteSheetTextureMap.at(page->Name)->References > 1;
+}
+void SpriteAtlas::RemoveDeadPages() {
+	for (size_t i = 0; i < Pages.size();) {
+		SpriteAtlasPage* page = Pages[i];
+		if (IsPageAlive(page)) {
+			i++;
+			continue;
+		}
+
+		Graphics::DisposeSpriteSheet(page->Name);
+		DeletePage(page);
+		Pages.erase(Pages.begin() + i);
+	}
+}
+
+int SpriteAtlas::GetPageSize() {
+	int pageSize = PageSize;
+	int maxTextureSize = std::min(Graphics::MaxTextureWidth, Graphics::MaxTextureHeight);
+	if (maxTextureSize > 0 && pageSize > maxTextureSize) {
+		pageSize = maxTextureSize;
+	}
+
+	return pageSize;
+}
+SpriteAtlasPage* SpriteAtlas::CreatePage(Texture* source, Uint32 paletteHash) {
+	int pageSize = GetPageSize();
+
+	Texture* texture =
+		Graphics::CreateTexture(source->Format, TextureAccess_STATIC, pageSize, pageSize);
+	if (!texture) {
+		return nullptr;
+	}
+
+	if (source->PaletteColors && source->NumPaletteColors) {
+		size_t paletteSize = source->NumPaletteColors * sizeof(Uint32);
+		Uint32* palette = (Uint32*)Memory::Malloc(paletteSize);
+		memcpy(palette, source->PaletteColors, paletteSize);
+		texture->SetPalette(palette, source->NumPaletteColors);
+	}
+
+	char name[32];
+	snprintf(name, sizeof name, "@SpriteAtlas/%u", NextPageID++);
+
+	SpriteAtlasPage* page = new SpriteAtlasPage;
+	page->Name = std::string(name);
+	page->TexturePtr = texture;
+	page->Format = source->Format;
+	page->PaletteHash = paletteHash;
+	page->Context = Memory::Malloc(sizeof(stbrp_context));
+	page->Nodes = Memory::Malloc(sizeof(stbrp_node) * pageSize);
+	page->UsedPixels = 0;
+
+	stbrp_init_target(
+		(stbrp_context*)page->Context, pageSize, pageSize, (stbrp_node*)page->Nodes, pageSize);
+
+	Graphics::AddSpriteSheet(page->Name, texture);
+
+	Pages.push_back(page);
+
+	return page;
+}
+void SpriteAtlas::DeletePage(SpriteAtlasPage* page) {
+	Memory::Free(page->Context);
+	Memory::Free(page->Nodes);
+	delete page;
+}
+SpriteAtlasPage* SpriteAtlas::FindPage(const std::string& name) {
+	for (size_t i = 0; i < Pages.size(); i++) {
+		if (Pages[i]->Name == name) {
+			return Pages[i];
+		}
+	}
+
+	return nullptr;
+}
+
+bool SpriteAtlas::Pack(ISprite* sprite) {
+	if (!Enabled || sprite->Spritesheets.size() == 0) {
+		return false;
+	}
+
+	// Only sprites whose sheets share a pixel format and palette are
+	// packed; anything else would have to be converted first.
+	Texture* firstSheet = sprite->Spritesheets[0];
+	if (firstSheet == nullptr) {
+		return false;
+	}
+
+	Uint32 format = firstSheet->Format;
+	Uint32 paletteHash = GetPaletteHash(firstSheet);
+	for (size_t i = 1; i < sprite->Spritesheets.size(); i++) {
+		Texture* sheet = sprite->Spritesheets[i];
+		if (sheet == nullptr || sheet->Format != format ||
+			GetPaletteHash(sheet) != paletteHash) {
+			return false;
+		}
+	}
+
+	// Gather every distinct frame rectangle. Frames that share a region
+	// of the same sheet share it in the atlas as well.
+	struct SourceRect {
+		int Sheet;
+		int X;
+		int Y;
+		int Width;
+		int Height;
+	};
+	vector<SourceRect> sources;
+	vector<stbrp_rect> rects;
+	std::map<std::tuple<int, int, int, int, int>, int> rectLookup;
+	vector<vector<int>> frameRects(sprite->Animations.size());
+	int pageSize = GetPageSize();
+
+	for (size_t a = 0; a < sprite->Animations.size(); a++) {
+		Animation& animation = sprite->Animations[a];
+		frameRects[a].resize(animation.Frames.size(), -1);
+
+		for (size_t f = 0; f < animation.Frames.size(); f++) {
+			AnimFrame& frame = animation.Frames[f];
+			if (frame.Width <= 0 || frame.Height <= 0) {
+				continue;
+			}
+
+			if (frame.SheetNumber < 0 ||
+				frame.SheetNumber >= (int)sprite->Spritesheets.size()) {
+				return false;
+			}
+
+			Texture* sheet = sprite->Spritesheets[frame.SheetNumber];
+			if (frame.X < 0 || frame.Y < 0 || frame.X + frame.Width > (int)sheet->Width ||
+				frame.Y + frame.Height > (int)sheet->Height) {
+				return false;
+			}
+
+			int paddedWidth = frame.Width + SPRITE_ATLAS_PADDING * 2;
+			int paddedHeight = frame.Height + SPRITE_ATLAS_PADDING * 2;
+			if (paddedWidth > pageSize || paddedHeight > pageSize) {
+				return false;
+			}
+
+			auto key = std::make_tuple(
+				frame.SheetNumber, frame.X, frame.Y, frame.Width, frame.Height);
+			auto it = rectLookup.find(key);
+			if (it != rectLookup.end()) {
+				frameRects[a][f] = it->second;
+				continue;
+			}
+
+			stbrp_rect rect;
+			rect.id = (int)rects.size();
+			rect.w = paddedWidth;
+			rect.h = paddedHeight;
+			rect.x = 0;
+			rect.y = 0;
+			rect.was_packed = 0;
+
+			rectLookup[key] = rect.id;
+			frameRects[a][f] = rect.id;
+			rects.push_back(rect);
+			sources.push_back(
+				{frame.SheetNumber, frame.X, frame.Y, frame.Width, frame.Height});
+		}
+	}
+
+	if (rects.size() == 0) {
+		return false;
+	}
+
+	RemoveDeadPages();
+
+	// Fill the existing pages first, then open new ones for whatever is left.
+	// The packer state of every existing page is saved before it is packed
+	// into, so that a failure partway through leaves the atlas untouched.
+	struct PageBackup {
+		SpriteAtlasPage* Page;
+		stbrp_context Context;
+		vector<stbrp_node> Nodes;
+	};
+	vector<PageBackup> backups;
+	size_t firstNewPage = Pages.size();
+
+	vector<SpriteAtlasPage*> rectPages(rects.size(), nullptr);
+	vector<stbrp_rect> pending;
+	size_t remaining = rects.size();
+	size_t pageIndex = 0;
+	bool failed = false;
+
+	while (remaining) {
+		SpriteAtlasPage* page = nullptr;
+		bool isNewPage = false;
+		while (pageIndex < firstNewPage) {
+			// A page whose texture was converted since it was made no longer
+			// holds what its format and palette say, so it isn't packed into.
+			SpriteAtlasPage* candidate = Pages[pageIndex++];
+			Texture* candidateTexture = candidate->TexturePtr;
+			if (candidateTexture->Format != candidate->Format ||
+				GetPaletteHash(candidateTexture) != candidate->PaletteHash) {
+				continue;
+			}
+			if (candidate->Format == format && candidate->PaletteHash == paletteHash) {
+				page = candidate;
+				break;
+			}
+		}
+		if (page) {
+			stbrp_node* nodes = (stbrp_node*)page->Nodes;
+			PageBackup backup;
+			backup.Page = page;
+			backup.Context = *(stbrp_context*)page->Context;
+			backup.Nodes.assign(nodes, nodes + page->TexturePtr->Width);
+			backups.push_back(backup);
+		}
+		else {
+			page = CreatePage(firstSheet, paletteHash);
+			if (page == nullptr) {
+				failed = true;
+				break;
+			}
+			isNewPage = true;
+		}
+
+		pending.clear();
+		for (size_t i = 0; i < rects.size(); i++) {
+			if (rectPages[i] == nullptr) {
+				pending.push_back(rects[i]);
+			}
+		}
+
+		stbrp_pack_rects((stbrp_context*)page->Context, pending.data(), (int)pending.size());
+
+		size_t packedCount = 0;
+		for (size_t i = 0; i < pending.size(); i++) {
+			if (!pending[i].was_packed) {
+				continue;
+			}
+
+			rects[pending[i].id] = pending[i];
+			rectPages[pending[i].id] = page;
+			packedCount++;
+		}
+
+		// Every rectangle is known to fit in an empty page, so this
+		// only happens if the page couldn't be sized as requested.
+		if (isNewPage && packedCount == 0) {
+			failed = true;
+			break;
+		}
+
+		remaining -= packedCount;
+	}
+
+	if (failed) {
+		// The saved state is copied back in place, so the pointers the
+		// context holds into its own node array stay valid.
+		for (size_t i = 0; i < backups.size(); i++) {
+			SpriteAtlasPage* page = backups[i].Page;
+			*(stbrp_context*)page->Context = backups[i].Context;
+			memcpy(page->Nodes,
+				backups[i].Nodes.data(),
+				backups[i].Nodes.size() * sizeof(stbrp_node));
+		}
+
+		for (size_t i = firstNewPage; i < Pages.size(); i++) {
+			Graphics::DisposeSpriteSheet(Pages[i]->Name);
+			DeletePage(Pages[i]);
+		}
+		Pages.resize(firstNewPage);
+
+		return false;
+	}
+
+	// Copy the frames into their pages.
+	vector<SpriteAtlasPage*> usedPages;
+	vector<int> rectSheets(rects.size(), 0);
+	for (size_t i = 0; i < rects.size(); i++) {
+		SpriteAtlasPage* page = rectPages[i];
+		auto it = std::find(usedPages.begin(), usedPages.end(), page);
+		if (it == usedPages.end()) {
+			rectSheets[i] = (int)usedPages.size();
+			usedPages.push_back(page);
+		}
+		else {
+			rectSheets[i] = (int)(it - usedPages.begin());
+		}
+
+		SourceRect& source = sources[i];
+		page->UsedPixels += (size_t)source.Width * source.Height;
+		page->TexturePtr->CopyPixels(sprite->Spritesheets[source.Sheet],
+			source.X,
+			source.Y,
+			source.Width,
+			source.Height,
+			rects[i].x + SPRITE_ATLAS_PADDING,
+			rects[i].y + SPRITE_ATLAS_PADDING);
+	}
+
+	// Upload only the regions that were written. The renderers expect the
+	// rows of a rectangle to be next to each other, so each one is gathered
+	// into a scratch buffer first.
+	vector<Uint8> upload;
+	for (size_t i = 0; i < rects.size(); i++) {
+		Texture* texture = rectPages[i]->TexturePtr;
+		size_t bpp = Texture::GetFormatBytesPerPixel(texture->Format);
+		size_t rowSize = rects[i].w * bpp;
+
+		upload.resize(rowSize * rects[i].h);
+
+		Uint8* src = (Uint8*)texture->Pixels + rects[i].y * texture->Pitch + rects[i].x * bpp;
+		for (int y = 0; y < rects[i].h; y++) {
+			memcpy(upload.data() + y * rowSize, src + y * texture->Pitch, rowSize);
+		}
+
+		SDL_Rect region = {rects[i].x, rects[i].y, rects[i].w, rects[i].h};
+		Graphics::UpdateTexture(texture, &region, upload.data(), (int)rowSize);
+	}
+
+	// Point the frames at their new location.
+	for (size_t a = 0; a < sprite->Animations.size(); a++) {
+		Animation& animation = sprite->Animations[a];
+		for (size_t f = 0; f < animation.Frames.size(); f++) {
+			AnimFrame& frame = animation.Frames[f];
+			int rectID = frameRects[a][f];
+			if (rectID < 0) {
+				frame.SheetNumber = 0;
+				continue;
+			}
+
+			frame.X = rects[rectID].x + SPRITE_ATLAS_PADDING;
+			frame.Y = rects[rectID].y + SPRITE_ATLAS_PADDING;
+			frame.SheetNumber = rectSheets[rectID];
+		}
+	}
+
+	// Swap the sheets for the pages.
+	size_t previousSheetCount = sprite->Spritesheets.size();
+	for (size_t i = 0; i < sprite->SpritesheetFilenames.size(); i++) {
+		Graphics::DisposeSpriteSheet(sprite->SpritesheetFilenames[i]);
+	}
+
+	sprite->Spritesheets.clear();
+	sprite->SpritesheetFilenames.clear();
+	for (size_t i = 0; i < usedPages.size(); i++) {
+		TextureReference* ref = Graphics::GetSpriteSheet(usedPages[i]->Name);
+		sprite->Spritesheets.push_back(ref->TexturePtr);
+		sprite->SpritesheetFilenames.push_back(usedPages[i]->Name);
+	}
+
+	sprite->RefreshGraphicsID();
+
+	Log::Print(Log::LOG_VERBOSE,
+		"Packed %d frame region(s) of \"%s\" into %d atlas page(s) (from %d sheet(s))",
+		(int)rects.size(),
+		sprite->Filename ? sprite->Filename : "(unnamed)",
+		(int)usedPages.size(),
+		(int)previousSheetCount);
+
+	return true;
+}
+
+static bool UnpackFailed(ISprite* sprite) {
+	Log::Print(Log::LOG_ERROR,
+		"Could not unpack \"%s\" from the sprite atlas; its sheets are left as they are",
+		sprite->Filename ? sprite->Filename : "(unnamed)");
+	return false;
+}
+
+bool SpriteAtlas::IsPacked(ISprite* sprite) {
+	for (size_t i = 0; i < sprite->SpritesheetFilenames.size(); i++) {
+		if (FindPage(sprite->SpritesheetFilenames[i])) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Gives a packed sprite sheets of its own again, holding only its frames, so
+// that converting them doesn't change every other sprite in the same pages.
+bool SpriteAtlas::Unpack(ISprite* sprite) {
+	if (!IsPacked(sprite)) {
+		return true;
+	}
+
+	Texture* firstSheet = sprite->Spritesheets[0];
+
+	// Gather every distinct frame rectangle, as Pack does.
+	struct SourceRect {
+		int Sheet;
+		int X;
+		int Y;
+		int Width;
+		int Height;
+	};
+	vector<SourceRect> sources;
+	vector<stbrp_rect> rects;
+	std::map<std::tuple<int, int, int, int, int>, int> rectLookup;
+	vector<vector<int>> frameRects(sprite->Animations.size());
+
+	for (size_t a = 0; a < sprite->Animations.size(); a++) {
+		Animation& animation = sprite->Animations[a];
+		frameRects[a].resize(animation.Frames.size(), -1);
+
+		for (size_t f = 0; f < animation.Frames.size(); f++) {
+			AnimFrame& frame = animation.Frames[f];
+			if (frame.Width <= 0 || frame.Height <= 0) {
+				continue;
+			}
+
+			if (frame.SheetNumber < 0 ||
+				frame.SheetNumber >= (int)sprite->Spritesheets.size()) {
+				return UnpackFailed(sprite);
+			}
+
+			auto key = std::make_tuple(
+				frame.SheetNumber, frame.X, frame.Y, frame.Width, frame.Height);
+			auto it = rectLookup.find(key);
+			if (it != rectLookup.end()) {
+				frameRects[a][f] = it->second;
+				continue;
+			}
+
+			stbrp_rect rect;
+			rect.id = (int)rects.size();
+			rect.w = frame.Width + SPRITE_ATLAS_PADDING * 2;
+			rect.h = frame.Height + SPRITE_ATLAS_PADDING * 2;
+			rect.x = 0;
+			rect.y = 0;
+			rect.was_packed = 0;
+
+			rectLookup[key] = rect.id;
+			frameRects[a][f] = rect.id;
+			rects.push_back(rect);
+			sources.push_back(
+				{frame.SheetNumber, frame.X, frame.Y, frame.Width, frame.Height});
+		}
+	}
+
+	// Find the smallest square sheet that holds every frame. If even a full
+	// page isn't enough, each page is copied whole instead, and the frames
+	// keep their places.
+	int pageSize = GetPageSize();
+	int sheetSize = 0;
+	vector<stbrp_node> nodes;
+	for (int size = 64; rects.size() > 0; size *= 2) {
+		if (size > pageSize) {
+			size = pageSize;
+		}
+
+		nodes.resize(size);
+		stbrp_context context;
+		stbrp_init_target(&context, size, size, nodes.data(), size);
+		if (stbrp_pack_rects(&context, rects.data(), (int)rects.size())) {
+			sheetSize = size;
+			break;
+		}
+		if (size == pageSize) {
+			break;
+		}
+	}
+
+	vector<int> rectSheets(rects.size(), 0);
+	vector<int> sheetWidths;
+	vector<int> sheetHeights;
+	if (sheetSize > 0 || rects.size() == 0) {
+		sheetWidths.push_back(sheetSize > 0 ? sheetSize : 1);
+		sheetHeights.push_back(sheetSize > 0 ? sheetSize : 1);
+	}
+	else {
+		for (size_t i = 0; i < sprite->Spritesheets.size(); i++) {
+			sheetWidths.push_back(sprite->Spritesheets[i]->Width);
+			sheetHeights.push_back(sprite->Spritesheets[i]->Height);
+		}
+		for (size_t i = 0; i < rects.size(); i++) {
+			rectSheets[i] = sources[i].Sheet;
+			rects[i].x = sources[i].X - SPRITE_ATLAS_PADDING;
+			rects[i].y = sources[i].Y - SPRITE_ATLAS_PADDING;
+		}
+	}
+
+	vector<Texture*> sheets;
+	for (size_t i = 0; i < sheetWidths.size(); i++) {
+		Texture* texture = Graphics::CreateTexture(
+			firstSheet->Format, TextureAccess_STATIC, sheetWidths[i], sheetHeights[i]);
+		if (!texture) {
+			for (size_t j = 0; j < sheets.size(); j++) {
+				Graphics::DisposeTexture(sheets[j]);
+			}
+			return UnpackFailed(sprite);
+		}
+
+		if (firstSheet->PaletteColors && firstSheet->NumPaletteColors) {
+			size_t paletteSize = firstSheet->NumPaletteColors * sizeof(Uint32);
+			Uint32* palette = (Uint32*)Memory::Malloc(paletteSize);
+			memcpy(palette, firstSheet->PaletteColors, paletteSize);
+			texture->SetPalette(palette, firstSheet->NumPaletteColors);
+		}
+
+		sheets.push_back(texture);
+	}
+
+	for (size_t i = 0; i < rects.size(); i++) {
+		SourceRect& source = sources[i];
+		sheets[rectSheets[i]]->CopyPixels(sprite->Spritesheets[source.Sheet],
+			source.X,
+			source.Y,
+			source.Width,
+			source.Height,
+			rects[i].x + SPRITE_ATLAS_PADDING,
+			rects[i].y + SPRITE_ATLAS_PADDING);
+
+		// The space stays taken in the page, but nothing draws from it.
+		SpriteAtlasPage* page = FindPage(sprite->SpritesheetFilenames[source.Sheet]);
+		if (page) {
+			page->UsedPixels -= (size_t)source.Width * source.Height;
+		}
+	}
+
+	for (size_t i = 0; i < sheets.size(); i++) {
+		Graphics::UpdateTexture(sheets[i], NULL, sheets[i]->Pixels, sheets[i]->Pitch);
+	}
+
+	for (size_t a = 0; a < sprite->Animations.size(); a++) {
+		Animation& animation = sprite->Animations[a];
+		for (size_t f = 0; f < animation.Frames.size(); f++) {
+			AnimFrame& frame = animation.Frames[f];
+			int rectID = frameRects[a][f];
+			if (rectID < 0) {
+				frame.SheetNumber = 0;
+				continue;
+			}
+
+			frame.X = rects[rectID].x + SPRITE_ATLAS_PADDING;
+			frame.Y = rects[rectID].y + SPRITE_ATLAS_PADDING;
+			frame.SheetNumber = rectSheets[rectID];
+		}
+	}
+
+	for (size_t i = 0; i < sprite->SpritesheetFilenames.size(); i++) {
+		Graphics::DisposeSpriteSheet(sprite->SpritesheetFilenames[i]);
+	}
+
+	sprite->Spritesheets.clear();
+	sprite->SpritesheetFilenames.clear();
+	for (size_t i = 0; i < sheets.size(); i++) {
+		char name[48];
+		snprintf(name, sizeof name, "@SpriteAtlas/Unpacked/%u", NextPageID++);
+
+		Graphics::AddSpriteSheet(std::string(name), sheets[i]);
+		sprite->Spritesheets.push_back(sheets[i]);
+		sprite->SpritesheetFilenames.push_back(std::string(name));
+	}
+
+	sprite->RefreshGraphicsID();
+
+	Log::Print(Log::LOG_VERBOSE,
+		"Unpacked \"%s\" from the sprite atlas into %d sheet(s)",
+		sprite->Filename ? sprite->Filename : "(unnamed)",
+		(int)sheets.size());
+
+	return true;
+}
+
+double SpriteAtlas::GetDensity() {
+	size_t usedPixels = 0;
+	size_t totalPixels = 0;
+	for (size_t i = 0; i < Pages.size(); i++) {
+		Texture* texture = Pages[i]->TexturePtr;
+		usedPixels += Pages[i]->UsedPixels;
+		totalPixels += (size_t)texture->Width * texture->Height;
+	}
+
+	if (totalPixels == 0) {
+		return 0.0;
+	}
+
+	return (double)usedPixels / totalPixels;
+}
+void SpriteAtlas::PrintReport() {
+	if (Enabled) {
+		RemoveDeadPages();
+
+		Log::Print(Log::LOG_INFO,
+			"Sprite atlas: %d page(s), %.1f%% of the atlas area in use",
+			(int)Pages.size(),
+			GetDensity() * 100.0);
+	}
+
+	Log::Print(Log::LOG_INFO,
+		"Sprite texture switches last frame: %u",
+		Graphics::LastFrameSpriteTextureSwitches);
+}
+
+void SpriteAtlas::Dispose() {
+	// The page textures belong to the sprite sheet map, which frees them.
+	for (size_t i = 0; i < Pages.size(); i++) {
+		DeletePage(Pages[i]);
+	}
+
+	Pages.clear();
+}
@@ -0,0 +1,44 @@
+#ifndef ENGINE_RENDERING_SPRITEATLAS_H
+#define ENGINE_RENDERING_SPRITEATLAS_H
+
+#include <Engine/Includes/Standard.h>
+#include <Engine/Rendering/Texture.h>
+#include <Engine/ResourceTypes/ISprite.h>
+
+#define SPRITE_ATLAS_DEFAULT_PAGE_SIZE 2048
+#define SPRITE_ATLAS_PADDING 1
+
+struct SpriteAtlasPage {
+	std::string Name;
+	Texture* TexturePtr;
+	Uint32 Format;
+	Uint32 PaletteHash;
+	void* Context;
+	void* Nodes;
+	size_t UsedPixels;
+};
+
+class SpriteAtlas {
+private:
+	static Uint32 GetPaletteHash(Texture* texture);
+	static bool IsPageAlive(SpriteAtlasPage* page);
+	static void RemoveDeadPages();
+	static int GetPageSize();
+	static SpriteAtlasPage* CreatePage(Texture* source, Uint32 paletteHash);
+	static void DeletePage(SpriteAtlasPage* page);
+	static SpriteAtlasPage* FindPage(const std::string& name);
+
+public:
+	static bool Enabled;
+	static int PageSize;
+	static vector<SpriteAtlasPage*> Pages;
+
+	static bool Pack(ISprite* sprite);
+	static bool IsPacked(ISprite* sprite);
+	static bool Unpack(ISprite* sprite);
+	static double GetDensity();
+	static void PrintReport();
+	static void Dispose();
+};
+
+#endif /* ENGINE_RENDERING_SPRITEATLAS_H */
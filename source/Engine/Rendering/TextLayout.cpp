@@ -0,0 +1,651 @@
+#include <Engine/Rendering/TextLayout.h>
+
+#include <Engine/Graphics.h>
+#include <Engine/Hashing/FNV1A.h>
+#include <Engine/Utilities/StringUtils.h>
+
+HashMap<TextLayout*>* TextLayoutCache::Layouts = nullptr;
+TextLayout* TextLayoutCache::MostRecent = nullptr;
+TextLayout* TextLayoutCache::LeastRecent = nullptr;
+size_t TextLayoutCache::Capacity = TEXT_LAYOUT_CACHE_SIZE;
+std::vector<TextLayout*> TextLayoutCache::Handles;
+
+TextLayout::TextLayout(Font* font, const char* text, TextDrawParams* params, bool wrapped) {
+	FontPtr = font;
+	Text = text;
+	Params = *params;
+	Wrapped = wrapped;
+}
+
+bool TextLayout::Matches(Font* font, const char* text, TextDrawParams* params, bool wrapped) {
+	return FontPtr == font && Wrapped == wrapped && Params.FontSize == params->FontSize &&
+		Params.Ascent == params->Ascent && Params.Descent == params->Descent &&
+		Params.Leading == params->Leading && Params.MaxWidth == params->MaxWidth &&
+		Params.MaxLines == params->MaxLines && Params.Flags == params->Flags &&
+		strcmp(Text.c_str(), text) == 0;
+}
+
+// Reloading a font moves its glyphs, and the space width can be changed
+// without reloading it.
+bool TextLayout::IsCurrent() {
+	return FontPtr && FontGeneration == FontPtr->Generation &&
+		SpaceWidth == FontPtr->SpaceWidth;
+}
+
+// Decodes the text, loads its glyphs, and works out how far each codepoint
+// advances the pen, including the kerning with the codepoint after it.
+void TextLayout::Prepare() {
+	Font* font = FontPtr;
+
+	std::vector<Uint32> codepoints = StringUtils::GetCodepoints(Text.c_str());
+
+	Codepoints.clear();
+	Codepoints.reserve(codepoints.size());
+
+	for (size_t i = 0; i < codepoints.size(); i++) {
+		Uint32 codepoint = codepoints[i];
+		if (codepoint != (Uint32)-1 && (char)codepoint == '\n' || (char)codepoint == ' ' ||
+			(font->IsValidCodepoint(codepoint) && font->RequestGlyph(codepoint))) {
+			Codepoints.push_back(codepoint);
+		}
+	}
+
+	if (Params.Flags & TEXTDRAW_ELLIPSIS) {
+		if (font->HasGlyph(ELLIPSIS_CODE_POINT)) {
+			font->RequestGlyph(ELLIPSIS_CODE_POINT);
+		}
+		else if (font->HasGlyph(FULL_STOP_CODE_POINT)) {
+			font->RequestGlyph(FULL_STOP_CODE_POINT);
+		}
+	}
+
+	font->Update();
+
+	size_t numCodepoints = Codepoints.size();
+
+	GlyphData.resize(numCodepoints);
+	Advances.resize(numCodepoints);
+
+	for (size_t i = 0; i < numCodepoints; i++) {
+		Uint32 codepoint = Codepoints[i];
+		if (codepoint == '\n') {
+			GlyphData[i] = nullptr;
+			Advances[i] = 0.0f;
+		}
+		else if (codepoint == ' ') {
+			GlyphData[i] = nullptr;
+			Advances[i] = font->SpaceWidth;
+		}
+		else {
+			GlyphData[i] = &font->Glyphs[codepoint];
+			Advances[i] = GlyphData[i]->Advance;
+		}
+	}
+
+	for (size_t i = 0; i + 1 < numCodepoints; i++) {
+		if (GlyphData[i] && GlyphData[i + 1]) {
+			Advances[i] += font->GetKerning(Codepoints[i], Codepoints[i + 1]);
+		}
+	}
+
+	FontGeneration = font->Generation;
+	SpaceWidth = font->SpaceWidth;
+}
+
+void TextLayout::AddGlyph(Uint32 codepoint, float x, float y, float scale, float glyphScale) {
+	FontGlyph& glyph = FontPtr->Glyphs[codepoint];
+
+	// Skips empty glyphs, which have no frame
+	if (glyph.Width == 0 || glyph.Height == 0) {
+		return;
+	}
+
+	TextLayoutGlyph layoutGlyph;
+	layoutGlyph.X = x + (glyph.OffsetX * glyphScale);
+	layoutGlyph.Y = y + (glyph.OffsetY * glyphScale) + (Params.Ascent * scale);
+	layoutGlyph.FrameID = glyph.FrameID;
+	Glyphs.push_back(layoutGlyph);
+}
+
+void TextLayout::AddEllipsis(float x, float y, float scale, float glyphScale) {
+	Font* font = FontPtr;
+
+	if (font->HasGlyph(ELLIPSIS_CODE_POINT) && font->IsGlyphLoaded(ELLIPSIS_CODE_POINT)) {
+		AddGlyph(ELLIPSIS_CODE_POINT, x, y, scale, glyphScale);
+	}
+	else if (font->HasGlyph(FULL_STOP_CODE_POINT) &&
+		font->IsGlyphLoaded(FULL_STOP_CODE_POINT)) {
+		for (size_t i = 0; i < 3; i++) {
+			AddGlyph(FULL_STOP_CODE_POINT, x, y, scale, glyphScale);
+
+			x += font->Glyphs[FULL_STOP_CODE_POINT].Advance * scale;
+		}
+	}
+}
+
+void TextLayout::LayOut() {
+	float currX = 0.0f;
+	float currY = 0.0f;
+
+	float ascent = Params.Ascent;
+	float descent = Params.Descent;
+	float leading = Params.Leading;
+
+	float scale = Params.FontSize / FontPtr->Size;
+	float xyScale = scale / FontPtr->Oversampling;
+
+	for (size_t i = 0; i < Codepoints.size(); i++) {
+		Uint32 codepoint = Codepoints[i];
+		if (codepoint == '\n') {
+			currX = 0.0f;
+			currY += (ascent - descent + leading) * scale;
+			continue;
+		}
+		else if (codepoint == ' ') {
+			currX += Advances[i] * scale;
+			continue;
+		}
+
+		AddGlyph(codepoint, currX, currY, scale, xyScale);
+
+		currX += Advances[i] * scale;
+	}
+}
+
+void TextLayout::LayOutWrapped() {
+	Font* font = FontPtr;
+
+	float currX = 0.0f;
+	float currY = 0.0f;
+
+	float ascent = Params.Ascent;
+	float descent = Params.Descent;
+	float leading = Params.Leading;
+
+	float scale = Params.FontSize / font->Size;
+	float xyScale = scale / font->Oversampling;
+
+	int word = 0;
+	int lineNo = 1;
+
+	size_t numCodepoints = Codepoints.size();
+	Uint32* codepointsData = Codepoints.data();
+	size_t linestart = 0;
+	size_t wordstart = 0;
+
+	float ellipsisWidth = 0.0;
+
+	bool drawEllipsis = Params.Flags & TEXTDRAW_ELLIPSIS;
+	if (drawEllipsis) {
+		if (font->HasGlyph(ELLIPSIS_CODE_POINT)) {
+			drawEllipsis = font->IsGlyphLoaded(ELLIPSIS_CODE_POINT);
+		}
+		else if (font->HasGlyph(FULL_STOP_CODE_POINT)) {
+			drawEllipsis = font->IsGlyphLoaded(FULL_STOP_CODE_POINT);
+		}
+		else {
+			drawEllipsis = false;
+		}
+
+		if (drawEllipsis) {
+			ellipsisWidth = font->GetEllipsisWidth() * scale;
+		}
+	}
+
+	for (size_t i = 0; i < numCodepoints; i++) {
+		Uint32 codepoint = codepointsData[i];
+
+		bool isLineBreak = codepoint == 0x000A;
+
+		if ((i != wordstart && codepoint == 0x0020) || isLineBreak) {
+			bool canLineBreak = isLineBreak;
+			if (!canLineBreak && word > 0) {
+				float lineWidth = 0.0f;
+
+				for (size_t o = linestart; o < i; o++) {
+					lineWidth += Advances[o] * scale;
+				}
+
+				canLineBreak = lineWidth > Params.MaxWidth;
+			}
+
+			size_t start = isLineBreak ? (i + 1) : wordstart;
+			size_t end = isLineBreak ? i : (wordstart - 1);
+
+			if (canLineBreak) {
+				bool isLastLine = Params.MaxLines > 0 && lineNo == Params.MaxLines;
+
+				currX = 0.0f;
+
+				for (size_t o = linestart; o < end; o++) {
+					float advance = Advances[o] * scale;
+
+					// Add the ellipsis if the text no longer fits
+					if (isLastLine && drawEllipsis &&
+						currX + advance > Params.MaxWidth - ellipsisWidth) {
+						AddEllipsis(currX, currY, scale, xyScale);
+						return;
+					}
+
+					if (codepointsData[o] != 0x0020) {
+						AddGlyph(codepointsData[o], currX, currY, scale, xyScale);
+					}
+
+					currX += advance;
+				}
+
+				if (isLastLine) {
+					// Add the ellipsis if the text no longer fits AND there is
+					// still space
+					if (drawEllipsis && currX < Params.MaxWidth - ellipsisWidth) {
+						AddEllipsis(currX, currY, scale, xyScale);
+					}
+
+					return;
+				}
+
+				lineNo++;
+				linestart = start;
+
+				currY += (ascent - descent + leading) * scale;
+			}
+
+			wordstart = i + 1;
+			word++;
+		}
+	}
+
+	// Lay out the remaining line
+	currX = 0.0f;
+
+	for (size_t o = linestart; o < numCodepoints; o++) {
+		float advance = Advances[o] * scale;
+
+		// Add the ellipsis if the text no longer fits
+		if (drawEllipsis && currX + advance > Params.MaxWidth - ellipsisWidth) {
+			AddEllipsis(currX, currY, scale, xyScale);
+			break;
+		}
+
+		if (codepointsData[o] != 0x0020 && codepointsData[o] != 0x000A) {
+			AddGlyph(codepointsData[o], currX, currY, scale, xyScale);
+		}
+
+		currX += advance;
+	}
+}
+
+void TextLayout::Measure() {
+	float currX = 0.0f;
+	float currY = 0.0f;
+
+	float ascent = Params.Ascent;
+	float descent = Params.Descent;
+	float leading = Params.Leading;
+
+	float scale = Params.FontSize / FontPtr->Size;
+	float xyScale = scale / FontPtr->Oversampling;
+
+	for (size_t i = 0; i < Codepoints.size(); i++) {
+		float glyphY = 0.0f;
+
+		Uint32 codepoint = Codepoints[i];
+		if (codepoint == '\n') {
+			currX = 0.0f;
+			currY += (ascent - descent + leading) * scale;
+		}
+		else if (codepoint == ' ') {
+			currX += Advances[i] * scale;
+		}
+		else {
+			FontGlyph* glyph = GlyphData[i];
+
+			currX += Advances[i] * scale;
+			glyphY += (ascent * scale) + (glyph->OffsetY * xyScale) +
+				(glyph->Height * xyScale);
+		}
+
+		if (currX > Width) {
+			Width = currX;
+		}
+		if (currY + glyphY > Height) {
+			Height = currY + glyphY;
+		}
+	}
+}
+
+void TextLayout::MeasureWrapped() {
+	float currX = 0.0f;
+	float currY = 0.0f;
+
+	float ascent = Params.Ascent;
+	float descent = Params.Descent;
+	float leading = Params.Leading;
+
+	float scale = Params.FontSize / FontPtr->Size;
+	float xyScale = scale / FontPtr->Oversampling;
+
+	int word = 0;
+	int lineNo = 1;
+
+	size_t numCodepoints = Codepoints.size();
+	Uint32* codepointsData = Codepoints.data();
+	size_t linestart = 0;
+	size_t wordstart = 0;
+
+	for (size_t i = 0; i < numCodepoints; i++) {
+		Uint32 codepoint = codepointsData[i];
+
+		bool isLineBreak = codepoint == 0x000A;
+
+		if ((i != wordstart && codepoint == 0x0020) || isLineBreak) {
+			bool canLineBreak = isLineBreak;
+			if (!canLineBreak && word > 0) {
+				float lineWidth = 0.0f;
+
+				for (size_t o = linestart; o < i; o++) {
+					lineWidth += Advances[o] * scale;
+				}
+
+				canLineBreak = lineWidth > Params.MaxWidth;
+			}
+
+			size_t start = isLineBreak ? (i + 1) : wordstart;
+			size_t end = isLineBreak ? i : (wordstart - 1);
+
+			if (canLineBreak) {
+				currX = 0.0f;
+
+				for (size_t o = linestart; o < end; o++) {
+					float glyphY = 0.0f;
+
+					currX += Advances[o] * scale;
+
+					if (GlyphData[o]) {
+						glyphY += (ascent * scale) +
+							(GlyphData[o]->OffsetY * xyScale) +
+							(GlyphData[o]->Height * xyScale);
+					}
+
+					if (currX > Width) {
+						Width = currX;
+					}
+					if (currY + glyphY > Height) {
+						Height = currY + glyphY;
+					}
+				}
+
+				if (Params.MaxLines > 0 && lineNo == Params.MaxLines) {
+					return;
+				}
+
+				lineNo++;
+				linestart = start;
+
+				currY += (ascent - descent + leading) * scale;
+			}
+
+			wordstart = i + 1;
+			word++;
+		}
+	}
+
+	// Measure the remaining line
+	currX = 0.0f;
+
+	for (size_t o = linestart; o < numCodepoints; o++) {
+		float glyphY = 0.0f;
+
+		currX += Advances[o] * scale;
+
+		if (GlyphData[o]) {
+			glyphY += (ascent * scale) + (GlyphData[o]->OffsetY * xyScale) +
+				(GlyphData[o]->Height * xyScale);
+		}
+
+		if (currX > Width) {
+			Width = currX;
+		}
+		if (currY + glyphY > Height) {
+			Height = currY + glyphY;
+		}
+	}
+}
+
+void TextLayout::Build() {
+	Glyphs.clear();
+	Width = 0.0f;
+	Height = 0.0f;
+
+	if (!FontPtr) {
+		return;
+	}
+
+	Prepare();
+
+	GlyphScale = (Params.FontSize / FontPtr->Size) / FontPtr->Oversampling;
+
+	if (Wrapped) {
+		LayOutWrapped();
+		MeasureWrapped();
+	}
+	else {
+		LayOut();
+		Measure();
+	}
+
+	// Only the results are kept.
+	Codepoints.clear();
+	GlyphData.clear();
+	Advances.clear();
+}
+
+void TextLayout::Draw(float x, float y, int paletteID) {
+	Font* font = FontPtr;
+	if (font == nullptr || font->Sprite == nullptr || font->Sprite->Spritesheets.size() == 0) {
+		return;
+	}
+
+	bool texBlend = Graphics::TextureBlend;
+	Graphics::TextureBlend = true;
+
+	for (size_t i = 0; i < Glyphs.size(); i++) {
+		TextLayoutGlyph& glyph = Glyphs[i];
+
+		Graphics::DrawSprite(font->Sprite,
+			0,
+			glyph.FrameID,
+			x + glyph.X,
+			y + glyph.Y,
+			false,
+			false,
+			GlyphScale,
+			GlyphScale,
+			0.0f,
+			paletteID);
+	}
+
+	Graphics::TextureBlend = texBlend;
+}
+
+Uint32 TextLayoutCache::GetHash(Font* font,
+	const char* text,
+	TextDrawParams* params,
+	bool wrapped) {
+	Uint32 hash = FNV1A::EncryptString(text);
+	hash = FNV1A::EncryptData(&font, sizeof(font), hash);
+	hash = FNV1A::EncryptData(&params->FontSize, sizeof(params->FontSize), hash);
+	hash = FNV1A::EncryptData(&params->Ascent, sizeof(params->Ascent), hash);
+	hash = FNV1A::EncryptData(&params->Descent, sizeof(params->Descent), hash);
+	hash = FNV1A::EncryptData(&params->Leading, sizeof(params->Leading), hash);
+	hash = FNV1A::EncryptData(&params->MaxWidth, sizeof(params->MaxWidth), hash);
+	hash = FNV1A::EncryptData(&params->MaxLines, sizeof(params->MaxLines), hash);
+	hash = FNV1A::EncryptData(&params->Flags, sizeof(params->Flags), hash);
+	hash = FNV1A::EncryptData(&wrapped, sizeof(wrapped), hash);
+	return hash;
+}
+
+void TextLayoutCache::Unlink(TextLayout* layout) {
+	if (layout->PrevUsed) {
+		layout->PrevUsed->NextUsed = layout->NextUsed;
+	}
+	else {
+		MostRecent = layout->NextUsed;
+	}
+
+	if (layout->NextUsed) {
+		layout->NextUsed->PrevUsed = layout->PrevUsed;
+	}
+	else {
+		LeastRecent = layout->PrevUsed;
+	}
+
+	layout->PrevUsed = nullptr;
+	layout->NextUsed = nullptr;
+}
+
+void TextLayoutCache::MakeMostRecent(TextLayout* layout) {
+	layout->PrevUsed = nullptr;
+	layout->NextUsed = MostRecent;
+	if (MostRecent) {
+		MostRecent->PrevUsed = layout;
+	}
+	else {
+		LeastRecent = layout;
+	}
+	MostRecent = layout;
+}
+
+// Returns the layout of the text, laying it out if it isn't cached. The
+// layout belongs to the cache, and can be evicted by the next call.
+TextLayout* TextLayoutCache::Get(Font* font,
+	const char* text,
+	TextDrawParams* params,
+	bool wrapped) {
+	if (!Layouts) {
+		Layouts = new HashMap<TextLayout*>(NULL, Capacity);
+	}
+
+	Uint32 hash = GetHash(font, text, params, wrapped);
+
+	TextLayout* layout = Layouts->Get(hash);
+	if (layout && layout->Matches(font, text, params, wrapped)) {
+		if (layout != MostRecent) {
+			Unlink(layout);
+			MakeMostRecent(layout);
+		}
+
+		if (!layout->IsCurrent()) {
+			layout->Build();
+		}
+
+		return layout;
+	}
+
+	// Another text with the same hash is replaced.
+	if (layout) {
+		Unlink(layout);
+		delete layout;
+	}
+	else if (Layouts->Count() >= Capacity && LeastRecent) {
+		TextLayout* evicted = LeastRecent;
+		Unlink(evicted);
+		Layouts->Remove(evicted->Hash);
+		delete evicted;
+	}
+
+	layout = new TextLayout(font, text, params, wrapped);
+	layout->Hash = hash;
+	layout->Build();
+
+	Layouts->Put(hash, layout);
+	MakeMostRecent(layout);
+
+	return layout;
+}
+
+// Lays out text that is kept until it's deleted. Returns its handle.
+int TextLayoutCache::Create(Font* font, const char* text, TextDrawParams* params, bool wrapped) {
+	TextLayout* layout = new TextLayout(font, text, params, wrapped);
+	layout->Build();
+
+	for (size_t i = 0; i < Handles.size(); i++) {
+		if (!Handles[i]) {
+			Handles[i] = layout;
+			return (int)i;
+		}
+	}
+
+	Handles.push_back(layout);
+	return (int)Handles.size() - 1;
+}
+
+TextLayout* TextLayoutCache::GetHandle(int index) {
+	if (index < 0 || index >= (int)Handles.size()) {
+		return nullptr;
+	}
+
+	TextLayout* layout = Handles[index];
+	if (layout && layout->FontPtr && !layout->IsCurrent()) {
+		layout->Build();
+	}
+
+	return layout;
+}
+
+bool TextLayoutCache::Delete(int index) {
+	if (index < 0 || index >= (int)Handles.size() || !Handles[index]) {
+		return false;
+	}
+
+	delete Handles[index];
+	Handles[index] = nullptr;
+	return true;
+}
+
+// Called when a font is deleted. Layouts with a handle stay, but draw
+// nothing.
+void TextLayoutCache::RemoveFont(Font* font) {
+	if (Layouts) {
+		for (TextLayout *layout = MostRecent, *next; layout; layout = next) {
+			next = layout->NextUsed;
+			if (layout->FontPtr == font) {
+				Unlink(layout);
+				Layouts->Remove(layout->Hash);
+				delete layout;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < Handles.size(); i++) {
+		if (Handles[i] && Handles[i]->FontPtr == font) {
+			Handles[i]->FontPtr = nullptr;
+			Handles[i]->Glyphs.clear();
+		}
+	}
+}
+
+void TextLayoutCache::Clear() {
+	for (TextLayout *layout = MostRecent, *next; layout; layout = next) {
+		next = layout->NextUsed;
+		delete layout;
+	}
+	MostRecent = nullptr;
+	LeastRecent = nullptr;
+
+	if (Layouts) {
+		Layouts->Clear();
+	}
+}
+
+void TextLayoutCache::Dispose() {
+	Clear();
+
+	delete Layouts;
+	Layouts = nullptr;
+
+	for (size_t i = 0; i < Handles.size(); i++) {
+		delete Handles[i];
+	}
+	Handles.clear();
+}
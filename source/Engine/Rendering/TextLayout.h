@@ -0,0 +1,85 @@
+#ifndef ENGINE_RENDERING_TEXTLAYOUT_H
+#define ENGINE_RENDERING_TEXTLAYOUT_H
+
+#include <Engine/Includes/HashMap.h>
+#include <Engine/Includes/Standard.h>
+#include <Engine/Rendering/Enums.h>
+#include <Engine/ResourceTypes/Font.h>
+
+#define TEXT_LAYOUT_CACHE_SIZE 256
+
+// A glyph's position relative to where the text is drawn, with the glyph's
+// offsets and the font's ascent already applied.
+struct TextLayoutGlyph {
+	float X;
+	float Y;
+	int FrameID;
+};
+
+// The glyphs of a string of text, positioned for a font and a set of text
+// drawing parameters. Drawing a layout only draws its glyphs; nothing is
+// decoded, looked up or measured again until the font changes.
+class TextLayout {
+private:
+	std::vector<Uint32> Codepoints;
+	std::vector<FontGlyph*> GlyphData;
+	std::vector<float> Advances;
+
+	void Prepare();
+	void AddGlyph(Uint32 codepoint, float x, float y, float scale, float glyphScale);
+	void AddEllipsis(float x, float y, float scale, float glyphScale);
+	void LayOut();
+	void LayOutWrapped();
+	void Measure();
+	void MeasureWrapped();
+
+public:
+	Font* FontPtr = nullptr;
+	Uint32 FontGeneration = 0;
+	float SpaceWidth = 0.0f;
+	std::string Text;
+	TextDrawParams Params;
+	bool Wrapped = false;
+
+	std::vector<TextLayoutGlyph> Glyphs;
+	float GlyphScale = 1.0f;
+	float Width = 0.0f;
+	float Height = 0.0f;
+
+	// Cached layouts are kept in least recently used order. Layouts that
+	// scripts hold a handle to aren't in the cache.
+	Uint32 Hash = 0;
+	TextLayout* PrevUsed = nullptr;
+	TextLayout* NextUsed = nullptr;
+
+	TextLayout(Font* font, const char* text, TextDrawParams* params, bool wrapped);
+	bool Matches(Font* font, const char* text, TextDrawParams* params, bool wrapped);
+	bool IsCurrent();
+	void Build();
+	void Draw(float x, float y, int paletteID);
+};
+
+class TextLayoutCache {
+private:
+	static HashMap<TextLayout*>* Layouts;
+	static TextLayout* MostRecent;
+	static TextLayout* LeastRecent;
+
+	static Uint32 GetHash(Font* font, const char* text, TextDrawParams* params, bool wrapped);
+	static void Unlink(TextLayout* layout);
+	static void MakeMostRecent(TextLayout* layout);
+
+public:
+	static size_t Capacity;
+	static std::vector<TextLayout*> Handles;
+
+	static TextLayout* Get(Font* font, const char* text, TextDrawParams* params, bool wrapped);
+	static int Create(Font* font, const char* text, TextDrawParams* params, bool wrapped);
+	static TextLayout* GetHandle(int index);
+	static bool Delete(int index);
+	static void RemoveFont(Font* font);
+	static void Clear();
+	static void Dispose();
+};
+
+#endif /* ENGINE_RENDERING_TEXTLAYOUT_H */
@@ -0,0 +1,616 @@
+#include <Engine/ResourceTypes/AsyncLoader.h>
+
+#include <Engine/Diagnostics/Clock.h>
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Memory.h>
+#include <Engine/Diagnostics/Profiler.h>
+#include <Engine/Graphics.h>
+#include <Engine/Hashing/CRC32.h>
+#include <Engine/IO/MemoryStream.h>
+#include <Engine/ResourceTypes/ISprite.h>
+#include <Engine/ResourceTypes/ResourceManager.h>
+#include <Engine/Scene.h>
+#include <Engine/Utilities/StringUtils.h>
+
+SDL_Thread* AsyncLoader::Threads[ASYNC_LOADER_MAX_THREADS];
+int AsyncLoader::NumThreads = 0;
+SDL_mutex* AsyncLoader::QueueLock = NULL;
+SDL_sem* AsyncLoader::WorkSignal = NULL;
+bool AsyncLoader::Running = false;
+std::deque<AsyncLoadJob*> AsyncLoader::Queue;
+std::deque<AsyncLoadJob*> AsyncLoader::Decoded;
+std::unordered_map<int, AsyncLoadJob*> AsyncLoader::Jobs;
+int AsyncLoader::NumDecoding = 0;
+int AsyncLoader::NextID = 0;
+int AsyncLoader::BatchRequested = 0;
+int AsyncLoader::BatchFinished = 0;
+
+bool AsyncLoader::Enabled = true;
+double AsyncLoader::FinalizeBudget = ASYNC_LOADER_DEFAULT_BUDGET;
+double AsyncLoader::LastFrameTime = 0.0;
+double AsyncLoader::MaxFrameTime = 0.0;
+
+// How long an idle worker sleeps when nobody wakes it up, in milliseconds.
+#define ASYNC_LOADER_POLL_INTERVAL 50
+
+void AsyncLoader::Init() {
+	if (!Enabled || Running) {
+		return;
+	}
+
+	QueueLock = SDL_CreateMutex();
+	if (QueueLock == NULL) {
+		Log::Print(Log::LOG_ERROR,
+			"Unable to create the asynchronous loader mutex: %s",
+			SDL_GetError());
+		return;
+	}
+
+	WorkSignal = SDL_CreateSemaphore(0);
+	if (WorkSignal == NULL) {
+		Log::Print(Log::LOG_ERROR,
+			"Unable to create the asynchronous loader semaphore: %s",
+			SDL_GetError());
+		SDL_DestroyMutex(QueueLock);
+		QueueLock = NULL;
+		return;
+	}
+
+	// Leave a core for the main thread.
+	int threadCount = SDL_GetCPUCount() - 1;
+	if (threadCount < 1) {
+		threadCount = 1;
+	}
+	else if (threadCount > ASYNC_LOADER_MAX_THREADS) {
+		threadCount = ASYNC_LOADER_MAX_THREADS;
+	}
+
+	Running = true;
+
+	NumThreads = 0;
+	for (int i = 0; i < threadCount; i++) {
+		SDL_Thread* thread =
+			SDL_CreateThread(AsyncLoader::ThreadFunc, "AsyncLoader::ThreadFunc", NULL);
+		if (thread == NULL) {
+			Log::Print(Log::LOG_ERROR,
+				"Unable to create an asynchronous loader thread: %s",
+				SDL_GetError());
+			break;
+		}
+		Threads[NumThreads++] = thread;
+	}
+
+	if (NumThreads == 0) {
+		Running = false;
+		SDL_DestroySemaphore(WorkSignal);
+		SDL_DestroyMutex(QueueLock);
+		WorkSignal = NULL;
+		QueueLock = NULL;
+	}
+}
+
+int AsyncLoader::ThreadFunc(void* data) {
+	PROFILE_THREAD("Async Loader");
+
+	while (true) {
+		SDL_SemWaitTimeout(WorkSignal, ASYNC_LOADER_POLL_INTERVAL);
+
+		SDL_LockMutex(QueueLock);
+		if (!Running) {
+			SDL_UnlockMutex(QueueLock);
+			break;
+		}
+		if (Queue.empty()) {
+			SDL_UnlockMutex(QueueLock);
+			continue;
+		}
+
+		AsyncLoadJob* job = Queue.front();
+		Queue.pop_front();
+		job->State = ASYNC_LOAD_DECODING;
+		NumDecoding++;
+		SDL_UnlockMutex(QueueLock);
+
+		Decode(job);
+
+		// Jobs that were cancelled while being decoded are no longer
+		// known to anyone else, so they're deleted here.
+		SDL_LockMutex(QueueLock);
+		bool cancelled = job->Cancelled;
+		if (cancelled) {
+			FreeJobData(job);
+			DeleteJob(job);
+		}
+		else {
+			job->State = ASYNC_LOAD_DECODED;
+			Decoded.push_back(job);
+		}
+		NumDecoding--;
+		SDL_UnlockMutex(QueueLock);
+	}
+
+	return 0;
+}
+
+vector<ResourceType*>* AsyncLoader::GetList(Uint8 type) {
+	switch (type) {
+	case ASYNC_LOAD_IMAGE:
+		return &Scene::ImageList;
+	case ASYNC_LOAD_SPRITE:
+		return &Scene::SpriteList;
+	case ASYNC_LOAD_SOUND:
+		return &Scene::SoundList;
+	case ASYNC_LOAD_MUSIC:
+		return &Scene::MusicList;
+	case ASYNC_LOAD_MODEL:
+		return &Scene::ModelList;
+	}
+	return nullptr;
+}
+int AsyncLoader::FindLoaded(Uint8 type, Uint32 hash) {
+	vector<ResourceType*>* list = GetList(type);
+	if (!list) {
+		return -1;
+	}
+
+	for (size_t i = 0; i < list->size(); i++) {
+		if ((*list)[i] && (*list)[i]->FilenameHash == hash) {
+			return (int)i;
+		}
+	}
+	return -1;
+}
+
+// Whether the resource a job loaded is still in its list. Scene resources go
+// away when the scene changes, and their slots can be reused by others.
+bool AsyncLoader::IsResultLoaded(AsyncLoadJob* job) {
+	if (job->State != ASYNC_LOAD_DONE) {
+		return false;
+	}
+
+	vector<ResourceType*>* list = GetList(job->Type);
+	if (!list || job->Result < 0 || job->Result >= (int)list->size()) {
+		return false;
+	}
+
+	ResourceType* resource = (*list)[job->Result];
+	return resource && resource->FilenameHash == job->FilenameHash;
+}
+
+// Runs on a worker thread, unless there are none. Nothing in here may touch
+// the renderer or the scene.
+void AsyncLoader::Decode(AsyncLoadJob* job) {
+	PROFILE_ZONE_DETAIL("Decode Resource", job->Filename);
+
+	switch (job->Type) {
+	case ASYNC_LOAD_IMAGE: {
+		ImageData image;
+		if (Image::Decode(job->Filename, &image)) {
+			job->Images.push_back(image);
+		}
+		break;
+	}
+	case ASYNC_LOAD_SPRITE:
+		if (!ISprite::GetSpritesheetPaths(job->Filename, &job->SheetPaths)) {
+			break;
+		}
+		job->Images.resize(job->SheetPaths.size());
+		for (size_t i = 0; i < job->SheetPaths.size(); i++) {
+			Image::Decode(job->SheetPaths[i].c_str(), &job->Images[i]);
+		}
+		break;
+	case ASYNC_LOAD_SOUND:
+		job->Sound = new (std::nothrow) ISound(job->Filename, false);
+		break;
+	case ASYNC_LOAD_MUSIC:
+		job->Sound = new (std::nothrow) ISound(job->Filename);
+		break;
+	case ASYNC_LOAD_MODEL:
+		// Models create their materials and textures as they're read,
+		// so only the file itself is read here.
+		if (!ResourceManager::LoadResource(job->Filename, &job->FileData, &job->FileSize)) {
+			job->FileData = nullptr;
+			job->FileSize = 0;
+		}
+		break;
+	}
+}
+
+// Runs on the main thread.
+void AsyncLoader::Finalize(AsyncLoadJob* job) {
+	PROFILE_ZONE_DETAIL("Finalize Resource", job->Filename);
+
+	int result = -1;
+
+	// Something else may have loaded the same resource in the meantime.
+	int existing = FindLoaded(job->Type, job->FilenameHash);
+	if (existing != -1) {
+		result = existing;
+	}
+	else {
+		switch (job->Type) {
+		case ASYNC_LOAD_IMAGE: {
+			if (job->Images.size() == 0) {
+				break;
+			}
+
+			Texture* texture = Image::CreateTexture(&job->Images[0], job->Filename);
+			if (!texture) {
+				break;
+			}
+
+			Image* image = new (std::nothrow) Image(texture);
+			image->Filename = StringUtils::Duplicate(job->Filename);
+
+			result = Scene::AddImageResource(image, job->Filename, job->UnloadPolicy);
+			image->ID = result;
+			break;
+		}
+		case ASYNC_LOAD_SPRITE: {
+			// The decoded sheets are put in the spritesheet cache, so
+			// that the sprite picks them up instead of loading them again.
+			vector<std::string> added;
+			for (size_t i = 0; i < job->Images.size(); i++) {
+				std::string& sheetPath = job->SheetPaths[i];
+				if (!job->Images[i].Data ||
+					Graphics::SpriteSheetTextureMap.count(sheetPath) != 0) {
+					continue;
+				}
+
+				Texture* texture =
+					Image::CreateTexture(&job->Images[i], sheetPath.c_str());
+				if (texture) {
+					Graphics::AddSpriteSheet(sheetPath, texture);
+					added.push_back(sheetPath);
+				}
+			}
+
+			result = Scene::LoadSpriteResource(job->Filename, job->UnloadPolicy);
+
+			// Drop the cache's own reference, leaving only the sprite's.
+			for (size_t i = 0; i < added.size(); i++) {
+				Graphics::DisposeSpriteSheet(added[i]);
+			}
+			break;
+		}
+		case ASYNC_LOAD_SOUND:
+		case ASYNC_LOAD_MUSIC: {
+			if (!job->Sound || job->Sound->LoadFailed) {
+				break;
+			}
+
+			if (job->Type == ASYNC_LOAD_MUSIC) {
+				result = Scene::AddMusicResource(
+					job->Sound, job->Filename, job->UnloadPolicy);
+			}
+			else {
+				result = Scene::AddSoundResource(
+					job->Sound, job->Filename, job->UnloadPolicy);
+			}
+			job->Sound = nullptr;
+			break;
+		}
+		case ASYNC_LOAD_MODEL: {
+			if (!job->FileData) {
+				break;
+			}
+
+			MemoryStream* stream = MemoryStream::New(job->FileData, job->FileSize);
+			if (!stream) {
+				break;
+			}
+
+			IModel* model = new (std::nothrow) IModel(stream, job->Filename);
+			stream->Close();
+
+			if (model->LoadFailed) {
+				delete model;
+				break;
+			}
+
+			result = Scene::AddModelResource(model, job->Filename, job->UnloadPolicy);
+			break;
+		}
+		}
+	}
+
+	FreeJobData(job);
+
+	job->Result = result;
+	job->State = result != -1 ? ASYNC_LOAD_DONE : ASYNC_LOAD_FAILED;
+
+	if (result == -1) {
+		Log::Print(Log::LOG_ERROR, "Could not load resource \"%s\"!", job->Filename);
+	}
+
+	BatchFinished++;
+}
+
+void AsyncLoader::FreeJobData(AsyncLoadJob* job) {
+	for (size_t i = 0; i < job->Images.size(); i++) {
+		Image::FreeData(&job->Images[i]);
+	}
+	job->Images.clear();
+	job->SheetPaths.clear();
+
+	delete job->Sound;
+	job->Sound = nullptr;
+
+	Memory::Free(job->FileData);
+	job->FileData = nullptr;
+	job->FileSize = 0;
+}
+void AsyncLoader::DeleteJob(AsyncLoadJob* job) {
+	Memory::Free(job->Filename);
+	delete job;
+}
+
+int AsyncLoader::Load(Uint8 type, const char* filename, int unloadPolicy) {
+	if (!GetList(type)) {
+		return -1;
+	}
+
+	Init();
+
+	Uint32 hash = CRC32::EncryptString(filename);
+
+	// Ask for the same resource twice, get the same handle, for as long as
+	// it's loading or loaded. A finished job for it that failed, or whose
+	// resource was unloaded since, is replaced by a new one.
+	for (std::unordered_map<int, AsyncLoadJob*>::iterator it = Jobs.begin();
+		it != Jobs.end();
+		it++) {
+		AsyncLoadJob* other = it->second;
+		if (other->Type != type || other->FilenameHash != hash) {
+			continue;
+		}
+
+		if (other->State < ASYNC_LOAD_DONE || IsResultLoaded(other)) {
+			return other->ID;
+		}
+
+		DeleteJob(other);
+		Jobs.erase(it);
+		break;
+	}
+
+	AsyncLoadJob* job = new AsyncLoadJob();
+	job->ID = NextID++;
+	job->Type = type;
+	job->Filename = StringUtils::Duplicate(filename);
+	job->FilenameHash = hash;
+	job->UnloadPolicy = unloadPolicy;
+	job->State = ASYNC_LOAD_QUEUED;
+	job->Result = -1;
+	job->Cancelled = false;
+	job->Sound = nullptr;
+	job->FileData = nullptr;
+	job->FileSize = 0;
+
+	Jobs[job->ID] = job;
+
+	int existing = FindLoaded(type, hash);
+	if (existing != -1) {
+		job->Result = existing;
+		job->State = ASYNC_LOAD_DONE;
+		return job->ID;
+	}
+
+	BatchRequested++;
+
+	if (!Running) {
+		Decode(job);
+		Finalize(job);
+		return job->ID;
+	}
+
+	SDL_LockMutex(QueueLock);
+	Queue.push_back(job);
+	SDL_UnlockMutex(QueueLock);
+
+	SDL_SemPost(WorkSignal);
+
+	return job->ID;
+}
+
+// Finalizes decoded jobs until the frame's budget runs out. At least one is
+// always done, so that loading can't stall completely.
+void AsyncLoader::Update() {
+	LastFrameTime = 0.0;
+
+	if (!Running) {
+		return;
+	}
+
+	double start = Clock::GetTicks();
+
+	while (true) {
+		SDL_LockMutex(QueueLock);
+		if (Decoded.empty()) {
+			SDL_UnlockMutex(QueueLock);
+			break;
+		}
+		AsyncLoadJob* job = Decoded.front();
+		Decoded.pop_front();
+		SDL_UnlockMutex(QueueLock);
+
+		Finalize(job);
+
+		if (Clock::GetTicks() - start >= FinalizeBudget) {
+			break;
+		}
+	}
+
+	LastFrameTime = Clock::GetTicks() - start;
+	if (LastFrameTime > MaxFrameTime) {
+		MaxFrameTime = LastFrameTime;
+	}
+
+	if (BatchFinished == BatchRequested) {
+		BatchRequested = BatchFinished = 0;
+	}
+}
+
+// Handles stay valid after their job is removed. Only finished jobs are
+// removed, so those count as complete, with nothing loaded.
+bool AsyncLoader::Exists(int id) {
+	return id >= 0 && id < NextID;
+}
+bool AsyncLoader::IsComplete(int id) {
+	std::unordered_map<int, AsyncLoadJob*>::iterator it = Jobs.find(id);
+	if (it == Jobs.end()) {
+		return Exists(id);
+	}
+
+	return it->second->State >= ASYNC_LOAD_DONE;
+}
+int AsyncLoader::GetResult(int id) {
+	std::unordered_map<int, AsyncLoadJob*>::iterator it = Jobs.find(id);
+	if (it == Jobs.end() || !IsResultLoaded(it->second)) {
+		return -1;
+	}
+
+	return it->second->Result;
+}
+
+// Blocks until the job is finished. If no worker has picked it up yet, it's
+// decoded right here instead of waiting for one.
+int AsyncLoader::Wait(int id) {
+	std::unordered_map<int, AsyncLoadJob*>::iterator it = Jobs.find(id);
+	if (it == Jobs.end()) {
+		return -1;
+	}
+
+	AsyncLoadJob* job = it->second;
+	if (job->State >= ASYNC_LOAD_DONE) {
+		return GetResult(id);
+	}
+
+	bool decodeHere = false;
+
+	SDL_LockMutex(QueueLock);
+	if (job->State == ASYNC_LOAD_QUEUED) {
+		Queue.erase(std::find(Queue.begin(), Queue.end(), job));
+		job->State = ASYNC_LOAD_DECODING;
+		decodeHere = true;
+	}
+	SDL_UnlockMutex(QueueLock);
+
+	if (decodeHere) {
+		Decode(job);
+	}
+	else {
+		while (true) {
+			SDL_LockMutex(QueueLock);
+			bool decoded = job->State == ASYNC_LOAD_DECODED;
+			if (decoded) {
+				Decoded.erase(std::find(Decoded.begin(), Decoded.end(), job));
+			}
+			SDL_UnlockMutex(QueueLock);
+
+			if (decoded) {
+				break;
+			}
+
+			SDL_Delay(1);
+		}
+	}
+
+	Finalize(job);
+
+	return job->Result;
+}
+
+int AsyncLoader::GetPendingCount() {
+	return BatchRequested - BatchFinished;
+}
+float AsyncLoader::GetProgress() {
+	if (BatchRequested == 0) {
+		return 1.0f;
+	}
+
+	return (float)BatchFinished / BatchRequested;
+}
+
+// Removes the finished jobs whose resource failed to load or has been
+// unloaded. This runs when the scene's resources are unloaded, so jobs don't
+// pile up over the course of the game.
+void AsyncLoader::RemoveUnloaded() {
+	for (std::unordered_map<int, AsyncLoadJob*>::iterator it = Jobs.begin();
+		it != Jobs.end();) {
+		AsyncLoadJob* job = it->second;
+		if (job->State < ASYNC_LOAD_DONE || IsResultLoaded(job)) {
+			it++;
+			continue;
+		}
+
+		DeleteJob(job);
+		it = Jobs.erase(it);
+	}
+}
+
+// Forgets about every job. Jobs that a worker is in the middle of decoding
+// are left for it to delete, but they're waited on, since the game's files
+// may be about to go away.
+void AsyncLoader::Reset() {
+	if (QueueLock) {
+		SDL_LockMutex(QueueLock);
+	}
+
+	for (std::unordered_map<int, AsyncLoadJob*>::iterator it = Jobs.begin();
+		it != Jobs.end();
+		it++) {
+		AsyncLoadJob* job = it->second;
+		if (job->State == ASYNC_LOAD_DECODING) {
+			job->Cancelled = true;
+			continue;
+		}
+
+		FreeJobData(job);
+		DeleteJob(job);
+	}
+
+	Jobs.clear();
+	Queue.clear();
+	Decoded.clear();
+
+	if (QueueLock) {
+		while (NumDecoding > 0) {
+			SDL_UnlockMutex(QueueLock);
+			SDL_Delay(1);
+			SDL_LockMutex(QueueLock);
+		}
+		SDL_UnlockMutex(QueueLock);
+	}
+
+	BatchRequested = 0;
+	BatchFinished = 0;
+}
+
+void AsyncLoader::Dispose() {
+	if (Running) {
+		SDL_LockMutex(QueueLock);
+		Running = false;
+		SDL_UnlockMutex(QueueLock);
+
+		for (int i = 0; i < NumThreads; i++) {
+			SDL_SemPost(WorkSignal);
+		}
+		for (int i = 0; i < NumThreads; i++) {
+			SDL_WaitThread(Threads[i], NULL);
+			Threads[i] = NULL;
+		}
+		NumThreads = 0;
+	}
+
+	Reset();
+
+	if (WorkSignal) {
+		SDL_DestroySemaphore(WorkSignal);
+		WorkSignal = NULL;
+	}
+	if (QueueLock) {
+		SDL_DestroyMutex(QueueLock);
+		QueueLock = NULL;
+	}
+}
@@ -0,0 +1,91 @@
+#ifndef ENGINE_RESOURCETYPES_ASYNCLOADER_H
+#define ENGINE_RESOURCETYPES_ASYNCLOADER_H
+
+#include <Engine/Includes/Standard.h>
+#include <Engine/Includes/StandardSDL2.h>
+#include <Engine/ResourceTypes/IModel.h>
+#include <Engine/ResourceTypes/ISound.h>
+#include <Engine/ResourceTypes/Image.h>
+
+#define ASYNC_LOADER_MAX_THREADS 4
+#define ASYNC_LOADER_DEFAULT_BUDGET 4.0
+
+enum AsyncLoadType {
+	ASYNC_LOAD_IMAGE,
+	ASYNC_LOAD_SPRITE,
+	ASYNC_LOAD_SOUND,
+	ASYNC_LOAD_MUSIC,
+	ASYNC_LOAD_MODEL
+};
+
+enum AsyncLoadState {
+	ASYNC_LOAD_QUEUED,
+	ASYNC_LOAD_DECODING,
+	ASYNC_LOAD_DECODED,
+	ASYNC_LOAD_DONE,
+	ASYNC_LOAD_FAILED
+};
+
+struct AsyncLoadJob {
+	int ID;
+	Uint8 Type;
+	char* Filename;
+	Uint32 FilenameHash;
+	int UnloadPolicy;
+	int State;
+	int Result;
+	bool Cancelled;
+
+	// Filled in by the worker that decodes the job.
+	vector<std::string> SheetPaths;
+	vector<ImageData> Images;
+	ISound* Sound;
+	Uint8* FileData;
+	size_t FileSize;
+};
+
+class AsyncLoader {
+private:
+	static SDL_Thread* Threads[ASYNC_LOADER_MAX_THREADS];
+	static int NumThreads;
+	static SDL_mutex* QueueLock;
+	static SDL_sem* WorkSignal;
+	static bool Running;
+	static std::deque<AsyncLoadJob*> Queue;
+	static std::deque<AsyncLoadJob*> Decoded;
+	static std::unordered_map<int, AsyncLoadJob*> Jobs;
+	static int NumDecoding;
+	static int NextID;
+	static int BatchRequested;
+	static int BatchFinished;
+
+	static int ThreadFunc(void* data);
+	static vector<ResourceType*>* GetList(Uint8 type);
+	static int FindLoaded(Uint8 type, Uint32 hash);
+	static bool IsResultLoaded(AsyncLoadJob* job);
+	static void Decode(AsyncLoadJob* job);
+	static void Finalize(AsyncLoadJob* job);
+	static void FreeJobData(AsyncLoadJob* job);
+	static void DeleteJob(AsyncLoadJob* job);
+
+public:
+	static bool Enabled;
+	static double FinalizeBudget;
+	static double LastFrameTime;
+	static double MaxFrameTime;
+
+	static void Init();
+	static int Load(Uint8 type, const char* filename, int unloadPolicy);
+	static void Update();
+	static bool Exists(int id);
+	static bool IsComplete(int id);
+	static int GetResult(int id);
+	static int Wait(int id);
+	static int GetPendingCount();
+	static float GetProgress();
+	static void RemoveUnloaded();
+	static void Reset();
+	static void Dispose();
+};
+
+#endif /* ENGINE_RESOURCETYPES_ASYNCLOADER_H */
@@ -1,6 +1,7 @@
 #include <Engine/Diagnostics/Memory.h>
 #include <Engine/Graphics.h>
 #include <Engine/IO/ResourceStream.h>
+#include <Engine/Rendering/TextLayout.h>
 #include <Engine/ResourceTypes/Font.h>
 
 // FIXME: Move to another file
@@ -119,6 +120,7 @@ void Font::InitCodepoints() {
 FontGlyphRange::FontGlyphRange(unsigned id) {
 	ID = id;
 	AtlasSize = DEFAULT_FONT_ATLAS_SIZE;
+	MaxAtlasSize = MAX_FONT_ATLAS_SIZE;
 }
 
 bool FontGlyphRange::Init() {
@@ -140,13 +142,63 @@ bool FontGlyphRange::Init() {
 		stbtt_PackEnd(context);
 	}
 
-	stbtt_PackBegin(context, Buffer, AtlasSize, AtlasSize, AtlasSize, 1, nullptr);
+	return BeginPacking();
+}
+
+bool FontGlyphRange::BeginPacking() {
+	stbtt_pack_context* context = (stbtt_pack_context*)Context;
+	if (!stbtt_PackBegin(context, Buffer, AtlasSize, AtlasSize, AtlasSize, 1, nullptr)) {
+		return false;
+	}
+
 	stbtt_PackSetSkipMissingCodepoints(context, false);
 	stbtt_PackSetOversampling(context, Oversampling, Oversampling);
 
 	return true;
 }
 
+// Doubles the size of the atlas. The glyphs already in it stay where they are,
+// and the new space is packed around them.
+bool FontGlyphRange::Grow() {
+	if (AtlasSize * 2 > MaxAtlasSize) {
+		return false;
+	}
+
+	unsigned oldSize = AtlasSize;
+	Uint8* oldBuffer = Buffer;
+
+	Buffer = (Uint8*)Memory::Malloc(oldSize * 2 * oldSize * 2);
+	if (Buffer == nullptr) {
+		Buffer = oldBuffer;
+		return false;
+	}
+
+	stbtt_pack_context* context = (stbtt_pack_context*)Context;
+	stbtt_PackEnd(context);
+
+	AtlasSize = oldSize * 2;
+	if (!BeginPacking()) {
+		Memory::Free(oldBuffer);
+		return false;
+	}
+
+	for (unsigned y = 0; y < oldSize; y++) {
+		memcpy(Buffer + y * AtlasSize, oldBuffer + y * oldSize, oldSize);
+	}
+	Memory::Free(oldBuffer);
+
+	// In an empty skyline, the first rectangle always goes into the corner.
+	stbrp_rect used;
+	used.id = 0;
+	used.w = oldSize;
+	used.h = oldSize;
+	stbrp_pack_rects((stbrp_context*)context->pack_info, &used, 1);
+
+	NeedRecreate = true;
+
+	return true;
+}
+
 void FontGlyphRange::AddGlyph(Uint32 codepoint) {
 	// Glyph is already present
 	std::unordered_map<Uint32, FontGlyph>::iterator it = Glyphs.find(codepoint);
@@ -160,187 +212,201 @@ void FontGlyphRange::AddGlyph(Uint32 codepoint) {
 	glyph.Codepoint = codepoint;
 	Glyphs[codepoint] = glyph;
 
-	NeedUpdate = true;
+	PendingGlyphs.push_back((int)codepoint);
 }
 
-bool FontGlyphRange::Update(Font* font) {
-	bool success = true;
-
-	if (NeedUpdate) {
-		success = PackGlyphs(font);
-
-		NeedUpdate = false;
-	}
-
-	return success;
+bool FontGlyphRange::IsEmpty() {
+	return Glyphs.size() == PendingGlyphs.size();
 }
 
-void FontGlyphRange::FreeGlyphMap() {
-	for (std::unordered_map<FontFamily*, PackedGlyphs>::iterator it = GlyphsPerFamily.begin();
-		it != GlyphsPerFamily.end();
-		it++) {
-		Memory::Free(GlyphsPerFamily[it->first].PackedChars);
-	}
-
-	GlyphsPerFamily.clear();
-}
-
-bool FontGlyphRange::InitGlyphMap(Font* font) {
-	FreeGlyphMap();
-
-	for (std::unordered_map<Uint32, FontGlyph>::iterator it = Glyphs.begin();
-		it != Glyphs.end();
-		it++) {
-		Uint32 codepoint = it->second.Codepoint;
-
-		FontFamily* family = font->FindFamilyForCodepoint(codepoint);
+bool FontGlyphRange::Update(Font* font) {
+	NewGlyphs.clear();
+	Overflow.clear();
 
-		GlyphsPerFamily[family].Codepoints.push_back(codepoint);
+	if (PendingGlyphs.size() == 0) {
+		return false;
 	}
 
-	for (std::unordered_map<FontFamily*, PackedGlyphs>::iterator it = GlyphsPerFamily.begin();
-		it != GlyphsPerFamily.end();
-		it++) {
-		PackedGlyphs& packedGlyphs = GlyphsPerFamily[it->first];
-
-		void* packedChars =
-			Memory::Malloc(packedGlyphs.Codepoints.size() * sizeof(stbtt_packedchar));
-		if (packedChars == nullptr) {
-			return false;
-		}
+	return PackGlyphs(font);
+}
 
-		packedGlyphs.PackedChars = packedChars;
+void FontGlyphRange::MarkDirty(unsigned left, unsigned top, unsigned right, unsigned bottom) {
+	if (DirtyRight == 0) {
+		DirtyLeft = left;
+		DirtyTop = top;
+		DirtyRight = right;
+		DirtyBottom = bottom;
+		return;
 	}
 
-	return true;
+	DirtyLeft = std::min(DirtyLeft, left);
+	DirtyTop = std::min(DirtyTop, top);
+	DirtyRight = std::max(DirtyRight, right);
+	DirtyBottom = std::max(DirtyBottom, bottom);
 }
 
-bool FontGlyphRange::PackGlyphs(Font* font) {
+// Packs and renders the given glyphs of a family. The ones that still don't
+// fit once the atlas is as large as it can be are put into Overflow.
+bool FontGlyphRange::PackFamilyGlyphs(FontFamily* family, std::vector<int>& codepoints) {
 	stbtt_pack_context* context = (stbtt_pack_context*)Context;
-	if (context == nullptr) {
-		return false;
-	}
-
-	if (!Init()) {
+	stbtt_fontinfo* info = (stbtt_fontinfo*)family->Context;
+	if (info == nullptr) {
 		return false;
 	}
 
-	if (!InitGlyphMap(font)) {
-		FreeGlyphMap();
+	size_t numCodepoints = codepoints.size();
 
+	stbtt_packedchar* packedChars =
+		(stbtt_packedchar*)Memory::Calloc(numCodepoints, sizeof(stbtt_packedchar));
+	stbrp_rect* rects = (stbrp_rect*)Memory::Malloc(numCodepoints * sizeof(stbrp_rect));
+	if (packedChars == nullptr || rects == nullptr) {
+		Memory::Free(packedChars);
+		Memory::Free(rects);
 		return false;
 	}
 
-	stbrp_rect* rects = nullptr;
-	size_t lastNumCodepoints = 0;
+	stbtt_pack_range range;
+	range.first_unicode_codepoint_in_range = 0;
+	range.array_of_unicode_codepoints = codepoints.data();
+	range.num_chars = numCodepoints;
+	range.chardata_for_range = packedChars;
+	range.font_size = FontSize;
 
-	bool packedAll = true;
+	int numRects = stbtt_PackFontRangesGatherRects(context, info, &range, 1, rects);
 
-	for (std::unordered_map<FontFamily*, PackedGlyphs>::iterator it = GlyphsPerFamily.begin();
-		it != GlyphsPerFamily.end();
-		it++) {
-		FontFamily* family = it->first;
-		PackedGlyphs& packedGlyphs = GlyphsPerFamily[family];
+	stbtt_PackFontRangesPackRects(context, rects, numRects);
 
-		int* codepoints = packedGlyphs.Codepoints.data();
-		size_t numCodepoints = packedGlyphs.Codepoints.size();
-		if (numCodepoints == 0) {
-			continue;
+	// Whatever didn't fit is packed again after the atlas grows. The glyphs
+	// that did fit are inside the part of the atlas that is kept as it is.
+	std::vector<stbrp_rect> unpacked;
+	for (int i = 0; i < numRects; i++) {
+		if (!rects[i].was_packed) {
+			rects[i].id = i;
+			unpacked.push_back(rects[i]);
 		}
+	}
+	while (unpacked.size() && Grow()) {
+		stbtt_PackFontRangesPackRects(context, unpacked.data(), unpacked.size());
 
-		stbtt_pack_range range;
-		range.first_unicode_codepoint_in_range = 0;
-		range.array_of_unicode_codepoints = codepoints;
-		range.num_chars = numCodepoints;
-		range.chardata_for_range = (stbtt_packedchar*)packedGlyphs.PackedChars;
-		range.font_size = FontSize;
-
-		if (numCodepoints > lastNumCodepoints) {
-			rects = (stbrp_rect*)Memory::Realloc(
-				rects, sizeof(stbrp_rect) * numCodepoints);
-			if (rects == nullptr) {
-				packedAll = false;
-				break;
+		size_t numUnpacked = 0;
+		for (size_t i = 0; i < unpacked.size(); i++) {
+			if (unpacked[i].was_packed) {
+				rects[unpacked[i].id] = unpacked[i];
+			}
+			else {
+				unpacked[numUnpacked++] = unpacked[i];
 			}
 		}
+		unpacked.resize(numUnpacked);
+	}
 
-		stbtt_fontinfo* info = (stbtt_fontinfo*)family->Context;
-		if (info == nullptr) {
-			packedAll = false;
-			break;
-		}
-
-		int numRects = stbtt_PackFontRangesGatherRects(context, info, &range, 1, rects);
+	stbtt_PackFontRangesRenderIntoRects(context, info, &range, 1, rects);
 
-		stbtt_PackFontRangesPackRects(context, rects, numRects);
+	for (int i = 0; i < numRects; i++) {
+		Uint32 codepoint = (Uint32)codepoints[i];
 
-		if (stbtt_PackFontRangesRenderIntoRects(context, info, &range, 1, rects) == 0) {
-			packedAll = false;
-			break;
+		if (!rects[i].was_packed) {
+			Glyphs.erase(codepoint);
+			Overflow.push_back(codepoint);
+			continue;
 		}
-	}
 
-	Memory::Free(rects);
+		stbtt_packedchar* packedChar = &packedChars[i];
 
-	if (!packedAll) {
-		int maxTextureSize =
-			std::min(Graphics::MaxTextureWidth, Graphics::MaxTextureHeight);
-		if (AtlasSize > maxTextureSize) {
-			return false;
-		}
+		FontGlyph& glyph = Glyphs[codepoint];
+		glyph.Exists = true;
+		glyph.Width = packedChar->x1 - packedChar->x0;
+		glyph.Height = packedChar->y1 - packedChar->y0;
+		glyph.SourceX = packedChar->x0;
+		glyph.SourceY = packedChar->y0;
+		glyph.OffsetX = packedChar->xoff * Oversampling;
+		glyph.OffsetY = packedChar->yoff * Oversampling;
+		glyph.Advance = packedChar->xadvance;
 
-		AtlasSize *= 2;
+		NewGlyphs.push_back(codepoint);
 
-		return PackGlyphs(font);
+		MarkDirty(rects[i].x, rects[i].y, rects[i].x + rects[i].w, rects[i].y + rects[i].h);
 	}
 
-	Texture* atlas = Font::CreateAtlasTexture(
-		Buffer, AtlasSize, UseAntialiasing, PixelCoverageThreshold);
-	if (!atlas) {
+	Memory::Free(packedChars);
+	Memory::Free(rects);
+
+	return true;
+}
+
+// Only the glyphs added since the last update are rasterized.
+bool FontGlyphRange::PackGlyphs(Font* font) {
+	stbtt_pack_context* context = (stbtt_pack_context*)Context;
+	if (context == nullptr || Buffer == nullptr) {
 		return false;
 	}
 
-	if (atlas) {
-		Graphics::SetTextureMinFilter(atlas, font->GetAtlasMinFilter());
-		Graphics::SetTextureMagFilter(atlas, font->GetAtlasMagFilter());
+	std::unordered_map<FontFamily*, std::vector<int>> glyphsPerFamily;
+	for (size_t i = 0; i < PendingGlyphs.size(); i++) {
+		int codepoint = PendingGlyphs[i];
+
+		FontFamily* family = font->FindFamilyForCodepoint(codepoint);
+		if (family) {
+			glyphsPerFamily[family].push_back(codepoint);
+		}
 	}
 
-	Graphics::DisposeTexture(Atlas);
+	PendingGlyphs.clear();
 
-	Atlas = atlas;
+	bool packedAll = true;
 
-	LoadGlyphs();
+	for (std::unordered_map<FontFamily*, std::vector<int>>::iterator it =
+			glyphsPerFamily.begin();
+		it != glyphsPerFamily.end();
+		it++) {
+		if (!PackFamilyGlyphs(it->first, it->second)) {
+			packedAll = false;
+		}
+	}
 
-	return true;
-}
+	if (!UploadAtlas(font)) {
+		return false;
+	}
 
-void FontGlyphRange::LoadGlyphs() {
-	for (std::unordered_map<FontFamily*, PackedGlyphs>::iterator it = GlyphsPerFamily.begin();
-		it != GlyphsPerFamily.end();
-		it++) {
-		PackedGlyphs& packedGlyphs = GlyphsPerFamily[it->first];
+	return packedAll;
+}
 
-		stbtt_packedchar* packedChars = (stbtt_packedchar*)packedGlyphs.PackedChars;
-		if (packedChars == nullptr) {
-			continue;
+bool FontGlyphRange::UploadAtlas(Font* font) {
+	if (Atlas == nullptr || NeedRecreate) {
+		Texture* atlas = Font::CreateAtlasTexture(
+			Buffer, AtlasSize, UseAntialiasing, PixelCoverageThreshold);
+		if (!atlas) {
+			return false;
 		}
 
-		for (size_t i = 0; i < packedGlyphs.Codepoints.size(); i++) {
-			int codepoint = packedGlyphs.Codepoints[i];
+		Graphics::SetTextureMinFilter(atlas, font->GetAtlasMinFilter());
+		Graphics::SetTextureMagFilter(atlas, font->GetAtlasMagFilter());
 
-			stbtt_packedchar* packedChar = &packedChars[i];
+		Graphics::DisposeTexture(Atlas);
 
-			FontGlyph& glyph = Glyphs[codepoint];
-			glyph.Exists = true;
-			glyph.Width = packedChar->x1 - packedChar->x0;
-			glyph.Height = packedChar->y1 - packedChar->y0;
-			glyph.SourceX = packedChar->x0;
-			glyph.SourceY = packedChar->y0;
-			glyph.OffsetX = packedChar->xoff * Oversampling;
-			glyph.OffsetY = packedChar->yoff * Oversampling;
-			glyph.Advance = packedChar->xadvance;
+		Atlas = atlas;
+	}
+	else if (DirtyRight > DirtyLeft && DirtyBottom > DirtyTop) {
+		unsigned width = std::min(DirtyRight, AtlasSize) - DirtyLeft;
+		unsigned height = std::min(DirtyBottom, AtlasSize) - DirtyTop;
+
+		Uint32* dataRgba = Font::GenerateAtlas(Buffer + DirtyTop * AtlasSize + DirtyLeft,
+			width,
+			height,
+			AtlasSize,
+			UseAntialiasing,
+			PixelCoverageThreshold);
+		if (dataRgba) {
+			SDL_Rect rect = {(int)DirtyLeft, (int)DirtyTop, (int)width, (int)height};
+			Graphics::UpdateTexture(Atlas, &rect, dataRgba, width * sizeof(Uint32));
+			Memory::Free(dataRgba);
 		}
 	}
+
+	DirtyLeft = DirtyTop = DirtyRight = DirtyBottom = 0;
+	NeedRecreate = false;
+
+	return true;
 }
 
 void FontGlyphRange::ReloadAtlas() {
@@ -353,7 +419,6 @@ void FontGlyphRange::ReloadAtlas() {
 }
 
 FontGlyphRange::~FontGlyphRange() {
-	FreeGlyphMap();
 	if (Context) {
 		stbtt_PackEnd((stbtt_pack_context*)Context);
 		Memory::Free(Context);
@@ -403,6 +468,8 @@ bool Font::LoadSize(float fontSize) {
 
 	Unload();
 
+	Generation++;
+
 	InitSprite();
 	InitCodepoints();
 
@@ -412,7 +479,7 @@ bool Font::LoadSize(float fontSize) {
 		range->AddGlyph(Codepoints[i]);
 	}
 
-	bool packed = range->PackGlyphs(this);
+	bool packed = range->Update(this);
 
 	LoadGlyphsFromRange(range);
 
@@ -436,10 +503,9 @@ bool Font::Reload() {
 }
 
 void Font::LoadGlyphsFromRange(FontGlyphRange* range) {
-	for (std::unordered_map<Uint32, FontGlyph>::iterator it = range->Glyphs.begin();
-		it != range->Glyphs.end();
-		it++) {
-		Glyphs[it->first] = it->second;
+	for (size_t i = 0; i < range->NewGlyphs.size(); i++) {
+		Uint32 codepoint = range->NewGlyphs[i];
+		Glyphs[codepoint] = range->Glyphs[codepoint];
 	}
 }
 
@@ -490,17 +556,75 @@ void Font::UpdateSprite() {
 	Sprite->RefreshGraphicsID();
 }
 
+// Adds the glyphs a range just packed to the sprite. Glyphs that were already
+// in the sprite don't move, so their frames are kept.
+void Font::AddGlyphsToSprite(FontGlyphRange* range) {
+	if (!Sprite || range->Atlas == nullptr) {
+		return;
+	}
+
+	if (Sprite->Spritesheets.size() <= range->ID) {
+		Sprite->Spritesheets.resize(range->ID + 1, nullptr);
+		Sprite->SpritesheetFilenames.resize(range->ID + 1, "");
+	}
+	Sprite->Spritesheets[range->ID] = range->Atlas;
+
+	for (size_t i = 0; i < range->NewGlyphs.size(); i++) {
+		FontGlyph& glyph = Glyphs[range->NewGlyphs[i]];
+
+		// Skips empty glyphs (like space characters)
+		if (glyph.Width == 0 || glyph.Height == 0) {
+			continue;
+		}
+
+		glyph.FrameID = Sprite->Animations[0].Frames.size();
+
+		// Offsets are handled when rendering
+		Sprite->AddFrame(0,
+			0,
+			glyph.SourceX,
+			glyph.SourceY,
+			glyph.Width,
+			glyph.Height,
+			0,
+			0,
+			0,
+			range->ID);
+	}
+}
+
 // Font updating is done lazily, which helps if multiple glyphs needed to be loaded at once.
 void Font::Update() {
 	if (NeedUpdate) {
+		// Glyphs that don't fit into a range go into a new one, which is
+		// updated by this same loop.
 		for (size_t i = 0; i < GlyphRanges.size(); i++) {
 			FontGlyphRange* range = GlyphRanges[i];
-			if (range->Update(this)) {
-				LoadGlyphsFromRange(range);
+			bool wasEmpty = range->IsEmpty();
+
+			range->Update(this);
+
+			LoadGlyphsFromRange(range);
+			AddGlyphsToSprite(range);
+
+			if (range->Overflow.size() == 0) {
+				continue;
+			}
+
+			// A glyph that doesn't fit into an empty range never will.
+			if (wasEmpty && range->NewGlyphs.size() == 0) {
+				continue;
+			}
+
+			FontGlyphRange* next = NewRange();
+			for (size_t j = 0; j < range->Overflow.size(); j++) {
+				next->AddGlyph(range->Overflow[j]);
 			}
 		}
 
-		UpdateSprite();
+		if (Sprite) {
+			Sprite->RefreshGraphicsID();
+		}
 
 		NeedUpdate = false;
 	}
@@ -549,23 +673,40 @@ bool Font::SetOversampling(int oversamplingValue) {
 }
 
 Uint32* Font::GenerateAtlas(Uint8* data, unsigned size, bool useAntialias, Uint8 threshold) {
+	return GenerateAtlas(data, size, size, size, useAntialias, threshold);
+}
+
+// Converts a `width` by `height` part of a coverage buffer, whose rows are
+// `pitch` bytes apart.
+Uint32* Font::GenerateAtlas(Uint8* data,
+	unsigned width,
+	unsigned height,
+	unsigned pitch,
+	bool useAntialias,
+	Uint8 threshold) {
 	if (!data) {
 		return nullptr;
 	}
 
-	Uint32* dataRgba = (Uint32*)Memory::Malloc(size * size * sizeof(Uint32));
+	Uint32* dataRgba = (Uint32*)Memory::Malloc(width * height * sizeof(Uint32));
 	if (!dataRgba) {
 		return nullptr;
 	}
 
-	for (size_t i = 0; i < size * size; i++) {
-		Uint8 value = data[i];
+	Uint32* out = dataRgba;
+	for (size_t y = 0; y < height; y++) {
+		Uint8* row = data + y * pitch;
 
-		if (!useAntialias) {
-			value = (value < threshold) ? 0 : 255;
-		}
+		for (size_t x = 0; x < width; x++) {
+			Uint8 value = row[x];
+
+			if (!useAntialias) {
+				value = (value < threshold) ? 0 : 255;
+			}
 
-		dataRgba[i] = ColorUtils::Make(0xFF, 0xFF, 0xFF, value, Graphics::PreferredPixelFormat);
+			*out++ = ColorUtils::Make(
+				0xFF, 0xFF, 0xFF, value, Graphics::PreferredPixelFormat);
+		}
 	}
 
 	return dataRgba;
@@ -617,6 +758,7 @@ FontGlyphRange* Font::NewRange() {
 	range->Oversampling = Oversampling;
 	range->UseAntialiasing = UseAntialiasing;
 	range->PixelCoverageThreshold = PixelCoverageThreshold;
+	range->MaxAtlasSize = GetMaxAtlasSize();
 	range->Init();
 
 	GlyphRanges.push_back(range);
@@ -627,20 +769,18 @@ FontGlyphRange* Font::NewRange() {
 FontGlyphRange* Font::GetRangeForNewGlyph() {
 	size_t numRanges = GlyphRanges.size();
 	if (numRanges > 0) {
-		FontGlyphRange* range = GlyphRanges[numRanges - 1];
-
-		// Check if the texture is too large already
-		int maxTextureSize =
-			std::min(Graphics::MaxTextureWidth, Graphics::MaxTextureHeight);
-		maxTextureSize = std::min(maxTextureSize, MAX_FONT_ATLAS_SIZE);
-		if (range->AtlasSize < maxTextureSize) {
-			return range;
-		}
+		return GlyphRanges[numRanges - 1];
 	}
 
 	return NewRange();
 }
 
+unsigned Font::GetMaxAtlasSize() {
+	int maxTextureSize = std::min(Graphics::MaxTextureWidth, Graphics::MaxTextureHeight);
+	maxTextureSize = std::min(maxTextureSize, MAX_FONT_ATLAS_SIZE);
+	return (unsigned)std::max(maxTextureSize, DEFAULT_FONT_ATLAS_SIZE);
+}
+
 bool Font::HasGlyph(Uint32 codepoint) {
 	if (!IsValidCodepoint(codepoint)) {
 		return false;
@@ -714,6 +854,26 @@ float Font::GetGlyphAdvance(Uint32 codepoint) {
 	return 0.0f;
 }
 
+// The kerning between two codepoints, if both are in the same family.
+float Font::GetKerning(Uint32 left, Uint32 right) {
+	FontFamily* family = FindFamilyForCodepoint(left);
+	if (family == nullptr || family != FindFamilyForCodepoint(right)) {
+		return 0.0f;
+	}
+
+	stbtt_fontinfo* info = (stbtt_fontinfo*)family->Context;
+	if (!info->kern && !info->gpos) {
+		return 0.0f;
+	}
+
+	int kerning = stbtt_GetCodepointKernAdvance(info, left, right);
+	if (kerning == 0) {
+		return 0.0f;
+	}
+
+	return (float)kerning * stbtt_ScaleForPixelHeight(info, Size);
+}
+
 float Font::GetEllipsisWidth() {
 	if (HasGlyph(ELLIPSIS_CODE_POINT) && IsGlyphLoaded(ELLIPSIS_CODE_POINT)) {
 		return Glyphs[ELLIPSIS_CODE_POINT].Advance;
@@ -738,6 +898,8 @@ void Font::Unload() {
 }
 
 void Font::Dispose() {
+	TextLayoutCache::RemoveFont(this);
+
 	Unload();
 
 	for (size_t i = 0; i < Families.size(); i++) {
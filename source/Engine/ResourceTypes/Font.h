@@ -39,29 +39,35 @@ public:
 	~FontFamily();
 };
 
-struct PackedGlyphs {
-	std::vector<int> Codepoints;
-
-	void* PackedChars = nullptr;
-};
-
 class Font;
 
-// Each glyph range uniquely corresponds to a font atlas
+// Each glyph range uniquely corresponds to a font atlas page. Glyphs are
+// packed into the free space of the page as they are requested, and only the
+// part of the atlas they were rendered into is uploaded.
 struct FontGlyphRange {
 private:
 	void* Context = nullptr;
 	Uint8* Buffer = nullptr;
 
-	bool NeedUpdate = false;
+	std::vector<int> PendingGlyphs;
+
+	// The part of Buffer that changed since the atlas was last uploaded.
+	unsigned DirtyLeft = 0;
+	unsigned DirtyTop = 0;
+	unsigned DirtyRight = 0;
+	unsigned DirtyBottom = 0;
+	bool NeedRecreate = false;
 
-	bool InitGlyphMap(Font* font);
-	void FreeGlyphMap();
-	void LoadGlyphs();
+	bool BeginPacking();
+	bool Grow();
+	bool PackFamilyGlyphs(FontFamily* family, std::vector<int>& codepoints);
+	void MarkDirty(unsigned left, unsigned top, unsigned right, unsigned bottom);
+	bool UploadAtlas(Font* font);
 
 public:
 	unsigned ID = 0;
 	unsigned AtlasSize = 0;
+	unsigned MaxAtlasSize = 0;
 
 	float FontSize;
 	int FontIndex;
@@ -70,10 +76,13 @@ public:
 	bool UseAntialiasing;
 	Uint8 PixelCoverageThreshold;
 
-	std::unordered_map<FontFamily*, PackedGlyphs> GlyphsPerFamily;
 	std::unordered_map<Uint32, FontGlyph> Glyphs;
 
-	void* PackedChars = nullptr;
+	// Glyphs that were packed by the last update, and the ones that didn't
+	// fit into this page.
+	std::vector<Uint32> NewGlyphs;
+	std::vector<Uint32> Overflow;
+
 	Texture* Atlas = nullptr;
 
 	bool Init();
@@ -81,6 +90,7 @@ public:
 	bool Update(Font* font);
 	void ReloadAtlas();
 	void AddGlyph(Uint32 codepoint);
+	bool IsEmpty();
 
 	FontGlyphRange(unsigned id);
 	~FontGlyphRange();
@@ -98,10 +108,10 @@ private:
 	FontGlyphRange* FindGlyphInRange(Uint32 codepoint);
 	FontGlyphRange* NewRange();
 	FontGlyphRange* GetRangeForNewGlyph();
+	unsigned GetMaxAtlasSize();
 
 	void LoadGlyphsFromRange(FontGlyphRange* range);
-
-	bool IsGlyphLoaded(Uint32 codepoint);
+	void AddGlyphsToSprite(FontGlyphRange* range);
 
 	void InitSprite();
 	void UpdateSprite();
@@ -125,6 +135,9 @@ public:
 
 	int FontIndex;
 
+	// Changes every time the glyphs are reloaded.
+	Uint32 Generation = 0;
+
 	bool LoadFailed;
 
 	Font();
@@ -145,8 +158,10 @@ public:
 
 	bool IsValidCodepoint(Uint32 codepoint);
 	bool HasGlyph(Uint32 codepoint);
+	bool IsGlyphLoaded(Uint32 codepoint);
 	bool RequestGlyph(Uint32 codepoint);
 	float GetGlyphAdvance(Uint32 codepoint);
+	float GetKerning(Uint32 left, Uint32 right);
 	float GetEllipsisWidth();
 	void Update();
 
@@ -154,6 +169,12 @@ public:
 
 	static Uint32*
 	GenerateAtlas(Uint8* data, unsigned size, bool useAntialias, Uint8 threshold);
+	static Uint32* GenerateAtlas(Uint8* data,
+		unsigned width,
+		unsigned height,
+		unsigned pitch,
+		bool useAntialias,
+		Uint8 threshold);
 	static Texture*
 	CreateAtlasTexture(Uint8* data, unsigned size, bool useAntialias, Uint8 threshold);
 
@@ -14,6 +14,23 @@
 #include <Engine/Utilities/StringUtils.h>
 
 IModel::IModel(const char* filename) {
+	Init();
+
+	ResourceStream* resourceStream = ResourceStream::New(filename);
+	if (!resourceStream) {
+		return;
+	}
+
+	LoadFailed = !Load(resourceStream, filename);
+
+	resourceStream->Close();
+}
+IModel::IModel(Stream* stream, const char* filename) {
+	Init();
+
+	LoadFailed = !Load(stream, filename);
+}
+void IModel::Init() {
 	VertexCount = 0;
 	VertexIndexCount = 0;
 	VertexPerFace = 0;
@@ -28,15 +45,6 @@ IModel::IModel(const char* filename) {
 	UseVertexAnimation = false;
 
 	LoadFailed = true;
-
-	ResourceStream* resourceStream = ResourceStream::New(filename);
-	if (!resourceStream) {
-		return;
-	}
-
-	LoadFailed = !Load(resourceStream, filename);
-
-	resourceStream->Close();
 }
 bool IModel::IsFile(Stream* stream) {
 	if (HatchModel::IsMagic(stream)) {
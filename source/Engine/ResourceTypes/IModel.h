@@ -10,6 +10,7 @@
 
 class IModel {
 private:
+	void Init();
 	void UpdateChannel(Matrix4x4* out, NodeAnim* channel, Uint32 frame);
 
 public:
@@ -26,6 +27,7 @@ public:
 	bool LoadFailed;
 
 	IModel(const char* filename);
+	IModel(Stream* stream, const char* filename);
 	static bool IsFile(Stream* stream);
 	bool Load(Stream* stream, const char* filename);
 	size_t FindMaterial(const char* name);
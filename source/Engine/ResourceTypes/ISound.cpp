@@ -1,4 +1,5 @@
 #include <Engine/Audio/AudioIncludes.h>
+#include <Engine/Audio/AudioStreamDecoder.h>
 #include <Engine/Diagnostics/Clock.h>
 #include <Engine/Diagnostics/Log.h>
 #include <Engine/Diagnostics/Memory.h>
@@ -9,6 +10,10 @@
 #include <Engine/ResourceTypes/SoundFormats/OGG.h>
 #include <Engine/ResourceTypes/SoundFormats/WAV.h>
 
+#define SOUND_CONVERSION_CHUNK_SAMPLES 4096
+
+std::atomic<size_t> ISound::TotalConvertedSize{0};
+
 ISound::ISound(const char* filename) {
 	ISound::Load(filename, true);
 }
@@ -97,7 +102,7 @@ void ISound::Load(const char* filename, bool streamFromFile) {
 	if (!StreamFromFile) {
 		ticks = Clock::GetTicks();
 
-		SoundData->LoadSamples(SoundData->TotalPossibleSamples);
+		SoundData->LoadAllSamples();
 		SoundData->Close();
 
 		Log::Print(Log::LOG_VERBOSE,
@@ -106,9 +111,126 @@ void ISound::Load(const char* filename, bool streamFromFile) {
 	}
 
 	BytesPerSample = ((Format.format & 0xFF) >> 3) * Format.channels;
+
+	if (!StreamFromFile) {
+		ticks = Clock::GetTicks();
+
+		if (ConvertToDeviceFormat()) {
+			Log::Print(Log::LOG_VERBOSE,
+				"Conversion to device format took %.3f ms (%d bytes)",
+				Clock::GetTicks() - ticks,
+				(int)ConvertedSize);
+		}
+	}
+
 	LoadFailed = false;
 }
 
+// Fully loaded sounds are converted to the device's format once, so that
+// playing them never needs a conversion stream. Streamed sounds are still
+// converted as they are played.
+// Loop points keep being given in samples of the original file, and
+// SampleScale turns them into samples of the converted data.
+bool ISound::ConvertToDeviceFormat() {
+	SDL_AudioSpec& device = AudioManager::DeviceFormat;
+	if (!AudioManager::AudioEnabled || !SoundData || device.freq <= 0) {
+		return false;
+	}
+
+	if (Format.freq == device.freq && Format.format == device.format &&
+		Format.channels == device.channels) {
+		return false;
+	}
+
+	size_t numSourceSamples = SoundData->Samples.size();
+	size_t sourceSampleSize = SoundData->SampleSize;
+	if (numSourceSamples == 0) {
+		return false;
+	}
+
+	SDL_AudioStream* conversion = SDL_NewAudioStream(Format.format,
+		Format.channels,
+		Format.freq,
+		device.format,
+		device.channels,
+		device.freq);
+	if (!conversion) {
+		Log::Print(Log::LOG_WARN,
+			"Could not convert \"%s\" to the device format: %s",
+			Filename,
+			SDL_GetError());
+		return false;
+	}
+
+	Uint8* chunk =
+		(Uint8*)Memory::Malloc(SOUND_CONVERSION_CHUNK_SAMPLES * sourceSampleSize);
+	bool failed = false;
+	for (size_t i = 0; i < numSourceSamples && !failed;) {
+		size_t count = std::min((size_t)SOUND_CONVERSION_CHUNK_SAMPLES, numSourceSamples - i);
+		for (size_t j = 0; j < count; j++, i++) {
+			memcpy(chunk + j * sourceSampleSize, SoundData->Samples[i], sourceSampleSize);
+		}
+
+		if (SDL_AudioStreamPut(conversion, chunk, (int)(count * sourceSampleSize)) < 0) {
+			failed = true;
+		}
+	}
+	Memory::Free(chunk);
+
+	if (!failed && SDL_AudioStreamFlush(conversion) < 0) {
+		failed = true;
+	}
+
+	size_t sampleSize = AudioManager::BytesPerSample;
+	size_t numSamples = 0;
+	if (!failed) {
+		numSamples = SDL_AudioStreamAvailable(conversion) / sampleSize;
+	}
+	if (numSamples == 0) {
+		SDL_FreeAudioStream(conversion);
+		return false;
+	}
+
+	size_t dataSize = numSamples * sampleSize;
+	Uint8* data = (Uint8*)Memory::TrackedMalloc("ISound::ConvertedSamples", dataSize);
+	int received = SDL_AudioStreamGet(conversion, data, (int)dataSize);
+	SDL_FreeAudioStream(conversion);
+
+	if (received <= 0) {
+		Memory::Free(data);
+		return false;
+	}
+
+	numSamples = received / sampleSize;
+	dataSize = numSamples * sampleSize;
+
+	SampleScale = (double)device.freq / Format.freq;
+
+	SoundFormat* converted = new SoundFormat;
+	converted->InputFormat = device;
+	converted->SampleSize = sampleSize;
+	converted->SampleBuffer = data;
+	converted->TotalPossibleSamples = (int)numSamples;
+	converted->Samples.reserve(numSamples);
+	for (size_t i = 0; i < numSamples; i++) {
+		converted->Samples.push_back(data + i * sampleSize);
+	}
+	if (SoundData->LoopPoint >= 0) {
+		converted->LoopPoint = (int)(SoundData->LoopPoint * SampleScale);
+	}
+
+	SoundData->Dispose();
+	delete SoundData;
+	SoundData = converted;
+
+	Format = device;
+	BytesPerSample = sampleSize;
+	ConvertedSize = dataSize;
+	TotalConvertedSize += dataSize;
+
+	return true;
+}
+
 AudioPlayback* ISound::CreatePlayer() {
 	int requiredSamples = AudioManager::DeviceFormat.samples * AUDIO_FIRST_LOAD_SAMPLE_BOOST;
 
@@ -116,11 +238,49 @@ AudioPlayback* ISound::CreatePlayer() {
 		Format, requiredSamples, BytesPerSample, AudioManager::BytesPerSample);
 	playback->SoundData = SoundData;
 	playback->OwnsSoundData = false;
+	playback->SampleScale = SampleScale;
+
+	// Streamed sounds are decoded on the stream decoder thread, from a
+	// decoder of their own.
+	if (StreamFromFile && AudioStreamDecoder::IsRunning()) {
+		SoundFormat* soundData = OpenStream();
+		if (soundData) {
+			if (!playback->StartStreaming(soundData)) {
+				soundData->Dispose();
+				delete soundData;
+			}
+		}
+	}
 
 	return playback;
 }
+SoundFormat* ISound::OpenStream() {
+	Stream* stream = ResourceStream::New(Filename);
+	if (!stream) {
+		return nullptr;
+	}
+
+	Uint8 format = DetectFormat(stream);
+	stream->Seek(0);
+
+	SoundFormat* soundData = nullptr;
+	if (format == AUDIO_FORMAT_OGG) {
+		soundData = OGG::Load(stream);
+	}
+	else if (format == AUDIO_FORMAT_WAV) {
+		soundData = WAV::Load(stream);
+	}
+	else {
+		stream->Close();
+	}
+
+	return soundData;
+}
 
 void ISound::Dispose() {
+	TotalConvertedSize -= ConvertedSize;
+	ConvertedSize = 0;
+
 	if (SoundData) {
 		SoundData->Dispose();
 		delete SoundData;
@@ -8,12 +8,18 @@
 #include <Engine/Includes/StandardSDL2.h>
 #include <Engine/ResourceTypes/SoundFormats/SoundFormat.h>
 
+#include <atomic>
+
 enum { AUDIO_FORMAT_UNKNOWN, AUDIO_FORMAT_OGG, AUDIO_FORMAT_WAV };
 
 #define AUDIO_LOOP_NONE (-2)
 #define AUDIO_LOOP_DEFAULT (-1)
 
 class ISound {
+private:
+	SoundFormat* OpenStream();
+	bool ConvertToDeviceFormat();
+
 public:
 	SDL_AudioSpec Format;
 	int BytesPerSample;
@@ -22,6 +28,10 @@ public:
 	char* Filename = NULL;
 	bool LoadFailed = false;
 	bool StreamFromFile = false;
+	double SampleScale = 1.0;
+	size_t ConvertedSize = 0;
+
+	static std::atomic<size_t> TotalConvertedSize;
 
 	ISound(const char* filename);
 	ISound(const char* filename, bool streamFromFile);
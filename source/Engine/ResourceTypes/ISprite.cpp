@@ -12,6 +12,8 @@
 
 #include <Engine/IO/FileStream.h>
 #include <Engine/IO/ResourceStream.h>
+#include <Engine/IO/StreamReader.h>
+#include <Engine/Rendering/SpriteAtlas.h>
 
 #include <Engine/Utilities/StringUtils.h>
 
@@ -164,6 +166,12 @@ void ISprite::RefreshGraphicsID() {
 }
 
 void ISprite::ConvertToNonIndexed(Uint32* palColors, unsigned numPaletteColors) {
+	// Atlas pages are shared with other sprites, so the sprite gets its own
+	// sheets back before they're converted.
+	if (!SpriteAtlas::Unpack(this)) {
+		return;
+	}
+
 	for (int a = 0; a < Spritesheets.size(); a++) {
 		Uint32* palette = palColors;
 		if (!palette) {
@@ -182,6 +190,10 @@ void ISprite::ConvertToNonIndexed(Uint32* palColors, unsigned numPaletteColors)
 	}
 }
 void ISprite::ConvertToIndexed(Uint32* palColors, unsigned numPaletteColors) {
+	if (!SpriteAtlas::Unpack(this)) {
+		return;
+	}
+
 	int transparent = 0;
 	if (palColors != nullptr) {
 		transparent = Graphics::GetPaletteTransparentColor(palColors, numPaletteColors);
@@ -202,12 +214,84 @@ void ISprite::ConvertToIndexed(Uint32* palColors, unsigned numPaletteColors) {
 bool ISprite::IsFile(Stream* stream) {
 	return stream->ReadUInt32() == RSDK_SPRITE_MAGIC;
 }
+std::string ISprite::ResolveSpritesheetPath(const char* filename, const char* sheet) {
+	char fullPath[MAX_RESOURCE_PATH_LENGTH];
+
+	// Spritesheet path is relative to where the animation
+	// file is
+	if (StringUtils::StartsWith(sheet, "./")) {
+		char* parentPath = StringUtils::GetPath(filename);
+		if (parentPath) {
+			snprintf(fullPath, sizeof fullPath, "%s/%s", parentPath, sheet + 2);
+			Memory::Free(parentPath);
+		}
+		else {
+			snprintf(fullPath, sizeof fullPath, "%s", sheet + 2);
+		}
+	}
+	else {
+		StringUtils::Copy(fullPath, sheet, sizeof fullPath);
+	}
+
+	// Replace '\' with '/'
+	StringUtils::ReplacePathSeparatorsInPlace(fullPath);
+
+	std::string sheetName = std::string(fullPath);
+
+	// If the resource doesn't exist, and the path doesn't begin with 'Sprites/' or 'sprites/'
+	if (!ResourceManager::ResourceExists(sheetName.c_str()) &&
+		!StringUtils::StartsWithCaseInsensitive(sheetName.c_str(), "Sprites/")) {
+		std::string altered = Path::Normalize(Path::Concat("Sprites", sheetName));
+
+		// Try with 'sprites/' if the above doesn't exist
+		if (!ResourceManager::ResourceExists(altered.c_str())) {
+			altered = Path::Normalize(Path::Concat("sprites", sheetName));
+		}
+
+		return altered;
+	}
+
+	return sheetName;
+}
+// Only reads which spritesheets the animation file uses, so that they can be
+// decoded ahead of time. Doesn't touch the renderer.
+bool ISprite::GetSpritesheetPaths(const char* filename, vector<std::string>* paths) {
+	Stream* stream = ResourceStream::New(filename);
+	if (!stream) {
+		return false;
+	}
+
+	if (!IsFile(stream)) {
+		stream->Close();
+		return false;
+	}
+
+	StreamReader reader(stream);
+
+	// Total frame count
+	reader.ReadUInt32();
+
+	unsigned spritesheetCount = reader.ReadByte();
+	for (unsigned i = 0; i < spritesheetCount; i++) {
+		char* str = reader.ReadHeaderedString();
+		std::string sheetName = ResolveSpritesheetPath(filename, str);
+		Memory::Free(str);
+
+		char* normalized = StringUtils::NormalizePath(sheetName.c_str());
+		paths->push_back(std::string(normalized));
+		Memory::Free(normalized);
+	}
+
+	reader.Close();
+
+	return true;
+}
 bool ISprite::LoadAnimation(const char* filename) {
 	char* str;
 	int animationCount, previousAnimationCount;
 
-	Stream* reader = ResourceStream::New(filename);
-	if (!reader) {
+	Stream* stream = ResourceStream::New(filename);
+	if (!stream) {
 		Log::Print(Log::LOG_ERROR, "Couldn't open file '%s'!", filename);
 		return false;
 	}
@@ -217,77 +301,44 @@ bool ISprite::LoadAnimation(const char* filename) {
 #endif
 
 	// Check MAGIC
-	if (!IsFile(reader)) {
-		reader->Close();
+	if (!IsFile(stream)) {
+		stream->Close();
 		return false;
 	}
 
+	StreamReader reader(stream);
+
 	// Total frame count
-	reader->ReadUInt32();
+	reader.ReadUInt32();
 
 	// Get texture count
-	unsigned spritesheetCount = reader->ReadByte();
+	unsigned spritesheetCount = reader.ReadByte();
 
 	// Load textures
 	for (int i = 0; i < spritesheetCount; i++) {
-		char fullPath[MAX_RESOURCE_PATH_LENGTH];
-
-		str = reader->ReadHeaderedString();
+		str = reader.ReadHeaderedString();
 
-		// Spritesheet path is relative to where the animation
-		// file is
-		if (StringUtils::StartsWith(str, "./")) {
-			char* parentPath = StringUtils::GetPath(filename);
-			if (parentPath) {
-				snprintf(fullPath, sizeof fullPath, "%s/%s", parentPath, str + 2);
-				Memory::Free(parentPath);
-			}
-			else {
-				snprintf(fullPath, sizeof fullPath, "%s", str + 2);
-			}
-		}
-		else {
-			StringUtils::Copy(fullPath, str, sizeof fullPath);
-		}
+		std::string sheetName = ResolveSpritesheetPath(filename, str);
 
 		Memory::Free(str);
 
-		// Replace '\' with '/'
-		StringUtils::ReplacePathSeparatorsInPlace(fullPath);
-
-		std::string sheetName = std::string(fullPath);
-
 #ifdef ISPRITE_DEBUG
 		Log::Print(Log::LOG_VERBOSE, " - %s", sheetName.c_str());
 #endif
 
-		// If the resource doesn't exist, and the path doesn't begin with 'Sprites/' or 'sprites/'
-		if (!ResourceManager::ResourceExists(sheetName.c_str()) &&
-			!StringUtils::StartsWithCaseInsensitive(sheetName.c_str(), "Sprites/")) {
-			std::string altered = Path::Normalize(Path::Concat("Sprites", sheetName));
-
-			// Try with 'sprites/' if the above doesn't exist
-			if (!ResourceManager::ResourceExists(altered.c_str())) {
-				altered = Path::Normalize(Path::Concat("sprites", sheetName));
-			}
-
-			AddSpriteSheet(altered.c_str());
-		}
-		else {
-			AddSpriteSheet(sheetName.c_str());
-		}
+		AddSpriteSheet(sheetName.c_str());
 	}
 
 	// Get collision group count
-	int hitboxCount = reader->ReadByte();
+	int hitboxCount = reader.ReadByte();
 
 	// Read collision groups names
 	std::vector<char*> hitboxNames;
 	for (int i = 0; i < hitboxCount; i++) {
-		hitboxNames.push_back(reader->ReadHeaderedString());
+		hitboxNames.push_back(reader.ReadHeaderedString());
 	}
 
-	animationCount = reader->ReadUInt16();
+	animationCount = reader.ReadUInt16();
 	previousAnimationCount = (int)Animations.size();
 	Animations.resize(previousAnimationCount + animationCount);
 
@@ -295,11 +346,11 @@ bool ISprite::LoadAnimation(const char* filename) {
 	int frameID = 0;
 	for (int a = 0; a < animationCount; a++) {
 		Animation an;
-		an.Name = reader->ReadHeaderedString();
-		an.FrameCount = reader->ReadUInt16();
+		an.Name = reader.ReadHeaderedString();
+		an.FrameCount = reader.ReadUInt16();
 		an.FrameListOffset = frameID;
-		an.AnimationSpeed = reader->ReadUInt16();
-		an.FrameToLoop = reader->ReadByte();
+		an.AnimationSpeed = reader.ReadUInt16();
+		an.FrameToLoop = reader.ReadByte();
 
 		// 0: No rotation
 		// 1: Full rotation
@@ -307,7 +358,7 @@ bool ISprite::LoadAnimation(const char* filename) {
 		// 3: Snaps to multiples of 90 degrees
 		// 4: Snaps to multiples of 180 degrees
 		// 5: Static rotation using extra frames
-		an.Flags = reader->ReadByte();
+		an.Flags = reader.ReadByte();
 
 #ifdef ISPRITE_DEBUG
 		Log::Print(Log::LOG_VERBOSE,
@@ -324,7 +375,7 @@ bool ISprite::LoadAnimation(const char* filename) {
 
 		for (int i = 0; i < an.FrameCount; i++) {
 			AnimFrame anfrm;
-			anfrm.SheetNumber = reader->ReadByte();
+			anfrm.SheetNumber = reader.ReadByte();
 			frameID++;
 
 			if (anfrm.SheetNumber >= Spritesheets.size()) {
@@ -336,22 +387,22 @@ bool ISprite::LoadAnimation(const char* filename) {
 					i);
 			}
 
-			anfrm.Duration = reader->ReadInt16();
-			anfrm.Advance = reader->ReadUInt16();
-			anfrm.X = reader->ReadUInt16();
-			anfrm.Y = reader->ReadUInt16();
-			anfrm.Width = reader->ReadUInt16();
-			anfrm.Height = reader->ReadUInt16();
-			anfrm.OffsetX = reader->ReadInt16();
-			anfrm.OffsetY = reader->ReadInt16();
+			anfrm.Duration = reader.ReadInt16();
+			anfrm.Advance = reader.ReadUInt16();
+			anfrm.X = reader.ReadUInt16();
+			anfrm.Y = reader.ReadUInt16();
+			anfrm.Width = reader.ReadUInt16();
+			anfrm.Height = reader.ReadUInt16();
+			anfrm.OffsetX = reader.ReadInt16();
+			anfrm.OffsetY = reader.ReadInt16();
 
 			for (int h = 0; h < hitboxCount; h++) {
 				CollisionBox box;
 				box.Name = std::string(hitboxNames[h]);
-				box.Left = reader->ReadInt16();
-				box.Top = reader->ReadInt16();
-				box.Right = reader->ReadInt16();
-				box.Bottom = reader->ReadInt16();
+				box.Left = reader.ReadInt16();
+				box.Top = reader.ReadInt16();
+				box.Right = reader.ReadInt16();
+				box.Bottom = reader.ReadInt16();
 				anfrm.Boxes.push_back(box);
 			}
 
@@ -379,7 +430,7 @@ bool ISprite::LoadAnimation(const char* filename) {
 		Memory::Free(hitboxNames[i]);
 	}
 
-	reader->Close();
+	reader.Close();
 
 	return true;
 }
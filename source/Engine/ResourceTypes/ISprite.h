@@ -57,6 +57,8 @@ public:
 	void ConvertToNonIndexed(Uint32* palColors, unsigned numPaletteColors);
 	void ConvertToIndexed(Uint32* palColors, unsigned numPaletteColors);
 	static bool IsFile(Stream* stream);
+	static std::string ResolveSpritesheetPath(const char* filename, const char* sheet);
+	static bool GetSpritesheetPaths(const char* filename, vector<std::string>* paths);
 	bool LoadAnimation(const char* filename);
 	int FindAnimation(const char* animname);
 	void LinkAnimation(vector<Animation> ani);
@@ -82,7 +82,9 @@ bool Image::IsFile(Stream* stream) {
 	return DetectFormat(stream) != IMAGE_FORMAT_UNKNOWN;
 }
 
-Texture* Image::LoadTextureFromResource(const char* filename) {
+// Reads and decodes the image into memory, without creating a texture.
+// This doesn't touch the renderer, so it may be called from any thread.
+bool Image::Decode(const char* filename, ImageData* image) {
 	Uint8* data = NULL;
 	Uint32 width = 0;
 	Uint32 height = 0;
@@ -96,16 +98,17 @@ Texture* Image::LoadTextureFromResource(const char* filename) {
 		stream->Seek(0);
 	}
 	else {
-		return NULL;
+		return false;
 	}
 
+	double ticks = Clock::GetTicks();
+
 	if (format == IMAGE_FORMAT_PNG) {
-		Clock::Start();
 		PNG* png = PNG::Load(stream);
 		if (png) {
 			Log::Print(Log::LOG_VERBOSE,
 				"PNG load took %.3f ms (%s)",
-				Clock::End(),
+				Clock::GetTicks() - ticks,
 				filename);
 			width = (Uint32)png->Width;
 			height = (Uint32)png->Height;
@@ -123,16 +126,15 @@ Texture* Image::LoadTextureFromResource(const char* filename) {
 		else {
 			stream->Close();
 			Log::Print(Log::LOG_ERROR, "PNG \"%s\" could not be loaded!", filename);
-			return NULL;
+			return false;
 		}
 	}
 	else if (format == IMAGE_FORMAT_JPEG) {
-		Clock::Start();
 		JPEG* jpeg = JPEG::Load(stream);
 		if (jpeg) {
 			Log::Print(Log::LOG_VERBOSE,
 				"JPEG load took %.3f ms (%s)",
-				Clock::End(),
+				Clock::GetTicks() - ticks,
 				filename);
 			width = (Uint32)jpeg->Width;
 			height = (Uint32)jpeg->Height;
@@ -145,16 +147,15 @@ Texture* Image::LoadTextureFromResource(const char* filename) {
 		else {
 			stream->Close();
 			Log::Print(Log::LOG_ERROR, "JPEG \"%s\" could not be loaded!", filename);
-			return NULL;
+			return false;
 		}
 	}
 	else if (format == IMAGE_FORMAT_GIF) {
-		Clock::Start();
 		GIF* gif = GIF::Load(stream);
 		if (gif) {
 			Log::Print(Log::LOG_VERBOSE,
 				"GIF load took %.3f ms (%s)",
-				Clock::End(),
+				Clock::GetTicks() - ticks,
 				filename);
 			width = (Uint32)gif->Width;
 			height = (Uint32)gif->Height;
@@ -172,17 +173,31 @@ Texture* Image::LoadTextureFromResource(const char* filename) {
 		else {
 			stream->Close();
 			Log::Print(Log::LOG_ERROR, "GIF \"%s\" could not be loaded!", filename);
-			return NULL;
+			return false;
 		}
 	}
 	else {
 		stream->Close();
 		Log::Print(Log::LOG_ERROR, "Unsupported image format for file \"%s\"!", filename);
-		return NULL;
+		return false;
 	}
 
 	stream->Close();
 
+	image->Data = data;
+	image->Width = width;
+	image->Height = height;
+	image->PaletteColors = paletteColors;
+	image->NumPaletteColors = numPaletteColors;
+
+	return true;
+}
+
+// Creates a texture out of decoded image data, which is consumed.
+Texture* Image::CreateTexture(ImageData* image, const char* filename) {
+	Uint32 width = image->Width;
+	Uint32 height = image->Height;
+
 	if (width > Graphics::MaxTextureWidth || height > Graphics::MaxTextureHeight) {
 		Log::Print(Log::LOG_WARN,
 			"Image file \"%s\" of size %d x %d is larger than maximum size of %d x %d!",
@@ -193,13 +208,34 @@ Texture* Image::LoadTextureFromResource(const char* filename) {
 			Graphics::MaxTextureHeight);
 	}
 
-	Uint32 textureFormat = paletteColors ? TextureFormat_INDEXED : Graphics::TextureFormat;
+	Uint32 textureFormat =
+		image->PaletteColors ? TextureFormat_INDEXED : Graphics::TextureFormat;
 	unsigned bpp = Texture::GetFormatBytesPerPixel(textureFormat);
 	Texture* texture = Graphics::CreateTextureFromPixels(
-		textureFormat, width, height, data, width * bpp);
-	Graphics::SetTexturePalette(texture, paletteColors, numPaletteColors);
+		textureFormat, width, height, image->Data, width * bpp);
+	if (texture) {
+		// The texture takes ownership of the palette.
+		Graphics::SetTexturePalette(texture, image->PaletteColors, image->NumPaletteColors);
+		image->PaletteColors = nullptr;
+	}
 
-	Memory::Free(data);
+	FreeData(image);
 
 	return texture;
 }
+
+void Image::FreeData(ImageData* image) {
+	Memory::Free(image->Data);
+	Memory::Free(image->PaletteColors);
+	image->Data = nullptr;
+	image->PaletteColors = nullptr;
+}
+
+Texture* Image::LoadTextureFromResource(const char* filename) {
+	ImageData image;
+	if (!Decode(filename, &image)) {
+		return NULL;
+	}
+
+	return CreateTexture(&image, filename);
+}
@@ -7,6 +7,14 @@
 
 enum { IMAGE_FORMAT_UNKNOWN, IMAGE_FORMAT_PNG, IMAGE_FORMAT_GIF, IMAGE_FORMAT_JPEG };
 
+struct ImageData {
+	Uint8* Data = nullptr;
+	Uint32 Width = 0;
+	Uint32 Height = 0;
+	Uint32* PaletteColors = nullptr;
+	unsigned NumPaletteColors = 0;
+};
+
 class Image {
 public:
 	int ID = -1;
@@ -23,6 +31,9 @@ public:
 
 	static Uint8 DetectFormat(Stream* stream);
 	static bool IsFile(Stream* stream);
+	static bool Decode(const char* filename, ImageData* image);
+	static Texture* CreateTexture(ImageData* image, const char* filename);
+	static void FreeData(ImageData* image);
 	static Texture* LoadTextureFromResource(const char* filename);
 };
 
@@ -8,6 +8,8 @@
 #include <Engine/Filesystem/VFS/VirtualFileSystem.h>
 #include <Engine/IO/FileStream.h>
 
+#include <mutex>
+
 #define RESOURCES_VFS_NAME "main"
 
 #define RESOURCES_DIR_PATH "Resources"
@@ -15,6 +17,9 @@
 VirtualFileSystem* vfs = nullptr;
 VFSProvider* mainResource = nullptr;
 
+// Resources are also loaded from the asynchronous loader's threads.
+static std::recursive_mutex VFSLock;
+
 bool ResourceManager::UsingDataFolder = false;
 char ResourceManager::DataFolderPath[MAX_PATH_LENGTH];
 
@@ -199,6 +204,8 @@ bool ResourceManager::Mount(const char* name,
 	const char* mountPoint,
 	VFSType type,
 	Uint16 flags) {
+	std::lock_guard<std::recursive_mutex> lock(VFSLock);
+
 	VFSMountStatus status = vfs->Mount(name, filename, mountPoint, type, flags);
 
 	if (status == VFSMountStatus::NOT_FOUND) {
@@ -211,6 +218,8 @@ bool ResourceManager::Mount(const char* name,
 	return status == VFSMountStatus::MOUNTED;
 }
 bool ResourceManager::Unmount(const char* name) {
+	std::lock_guard<std::recursive_mutex> lock(VFSLock);
+
 	if (vfs == nullptr) {
 		return false;
 	}
@@ -250,18 +259,36 @@ void ResourceManager::SetMainResourceWritable(bool writable) {
 }
 
 bool ResourceManager::LoadResource(const char* filename, Uint8** out, size_t* size) {
+	std::lock_guard<std::recursive_mutex> lock(VFSLock);
+
 	if (vfs) {
 		return vfs->LoadFile(filename, out, size);
 	}
 	return false;
 }
+bool ResourceManager::LoadResource(const char* filename,
+	Uint8** out,
+	size_t* size,
+	MappedFile** mapping,
+	Stream** stream) {
+	std::lock_guard<std::recursive_mutex> lock(VFSLock);
+
+	if (vfs) {
+		return vfs->LoadFile(filename, out, size, mapping, stream);
+	}
+	return false;
+}
 bool ResourceManager::ResourceExists(const char* filename) {
+	std::lock_guard<std::recursive_mutex> lock(VFSLock);
+
 	if (vfs) {
 		return vfs->FileExists(filename);
 	}
 	return false;
 }
 void ResourceManager::Dispose() {
+	std::lock_guard<std::recursive_mutex> lock(VFSLock);
+
 	delete vfs;
 	vfs = nullptr;
 	mainResource = nullptr;
@@ -22,6 +22,11 @@ public:
 	static VFSProvider* GetMainResource();
 	static void SetMainResourceWritable(bool writable);
 	static bool LoadResource(const char* filename, Uint8** out, size_t* size);
+	static bool LoadResource(const char* filename,
+		Uint8** out,
+		size_t* size,
+		MappedFile** mapping,
+		Stream** stream);
 	static bool ResourceExists(const char* filename);
 	static void Dispose();
 };
@@ -4,14 +4,23 @@
 #include <Engine/Diagnostics/Log.h>
 #include <Engine/Diagnostics/Memory.h>
 #include <Engine/Error.h>
-#include <Engine/Hashing/CRC32.h>
 #include <Engine/Hashing/MD5.h>
+#include <Engine/Hashing/Murmur.h>
 #include <Engine/IO/ResourceStream.h>
 #include <Engine/Scene.h>
 #include <Engine/Scene/SceneLayer.h>
+#include <Engine/ResourceTypes/SceneFormats/TileLayerDecoder.h>
 #include <Engine/Scene/TileLayer.h>
 #include <Engine/Types/Entity.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HSCN_READER_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define HSCN_READER_NEON
+#include <arm_neon.h>
+#endif
+
 Uint32 HatchSceneReader::Magic = 0x4E435348; // HSCN
 
 #define HSCN_EMPTY_TILE 0xFFFFFFFFU
@@ -33,7 +42,10 @@ bool HatchSceneReader::Read(const char* filename, const char* parentFolder) {
 	return HatchSceneReader::Read(r, parentFolder);
 }
 
-bool HatchSceneReader::Read(Stream* r, const char* parentFolder) {
+bool HatchSceneReader::Read(Stream* stream, const char* parentFolder) {
+	StreamReader reader(stream);
+	StreamReader* r = &reader;
+
 	// Start reading
 	if (r->ReadUInt32() != HatchSceneReader::Magic) {
 		Log::Print(Log::LOG_ERROR, "Not a Hatch scene!");
@@ -93,6 +105,9 @@ bool HatchSceneReader::Read(Stream* r, const char* parentFolder) {
 		Scene::AddLayer(layer);
 	}
 
+	// Inflate and convert the tile data of every layer
+	TileLayerDecoder::Run();
+
 	// Read classes and entities
 	HatchSceneReader::ReadClasses(r);
 	HatchSceneReader::ReadEntities(r);
@@ -103,7 +118,7 @@ bool HatchSceneReader::Read(Stream* r, const char* parentFolder) {
 	return true;
 }
 
-TileLayer* HatchSceneReader::ReadLayer(Stream* r) {
+TileLayer* HatchSceneReader::ReadLayer(StreamReader* r) {
 	char* name = r->ReadHeaderedString();
 	Uint8 drawBehavior = r->ReadByte();
 	Uint8 drawGroup = r->ReadByte();
@@ -149,66 +164,115 @@ TileLayer* HatchSceneReader::ReadLayer(Stream* r) {
 	// Read scroll data
 	HatchSceneReader::ReadScrollData(r, layer);
 
-	// Read and convert tile data
+	// Read tile data. It's converted later, along with every other layer's.
 	HatchSceneReader::ReadTileData(r, layer);
-	HatchSceneReader::ConvertTileData(layer);
-
-	memcpy(layer->TilesBackup, layer->Tiles, layer->DataSize);
 
 	return layer;
 }
 
-void HatchSceneReader::ReadTileData(Stream* r, TileLayer* layer) {
-	size_t streamPos = r->Position();
-
-	r->ReadUInt32(); // compressed size
-	Uint32 layerUncompSize = r->ReadUInt32BE();
-
-	r->Seek(streamPos);
-
+void HatchSceneReader::ReadTileData(StreamReader* r, TileLayer* layer) {
 	Uint32 dataSize = layer->DataSize;
+	Uint32 layerUncompSize = TileLayerDecoder::Read(
+		r, layer->Tiles, dataSize, layer, HatchSceneReader::ConvertTileData);
 	if (layerUncompSize > dataSize) {
 		Log::Print(Log::LOG_WARN,
 			"Layer has more stored tile data (%u) than allocated (%u)\n",
 			layerUncompSize,
 			dataSize);
 	}
-
-	r->ReadCompressed(layer->Tiles, dataSize);
 }
 
-void HatchSceneReader::ConvertTileData(TileLayer* layer) {
-	for (size_t i = 0; i < (size_t)layer->Width * layer->Height; i++) {
-		if (layer->Tiles[i] == HSCN_EMPTY_TILE) {
-			layer->Tiles[i] = Scene::EmptyTile;
-			continue;
-		}
+// Converts a single tile. Both the empty tile marker and tile IDs past the
+// end of the tileset become the empty tile.
+static inline Uint32 ConvertTile(Uint32 value, Uint32 tileCount, Uint32 emptyTile) {
+	Uint32 tile = value & HSCN_IDENT_MASK;
+	if (value == HSCN_EMPTY_TILE || tile >= tileCount) {
+		return emptyTile;
+	}
 
-		Uint32 tileID = (layer->Tiles[i] & HSCN_FXYID_MASK);
-		Uint32 tile = tileID & 0xFFF;
-		if (tile >= Scene::TileSpriteInfos.size()) {
-			layer->Tiles[i] = Scene::EmptyTile;
-			continue;
-		}
+	tile |= (value & HSCN_FLIPX_MASK) << 19;
+	tile |= (value & HSCN_FLIPY_MASK) << 17;
+	tile |= (value & HSCN_COLLA_MASK) << 14;
+	tile |= (value & HSCN_COLLB_MASK) << 10;
 
-		if (layer->Tiles[i] & HSCN_FLIPX_MASK) {
-			tile |= TILE_FLIPX_MASK;
-		}
-		if (layer->Tiles[i] & HSCN_FLIPY_MASK) {
-			tile |= TILE_FLIPY_MASK;
-		}
+	return tile;
+}
 
-		Uint32 collA = (layer->Tiles[i] & HSCN_COLLA_MASK) >> 14;
-		Uint32 collB = (layer->Tiles[i] & HSCN_COLLB_MASK) >> 16;
+// Runs on a tile layer decoder thread. Fills in TilesBackup in the same pass.
+void HatchSceneReader::ConvertTileData(TileLayer* layer, void* data, size_t size) {
+	Uint32* tiles = (Uint32*)data;
+	Uint32* backup = layer->TilesBackup;
+	size_t count = (size_t)layer->Width * layer->Height;
+	Uint32 tileCount = (Uint32)Scene::TileSpriteInfos.size();
+	Uint32 emptyTile = (Uint32)Scene::EmptyTile;
+	if (tileCount > HSCN_IDENT_MASK + 1) {
+		tileCount = HSCN_IDENT_MASK + 1;
+	}
 
-		tile |= (collA << 28);
-		tile |= (collB << 26);
+	size_t i = 0;
+
+#if defined(HSCN_READER_SSE2)
+	const __m128i identMask = _mm_set1_epi32(HSCN_IDENT_MASK);
+	const __m128i flipXMask = _mm_set1_epi32(HSCN_FLIPX_MASK);
+	const __m128i flipYMask = _mm_set1_epi32(HSCN_FLIPY_MASK);
+	const __m128i collAMask = _mm_set1_epi32(HSCN_COLLA_MASK);
+	const __m128i collBMask = _mm_set1_epi32(HSCN_COLLB_MASK);
+	const __m128i emptyMarker = _mm_set1_epi32(HSCN_EMPTY_TILE);
+	const __m128i tileCountV = _mm_set1_epi32(tileCount);
+	const __m128i emptyTileV = _mm_set1_epi32(emptyTile);
+	for (; i + 4 <= count; i += 4) {
+		__m128i value = _mm_loadu_si128((__m128i*)&tiles[i]);
+		__m128i tile = _mm_and_si128(value, identMask);
+		__m128i empty = _mm_or_si128(_mm_cmpeq_epi32(value, emptyMarker),
+			_mm_cmpgt_epi32(_mm_add_epi32(tile, _mm_set1_epi32(1)), tileCountV));
+
+		tile = _mm_or_si128(tile, _mm_slli_epi32(_mm_and_si128(value, flipXMask), 19));
+		tile = _mm_or_si128(tile, _mm_slli_epi32(_mm_and_si128(value, flipYMask), 17));
+		tile = _mm_or_si128(tile, _mm_slli_epi32(_mm_and_si128(value, collAMask), 14));
+		tile = _mm_or_si128(tile, _mm_slli_epi32(_mm_and_si128(value, collBMask), 10));
+		tile = _mm_or_si128(_mm_and_si128(empty, emptyTileV), _mm_andnot_si128(empty, tile));
+
+		_mm_storeu_si128((__m128i*)&tiles[i], tile);
+		_mm_storeu_si128((__m128i*)&backup[i], tile);
+	}
+#elif defined(HSCN_READER_NEON)
+	const uint32x4_t identMask = vdupq_n_u32(HSCN_IDENT_MASK);
+	const uint32x4_t flipXMask = vdupq_n_u32(HSCN_FLIPX_MASK);
+	const uint32x4_t flipYMask = vdupq_n_u32(HSCN_FLIPY_MASK);
+	const uint32x4_t collAMask = vdupq_n_u32(HSCN_COLLA_MASK);
+	const uint32x4_t collBMask = vdupq_n_u32(HSCN_COLLB_MASK);
+	const uint32x4_t emptyMarker = vdupq_n_u32(HSCN_EMPTY_TILE);
+	const uint32x4_t tileCountV = vdupq_n_u32(tileCount);
+	const uint32x4_t emptyTileV = vdupq_n_u32(emptyTile);
+	for (; i + 4 <= count; i += 4) {
+		uint32x4_t value = vld1q_u32(&tiles[i]);
+		uint32x4_t tile = vandq_u32(value, identMask);
+		uint32x4_t empty =
+			vorrq_u32(vceqq_u32(value, emptyMarker), vcgeq_u32(tile, tileCountV));
+
+		tile = vorrq_u32(tile, vshlq_n_u32(vandq_u32(value, flipXMask), 19));
+		tile = vorrq_u32(tile, vshlq_n_u32(vandq_u32(value, flipYMask), 17));
+		tile = vorrq_u32(tile, vshlq_n_u32(vandq_u32(value, collAMask), 14));
+		tile = vorrq_u32(tile, vshlq_n_u32(vandq_u32(value, collBMask), 10));
+		tile = vbslq_u32(empty, emptyTileV, tile);
+
+		vst1q_u32(&tiles[i], tile);
+		vst1q_u32(&backup[i], tile);
+	}
+#endif
+
+	for (; i < count; i++) {
+		tiles[i] = ConvertTile(tiles[i], tileCount, emptyTile);
+		backup[i] = tiles[i];
+	}
 
-		layer->Tiles[i] = tile;
+	// Anything past the stored tiles is kept as it was read.
+	if (size > count * sizeof(Uint32)) {
+		memcpy(&backup[count], &tiles[count], size - count * sizeof(Uint32));
 	}
 }
 
-void HatchSceneReader::ReadScrollData(Stream* r, TileLayer* layer) {
+void HatchSceneReader::ReadScrollData(StreamReader* r, TileLayer* layer) {
 	for (int i = 0; i < layer->ScrollInfoCount; i++) {
 		ScrollingInfo* info = &layer->ScrollInfos[i];
 
@@ -222,28 +286,32 @@ void HatchSceneReader::ReadScrollData(Stream* r, TileLayer* layer) {
 		r->ReadByte(); // ?
 	}
 
-	size_t streamPos = r->Position();
-
-	r->ReadUInt32(); // compressed size
-	Uint32 layerUncompSize = r->ReadUInt32BE();
-
-	r->Seek(streamPos);
-
 	Uint32 dataSize = layer->ScrollIndexCount * 16;
+	layer->ScrollIndexes = (Uint8*)Memory::Malloc(dataSize);
+
+	Uint32 layerUncompSize = TileLayerDecoder::Read(r, layer->ScrollIndexes, dataSize);
 	if (layerUncompSize > dataSize) {
 		Log::Print(Log::LOG_WARN,
 			"Layer has more stored scroll indexes (%u) than allocated (%u)\n",
 			layerUncompSize,
 			dataSize);
 	}
-
-	layer->ScrollIndexes = (Uint8*)Memory::Malloc(dataSize);
-	r->ReadCompressed(layer->ScrollIndexes, dataSize);
 }
 
 static vector<SceneClass> SceneClasses;
 
+// Maps the first word of a class's hash to its index in SceneClasses. The
+// hashes are MD5 digests, so the first word alone is almost always unique;
+// FindClass still compares the full hash and falls back to a linear search.
+static HashMap<Uint16>* SceneClassIndexes = nullptr;
+
 SceneClass* HatchSceneReader::FindClass(SceneHash hash) {
+	Uint16 index;
+	if (SceneClassIndexes && SceneClassIndexes->GetIfExists(hash.A, &index) &&
+		SceneClasses[index].Hash == hash) {
+		return &SceneClasses[index];
+	}
+
 	for (size_t i = 0; i < SceneClasses.size(); i++) {
 		if (SceneClasses[i].Hash == hash) {
 			return &SceneClasses[i];
@@ -253,7 +321,14 @@ SceneClass* HatchSceneReader::FindClass(SceneHash hash) {
 	return NULL;
 }
 
-SceneClassProperty* HatchSceneReader::FindProperty(SceneClass* scnClass, SceneHash hash) {
+SceneClassProperty*
+HatchSceneReader::FindProperty(SceneClass* scnClass, SceneHash hash, Uint8 index) {
+	// Entities list their properties in the order the class declares them,
+	// so the property at the same position is checked first.
+	if (index < scnClass->Properties.size() && scnClass->Properties[index].Hash == hash) {
+		return &scnClass->Properties[index];
+	}
+
 	for (size_t i = 0; i < scnClass->Properties.size(); i++) {
 		if (scnClass->Properties[i].Hash == hash) {
 			return &scnClass->Properties[i];
@@ -274,10 +349,17 @@ void HatchSceneReader::HashString(char* string, SceneHash* hash) {
 	hash->D = final[12] + (final[13] << 8) + (final[14] << 16) + (final[15] << 24);
 }
 
-void HatchSceneReader::ReadClasses(Stream* r) {
+void HatchSceneReader::ReadClasses(StreamReader* r) {
 	Uint16 numClasses = r->ReadUInt16();
 
 	SceneClasses.clear();
+	SceneClasses.reserve(numClasses);
+
+	if (!SceneClassIndexes) {
+		SceneClassIndexes = new HashMap<Uint16>(NULL, numClasses);
+	}
+	SceneClassIndexes->Clear();
+	SceneClassIndexes->Reserve(numClasses);
 
 	for (Uint16 i = 0; i < numClasses; i++) {
 		char* className = r->ReadHeaderedString();
@@ -286,6 +368,9 @@ void HatchSceneReader::ReadClasses(Stream* r) {
 		SceneClass scnClass;
 		scnClass.Name = className;
 		scnClass.Properties.clear();
+		scnClass.Properties.reserve(numProps);
+		scnClass.List = nullptr;
+		scnClass.ListResolved = false;
 
 		HatchSceneReader::HashString(className, &scnClass.Hash); // Create hash
 
@@ -307,6 +392,7 @@ void HatchSceneReader::ReadClasses(Stream* r) {
 			SceneClassProperty prop;
 			prop.Name = propName;
 			prop.Type = propType;
+			prop.NameHash = Murmur::EncryptData(propName, strlen(propName));
 
 			HatchSceneReader::HashString(propName, &prop.Hash); // Create hash
 
@@ -337,6 +423,10 @@ void HatchSceneReader::ReadClasses(Stream* r) {
 			scnClass.Properties.push_back(prop);
 		}
 
+		if (!SceneClassIndexes->Exists(scnClass.Hash.A)) {
+			SceneClassIndexes->Put(scnClass.Hash.A, i);
+		}
+
 		SceneClasses.push_back(scnClass);
 	}
 }
@@ -351,6 +441,10 @@ void HatchSceneReader::FreeClasses() {
 	}
 
 	SceneClasses.clear();
+
+	if (SceneClassIndexes) {
+		SceneClassIndexes->Clear();
+	}
 }
 
 bool HatchSceneReader::LoadTileset(const char* parentFolder) {
@@ -415,9 +509,11 @@ bool HatchSceneReader::LoadTileset(const char* parentFolder) {
 	return true;
 }
 
-void HatchSceneReader::ReadEntities(Stream* r) {
+void HatchSceneReader::ReadEntities(StreamReader* r) {
 	Uint16 numEntities = r->ReadUInt16();
 
+	static Uint32 filterHash = Murmur::EncryptData("filter", strlen("filter"));
+
 	for (Uint16 i = 0; i < numEntities; i++) {
 		SceneHash classHash;
 		classHash.A = r->ReadUInt32();
@@ -454,8 +550,6 @@ void HatchSceneReader::ReadEntities(Stream* r) {
 			continue;
 		}
 
-		// Get the correct object list from the class name
-		Uint32 objectHash = CRC32::EncryptData(&classHash.A, 16);
 		char* objectName = scnClass->Name;
 
 		if (!filter) {
@@ -467,8 +561,15 @@ void HatchSceneReader::ReadEntities(Stream* r) {
 			continue;
 		}
 
+		// Get the correct object list from the class name. This is only
+		// done for the first entity of each class.
+		if (!scnClass->ListResolved) {
+			scnClass->List = Scene::GetStaticObjectList(objectName);
+			scnClass->ListResolved = true;
+		}
+
 		// Spawn the object, if the class exists
-		ObjectList* objectList = Scene::GetStaticObjectList(objectName);
+		ObjectList* objectList = scnClass->List;
 		if (!objectList) {
 			Log::Print(Log::LOG_WARN,
 				"Class \"%s\" does not exist! (ID: %d, X: %f, Y: %f)",
@@ -476,6 +577,7 @@ void HatchSceneReader::ReadEntities(Stream* r) {
 				(int)i,
 				posX,
 				posY);
+			HatchSceneReader::SkipEntityProperties(r, numProps);
 			continue;
 		}
 
@@ -489,10 +591,11 @@ void HatchSceneReader::ReadEntities(Stream* r) {
 
 		obj->SlotID = (int)i + Scene::ReservedSlotIDs;
 		obj->InitProperties();
+		obj->Properties->Reserve(obj->Properties->Count() + numProps + 1);
 
 		// Add "filter" property
 		obj->Filter = filter;
-		obj->Properties->Put("filter", Property::MakeInteger(filter));
+		obj->Properties->Put(filterHash, Property::MakeInteger(filter));
 
 		// Add all properties
 		for (Uint8 j = 0; j < numProps; j++) {
@@ -506,7 +609,7 @@ void HatchSceneReader::ReadEntities(Stream* r) {
 
 			// Find the class property from the hash
 			SceneClassProperty* classProp =
-				HatchSceneReader::FindProperty(scnClass, propHash);
+				HatchSceneReader::FindProperty(scnClass, propHash, j);
 			if (!classProp) {
 #ifdef HSCN_READER_DEBUG
 				Log::Print(Log::LOG_WARN,
@@ -584,12 +687,12 @@ void HatchSceneReader::ReadEntities(Stream* r) {
 				break;
 			}
 
-			obj->Properties->Put(classProp->Name, val);
+			obj->Properties->Put(classProp->NameHash, val);
 		}
 	}
 }
 
-void HatchSceneReader::SkipEntityProperties(Stream* r, Uint8 numProps) {
+void HatchSceneReader::SkipEntityProperties(StreamReader* r, Uint8 numProps) {
 	for (Uint8 j = 0; j < numProps; j++) {
 		r->ReadUInt32();
 		r->ReadUInt32();
@@ -599,7 +702,7 @@ void HatchSceneReader::SkipEntityProperties(Stream* r, Uint8 numProps) {
 	}
 }
 
-void HatchSceneReader::SkipProperty(Stream* r, Uint8 varType) {
+void HatchSceneReader::SkipProperty(StreamReader* r, Uint8 varType) {
 	switch (varType) {
 	case HSCN_VAR_INT8:
 	case HSCN_VAR_UINT8:
@@ -2,24 +2,25 @@
 #define ENGINE_RESOURCETYPES_SCENEFORMATS_HATCHSCENEREADER_H
 
 #include <Engine/IO/ResourceStream.h>
+#include <Engine/IO/StreamReader.h>
 #include <Engine/ResourceTypes/SceneFormats/HatchSceneTypes.h>
 #include <Engine/Scene/TileLayer.h>
 
 class HatchSceneReader {
 private:
-	static TileLayer* ReadLayer(Stream* r);
-	static void ReadTileData(Stream* r, TileLayer* layer);
-	static void ConvertTileData(TileLayer* layer);
-	static void ReadScrollData(Stream* r, TileLayer* layer);
+	static TileLayer* ReadLayer(StreamReader* r);
+	static void ReadTileData(StreamReader* r, TileLayer* layer);
+	static void ConvertTileData(TileLayer* layer, void* data, size_t size);
+	static void ReadScrollData(StreamReader* r, TileLayer* layer);
 	static SceneClass* FindClass(SceneHash hash);
-	static SceneClassProperty* FindProperty(SceneClass* scnClass, SceneHash hash);
+	static SceneClassProperty* FindProperty(SceneClass* scnClass, SceneHash hash, Uint8 index);
 	static void HashString(char* string, SceneHash* hash);
-	static void ReadClasses(Stream* r);
+	static void ReadClasses(StreamReader* r);
 	static void FreeClasses();
 	static bool LoadTileset(const char* parentFolder);
-	static void ReadEntities(Stream* r);
-	static void SkipEntityProperties(Stream* r, Uint8 numProps);
-	static void SkipProperty(Stream* r, Uint8 varType);
+	static void ReadEntities(StreamReader* r);
+	static void SkipEntityProperties(StreamReader* r, Uint8 numProps);
+	static void SkipProperty(StreamReader* r, Uint8 varType);
 
 public:
 	static Uint32 Magic;
@@ -1,6 +1,8 @@
 #ifndef HATCH_SCENE_TYPES_H
 #define HATCH_SCENE_TYPES_H
 
+#include <Engine/Types/ObjectList.h>
+
 struct SceneHash {
 	Uint32 A, B, C, D;
 
@@ -10,6 +12,7 @@ struct SceneHash {
 
 struct SceneClassProperty {
 	char* Name;
+	Uint32 NameHash;
 	SceneHash Hash;
 	Uint8 Type;
 };
@@ -33,6 +36,8 @@ struct SceneClass {
 	char* Name;
 	SceneHash Hash;
 	vector<SceneClassProperty> Properties;
+	ObjectList* List;
+	bool ListResolved;
 };
 
 #endif // HATCH_SCENE_TYPES_H
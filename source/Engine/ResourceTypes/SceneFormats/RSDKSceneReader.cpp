@@ -12,6 +12,7 @@
 #include <Engine/Includes/HashMap.h>
 #include <Engine/ResourceTypes/ImageFormats/GIF.h>
 #include <Engine/ResourceTypes/ResourceManager.h>
+#include <Engine/ResourceTypes/SceneFormats/TileLayerDecoder.h>
 #include <Engine/Scene.h>
 #include <Engine/Scene/SceneLayer.h>
 #include <Engine/Scene/TileLayer.h>
@@ -289,16 +290,20 @@ TileLayer* RSDKSceneReader::ReadLayer(Stream* r) {
 		r->ReadByte();
 	}
 
-	Uint16* tileBoys = (Uint16*)malloc(sizeof(Uint16) * Width * Height);
-
-	Uint32 scrollIndexRead = r->ReadCompressed(layer->ScrollIndexes, 16 * layer->HeightData);
+	// Both are inflated later, along with every other layer's data.
+	Uint32 scrollIndexRead =
+		TileLayerDecoder::Read(r, layer->ScrollIndexes, 16 * layer->HeightData);
 	if (scrollIndexRead > 16 * layer->HeightData) {
 		Log::Print(Log::LOG_ERROR,
 			"Read more parallax indexes (%u) than buffer (%d) allows!",
 			scrollIndexRead,
 			16 * layer->HeightData);
 	}
-	Uint32 tileBoysRead = r->ReadCompressed(tileBoys, sizeof(Uint16) * Width * Height);
+	Uint32 tileBoysRead = TileLayerDecoder::Read(r,
+		nullptr,
+		sizeof(Uint16) * Width * Height,
+		layer,
+		RSDKSceneReader::ConvertTileData);
 	if (tileBoysRead > sizeof(Uint16) * Width * Height) {
 		Log::Print(Log::LOG_ERROR,
 			"Read more tile data (%u) than buffer (%d) allows!",
@@ -306,25 +311,29 @@ TileLayer* RSDKSceneReader::ReadLayer(Stream* r) {
 			sizeof(Uint16) * Width * Height);
 	}
 
-	// Convert to Hatch tiles
-	int t = 0;
+	return layer;
+}
+// Runs on a tile layer decoder thread. Converts to Hatch tiles, and fills in
+// TilesBackup in the same pass.
+void RSDKSceneReader::ConvertTileData(TileLayer* layer, void* data, size_t size) {
+	Uint16* tileBoys = (Uint16*)data;
 	Uint32* tileRow = &layer->Tiles[0];
+	Uint32* backupRow = &layer->TilesBackup[0];
 	for (int y = 0; y < layer->Height; y++) {
 		for (int x = 0; x < layer->Width; x++) {
-			tileRow[x] = (tileBoys[t] & 0x3FF);
-			tileRow[x] |= (tileBoys[t] & 0x400) << 21; // Flip X
-			tileRow[x] |= (tileBoys[t] & 0x800) << 19; // Flip Y
-			tileRow[x] |= (tileBoys[t] & 0xC000) << 12; // Collision B
-			tileRow[x] |= (tileBoys[t] & 0x3000) << 16; // Collision A
-			t++;
+			Uint32 tile = tileBoys[x];
+			Uint32 converted = (tile & 0x3FF);
+			converted |= (tile & 0x400) << 21; // Flip X
+			converted |= (tile & 0x800) << 19; // Flip Y
+			converted |= (tile & 0xC000) << 12; // Collision B
+			converted |= (tile & 0x3000) << 16; // Collision A
+			tileRow[x] = converted;
+			backupRow[x] = converted;
 		}
+		tileBoys += layer->Width;
 		tileRow += layer->WidthData;
+		backupRow += layer->WidthData;
 	}
-	memcpy(layer->TilesBackup, layer->Tiles, layer->DataSize);
-
-	free(tileBoys);
-
-	return layer;
 }
 bool RSDKSceneReader::ReadObjectDefinition(Stream* r, Entity** objSlots, const int maxObjSlots) {
 	Uint8 hashTemp[16];
@@ -645,6 +654,8 @@ bool RSDKSceneReader::Read(Stream* r, const char* parentFolder) {
 		Scene::AddLayer(layer);
 	}
 
+	TileLayerDecoder::Run();
+
 	ticks = Clock::GetTicks() - ticks;
 	Log::Print(Log::LOG_VERBOSE, "Scene Layer load took %.3f milliseconds.", ticks);
 
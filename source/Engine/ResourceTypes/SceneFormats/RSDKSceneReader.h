@@ -10,6 +10,7 @@ private:
 	static void LoadObjectList();
 	static void LoadPropertyList();
 	static TileLayer* ReadLayer(Stream* r);
+	static void ConvertTileData(TileLayer* layer, void* data, size_t size);
 	static bool LoadTileset(const char* parentFolder);
 
 public:
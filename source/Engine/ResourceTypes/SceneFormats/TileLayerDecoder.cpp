@@ -0,0 +1,146 @@
+#include <Engine/ResourceTypes/SceneFormats/TileLayerDecoder.h>
+
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Memory.h>
+#include <Engine/Diagnostics/Profiler.h>
+#include <Engine/IO/Compression/ZLibStream.h>
+
+vector<TileLayerDecodeJob> TileLayerDecoder::Jobs;
+SDL_atomic_t TileLayerDecoder::NextJob;
+
+bool TileLayerDecoder::Parallel = true;
+
+// Stream and StreamReader have the same read calls, so both overloads of
+// Read share this.
+template<typename T> Uint32 TileLayerDecoder::ReadPayload(T* r,
+	void* out,
+	size_t outSize,
+	TileLayer* layer,
+	TileLayerConvertFunc convert) {
+	Uint32 compressedSize = r->ReadUInt32() - 4;
+	Uint32 uncompressedSize = r->ReadUInt32BE();
+
+	void* compressed = Memory::Malloc(compressedSize);
+	r->ReadBytes(compressed, compressedSize);
+
+	Queue(compressed, compressedSize, out, outSize, layer, convert);
+
+	return uncompressedSize;
+}
+
+Uint32 TileLayerDecoder::Read(Stream* r,
+	void* out,
+	size_t outSize,
+	TileLayer* layer,
+	TileLayerConvertFunc convert) {
+	return ReadPayload(r, out, outSize, layer, convert);
+}
+Uint32 TileLayerDecoder::Read(StreamReader* r,
+	void* out,
+	size_t outSize,
+	TileLayer* layer,
+	TileLayerConvertFunc convert) {
+	return ReadPayload(r, out, outSize, layer, convert);
+}
+
+// If out is null, the data is inflated into a temporary buffer that is freed
+// once it's been converted.
+void TileLayerDecoder::Queue(void* compressed,
+	size_t compressedSize,
+	void* out,
+	size_t outSize,
+	TileLayer* layer,
+	TileLayerConvertFunc convert) {
+	TileLayerDecodeJob job;
+	job.Layer = layer;
+	job.Compressed = compressed;
+	job.CompressedSize = compressedSize;
+	job.Out = out;
+	job.OutSize = outSize;
+	job.OwnsOut = out == nullptr;
+	job.Convert = convert;
+
+	if (job.OwnsOut) {
+		job.Out = Memory::Calloc(1, outSize);
+	}
+
+	Jobs.push_back(job);
+}
+
+void TileLayerDecoder::RunJobs() {
+	while (true) {
+		int index = SDL_AtomicAdd(&NextJob, 1);
+		if (index >= (int)Jobs.size()) {
+			break;
+		}
+
+		TileLayerDecodeJob* job = &Jobs[index];
+
+		PROFILE_ZONE("Decode Tile Layer");
+
+		ZLibStream::Decompress(job->Out, job->OutSize, job->Compressed, job->CompressedSize);
+
+		if (job->Convert) {
+			job->Convert(job->Layer, job->Out, job->OutSize);
+		}
+	}
+}
+int TileLayerDecoder::ThreadFunc(void* data) {
+	PROFILE_THREAD("Tile Layer Decoder");
+
+	RunJobs();
+
+	return 0;
+}
+
+// Inflates and converts everything that was queued, and waits for it to
+// finish. The calling thread takes jobs too.
+void TileLayerDecoder::Run() {
+	if (Jobs.size() == 0) {
+		return;
+	}
+
+	PROFILE_ZONE("TileLayerDecoder::Run");
+
+	SDL_AtomicSet(&NextJob, 0);
+
+	int threadCount = 0;
+	if (Parallel) {
+		threadCount = SDL_GetCPUCount() - 1;
+		if (threadCount > (int)Jobs.size() - 1) {
+			threadCount = (int)Jobs.size() - 1;
+		}
+		if (threadCount > TILE_LAYER_DECODER_MAX_THREADS) {
+			threadCount = TILE_LAYER_DECODER_MAX_THREADS;
+		}
+	}
+
+	SDL_Thread* threads[TILE_LAYER_DECODER_MAX_THREADS];
+	int numThreads = 0;
+	for (int i = 0; i < threadCount; i++) {
+		SDL_Thread* thread =
+			SDL_CreateThread(TileLayerDecoder::ThreadFunc, "TileLayerDecoder::ThreadFunc", NULL);
+		if (thread == NULL) {
+			Log::Print(Log::LOG_WARN,
+				"Unable to create a tile layer decoder thread: %s",
+				SDL_GetError());
+			break;
+		}
+		threads[numThreads++] = thread;
+	}
+
+	RunJobs();
+
+	for (int i = 0; i < numThreads; i++) {
+		SDL_WaitThread(threads[i], NULL);
+	}
+
+	for (size_t i = 0; i < Jobs.size(); i++) {
+		Memory::Free(Jobs[i].Compressed);
+		if (Jobs[i].OwnsOut) {
+			Memory::Free(Jobs[i].Out);
+		}
+	}
+
+	Jobs.clear();
+}
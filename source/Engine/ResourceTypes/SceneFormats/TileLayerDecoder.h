@@ -0,0 +1,64 @@
+#ifndef ENGINE_RESOURCETYPES_SCENEFORMATS_TILELAYERDECODER_H
+#define ENGINE_RESOURCETYPES_SCENEFORMATS_TILELAYERDECODER_H
+
+#include <Engine/IO/Stream.h>
+#include <Engine/IO/StreamReader.h>
+#include <Engine/Includes/Standard.h>
+#include <Engine/Includes/StandardSDL2.h>
+#include <Engine/Scene/TileLayer.h>
+
+#define TILE_LAYER_DECODER_MAX_THREADS 8
+
+// Called on whichever thread inflated the data. It must only touch the layer
+// it was queued for.
+typedef void (*TileLayerConvertFunc)(TileLayer* layer, void* data, size_t size);
+
+struct TileLayerDecodeJob {
+	TileLayer* Layer;
+	void* Compressed;
+	size_t CompressedSize;
+	void* Out;
+	size_t OutSize;
+	bool OwnsOut;
+	TileLayerConvertFunc Convert;
+};
+
+// Scene readers queue the compressed payloads of their layers as they read
+// them, and then inflate and convert all of them at once. Compressed data is
+// read from the stream up front, so the stream is not touched by the workers.
+class TileLayerDecoder {
+private:
+	static vector<TileLayerDecodeJob> Jobs;
+	static SDL_atomic_t NextJob;
+
+	template<typename T> static Uint32 ReadPayload(T* r,
+		void* out,
+		size_t outSize,
+		TileLayer* layer,
+		TileLayerConvertFunc convert);
+	static void Queue(void* compressed,
+		size_t compressedSize,
+		void* out,
+		size_t outSize,
+		TileLayer* layer,
+		TileLayerConvertFunc convert);
+	static void RunJobs();
+	static int ThreadFunc(void* data);
+
+public:
+	static bool Parallel;
+
+	static Uint32 Read(Stream* r,
+		void* out,
+		size_t outSize,
+		TileLayer* layer = nullptr,
+		TileLayerConvertFunc convert = nullptr);
+	static Uint32 Read(StreamReader* r,
+		void* out,
+		size_t outSize,
+		TileLayer* layer = nullptr,
+		TileLayerConvertFunc convert = nullptr);
+	static void Run();
+};
+
+#endif /* ENGINE_RESOURCETYPES_SCENEFORMATS_TILELAYERDECODER_H */
@@ -0,0 +1,417 @@
+#include <Engine/ResourceTypes/SceneFormats/TiledMapCache.h>
+
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Memory.h>
+#include <Engine/Hashing/Murmur.h>
+#include <Engine/IO/FileStream.h>
+#include <Engine/IO/ResourceStream.h>
+#include <Engine/Includes/Endian.h>
+#include <Engine/ResourceTypes/ResourceManager.h>
+#include <Engine/TextFormats/XML/XMLParser.h>
+#include <Engine/Utilities/StringUtils.h>
+
+#define TILED_MAP_CACHE_MAGIC MAGIC_LE32("HTMC")
+
+// Deeper trees than this are assumed to come from a corrupt file.
+#define TILED_MAP_CACHE_MAX_DEPTH 256
+
+Uint8* TiledMapCache::Data = nullptr;
+size_t TiledMapCache::DataSize = 0;
+vector<TiledMapCacheTileset> TiledMapCache::Tilesets;
+
+bool TiledMapCache::Compiling = false;
+char TiledMapCache::Filename[MAX_RESOURCE_PATH_LENGTH];
+Uint32 TiledMapCache::SourceHash = 0;
+MemoryStream* TiledMapCache::TilesetData = nullptr;
+Uint32 TiledMapCache::TilesetCount = 0;
+vector<TiledMapCacheLayerData> TiledMapCache::LayerData;
+
+bool TiledMapCache::Enabled = true;
+
+Uint32 TiledMapCache::Hash(const void* data, size_t size) {
+	return Murmur::EncryptData(data, size);
+}
+
+void TiledMapCache::GetCachePath(const char* sourceF, char* buffer, size_t size) {
+	snprintf(buffer, size, "cache://TiledMap_%08X.bin", Hash(sourceF, strlen(sourceF)));
+}
+
+bool TiledMapCache::HashResource(const char* filename, Uint32* hash) {
+	Uint8* data;
+	size_t size;
+	if (!ResourceManager::LoadResource(filename, &data, &size)) {
+		return false;
+	}
+
+	*hash = Hash(data, size);
+
+	Memory::Free(data);
+
+	return true;
+}
+
+// Reads a resource into a text stream that can be given to the XML parser,
+// and hashes its contents.
+TextStream* TiledMapCache::LoadSource(const char* filename, Uint32* hash) {
+	ResourceStream* res = ResourceStream::New(filename);
+	if (!res) {
+		return nullptr;
+	}
+
+	TextStream* textStream = TextStream::New(res);
+	res->Close();
+
+	if (!textStream) {
+		return nullptr;
+	}
+
+	// The text stream has an extra byte for the terminator.
+	*hash = Hash(textStream->pointer_start, textStream->size - 1);
+
+	return textStream;
+}
+
+// Strings are stored with their length, and are terminated so that the
+// tokens pointing to them can be read like the ones from the XML parser.
+void TiledMapCache::WriteString(Stream* stream, const char* string, size_t length) {
+	stream->WriteUInt32((Uint32)length);
+	if (length) {
+		stream->WriteBytes((void*)string, length);
+	}
+	stream->WriteByte(0);
+}
+void TiledMapCache::WriteNode(Stream* stream, XMLNode* node) {
+	// Tile layer data is written as it was decoded.
+	for (size_t i = 0; i < LayerData.size(); i++) {
+		if (LayerData[i].Node != node) {
+			continue;
+		}
+
+		WriteString(stream, node->name.Start, node->name.Length);
+		stream->WriteUInt32(1);
+		WriteString(stream, "encoding", 8);
+		WriteString(stream, "raw", 3);
+		stream->WriteUInt32(1);
+		WriteString(stream, (const char*)LayerData[i].Data, LayerData[i].Size);
+		stream->WriteUInt32(0);
+		stream->WriteUInt32(0);
+		return;
+	}
+
+	WriteString(stream, node->name.Start, node->name.Length);
+
+	XMLAttributes* attributes = &node->attributes;
+	stream->WriteUInt32((Uint32)attributes->KeyVector.size());
+	for (size_t i = 0; i < attributes->KeyVector.size(); i++) {
+		char* key = attributes->KeyVector[i];
+		Token value = attributes->Get(key);
+		WriteString(stream, key, strlen(key));
+		WriteString(stream, value.Start, value.Length);
+	}
+
+	stream->WriteUInt32((Uint32)node->children.size());
+	for (size_t i = 0; i < node->children.size(); i++) {
+		WriteNode(stream, node->children[i]);
+	}
+}
+
+// The cache has no alignment, so numbers are copied out of it.
+static Uint32 ReadUInt32(Uint8* data) {
+	Uint32 value;
+	memcpy(&value, data, sizeof value);
+	return FROM_LE32(value);
+}
+
+bool TiledMapCache::ReadString(Uint8** cursor, Uint8* end, char** string, Uint32* length) {
+	if (end - *cursor < 4) {
+		return false;
+	}
+
+	Uint32 len = ReadUInt32(*cursor);
+	*cursor += 4;
+
+	if ((size_t)(end - *cursor) < (size_t)len + 1 || (*cursor)[len] != 0) {
+		return false;
+	}
+
+	*string = (char*)*cursor;
+	*length = len;
+	*cursor += len + 1;
+
+	return true;
+}
+XMLNode* TiledMapCache::ReadNode(Uint8** cursor, Uint8* end, XMLNode* parent, int depth) {
+	if (depth > TILED_MAP_CACHE_MAX_DEPTH) {
+		return nullptr;
+	}
+
+	XMLNode* node = new (std::nothrow) XMLNode;
+	if (!node) {
+		return nullptr;
+	}
+
+	node->parent = parent;
+	node->base_stream = NULL;
+	node->name = {};
+
+	char* string;
+	Uint32 length;
+	Uint32 count;
+
+	if (!ReadString(cursor, end, &string, &length)) {
+		goto FAIL;
+	}
+
+	node->name.Start = string;
+	node->name.Length = length;
+
+	if (end - *cursor < 4) {
+		goto FAIL;
+	}
+	count = ReadUInt32(*cursor);
+	*cursor += 4;
+
+	for (Uint32 i = 0; i < count; i++) {
+		char* key;
+		Uint32 keyLength;
+		if (!ReadString(cursor, end, &key, &keyLength) ||
+			!ReadString(cursor, end, &string, &length)) {
+			goto FAIL;
+		}
+
+		Token value = {};
+		value.Start = string;
+		value.Length = length;
+		node->attributes.Put(StringUtils::Duplicate(key), value);
+	}
+
+	if (end - *cursor < 4) {
+		goto FAIL;
+	}
+	count = ReadUInt32(*cursor);
+	*cursor += 4;
+
+	for (Uint32 i = 0; i < count; i++) {
+		XMLNode* child = ReadNode(cursor, end, node, depth + 1);
+		if (!child) {
+			goto FAIL;
+		}
+		node->children.push_back(child);
+	}
+
+	return node;
+
+FAIL:
+	XMLParser::Free(node);
+	return nullptr;
+}
+
+XMLNode* TiledMapCache::ReadFile(const char* sourceF, Uint32 sourceHash) {
+	char cachePath[MAX_PATH_LENGTH];
+	GetCachePath(sourceF, cachePath, sizeof cachePath);
+
+	Stream* stream = FileStream::New(cachePath, FileStream::READ_ACCESS, true);
+	if (!stream) {
+		return nullptr;
+	}
+
+	DataSize = stream->Length();
+	Data = (Uint8*)Memory::Malloc(DataSize);
+	if (!Data) {
+		stream->Close();
+		return nullptr;
+	}
+
+	stream->ReadBytes(Data, DataSize);
+	stream->Close();
+
+	Uint8* cursor = Data;
+	Uint8* end = Data + DataSize;
+
+	if (DataSize < 16) {
+		return nullptr;
+	}
+
+	Uint32 magic = ReadUInt32(cursor + 0);
+	Uint32 version = ReadUInt32(cursor + 4);
+	Uint32 hash = ReadUInt32(cursor + 8);
+	Uint32 tilesetCount = ReadUInt32(cursor + 12);
+	cursor += 16;
+
+	if (magic != TILED_MAP_CACHE_MAGIC || version != TILED_MAP_CACHE_VERSION) {
+		return nullptr;
+	}
+	if (hash != sourceHash) {
+		Log::Print(Log::LOG_VERBOSE, "Tiled map \"%s\" changed since it was cached.", sourceF);
+		return nullptr;
+	}
+
+	for (Uint32 i = 0; i < tilesetCount; i++) {
+		char* path;
+		Uint32 pathLength;
+		if (!ReadString(&cursor, end, &path, &pathLength) || end - cursor < 4) {
+			return nullptr;
+		}
+
+		Uint32 tilesetHash = ReadUInt32(cursor);
+		cursor += 4;
+
+		// Any external tileset that changed makes the whole cache stale.
+		Uint32 currentHash;
+		if (!HashResource(path, &currentHash) || currentHash != tilesetHash) {
+			Log::Print(Log::LOG_VERBOSE,
+				"Tileset \"%s\" changed since \"%s\" was cached.",
+				path,
+				sourceF);
+			return nullptr;
+		}
+
+		TiledMapCacheTileset tileset;
+		tileset.Path = path;
+		tileset.Hash = tilesetHash;
+		tileset.Root = ReadNode(&cursor, end, nullptr, 0);
+		if (!tileset.Root) {
+			return nullptr;
+		}
+
+		Tilesets.push_back(tileset);
+	}
+
+	// The map's tree follows the tilesets.
+	return ReadNode(&cursor, end, nullptr, 0);
+}
+
+// Returns the cached tree of a map, or null if there is no cache for it, or
+// if the cache is out of date. The tree must be freed with XMLParser::Free.
+XMLNode* TiledMapCache::Open(const char* sourceF, Uint32 sourceHash) {
+	if (!Enabled) {
+		return nullptr;
+	}
+
+	Close();
+
+	XMLNode* map = ReadFile(sourceF, sourceHash);
+	if (!map) {
+		Close();
+	}
+
+	return map;
+}
+
+// Hands over the cached tree of an external tileset. It must be freed with
+// XMLParser::Free.
+XMLNode* TiledMapCache::GetTileset(const char* path) {
+	for (size_t i = 0; i < Tilesets.size(); i++) {
+		if (Tilesets[i].Root && !strcmp(Tilesets[i].Path, path)) {
+			XMLNode* root = Tilesets[i].Root;
+			Tilesets[i].Root = nullptr;
+			return root;
+		}
+	}
+
+	return nullptr;
+}
+
+void TiledMapCache::BeginCompile(const char* sourceF, Uint32 sourceHash) {
+	Close();
+
+	if (!Enabled) {
+		return;
+	}
+
+	TilesetData = MemoryStream::New(0x1000);
+	if (!TilesetData) {
+		return;
+	}
+
+	StringUtils::Copy(Filename, sourceF, sizeof Filename);
+	SourceHash = sourceHash;
+	TilesetCount = 0;
+	Compiling = true;
+}
+bool TiledMapCache::IsCompiling() {
+	return Compiling;
+}
+void TiledMapCache::AddTileset(const char* path, Uint32 hash, XMLNode* root) {
+	if (!Compiling) {
+		return;
+	}
+
+	WriteString(TilesetData, path, strlen(path));
+	TilesetData->WriteUInt32(hash);
+	WriteNode(TilesetData, root);
+	TilesetCount++;
+}
+void TiledMapCache::AddLayerData(XMLNode* node, void* data, size_t size) {
+	if (!Compiling) {
+		return;
+	}
+
+	TiledMapCacheLayerData layerData;
+	layerData.Node = node;
+	layerData.Data = (Uint8*)Memory::Malloc(size);
+	layerData.Size = size;
+	if (!layerData.Data) {
+		return;
+	}
+
+	memcpy(layerData.Data, data, size);
+	LayerData.push_back(layerData);
+}
+void TiledMapCache::Write(XMLNode* map) {
+	if (!Compiling) {
+		return;
+	}
+
+	MemoryStream* out = MemoryStream::New(TilesetData->Position() + 0x10000);
+	if (!out) {
+		return;
+	}
+
+	out->WriteUInt32(TILED_MAP_CACHE_MAGIC);
+	out->WriteUInt32(TILED_MAP_CACHE_VERSION);
+	out->WriteUInt32(SourceHash);
+	out->WriteUInt32(TilesetCount);
+	out->WriteBytes(TilesetData->pointer_start, TilesetData->Position());
+	WriteNode(out, map);
+
+	char cachePath[MAX_PATH_LENGTH];
+	GetCachePath(Filename, cachePath, sizeof cachePath);
+
+	Stream* stream = FileStream::New(cachePath, FileStream::WRITE_ACCESS, true);
+	if (stream) {
+		stream->WriteBytes(out->pointer_start, out->Position());
+		stream->Close();
+
+		Log::Print(Log::LOG_VERBOSE, "Cached Tiled map \"%s\" to \"%s\".", Filename, cachePath);
+	}
+
+	out->Close();
+}
+
+void TiledMapCache::Close() {
+	for (size_t i = 0; i < Tilesets.size(); i++) {
+		if (Tilesets[i].Root) {
+			XMLParser::Free(Tilesets[i].Root);
+		}
+	}
+	Tilesets.clear();
+
+	if (Data) {
+		Memory::Free(Data);
+		Data = nullptr;
+	}
+	DataSize = 0;
+
+	for (size_t i = 0; i < LayerData.size(); i++) {
+		Memory::Free(LayerData[i].Data);
+	}
+	LayerData.clear();
+
+	if (TilesetData) {
+		TilesetData->Close();
+		TilesetData = nullptr;
+	}
+	TilesetCount = 0;
+	Compiling = false;
+}
@@ -0,0 +1,65 @@
+#ifndef ENGINE_RESOURCETYPES_SCENEFORMATS_TILEDMAPCACHE_H
+#define ENGINE_RESOURCETYPES_SCENEFORMATS_TILEDMAPCACHE_H
+
+#include <Engine/Filesystem/Path.h>
+#include <Engine/IO/MemoryStream.h>
+#include <Engine/IO/TextStream.h>
+#include <Engine/Includes/Standard.h>
+#include <Engine/TextFormats/XML/XMLNode.h>
+
+#define TILED_MAP_CACHE_VERSION 1
+
+struct TiledMapCacheTileset {
+	char* Path;
+	Uint32 Hash;
+	XMLNode* Root;
+};
+
+struct TiledMapCacheLayerData {
+	XMLNode* Node;
+	Uint8* Data;
+	size_t Size;
+};
+
+// A compiled copy of a Tiled map and its external tilesets, kept in the cache
+// folder. It stores the parsed XML trees, with the tile data of every layer
+// already decoded, and the content hash of every file it was compiled from.
+// Trees read from the cache point into the loaded file, so they can only be
+// used until Close() is called.
+class TiledMapCache {
+private:
+	static Uint8* Data;
+	static size_t DataSize;
+	static vector<TiledMapCacheTileset> Tilesets;
+
+	static bool Compiling;
+	static char Filename[MAX_RESOURCE_PATH_LENGTH];
+	static Uint32 SourceHash;
+	static MemoryStream* TilesetData;
+	static Uint32 TilesetCount;
+	static vector<TiledMapCacheLayerData> LayerData;
+
+	static void GetCachePath(const char* sourceF, char* buffer, size_t size);
+	static bool HashResource(const char* filename, Uint32* hash);
+	static void WriteString(Stream* stream, const char* string, size_t length);
+	static void WriteNode(Stream* stream, XMLNode* node);
+	static bool ReadString(Uint8** cursor, Uint8* end, char** string, Uint32* length);
+	static XMLNode* ReadNode(Uint8** cursor, Uint8* end, XMLNode* parent, int depth);
+	static XMLNode* ReadFile(const char* sourceF, Uint32 sourceHash);
+
+public:
+	static bool Enabled;
+
+	static Uint32 Hash(const void* data, size_t size);
+	static TextStream* LoadSource(const char* filename, Uint32* hash);
+	static XMLNode* Open(const char* sourceF, Uint32 sourceHash);
+	static XMLNode* GetTileset(const char* path);
+	static void BeginCompile(const char* sourceF, Uint32 sourceHash);
+	static bool IsCompiling();
+	static void AddTileset(const char* path, Uint32 hash, XMLNode* root);
+	static void AddLayerData(XMLNode* node, void* data, size_t size);
+	static void Write(XMLNode* map);
+	static void Close();
+};
+
+#endif /* ENGINE_RESOURCETYPES_SCENEFORMATS_TILEDMAPCACHE_H */
@@ -4,6 +4,7 @@
 #include <Engine/Diagnostics/Memory.h>
 #include <Engine/IO/Compression/ZLibStream.h>
 #include <Engine/ResourceTypes/ResourceManager.h>
+#include <Engine/ResourceTypes/SceneFormats/TiledMapCache.h>
 #include <Engine/Scene.h>
 #include <Engine/Scene/SceneLayer.h>
 #include <Engine/Scene/TileLayer.h>
@@ -11,6 +12,12 @@
 #include <Engine/Types/Entity.h>
 #include <Engine/Utilities/StringUtils.h>
 
+#undef min
+#undef max
+
+#define MINIZ_HEADER_FILE_ONLY
+#include <Libraries/miniz.h>
+
 #define TILE_FLIPX_MASK 0x80000000U
 #define TILE_FLIPY_MASK 0x40000000U
 #define TILE_COLLA_MASK 0x30000000U
@@ -18,154 +25,122 @@
 #define TILE_COLLC_MASK 0x03000000U
 #define TILE_IDENT_MASK 0x00FFFFFFU
 
-static const int decoding[] = {62,
-	-1,
-	-1,
-	-1,
-	63,
-	52,
-	53,
-	54,
-	55,
-	56,
-	57,
-	58,
-	59,
-	60,
-	61,
-	-1,
-	-1,
-	-1,
-	-2,
-	-1,
-	-1,
-	-1,
-	0,
-	1,
-	2,
-	3,
-	4,
-	5,
-	6,
-	7,
-	8,
-	9,
-	10,
-	11,
-	12,
-	13,
-	14,
-	15,
-	16,
-	17,
-	18,
-	19,
-	20,
-	21,
-	22,
-	23,
-	24,
-	25,
-	-1,
-	-1,
-	-1,
-	-1,
-	-1,
-	-1,
-	26,
-	27,
-	28,
-	29,
-	30,
-	31,
-	32,
-	33,
-	34,
-	35,
-	36,
-	37,
-	38,
-	39,
-	40,
-	41,
-	42,
-	43,
-	44,
-	45,
-	46,
-	47,
-	48,
-	49,
-	50,
-	51};
-int base64_decode_value(int8_t value_in) {
-	value_in -= 43;
-	if (value_in < 0 || value_in >= 80) {
-		return -1;
-	}
-	return decoding[(int)value_in];
+#define TILED_LAYER_DECODE_CHUNK_SIZE 0x4000
+
+#define BASE64_SKIP 0xFF
+#define BASE64_END 0xFE
+
+static Uint8 Base64Values[256];
+static bool Base64ValuesInitialized = false;
+
+static void InitBase64Values() {
+	const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	memset(Base64Values, BASE64_SKIP, sizeof Base64Values);
+	for (int i = 0; i < 64; i++) {
+		Base64Values[(Uint8)alphabet[i]] = (Uint8)i;
+	}
+	Base64Values['='] = BASE64_END;
+
+	Base64ValuesInitialized = true;
 }
-size_t base64_decode_block(const char* code_in, const int length_in, char* plaintext_out) {
-	const char* codechar = code_in;
-	int8_t* plainchar = (int8_t*)plaintext_out;
-	int8_t fragment;
-
-	int _step = 0;
-	int8_t _plainchar = 0;
-
-	*plainchar = _plainchar;
-
-	switch (_step) {
-		while (1) {
-		case 0:
-			do {
-				if (codechar >= code_in + length_in) {
-					_step = 0;
-					_plainchar = *plainchar;
-					return (int)(plainchar - (int8_t*)plaintext_out);
-				}
-				fragment = (char)base64_decode_value(*codechar++);
-			} while (fragment < 0);
-			*plainchar = (fragment & 0x03f) << 2;
-
-		case 1:
-			do {
-				if (codechar >= code_in + length_in) {
-					_step = 1;
-					_plainchar = *plainchar;
-					return (int)(plainchar - (int8_t*)plaintext_out);
-				}
-				fragment = (char)base64_decode_value(*codechar++);
-			} while (fragment < 0);
-			*plainchar++ |= (fragment & 0x030) >> 4;
-			*plainchar = (fragment & 0x00f) << 4;
-
-		case 2:
-			do {
-				if (codechar >= code_in + length_in) {
-					_step = 2;
-					_plainchar = *plainchar;
-					return (int)(plainchar - (int8_t*)plaintext_out);
-				}
-				fragment = (char)base64_decode_value(*codechar++);
-			} while (fragment < 0);
-			*plainchar++ |= (fragment & 0x03c) >> 2;
-			*plainchar = (fragment & 0x003) << 6;
-
-		case 3:
-			do {
-				if (codechar >= code_in + length_in) {
-					_step = 3;
-					_plainchar = *plainchar;
-					return (int)(plainchar - (int8_t*)plaintext_out);
-				}
-				fragment = (char)base64_decode_value(*codechar++);
-			} while (fragment < 0);
-			*plainchar++ |= (fragment & 0x03f);
+
+// Decodes base64 text in fixed-size chunks. If the data is compressed, each
+// chunk is inflated as soon as it's decoded, so neither the decoded nor the
+// compressed layer is ever held in memory as a whole. Returns how many bytes
+// were written to the output.
+size_t TiledMapReader::DecodeLayerData(Token text, bool compressed, Uint8* out, size_t outSize) {
+	if (!Base64ValuesInitialized) {
+		InitBase64Values();
+	}
+
+	Uint8 chunk[TILED_LAYER_DECODE_CHUNK_SIZE];
+	size_t chunkLength = 0;
+	size_t written = 0;
+	bool done = false;
+
+	z_stream zs;
+	if (compressed) {
+		memset(&zs, 0, sizeof zs);
+		zs.next_out = (Bytef*)out;
+		zs.avail_out = (unsigned int)outSize;
+		if (inflateInit(&zs) != Z_OK) {
+			return 0;
 		}
 	}
-	/* control should not reach here */
-	return (int)(plainchar - (int8_t*)plaintext_out);
+
+	const Uint8* src = (const Uint8*)text.Start;
+	const Uint8* srcEnd = src + text.Length;
+
+	Uint32 bits = 0;
+	int numValues = 0;
+
+	while (!done) {
+		// Fill the chunk, four characters at a time.
+		while (src < srcEnd && chunkLength + 3 <= sizeof chunk) {
+			Uint8 value = Base64Values[*src++];
+			if (value == BASE64_SKIP) {
+				continue;
+			}
+			if (value == BASE64_END) {
+				src = srcEnd;
+				break;
+			}
+
+			bits = (bits << 6) | value;
+			if (++numValues == 4) {
+				chunk[chunkLength++] = (Uint8)(bits >> 16);
+				chunk[chunkLength++] = (Uint8)(bits >> 8);
+				chunk[chunkLength++] = (Uint8)bits;
+				bits = 0;
+				numValues = 0;
+			}
+		}
+
+		// Flush the characters of an unfinished group.
+		if (src >= srcEnd) {
+			if (numValues == 2) {
+				chunk[chunkLength++] = (Uint8)(bits >> 4);
+			}
+			else if (numValues == 3) {
+				chunk[chunkLength++] = (Uint8)(bits >> 10);
+				chunk[chunkLength++] = (Uint8)(bits >> 2);
+			}
+			numValues = 0;
+			done = true;
+		}
+
+		if (compressed) {
+			zs.next_in = chunk;
+			zs.avail_in = (unsigned int)chunkLength;
+
+			int result = inflate(&zs, Z_NO_FLUSH);
+			if (result == Z_STREAM_END || zs.avail_out == 0) {
+				done = true;
+			}
+			else if (result != Z_OK && result != Z_BUF_ERROR) {
+				Log::Print(Log::LOG_ERROR, "Could not decompress tile layer data!");
+				done = true;
+			}
+		}
+		else {
+			size_t length = std::min(chunkLength, outSize - written);
+			memcpy(out + written, chunk, length);
+			written += length;
+			if (written == outSize) {
+				done = true;
+			}
+		}
+
+		chunkLength = 0;
+	}
+
+	if (compressed) {
+		written = outSize - zs.avail_out;
+		inflateEnd(&zs);
+	}
+
+	return written;
 }
 
 Property TiledMapReader::ParseProperty(XMLNode* property) {
@@ -499,9 +474,23 @@ void TiledMapReader::LoadTileset(XMLNode* tileset, const char* parentFolder) {
 		memcpy(tilesetParentFolder, resourcePath, MAX_RESOURCE_PATH_LENGTH);
 		StringUtils::GetPathInPlace(tilesetParentFolder);
 
-		tilesetXML = XMLParser::ParseFromResource(resourcePath);
+		// The tileset is either in the map's cache, or it's parsed and
+		// added to the cache that's being compiled.
+		tilesetXML = TiledMapCache::GetTileset(resourcePath);
 		if (!tilesetXML) {
-			return;
+			Uint32 tilesetHash;
+			TextStream* tilesetSource = TiledMapCache::LoadSource(resourcePath, &tilesetHash);
+			if (!tilesetSource) {
+				return;
+			}
+
+			tilesetXML = XMLParser::ParseFromStream(tilesetSource);
+			if (!tilesetXML) {
+				tilesetSource->Close();
+				return;
+			}
+
+			TiledMapCache::AddTileset(resourcePath, tilesetHash, tilesetXML);
 		}
 		tilesetNode = tilesetXML->children[0];
 	}
@@ -598,27 +587,41 @@ bool TiledMapReader::ParseTileLayer(XMLNode* mapLayer, LayerGroup* group) {
 			XMLNode* data = mapLayer->children[e];
 			XMLNode* data_text = data->children[0];
 
-			size_t tile_buffer_len = 0;
-			if (data->attributes.Exists("encoding")) {
+			bool compressed = false;
+			if (data->attributes.Exists("compression")) {
 				if (XMLParser::MatchToken(
-					    data->attributes.Get("encoding"), "base64")) {
-					size_t decoded_buffer_size = ((data_text->name.Length * 3) / 4) + 1;
-					char* decoded_buffer = (char*)Memory::Calloc(decoded_buffer_size, sizeof(char));
-
-					tile_buffer_len = base64_decode_block(data_text->name.Start,
-						(int)data_text->name.Length,
-						decoded_buffer);
+					    data->attributes.Get("compression"), "zlib")) {
+					compressed = true;
+				}
+				else {
+					Log::Print(Log::LOG_ERROR,
+						"Unsupported tile layer compression format!");
+					return false;
+				}
+			}
 
+			if (data->attributes.Exists("encoding")) {
+				Token encoding = data->attributes.Get("encoding");
+				if (XMLParser::MatchToken(encoding, "base64")) {
 					tile_buffer = (int*)Memory::Calloc(layer_size_in_bytes, sizeof(Uint8));
-					if (tile_buffer_len > layer_size_in_bytes) {
-						tile_buffer_len = layer_size_in_bytes;
+					DecodeLayerData(data_text->name,
+						compressed,
+						(Uint8*)tile_buffer,
+						layer_size_in_bytes);
+
+					TiledMapCache::AddLayerData(data, tile_buffer, layer_size_in_bytes);
+				}
+				// Tile data from a compiled map is already decoded.
+				else if (XMLParser::MatchToken(encoding, "raw")) {
+					size_t length = data_text->name.Length;
+					if (length > layer_size_in_bytes) {
+						length = layer_size_in_bytes;
 					}
-					memcpy(tile_buffer, decoded_buffer, tile_buffer_len);
 
-					Memory::Free(decoded_buffer);
+					tile_buffer = (int*)Memory::Calloc(layer_size_in_bytes, sizeof(Uint8));
+					memcpy(tile_buffer, data_text->name.Start, length);
 				}
-				else if (XMLParser::MatchToken(
-						 data->attributes.Get("encoding"), "csv")) {
+				else if (XMLParser::MatchToken(encoding, "csv")) {
 					Log::Print(Log::LOG_ERROR,
 						"Unsupported tile layer format \"CSV\"!");
 					return false;
@@ -634,26 +637,6 @@ bool TiledMapReader::ParseTileLayer(XMLNode* mapLayer, LayerGroup* group) {
 					Log::LOG_ERROR, "Unsupported tile layer format \"XML\"!");
 				return false;
 			}
-
-			if (data->attributes.Exists("compression")) {
-				if (XMLParser::MatchToken(
-					    data->attributes.Get("compression"), "zlib")) {
-					int* decomp_tile_buffer =
-						(int*)Memory::Malloc(layer_size_in_bytes);
-					ZLibStream::Decompress(decomp_tile_buffer,
-						layer_size_in_bytes,
-						tile_buffer,
-						tile_buffer_len);
-					Memory::Free(tile_buffer);
-
-					tile_buffer = decomp_tile_buffer;
-				}
-				else {
-					Log::Print(Log::LOG_ERROR,
-						"Unsupported tile layer compression format!");
-					return false;
-				}
-			}
 		}
 	}
 
@@ -985,12 +968,31 @@ bool TiledMapReader::ParseGroup(XMLNode* node, LayerGroup* parent, const char* p
 }
 
 void TiledMapReader::Read(const char* sourceF, const char* parentFolder) {
-	XMLNode* tileMapXML = XMLParser::ParseFromResource(sourceF);
-	if (!tileMapXML) {
+	Uint32 sourceHash;
+	TextStream* source = TiledMapCache::LoadSource(sourceF, &sourceHash);
+	if (!source) {
 		Log::Print(Log::LOG_ERROR, "Could not parse resource \"%s\"!", sourceF);
 		return;
 	}
 
+	// Use the compiled map if it's up to date. Otherwise, parse the map, and
+	// compile it while it's read. A layer's data stays a single text node
+	// that points into the source, and DecodeLayerData streams it from there.
+	XMLNode* tileMapXML = TiledMapCache::Open(sourceF, sourceHash);
+	if (tileMapXML) {
+		source->Close();
+	}
+	else {
+		tileMapXML = XMLParser::ParseFromStream(source);
+		if (!tileMapXML) {
+			source->Close();
+			Log::Print(Log::LOG_ERROR, "Could not parse resource \"%s\"!", sourceF);
+			return;
+		}
+
+		TiledMapCache::BeginCompile(sourceF, sourceHash);
+	}
+
 	XMLNode* map = tileMapXML->children[0];
 
 	// 'infinite' maps will not work
@@ -998,6 +1000,7 @@ void TiledMapReader::Read(const char* sourceF, const char* parentFolder) {
 		Log::Print(Log::LOG_ERROR,
 			"Not compatible with infinite maps! (Map > Map Properties > Set \"Infinite\" to unchecked)");
 		XMLParser::Free(tileMapXML);
+		TiledMapCache::Close();
 		return;
 	}
 
@@ -1047,6 +1050,9 @@ void TiledMapReader::Read(const char* sourceF, const char* parentFolder) {
 		}
 	}
 
+	TiledMapCache::Write(tileMapXML);
+
 FREE:
 	XMLParser::Free(tileMapXML);
+	TiledMapCache::Close();
 }
@@ -23,6 +23,7 @@ struct TiledLayer {
 
 class TiledMapReader {
 private:
+	static size_t DecodeLayerData(Token text, bool compressed, Uint8* out, size_t outSize);
 	static Property ParseProperty(XMLNode* property);
 	static void ParsePropertyNode(XMLNode* node, HashMap<Property>* properties);
 	static PropertyArray ParsePolyPoints(XMLNode* node);
@@ -38,13 +38,10 @@ void SoundFormat::LoadAllSamples() {
 	LoadSamples(TotalPossibleSamples - Samples.size());
 }
 
+// The sound must already be fully loaded. Playbacks are prepared on whatever
+// thread posts them, so loading the rest of the sound here would race with
+// any other thread playing it.
 void SoundFormat::CopySamples(SoundFormat* dest) {
-	// Load the entire sound
-	if (Samples.size() < TotalPossibleSamples) {
-		LoadAllSamples();
-		Close();
-	}
-
 	// The destination SoundData's Samples are the same as the
 	// source SoundData's Samples. Why? Because Samples is just a
 	// list of pointers to the sample buffer, which the destination
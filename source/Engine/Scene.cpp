@@ -7,6 +7,7 @@
 #include <Engine/Diagnostics/Log.h>
 #include <Engine/Diagnostics/Memory.h>
 #include <Engine/Diagnostics/MemoryPools.h>
+#include <Engine/Diagnostics/Profiler.h>
 #include <Engine/Error.h>
 #include <Engine/Filesystem/File.h>
 #include <Engine/Hashing/CRC32.h>
@@ -20,12 +21,15 @@
 #include <Engine/Includes/HashMap.h>
 #include <Engine/Math/Math.h>
 #include <Engine/Rendering/SDL2/SDL2Renderer.h>
+#include <Engine/Rendering/SpriteAtlas.h>
+#include <Engine/ResourceTypes/AsyncLoader.h>
 #include <Engine/ResourceTypes/ISound.h>
 #include <Engine/ResourceTypes/ResourceManager.h>
 #include <Engine/ResourceTypes/SceneFormats/HatchSceneReader.h>
 #include <Engine/ResourceTypes/SceneFormats/RSDKSceneReader.h>
 #include <Engine/ResourceTypes/SceneFormats/TiledMapReader.h>
 #include <Engine/Scene/SceneInfo.h>
+#include <Engine/Scene/SceneSnapshot.h>
 #include <Engine/TextFormats/XML/XMLNode.h>
 #include <Engine/TextFormats/XML/XMLParser.h>
 #include <Engine/Types/EntityTypes.h>
@@ -774,6 +778,8 @@ void Scene::FrameUpdate() {
 	Scene::SortEntities();
 }
 void Scene::Update() {
+	PROFILE_ZONE("Scene::Update");
+
 	// Clear OnScreenObjects
 	Scene::OnScreenObjects->Clear();
 
@@ -789,20 +795,25 @@ void Scene::Update() {
 	ScriptManager::CallStaticClassFunction("Scene", "UpdateEarly");
 
 	// Early Update
+	PROFILE_BEGIN("Update Objects Early");
 	for (Entity *ent = Scene::ObjectFirst, *next; ent; ent = next) {
 		next = ent->NextSceneEntity;
 		UpdateObjectEarly(ent);
 	}
+	PROFILE_END();
 
 	// Check if objects are on screen
+	PROFILE_BEGIN("Check Objects On Screen");
 	for (Entity *ent = Scene::ObjectFirst; ent; ent = ent->NextSceneEntity) {
 		CheckObjectOnScreen(ent);
 	}
+	PROFILE_END();
 
 	// Call Scene.Update
 	ScriptManager::CallStaticClassFunction("Scene", "Update");
 
 	// Update objects
+	PROFILE_BEGIN("Update Objects");
 	for (Entity *ent = Scene::ObjectFirst, *next; ent; ent = next) {
 		// Store the "next" so that when/if the current is removed,
 		// it can still be used to point at the end of the loop.
@@ -811,20 +822,25 @@ void Scene::Update() {
 		// Call "Update" on the object
 		UpdateObject(ent);
 	}
+	PROFILE_END();
 
 	// Call Scene.UpdateLate
 	ScriptManager::CallStaticClassFunction("Scene", "UpdateLate");
 
 	// Late Update
+	PROFILE_BEGIN("Update Objects Late");
 	for (Entity *ent = Scene::ObjectFirst, *next; ent; ent = next) {
 		next = ent->NextSceneEntity;
 		UpdateObjectLate(ent);
 	}
+	PROFILE_END();
 
 	// Call Scene.UpdateFinish
 	ScriptManager::CallStaticClassFunction("Scene", "UpdateFinish");
 }
 void Scene::FixedUpdate() {
+	PROFILE_ZONE("Scene::FixedUpdate");
+
 	// Clear OnScreenObjects
 	Scene::OnScreenObjects->Clear();
 
@@ -855,15 +871,19 @@ void Scene::FixedUpdate() {
 	}
 
 	// Early Update
+	PROFILE_BEGIN("Update Objects Early");
 	for (Entity *ent = Scene::ObjectFirst, *next; ent; ent = next) {
 		next = ent->NextSceneEntity;
 		FixedUpdateObjectEarly(ent);
 	}
+	PROFILE_END();
 
 	// Check if objects are on screen
+	PROFILE_BEGIN("Check Objects On Screen");
 	for (Entity *ent = Scene::ObjectFirst; ent; ent = ent->NextSceneEntity) {
 		CheckObjectOnScreen(ent);
 	}
+	PROFILE_END();
 
 	// Call Scene.FixedUpdate
 	if (!Application::UseFixedTimestep) {
@@ -874,6 +894,7 @@ void Scene::FixedUpdate() {
 	}
 
 	// Update objects
+	PROFILE_BEGIN("Update Objects");
 	for (Entity *ent = Scene::ObjectFirst, *next; ent; ent = next) {
 		// Store the "next" so that when/if the current is removed,
 		// it can still be used to point at the end of the loop.
@@ -882,6 +903,7 @@ void Scene::FixedUpdate() {
 		// Call "Update" or "FixedUpdate" on the object
 		FixedUpdateObject(ent);
 	}
+	PROFILE_END();
 
 	// Call Scene.FixedUpdateLate
 	if (!Application::UseFixedTimestep) {
@@ -892,6 +914,7 @@ void Scene::FixedUpdate() {
 	}
 
 	// Late Update
+	PROFILE_BEGIN("Update Objects Late");
 	for (Entity *ent = Scene::ObjectFirst, *next; ent; ent = next) {
 		next = ent->NextSceneEntity;
 		FixedUpdateObjectLate(ent);
@@ -904,6 +927,7 @@ void Scene::FixedUpdate() {
 				ent);
 		}
 	}
+	PROFILE_END();
 
 	if (!Scene::Paused) {
 		Scene::Frame++;
@@ -919,10 +943,22 @@ void Scene::FixedUpdate() {
 	}
 }
 void Scene::RunTileAnimations() {
+	bool animationsChanged = false;
+
 	if ((Scene::TileAnimationEnabled == 1 && !Scene::Paused) ||
 		Scene::TileAnimationEnabled == 2) {
 		for (Tileset& tileset : Scene::Tilesets) {
-			tileset.RunAnimations();
+			if (tileset.RunAnimations()) {
+				animationsChanged = true;
+			}
+		}
+	}
+
+	if (animationsChanged) {
+		for (size_t i = 0; i < Scene::Layers.size(); i++) {
+			if (Scene::Layers[i]->Type == SceneLayer::TYPE_TILE) {
+				((TileLayer*)Scene::Layers[i])->InvalidateAnimatedTileChunks();
+			}
 		}
 	}
 
@@ -936,6 +972,8 @@ void Scene::RunTileAnimations() {
 			if (tileLayer->UsingTileBuffers) {
 				Graphics::RefreshLayerTileAnimations(tileLayer);
 			}
+
+			tileLayer->InvalidateTileChunks();
 		}
 
 		Scene::RefreshTileAnimations = false;
@@ -1069,6 +1107,8 @@ bool Scene::CheckPosOnScreen(float posX, float posY, float rangeX, float rangeY)
 	viewPerf->n = Clock::GetTicks() - viewPerf->n
 
 void Scene::RenderView(int viewIndex, bool doPerf) {
+	PROFILE_ZONE_ARG("Scene::RenderView", viewIndex);
+
 	View* currentView = &Scene::Views[viewIndex];
 	Perf_ViewRender* viewPerf = doPerf ? &Scene::PERF_ViewRender[viewIndex] : NULL;
 
@@ -1117,6 +1157,7 @@ void Scene::RenderView(int viewIndex, bool doPerf) {
 	PERF_END(ProjectionSetupTime);
 
 	// RenderEarly
+	PROFILE_BEGIN("Render Objects Early");
 	PERF_START(ObjectRenderEarlyTime);
 	// Call Scene.RenderStart
 	ScriptManager::CallStaticClassFunction("Scene", "RenderStart");
@@ -1146,6 +1187,7 @@ void Scene::RenderView(int viewIndex, bool doPerf) {
 		ScriptManager::CallStaticClassFunction("Scene", "RenderEarlyDrawGroupFinish", args);
 	}
 	PERF_END(ObjectRenderEarlyTime);
+	PROFILE_END();
 
 	bool showObjectRegions = Scene::ShowObjectRegions;
 
@@ -1156,6 +1198,8 @@ void Scene::RenderView(int viewIndex, bool doPerf) {
 	float _vh = currentView->GetScaledHeight();
 	double objectTimeTotal = 0.0;
 	for (int l = 0; l < Scene::PriorityPerLayer; l++) {
+		PROFILE_ZONE_ARG("Draw Group", l);
+
 		Scene::CurrentDrawGroup = l;
 
 		// Call Scene.RenderDrawGroupStart
@@ -1343,6 +1387,7 @@ void Scene::RenderView(int viewIndex, bool doPerf) {
 
 			// Draw Tiles
 			if (layer->Visible) {
+				PROFILE_ZONE_DETAIL("Draw Layer", layer->Name);
 				PERF_START(LayerTileRenderTime[li]);
 
 				Graphics::TextureBlend = layer->UseBlending;
@@ -1371,6 +1416,7 @@ void Scene::RenderView(int viewIndex, bool doPerf) {
 	}
 
 	// RenderLate
+	PROFILE_BEGIN("Render Objects Late");
 	PERF_START(ObjectRenderLateTime);
 	for (int l = 0; l < Scene::PriorityPerLayer; l++) {
 		Scene::CurrentDrawGroup = l;
@@ -1401,6 +1447,7 @@ void Scene::RenderView(int viewIndex, bool doPerf) {
 	ScriptManager::CallStaticClassFunction("Scene", "RenderFinish");
 	Scene::CurrentDrawGroup = -1;
 	PERF_END(ObjectRenderLateTime);
+	PROFILE_END();
 
 	PERF_START(RenderFinishTime);
 	if (useDrawTarget && currentView->Software) {
@@ -1700,6 +1747,8 @@ void Scene::AfterScene() {
 
 		doRestart = false;
 	}
+
+	SceneSnapshot::RunPendingRestore();
 }
 
 void Scene::Iterate(Entity* first, std::function<void(Entity* e)> func) {
@@ -1846,6 +1895,7 @@ void Scene::Restart() {
 
 			TileLayer* layer = (TileLayer*)Layers[l];
 			memcpy(layer->Tiles, layer->TilesBackup, layer->DataSize);
+			layer->InvalidateTileChunks();
 		}
 		Scene::AnyLayerTileChange = false;
 	}
@@ -2047,6 +2097,8 @@ void Scene::RemoveNonPersistentObjects(Entity** first, Entity** last, int* count
 	}
 }
 void Scene::Unload() {
+	SceneSnapshot::DisposeAll();
+
 	// Remove non-persistent objects from lists
 	if (Scene::ObjectLists) {
 		Scene::ObjectLists->ForAll([](Uint32, ObjectList* list) -> void {
@@ -2076,6 +2128,7 @@ void Scene::Unload() {
 
 	// Dispose of resources in SCOPE_SCENE
 	Scene::DisposeInScope(SCOPE_SCENE);
+	AsyncLoader::RemoveUnloaded();
 
 	// Clear and dispose of non-persistent objects
 	Scene::RemoveNonPersistentObjects(
@@ -3152,17 +3205,17 @@ bool Scene::AddTileset(char* path) {
 	Scene::SetTileCount(Scene::TileCount + (cols * rows));
 
 	// Remake layer tile buffers
-	if (Graphics::LayerTileBufferingEnabled) {
-		for (int l = 0; l < (int)Layers.size(); l++) {
-			if (Layers[l]->Type != SceneLayer::TYPE_TILE) {
-				continue;
-			}
+	for (int l = 0; l < (int)Layers.size(); l++) {
+		if (Layers[l]->Type != SceneLayer::TYPE_TILE) {
+			continue;
+		}
 
-			TileLayer* layer = (TileLayer*)Layers[l];
-			if (layer->UsingTileBuffers) {
-				layer->RemakeTileBuffers = true;
-			}
+		TileLayer* layer = (TileLayer*)Layers[l];
+		if (layer->UsingTileBuffers && Graphics::LayerTileBufferingEnabled) {
+			layer->RemakeTileBuffers = true;
 		}
+
+		layer->InvalidateTileChunks();
 	}
 
 	return true;
@@ -3304,6 +3357,8 @@ bool Scene::GetResource(vector<ResourceType*>* list, ResourceType* resource, siz
 }
 
 int Scene::LoadSpriteResource(const char* filename, int unloadPolicy) {
+	PROFILE_ZONE_DETAIL("Load Sprite", filename);
+
 	ResourceType* resource = new (std::nothrow) ResourceType();
 	resource->FilenameHash = CRC32::EncryptString(filename);
 	resource->UnloadPolicy = unloadPolicy;
@@ -3322,9 +3377,13 @@ int Scene::LoadSpriteResource(const char* filename, int unloadPolicy) {
 		return -1;
 	}
 
+	SpriteAtlas::Pack(resource->AsSprite);
+
 	return (int)index;
 }
 int Scene::LoadImageResource(const char* filename, int unloadPolicy) {
+	PROFILE_ZONE_DETAIL("Load Image", filename);
+
 	ResourceType* resource = new (std::nothrow) ResourceType();
 	resource->FilenameHash = CRC32::EncryptString(filename);
 	resource->UnloadPolicy = unloadPolicy;
@@ -3363,6 +3422,8 @@ int Scene::AddImageResource(Image* image, const char* filename, int unloadPolicy
 	return (int)index;
 }
 int Scene::LoadModelResource(const char* filename, int unloadPolicy) {
+	PROFILE_ZONE_DETAIL("Load Model", filename);
+
 	ResourceType* resource = new (std::nothrow) ResourceType();
 	resource->FilenameHash = CRC32::EncryptString(filename);
 	resource->UnloadPolicy = unloadPolicy;
@@ -3383,7 +3444,24 @@ int Scene::LoadModelResource(const char* filename, int unloadPolicy) {
 
 	return (int)index;
 }
+int Scene::AddModelResource(IModel* model, const char* filename, int unloadPolicy) {
+	ResourceType* resource = new (std::nothrow) ResourceType();
+	resource->FilenameHash = CRC32::EncryptString(filename);
+	resource->UnloadPolicy = unloadPolicy;
+
+	size_t index = 0;
+	vector<ResourceType*>* list = &Scene::ModelList;
+	if (Scene::GetResource(list, resource, index)) {
+		return (int)index;
+	}
+
+	resource->AsModel = model;
+
+	return (int)index;
+}
 int Scene::LoadMusicResource(const char* filename, int unloadPolicy) {
+	PROFILE_ZONE_DETAIL("Load Music", filename);
+
 	ResourceType* resource = new (std::nothrow) ResourceType();
 	resource->FilenameHash = CRC32::EncryptString(filename);
 	resource->UnloadPolicy = unloadPolicy;
@@ -3405,6 +3483,8 @@ int Scene::LoadMusicResource(const char* filename, int unloadPolicy) {
 	return (int)index;
 }
 int Scene::LoadSoundResource(const char* filename, int unloadPolicy) {
+	PROFILE_ZONE_DETAIL("Load Sound", filename);
+
 	ResourceType* resource = new (std::nothrow) ResourceType();
 	resource->FilenameHash = CRC32::EncryptString(filename);
 	resource->UnloadPolicy = unloadPolicy;
@@ -3415,7 +3495,9 @@ int Scene::LoadSoundResource(const char* filename, int unloadPolicy) {
 		return (int)index;
 	}
 
-	resource->AsSound = new (std::nothrow) ISound(filename);
+	// Sounds are loaded in full here, since any thread that plays one reads
+	// its samples.
+	resource->AsSound = new (std::nothrow) ISound(filename, false);
 	if (resource->AsSound->LoadFailed) {
 		delete resource->AsSound;
 		delete resource;
@@ -3425,7 +3507,39 @@ int Scene::LoadSoundResource(const char* filename, int unloadPolicy) {
 
 	return (int)index;
 }
+int Scene::AddMusicResource(ISound* music, const char* filename, int unloadPolicy) {
+	ResourceType* resource = new (std::nothrow) ResourceType();
+	resource->FilenameHash = CRC32::EncryptString(filename);
+	resource->UnloadPolicy = unloadPolicy;
+
+	size_t index = 0;
+	vector<ResourceType*>* list = &Scene::MusicList;
+	if (Scene::GetResource(list, resource, index)) {
+		return (int)index;
+	}
+
+	resource->AsMusic = music;
+
+	return (int)index;
+}
+int Scene::AddSoundResource(ISound* sound, const char* filename, int unloadPolicy) {
+	ResourceType* resource = new (std::nothrow) ResourceType();
+	resource->FilenameHash = CRC32::EncryptString(filename);
+	resource->UnloadPolicy = unloadPolicy;
+
+	size_t index = 0;
+	vector<ResourceType*>* list = &Scene::SoundList;
+	if (Scene::GetResource(list, resource, index)) {
+		return (int)index;
+	}
+
+	resource->AsSound = sound;
+
+	return (int)index;
+}
 int Scene::LoadVideoResource(const char* filename, int unloadPolicy) {
+	PROFILE_ZONE_DETAIL("Load Video", filename);
+
 #ifdef USING_FFMPEG
 	ResourceType* resource = new (std::nothrow) ResourceType();
 	resource->FilenameHash = CRC32::EncryptString(filename);
@@ -3645,6 +3759,8 @@ void Scene::DisposeInScope(Uint32 scope) {
 	}
 }
 void Scene::Dispose() {
+	SceneSnapshot::DisposeAll();
+
 	Graphics::UnloadData();
 
 	for (int i = 0; i < MAX_SCENE_VIEWS; i++) {
@@ -3667,6 +3783,10 @@ void Scene::Dispose() {
 			Scene::Views[i].DeleteStencil();
 			Scene::Views[i].UseStencil = false;
 		}
+
+		if (Scene::Views[i].UseIndexedFramebuffer) {
+			Scene::Views[i].SetIndexedFramebufferEnabled(false);
+		}
 	}
 
 	Scene::DisposeInScope(SCOPE_SCENE);
@@ -3792,8 +3912,12 @@ void Scene::SetTile(int layerIndex,
 	*tile |= collB << 26;
 
 	Uint32 newTileData = (*tile) & (TILE_IDENT_MASK | TILE_FLIPX_MASK | TILE_FLIPY_MASK);
-	if (oldTileData != newTileData && Graphics::LayerTileBufferingEnabled) {
-		Graphics::UpdateBufferedLayerTile(layer, x, y);
+	if (oldTileData != newTileData) {
+		if (Graphics::LayerTileBufferingEnabled) {
+			Graphics::UpdateBufferedLayerTile(layer, x, y);
+		}
+
+		layer->InvalidateTileChunk(x, y);
 	}
 
 	Scene::AnyLayerTileChange = true;
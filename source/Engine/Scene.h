@@ -209,8 +209,11 @@ public:
 	static int LoadImageResource(const char* filename, int unloadPolicy);
 	static int AddImageResource(Image* image, const char* filename, int unloadPolicy);
 	static int LoadModelResource(const char* filename, int unloadPolicy);
+	static int AddModelResource(IModel* model, const char* filename, int unloadPolicy);
 	static int LoadMusicResource(const char* filename, int unloadPolicy);
 	static int LoadSoundResource(const char* filename, int unloadPolicy);
+	static int AddMusicResource(ISound* music, const char* filename, int unloadPolicy);
+	static int AddSoundResource(ISound* sound, const char* filename, int unloadPolicy);
 	static int LoadVideoResource(const char* filename, int unloadPolicy);
 	static ResourceType* GetSpriteResource(int index);
 	static ResourceType* GetImageResource(int index);
@@ -11,4 +11,25 @@ struct LayerTileBuffers {
 	std::unordered_map<Texture*, LayerTextureBatch> TextureBatches;
 };
 
+// Size of a chunk, in tiles
+#define TILE_CHUNK_SIZE 8
+// How many chunk bitmaps a layer may keep. Past this, the least recently
+// drawn chunk is evicted, even if it was drawn this frame.
+#define MAX_TILE_CHUNKS_PER_LAYER 256
+
+struct LayerTileChunk {
+	enum {
+		ROW_VISIBLE = 1,
+		ROW_OPAQUE = 2
+	};
+
+	Uint32* Pixels = nullptr;
+	Uint8* RowFlags = nullptr;
+	// Neighbors in the layer's LRU list of allocated chunks
+	int LRUPrev = -1;
+	int LRUNext = -1;
+	bool Dirty = true;
+	bool HasAnimatedTiles = false;
+};
+
 #endif /* ENGINE_SCENE_LAYERTILEBUFFERS_H */
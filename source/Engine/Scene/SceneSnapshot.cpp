@@ -0,0 +1,644 @@
+#include <Engine/Scene/SceneSnapshot.h>
+
+#include <Engine/Audio/AudioManager.h>
+#include <Engine/Bytecode/ScriptEntity.h>
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Graphics.h>
+#include <Engine/Math/Math.h>
+#include <Engine/Math/Random.h>
+#include <Engine/Scene.h>
+#include <Engine/Types/DrawGroupList.h>
+#include <Engine/Types/ObjectList.h>
+#include <Engine/Types/ObjectRegistry.h>
+
+vector<SceneSnapshot*> SceneSnapshot::List;
+int SceneSnapshot::PendingRestore = -1;
+
+// Dynamic entities that were removed are deleted at the end of the frame, so
+// they aren't part of the scene's state anymore.
+static bool IsRecorded(Entity* ent) {
+	return !ent->Dynamic || ((ScriptEntity*)ent)->Instance != nullptr;
+}
+
+static bool IsSnapshotField(VMValue value) {
+	// Linked fields are part of the entity, and native methods are added to
+	// every instance by the entity class.
+	return !IS_LINKED_INTEGER(value) && !IS_LINKED_DECIMAL(value) &&
+		!IS_NATIVE_FUNCTION(value);
+}
+
+// Lists usually come in the same order they were captured in, so the range at
+// `hint` is checked first.
+static SnapshotEntityRange* FindRange(vector<SnapshotEntityRange>& ranges,
+	void* owner,
+	size_t hint) {
+	if (hint < ranges.size() && ranges[hint].Owner == owner) {
+		return &ranges[hint];
+	}
+	for (size_t i = 0; i < ranges.size(); i++) {
+		if (ranges[i].Owner == owner) {
+			return &ranges[i];
+		}
+	}
+	return nullptr;
+}
+
+void SceneSnapshot::Capture() {
+	LastEntities.swap(Entities);
+	LastFields.swap(Fields);
+	size_t lastIndex = 0;
+
+	Entities.clear();
+	Fields.clear();
+	Members.clear();
+	Lists.clear();
+	Registries.clear();
+	DrawGroups.clear();
+
+	for (Entity* ent = Scene::ObjectFirst; ent; ent = ent->NextSceneEntity) {
+		if (!IsRecorded(ent)) {
+			continue;
+		}
+
+		ScriptEntity* scriptEntity = (ScriptEntity*)ent;
+
+		SnapshotEntity record;
+		record.Ent = ent;
+		record.Instance = scriptEntity->Instance;
+		record.Class = record.Instance ? record.Instance->Object.Class : nullptr;
+		record.List = ent->List;
+		record.Dynamic = ent->Dynamic;
+#define SNAPSHOT_FIELD(name) record.State.name = ent->name;
+		SNAPSHOT_ENTITY_FIELDS
+#undef SNAPSHOT_FIELD
+
+		// Entities are usually in the same order as the last time this
+		// snapshot was taken, give or take the ones that were added or
+		// removed since.
+		SnapshotEntity* last = nullptr;
+		for (size_t i = lastIndex; i < lastIndex + 2 && i < LastEntities.size(); i++) {
+			if (LastEntities[i].Ent == ent) {
+				last = &LastEntities[i];
+				lastIndex = i + 1;
+				break;
+			}
+		}
+
+		record.FirstField = (Uint32)Fields.size();
+		record.FieldCount = 0;
+		record.TableCount = 0;
+		if (record.Instance) {
+			Table* fields = record.Instance->InstanceObj.Fields;
+			record.TableCount = (Uint32)fields->Count();
+			if (!CaptureKnownFields(record, last, fields)) {
+				CaptureFields(record, fields);
+			}
+		}
+
+		Entities.push_back(record);
+	}
+
+	DynamicOrder.Owner = nullptr;
+	DynamicOrder.Start = (Uint32)Members.size();
+	for (Entity* ent = Scene::DynamicObjectFirst; ent; ent = ent->NextEntity) {
+		if (IsRecorded(ent)) {
+			Members.push_back(ent);
+		}
+	}
+	DynamicOrder.Count = (Uint32)Members.size() - DynamicOrder.Start;
+
+	if (Scene::ObjectLists) {
+		for (auto& it : Scene::ObjectLists->Data) {
+			ObjectList* list = it.second;
+			SnapshotEntityRange range = {list, (Uint32)Members.size(), 0};
+			for (Entity* ent = list->EntityFirst; ent; ent = ent->NextEntityInList) {
+				if (IsRecorded(ent)) {
+					Members.push_back(ent);
+				}
+			}
+			range.Count = (Uint32)Members.size() - range.Start;
+			Lists.push_back(range);
+		}
+	}
+
+	if (Scene::ObjectRegistries) {
+		for (auto& it : Scene::ObjectRegistries->Data) {
+			ObjectRegistry* registry = it.second;
+			SnapshotEntityRange range = {registry, (Uint32)Members.size(), 0};
+			for (Entity* ent : registry->List) {
+				if (IsRecorded(ent)) {
+					Members.push_back(ent);
+				}
+			}
+			range.Count = (Uint32)Members.size() - range.Start;
+			Registries.push_back(range);
+		}
+	}
+
+	for (int l = 0; l < Scene::PriorityPerLayer; l++) {
+		DrawGroupList* drawGroup = Scene::PriorityLists[l];
+		if (!drawGroup) {
+			continue;
+		}
+
+		SnapshotEntityRange range = {drawGroup, (Uint32)Members.size(), 0};
+		for (Entity* ent : *drawGroup->Entities) {
+			if (IsRecorded(ent)) {
+				Members.push_back(ent);
+			}
+		}
+		range.Count = (Uint32)Members.size() - range.Start;
+		DrawGroups.push_back(range);
+	}
+
+	CaptureTiles();
+
+	Frame = Scene::Frame;
+	TimeEnabled = Scene::TimeEnabled;
+	TimeCounter = Scene::TimeCounter;
+	Minutes = Scene::Minutes;
+	Seconds = Scene::Seconds;
+	Milliseconds = Scene::Milliseconds;
+	RandomSeed = Random::Seed;
+	RSDKRandomSeed = Math::RSDK_GetRandSeed();
+
+	LastEntities.clear();
+	LastFields.clear();
+}
+
+void SceneSnapshot::CaptureFields(SnapshotEntity& record, Table* fields) {
+	Uint32 slot = 0;
+	for (auto& it : fields->Data) {
+		if (IsSnapshotField(it.second)) {
+			Fields.push_back({it.first, slot, it.second});
+		}
+		slot++;
+	}
+	record.FieldCount = (Uint32)Fields.size() - record.FirstField;
+}
+
+// Looking for an instance's script fields means going through all of its
+// fields, most of which are linked fields and methods. If the instance has
+// as many fields as the last time, and its script fields are still where they
+// were, only those are read.
+bool SceneSnapshot::CaptureKnownFields(SnapshotEntity& record,
+	SnapshotEntity* last,
+	Table* fields) {
+#ifdef USE_STD_UNORDERED_MAP
+	return false;
+#else
+	if (!last || last->Instance != record.Instance || last->TableCount != record.TableCount) {
+		return false;
+	}
+
+	auto data = fields->Data.begin();
+	SnapshotField* field = LastFields.data() + last->FirstField;
+	for (Uint32 i = 0; i < last->FieldCount; i++, field++) {
+		if (field->Slot >= record.TableCount || data[field->Slot].first != field->Hash ||
+			!IsSnapshotField(data[field->Slot].second)) {
+			Fields.resize(record.FirstField);
+			return false;
+		}
+		Fields.push_back({field->Hash, field->Slot, data[field->Slot].second});
+	}
+	record.FieldCount = last->FieldCount;
+	return true;
+#endif
+}
+
+// Only the tiles that differ from the ones the layers were loaded with are
+// kept, and nothing at all if no tile was ever changed.
+void SceneSnapshot::CaptureTiles() {
+	TileRuns.clear();
+	Tiles.clear();
+
+	AnyLayerTileChange = Scene::AnyLayerTileChange;
+	if (!AnyLayerTileChange) {
+		return;
+	}
+
+	for (size_t l = 0; l < Scene::Layers.size(); l++) {
+		if (Scene::Layers[l]->Type != SceneLayer::TYPE_TILE) {
+			continue;
+		}
+
+		TileLayer* layer = (TileLayer*)Scene::Layers[l];
+		Uint32 count = layer->DataSize / sizeof(Uint32);
+		for (Uint32 i = 0; i < count;) {
+			if (layer->Tiles[i] == layer->TilesBackup[i]) {
+				i++;
+				continue;
+			}
+
+			Uint32 start = i;
+			while (i < count && layer->Tiles[i] != layer->TilesBackup[i]) {
+				i++;
+			}
+
+			TileRuns.push_back({(Uint32)l, start, i - start});
+			Tiles.insert(Tiles.end(), layer->Tiles + start, layer->Tiles + i);
+		}
+	}
+}
+
+void SceneSnapshot::RestoreTiles() {
+	if (!Scene::AnyLayerTileChange && !AnyLayerTileChange) {
+		return;
+	}
+
+	// A layer's tiles changed if they differ from the backup now, or if the
+	// snapshot has tiles of its own for it.
+	vector<bool> changed(Scene::Layers.size(), false);
+
+	for (size_t l = 0; l < Scene::Layers.size(); l++) {
+		if (Scene::Layers[l]->Type == SceneLayer::TYPE_TILE) {
+			TileLayer* layer = (TileLayer*)Scene::Layers[l];
+			if (memcmp(layer->Tiles, layer->TilesBackup, layer->DataSize) != 0) {
+				memcpy(layer->Tiles, layer->TilesBackup, layer->DataSize);
+				changed[l] = true;
+			}
+		}
+	}
+
+	size_t offset = 0;
+	for (SnapshotTileRun& run : TileRuns) {
+		Uint32* tiles = &Tiles[offset];
+		offset += run.Count;
+
+		if (run.Layer >= Scene::Layers.size() ||
+			Scene::Layers[run.Layer]->Type != SceneLayer::TYPE_TILE) {
+			continue;
+		}
+
+		TileLayer* layer = (TileLayer*)Scene::Layers[run.Layer];
+		if (run.Start + run.Count > layer->DataSize / sizeof(Uint32)) {
+			continue;
+		}
+
+		memcpy(layer->Tiles + run.Start, tiles, run.Count * sizeof(Uint32));
+		changed[run.Layer] = true;
+	}
+
+	// Remake the layer tile buffers, like Scene::Restart does.
+	for (size_t l = 0; l < Scene::Layers.size(); l++) {
+		if (!changed[l]) {
+			continue;
+		}
+
+		((TileLayer*)Scene::Layers[l])->InvalidateTileChunks();
+
+		if (Graphics::LayerTileBufferingEnabled) {
+			Graphics::MakeLayerTileBuffers(Scene::Layers[l]);
+		}
+	}
+
+	Scene::AnyLayerTileChange = AnyLayerTileChange;
+}
+
+// Finds the entity that holds the recorded entity's state now. Static
+// entities are never deleted while their scene is loaded, and a dynamic one
+// that still exists is still linked to its instance; dynamic entities that
+// were deleted since are spawned again, and take over their old instance, so
+// that references to them keep working.
+Entity* SceneSnapshot::Resolve(SnapshotEntity& record) {
+	ScriptEntity* ent = (ScriptEntity*)record.Ent;
+	if (!record.Dynamic) {
+		if (!record.Instance) {
+			if (ent->Instance) {
+				ent->Unlink();
+			}
+		}
+		else if (ent->Instance != record.Instance) {
+			ent->Link(record.Instance);
+		}
+		return ent;
+	}
+
+	ScriptEntity* live = (ScriptEntity*)record.Instance->EntityPtr;
+	if (!live || live->Instance != record.Instance) {
+		live = record.List ? (ScriptEntity*)Scene::TrySpawnObject(
+						     record.List, record.State.X, record.State.Y)
+				   : nullptr;
+		if (!live) {
+			Log::Print(Log::LOG_ERROR,
+				"Could not spawn entity of class \"%s\" for snapshot!",
+				record.List ? record.List->ObjectName : "(none)");
+			Replaced[record.Ent] = nullptr;
+			return nullptr;
+		}
+
+		live->Unlink();
+		live->Link(record.Instance);
+		live->Dynamic = true;
+	}
+
+	if (live != record.Ent) {
+		Replaced[record.Ent] = live;
+	}
+	return live;
+}
+
+Entity* SceneSnapshot::Lookup(Entity* ent) {
+	if (Replaced.empty()) {
+		return ent;
+	}
+
+	auto it = Replaced.find(ent);
+	return it == Replaced.end() ? ent : it->second;
+}
+
+void SceneSnapshot::RestoreEntity(SnapshotEntity& record, Entity* ent) {
+#define SNAPSHOT_FIELD(name) ent->name = record.State.name;
+	SNAPSHOT_ENTITY_FIELDS
+#undef SNAPSHOT_FIELD
+	ent->List = record.List;
+	ent->Dynamic = record.Dynamic;
+
+	if (!record.Instance) {
+		return;
+	}
+
+	record.Instance->Object.Class = record.Class;
+
+	Table* fields = record.Instance->InstanceObj.Fields;
+	SnapshotField* field = Fields.data() + record.FirstField;
+	for (Uint32 i = 0; i < record.FieldCount; i++, field++) {
+#ifndef USE_STD_UNORDERED_MAP
+		if (field->Slot < fields->Count()) {
+			auto it = fields->Data.begin() + field->Slot;
+			if (it->first == field->Hash) {
+				it->second = field->Value;
+				continue;
+			}
+		}
+#endif
+		fields->Put(field->Hash, field->Value);
+	}
+
+	if (fields->Count() != record.TableCount) {
+		RemoveAddedFields(record, fields);
+	}
+}
+
+// Removes the fields that were added to an instance after the snapshot was
+// taken.
+void SceneSnapshot::RemoveAddedFields(SnapshotEntity& record, Table* fields) {
+	vector<Uint32> hashes(record.FieldCount);
+	for (Uint32 i = 0; i < record.FieldCount; i++) {
+		hashes[i] = Fields[record.FirstField + i].Hash;
+	}
+	std::sort(hashes.begin(), hashes.end());
+
+	for (auto it = fields->Data.begin(); it != fields->Data.end();) {
+		if (IsSnapshotField(it->second) &&
+			!std::binary_search(hashes.begin(), hashes.end(), it->first)) {
+			it = fields->Data.erase(it);
+		}
+		else {
+			it++;
+		}
+	}
+}
+
+void SceneSnapshot::RebuildLists() {
+	Scene::DynamicObjectFirst = nullptr;
+	Scene::DynamicObjectLast = nullptr;
+	Scene::DynamicObjectCount = 0;
+	for (Uint32 i = 0; i < DynamicOrder.Count; i++) {
+		Entity* ent = Lookup(Members[DynamicOrder.Start + i]);
+		if (!ent) {
+			continue;
+		}
+
+		ent->PrevEntity = Scene::DynamicObjectLast;
+		ent->NextEntity = nullptr;
+		if (Scene::DynamicObjectLast) {
+			Scene::DynamicObjectLast->NextEntity = ent;
+		}
+		else {
+			Scene::DynamicObjectFirst = ent;
+		}
+		Scene::DynamicObjectLast = ent;
+		Scene::DynamicObjectCount++;
+	}
+
+	if (Scene::ObjectLists) {
+		size_t index = 0;
+		for (auto& it : Scene::ObjectLists->Data) {
+			ObjectList* list = it.second;
+			list->EntityFirst = nullptr;
+			list->EntityLast = nullptr;
+			list->EntityCount = 0;
+
+			SnapshotEntityRange* range = FindRange(Lists, list, index++);
+			for (Uint32 i = 0; range && i < range->Count; i++) {
+				Entity* ent = Lookup(Members[range->Start + i]);
+				if (ent) {
+					list->Add(ent);
+				}
+			}
+		}
+	}
+
+	if (Scene::ObjectRegistries) {
+		size_t index = 0;
+		for (auto& it : Scene::ObjectRegistries->Data) {
+			ObjectRegistry* registry = it.second;
+			registry->List.clear();
+
+			SnapshotEntityRange* range = FindRange(Registries, registry, index++);
+			for (Uint32 i = 0; range && i < range->Count; i++) {
+				Entity* ent = Lookup(Members[range->Start + i]);
+				if (ent) {
+					registry->List.push_back(ent);
+				}
+			}
+		}
+	}
+
+	size_t index = 0;
+	for (int l = 0; l < Scene::PriorityPerLayer; l++) {
+		DrawGroupList* drawGroup = Scene::PriorityLists[l];
+		if (!drawGroup) {
+			continue;
+		}
+
+		drawGroup->Clear();
+
+		SnapshotEntityRange* range = FindRange(DrawGroups, drawGroup, index++);
+		for (Uint32 i = 0; range && i < range->Count; i++) {
+			Entity* ent = Lookup(Members[range->Start + i]);
+			if (ent) {
+				drawGroup->Add(ent);
+			}
+		}
+	}
+}
+
+// Puts the scene back into the state it was captured in. Entities that still
+// exist are restored in place; the ones spawned since are deleted without
+// running their Dispose event. Must not be called while entities are being
+// updated, since the scene's entity list is rebuilt.
+bool SceneSnapshot::Restore() {
+	Replaced.clear();
+
+	Previous.clear();
+	for (Entity* ent = Scene::ObjectFirst; ent; ent = ent->NextSceneEntity) {
+		Previous.push_back(ent);
+	}
+
+	Resolved.resize(Entities.size());
+	for (size_t i = 0; i < Entities.size(); i++) {
+		Resolved[i] = Resolve(Entities[i]);
+	}
+
+	// Rebuild the scene's update order. Entities that aren't in the snapshot
+	// end up without neighbors, which is how they're told apart below.
+	for (Entity* ent : Previous) {
+		ent->PrevSceneEntity = nullptr;
+		ent->NextSceneEntity = nullptr;
+	}
+
+	Scene::ObjectFirst = nullptr;
+	Scene::ObjectLast = nullptr;
+	Scene::ObjectCount = 0;
+	for (Entity* ent : Resolved) {
+		if (!ent) {
+			continue;
+		}
+
+		ent->PrevSceneEntity = Scene::ObjectLast;
+		ent->NextSceneEntity = nullptr;
+		if (Scene::ObjectLast) {
+			Scene::ObjectLast->NextSceneEntity = ent;
+		}
+		else {
+			Scene::ObjectFirst = ent;
+		}
+		Scene::ObjectLast = ent;
+		Scene::ObjectCount++;
+	}
+
+	for (Entity* ent : Previous) {
+		if (ent == Scene::ObjectFirst || ent->PrevSceneEntity) {
+			continue;
+		}
+
+		// Static entities stay, at the end of the update order.
+		if (!ent->Dynamic) {
+			ent->PrevSceneEntity = Scene::ObjectLast;
+			if (Scene::ObjectLast) {
+				Scene::ObjectLast->NextSceneEntity = ent;
+			}
+			else {
+				Scene::ObjectFirst = ent;
+			}
+			Scene::ObjectLast = ent;
+			Scene::ObjectCount++;
+			continue;
+		}
+
+		ScriptEntity* scriptEntity = (ScriptEntity*)ent;
+		scriptEntity->Unlink();
+		AudioManager::StopAllOriginSounds((void*)ent);
+		ent->Dispose();
+		delete ent;
+	}
+
+	for (size_t i = 0; i < Entities.size(); i++) {
+		if (Resolved[i]) {
+			RestoreEntity(Entities[i], Resolved[i]);
+		}
+	}
+
+	RebuildLists();
+	RestoreTiles();
+
+	Scene::Frame = Frame;
+	Scene::TimeEnabled = TimeEnabled;
+	Scene::TimeCounter = TimeCounter;
+	Scene::Minutes = Minutes;
+	Scene::Seconds = Seconds;
+	Scene::Milliseconds = Milliseconds;
+	Random::Seed = RandomSeed;
+	Math::RSDK_SetRandSeed(RSDKRandomSeed);
+
+	Replaced.clear();
+	Previous.clear();
+	return true;
+}
+
+size_t SceneSnapshot::GetSize() {
+	return Entities.size() * sizeof(SnapshotEntity) + Fields.size() * sizeof(SnapshotField) +
+		Members.size() * sizeof(Entity*) +
+		(Lists.size() + Registries.size() + DrawGroups.size()) *
+		sizeof(SnapshotEntityRange) +
+		TileRuns.size() * sizeof(SnapshotTileRun) + Tiles.size() * sizeof(Uint32);
+}
+
+// Takes a snapshot of the scene into the snapshot at `index`, reusing its
+// memory, or into a new one if there is none. Returns the snapshot's index.
+int SceneSnapshot::Save(int index) {
+	SceneSnapshot* snapshot = Get(index);
+	if (!snapshot) {
+		snapshot = new SceneSnapshot();
+
+		index = -1;
+		for (size_t i = 0; i < List.size(); i++) {
+			if (!List[i]) {
+				index = (int)i;
+				break;
+			}
+		}
+		if (index == -1) {
+			index = (int)List.size();
+			List.push_back(nullptr);
+		}
+		List[index] = snapshot;
+	}
+
+	snapshot->Capture();
+	return index;
+}
+SceneSnapshot* SceneSnapshot::Get(int index) {
+	if (index < 0 || index >= (int)List.size()) {
+		return nullptr;
+	}
+	return List[index];
+}
+bool SceneSnapshot::Delete(int index) {
+	SceneSnapshot* snapshot = Get(index);
+	if (!snapshot) {
+		return false;
+	}
+
+	delete snapshot;
+	List[index] = nullptr;
+	if (PendingRestore == index) {
+		PendingRestore = -1;
+	}
+	return true;
+}
+
+// Scripts restore snapshots between frames, since they run while the
+// entities are being updated.
+void SceneSnapshot::RunPendingRestore() {
+	if (PendingRestore == -1) {
+		return;
+	}
+
+	SceneSnapshot* snapshot = Get(PendingRestore);
+	PendingRestore = -1;
+	if (snapshot) {
+		snapshot->Restore();
+	}
+}
+
+// Snapshots refer to the scene's entities, so they can't outlive it.
+void SceneSnapshot::DisposeAll() {
+	for (size_t i = 0; i < List.size(); i++) {
+		delete List[i];
+	}
+	List.clear();
+	PendingRestore = -1;
+}
@@ -0,0 +1,189 @@
+#ifndef ENGINE_SCENE_SCENESNAPSHOT_H
+#define ENGINE_SCENE_SCENESNAPSHOT_H
+
+#include <Engine/Bytecode/Types.h>
+#include <Engine/Includes/Standard.h>
+#include <Engine/Types/Entity.h>
+
+// The built-in entity fields that are part of an entity's state. Pointers
+// into the scene's lists are not; those are rebuilt from the snapshot's own
+// copies of the lists.
+#define SNAPSHOT_ENTITY_FIELDS \
+	SNAPSHOT_FIELD(InitialX) \
+	SNAPSHOT_FIELD(InitialY) \
+	SNAPSHOT_FIELD(Active) \
+	SNAPSHOT_FIELD(Pauseable) \
+	SNAPSHOT_FIELD(Interactable) \
+	SNAPSHOT_FIELD(Persistence) \
+	SNAPSHOT_FIELD(Activity) \
+	SNAPSHOT_FIELD(UpdatePriority) \
+	SNAPSHOT_FIELD(InRange) \
+	SNAPSHOT_FIELD(Created) \
+	SNAPSHOT_FIELD(PostCreated) \
+	SNAPSHOT_FIELD(X) \
+	SNAPSHOT_FIELD(Y) \
+	SNAPSHOT_FIELD(Z) \
+	SNAPSHOT_FIELD(SpeedX) \
+	SNAPSHOT_FIELD(SpeedY) \
+	SNAPSHOT_FIELD(GroundSpeed) \
+	SNAPSHOT_FIELD(GravitySpeed) \
+	SNAPSHOT_FIELD(OnGround) \
+	SNAPSHOT_FIELD(WasOffScreen) \
+	SNAPSHOT_FIELD(OnScreen) \
+	SNAPSHOT_FIELD(OnScreenHitboxW) \
+	SNAPSHOT_FIELD(OnScreenHitboxH) \
+	SNAPSHOT_FIELD(OnScreenRegionTop) \
+	SNAPSHOT_FIELD(OnScreenRegionLeft) \
+	SNAPSHOT_FIELD(OnScreenRegionRight) \
+	SNAPSHOT_FIELD(OnScreenRegionBottom) \
+	SNAPSHOT_FIELD(Visible) \
+	SNAPSHOT_FIELD(ViewRenderFlag) \
+	SNAPSHOT_FIELD(ViewOverrideFlag) \
+	SNAPSHOT_FIELD(RenderRegionW) \
+	SNAPSHOT_FIELD(RenderRegionH) \
+	SNAPSHOT_FIELD(RenderRegionTop) \
+	SNAPSHOT_FIELD(RenderRegionLeft) \
+	SNAPSHOT_FIELD(RenderRegionRight) \
+	SNAPSHOT_FIELD(RenderRegionBottom) \
+	SNAPSHOT_FIELD(Angle) \
+	SNAPSHOT_FIELD(AngleMode) \
+	SNAPSHOT_FIELD(ScaleX) \
+	SNAPSHOT_FIELD(ScaleY) \
+	SNAPSHOT_FIELD(Rotation) \
+	SNAPSHOT_FIELD(Alpha) \
+	SNAPSHOT_FIELD(BlendMode) \
+	SNAPSHOT_FIELD(AutoPhysics) \
+	SNAPSHOT_FIELD(Priority) \
+	SNAPSHOT_FIELD(PriorityListIndex) \
+	SNAPSHOT_FIELD(PriorityOld) \
+	SNAPSHOT_FIELD(Depth) \
+	SNAPSHOT_FIELD(OldDepth) \
+	SNAPSHOT_FIELD(Sprite) \
+	SNAPSHOT_FIELD(CurrentAnimation) \
+	SNAPSHOT_FIELD(CurrentFrame) \
+	SNAPSHOT_FIELD(CurrentFrameCount) \
+	SNAPSHOT_FIELD(AnimationSpeedMult) \
+	SNAPSHOT_FIELD(AnimationSpeedAdd) \
+	SNAPSHOT_FIELD(PrevAnimation) \
+	SNAPSHOT_FIELD(AutoAnimate) \
+	SNAPSHOT_FIELD(AnimationFrameSkip) \
+	SNAPSHOT_FIELD(AnimationSpeed) \
+	SNAPSHOT_FIELD(AnimationTimer) \
+	SNAPSHOT_FIELD(AnimationFrameDuration) \
+	SNAPSHOT_FIELD(AnimationLoopIndex) \
+	SNAPSHOT_FIELD(RotationStyle) \
+	SNAPSHOT_FIELD(Hitbox) \
+	SNAPSHOT_FIELD(Direction) \
+	SNAPSHOT_FIELD(SensorX) \
+	SNAPSHOT_FIELD(SensorY) \
+	SNAPSHOT_FIELD(SensorCollided) \
+	SNAPSHOT_FIELD(SensorAngle) \
+	SNAPSHOT_FIELD(TileCollisions) \
+	SNAPSHOT_FIELD(CollisionLayers) \
+	SNAPSHOT_FIELD(CollisionPlane) \
+	SNAPSHOT_FIELD(CollisionMode) \
+	SNAPSHOT_FIELD(SlotID) \
+	SNAPSHOT_FIELD(Filter) \
+	SNAPSHOT_FIELD(Removed)
+
+struct SnapshotEntityState {
+#define SNAPSHOT_FIELD(name) decltype(Entity::name) name;
+	SNAPSHOT_ENTITY_FIELDS
+#undef SNAPSHOT_FIELD
+};
+
+struct SnapshotEntity {
+	Entity* Ent;
+	ObjEntity* Instance;
+	ObjClass* Class;
+	ObjectList* List;
+	bool Dynamic;
+	SnapshotEntityState State;
+	// Where this entity's script fields are in Fields, and how many fields
+	// its instance had in total.
+	Uint32 FirstField;
+	Uint32 FieldCount;
+	Uint32 TableCount;
+};
+
+// Slot is where the field was in its instance's table, which is usually
+// still where it is when the snapshot is restored or taken again.
+struct SnapshotField {
+	Uint32 Hash;
+	Uint32 Slot;
+	VMValue Value;
+};
+
+// A run of tiles that differ from the layer's original tiles.
+struct SnapshotTileRun {
+	Uint32 Layer;
+	Uint32 Start;
+	Uint32 Count;
+};
+
+// Lists of entities are stored as one array of entity pointers, with each
+// list being a range of it.
+struct SnapshotEntityRange {
+	void* Owner;
+	Uint32 Start;
+	Uint32 Count;
+};
+
+class SceneSnapshot {
+private:
+	void CaptureFields(SnapshotEntity& record, Table* fields);
+	bool CaptureKnownFields(SnapshotEntity& record, SnapshotEntity* last, Table* fields);
+	void CaptureTiles();
+	void RestoreTiles();
+	Entity* Resolve(SnapshotEntity& record);
+	void RestoreEntity(SnapshotEntity& record, Entity* ent);
+	void RemoveAddedFields(SnapshotEntity& record, Table* fields);
+	void RebuildLists();
+	Entity* Lookup(Entity* ent);
+
+	// Entities that were respawned while restoring, by the pointer the
+	// snapshot knew them by.
+	std::unordered_map<Entity*, Entity*> Replaced;
+	vector<Entity*> Previous;
+	vector<Entity*> Resolved;
+
+	// What the snapshot held before it was taken again.
+	vector<SnapshotEntity> LastEntities;
+	vector<SnapshotField> LastFields;
+
+public:
+	vector<SnapshotEntity> Entities;
+	vector<SnapshotField> Fields;
+	vector<Entity*> Members;
+	vector<SnapshotEntityRange> Lists;
+	vector<SnapshotEntityRange> Registries;
+	vector<SnapshotEntityRange> DrawGroups;
+	SnapshotEntityRange DynamicOrder;
+	vector<SnapshotTileRun> TileRuns;
+	vector<Uint32> Tiles;
+	bool AnyLayerTileChange = false;
+
+	int Frame = 0;
+	int TimeEnabled = 0;
+	int TimeCounter = 0;
+	int Minutes = 0;
+	int Seconds = 0;
+	int Milliseconds = 0;
+	Sint32 RandomSeed = 0;
+	int RSDKRandomSeed = 0;
+
+	static vector<SceneSnapshot*> List;
+	static int PendingRestore;
+
+	void Capture();
+	bool Restore();
+	size_t GetSize();
+
+	static int Save(int index);
+	static SceneSnapshot* Get(int index);
+	static bool Delete(int index);
+	static void RunPendingRestore();
+	static void DisposeAll();
+};
+
+#endif /* ENGINE_SCENE_SCENESNAPSHOT_H */
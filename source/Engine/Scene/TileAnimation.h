@@ -56,7 +56,9 @@ struct TileAnimator {
 		TileInfo->FrameIndex = FrameIndex;
 	}
 
-	void Animate() {
+	bool Animate() {
+		bool changed = false;
+
 		Timer += Speed;
 
 		while (FrameDuration && Timer > FrameDuration) {
@@ -71,7 +73,10 @@ struct TileAnimator {
 
 			FrameDuration =
 				Sprite->Animations[AnimationIndex].Frames[FrameIndex].Duration;
+			changed = true;
 		}
+
+		return changed;
 	}
 };
 
@@ -40,7 +40,99 @@ TileLayer::TileLayer(int w, int h) {
 		(Uint32*)Memory::TrackedCalloc("TileLayer::TilesBackup", w * h, sizeof(Uint32));
 	UsingScrollIndexes = false;
 }
+void TileLayer::InitTileChunks() {
+	DeleteTileChunks();
+
+	TileChunksX = (Width + TILE_CHUNK_SIZE - 1) / TILE_CHUNK_SIZE;
+	TileChunksY = (Height + TILE_CHUNK_SIZE - 1) / TILE_CHUNK_SIZE;
+	TileChunks.resize(TileChunksX * TileChunksY);
+}
+void TileLayer::InvalidateTileChunk(int x, int y) {
+	if (TileChunks.size() == 0) {
+		return;
+	}
+
+	int chunkX = x / TILE_CHUNK_SIZE;
+	int chunkY = y / TILE_CHUNK_SIZE;
+	if (chunkX < 0 || chunkY < 0 || chunkX >= TileChunksX || chunkY >= TileChunksY) {
+		return;
+	}
+
+	TileChunks[chunkX + chunkY * TileChunksX].Dirty = true;
+}
+void TileLayer::InvalidateTileChunks() {
+	for (size_t i = 0; i < TileChunks.size(); i++) {
+		TileChunks[i].Dirty = true;
+	}
+}
+void TileLayer::InvalidateAnimatedTileChunks() {
+	for (size_t i = 0; i < TileChunks.size(); i++) {
+		if (TileChunks[i].HasAnimatedTiles) {
+			TileChunks[i].Dirty = true;
+		}
+	}
+}
+// Moves an allocated chunk to the front of the LRU list.
+void TileLayer::TouchTileChunk(int index) {
+	if (TileChunkLRUHead == index) {
+		return;
+	}
+
+	UnlinkTileChunk(index);
+
+	LayerTileChunk* chunk = &TileChunks[index];
+	chunk->LRUNext = TileChunkLRUHead;
+	if (TileChunkLRUHead != -1) {
+		TileChunks[TileChunkLRUHead].LRUPrev = index;
+	}
+	TileChunkLRUHead = index;
+	if (TileChunkLRUTail == -1) {
+		TileChunkLRUTail = index;
+	}
+}
+void TileLayer::UnlinkTileChunk(int index) {
+	LayerTileChunk* chunk = &TileChunks[index];
+	if (chunk->LRUPrev != -1) {
+		TileChunks[chunk->LRUPrev].LRUNext = chunk->LRUNext;
+	}
+	else if (TileChunkLRUHead == index) {
+		TileChunkLRUHead = chunk->LRUNext;
+	}
+	if (chunk->LRUNext != -1) {
+		TileChunks[chunk->LRUNext].LRUPrev = chunk->LRUPrev;
+	}
+	else if (TileChunkLRUTail == index) {
+		TileChunkLRUTail = chunk->LRUPrev;
+	}
+	chunk->LRUPrev = -1;
+	chunk->LRUNext = -1;
+}
+void TileLayer::FreeTileChunk(int index) {
+	LayerTileChunk* chunk = &TileChunks[index];
+	if (chunk->Pixels) {
+		UnlinkTileChunk(index);
+		Memory::Free(chunk->Pixels);
+		Memory::Free(chunk->RowFlags);
+		chunk->Pixels = nullptr;
+		chunk->RowFlags = nullptr;
+		NumAllocatedTileChunks--;
+	}
+
+	chunk->Dirty = true;
+}
+void TileLayer::DeleteTileChunks() {
+	for (size_t i = 0; i < TileChunks.size(); i++) {
+		FreeTileChunk((int)i);
+	}
+
+	TileChunks.clear();
+	TileChunkLRUHead = -1;
+	TileChunkLRUTail = -1;
+	TileChunksX = 0;
+	TileChunksY = 0;
+}
 TileLayer::~TileLayer() {
+	DeleteTileChunks();
 	Memory::Free(Tiles);
 	Memory::Free(TilesBackup);
 	Memory::Free(TileBufferIndexes);
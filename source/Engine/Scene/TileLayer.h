@@ -37,8 +37,25 @@ public:
 	bool UsingTileBuffers = false;
 	bool RemakeTileBuffers = false;
 
+	std::vector<LayerTileChunk> TileChunks;
+	int TileChunksX = 0;
+	int TileChunksY = 0;
+	size_t NumAllocatedTileChunks = 0;
+	int TileChunkLRUHead = -1;
+	int TileChunkLRUTail = -1;
+	Uint32 TileChunkPaletteHash = 0;
+	bool UseChunkCache = false;
+
 	TileLayer();
 	TileLayer(int w, int h);
+	void InitTileChunks();
+	void InvalidateTileChunk(int x, int y);
+	void InvalidateTileChunks();
+	void InvalidateAnimatedTileChunks();
+	void TouchTileChunk(int index);
+	void UnlinkTileChunk(int index);
+	void FreeTileChunk(int index);
+	void DeleteTileChunks();
 	~TileLayer();
 };
 
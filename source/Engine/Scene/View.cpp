@@ -9,6 +9,7 @@ void View::SetSize(float w, float h) {
 
 	if (Software) {
 		ReallocStencil();
+		ReallocIndexedFramebuffer();
 	}
 }
 
@@ -78,3 +79,35 @@ void View::DeleteStencil() {
 	StencilBuffer = NULL;
 	StencilBufferSize = 0;
 }
+
+void View::SetIndexedFramebufferEnabled(bool enabled) {
+	UseIndexedFramebuffer = enabled;
+	if (!enabled) {
+		DeleteIndexedFramebuffer();
+	}
+}
+void View::ReallocIndexedFramebuffer() {
+	if (!UseIndexedFramebuffer || DrawTarget == nullptr) {
+		return;
+	}
+
+	size_t bufSize = DrawTarget->Width * DrawTarget->Height;
+	if (IndexedFramebuffer == NULL || bufSize > IndexedFramebufferSize) {
+		IndexedFramebufferSize = bufSize;
+		IndexedFramebuffer = (Uint8*)Memory::Realloc(
+			IndexedFramebuffer, IndexedFramebufferSize * sizeof(*IndexedFramebuffer));
+		ClearIndexedFramebuffer();
+	}
+}
+void View::ClearIndexedFramebuffer() {
+	if (IndexedFramebuffer) {
+		memset(IndexedFramebuffer,
+			0x00,
+			IndexedFramebufferSize * sizeof(*IndexedFramebuffer));
+	}
+}
+void View::DeleteIndexedFramebuffer() {
+	Memory::Free(IndexedFramebuffer);
+	IndexedFramebuffer = NULL;
+	IndexedFramebufferSize = 0;
+}
@@ -36,9 +36,12 @@ public:
 	bool UsePerspective = false;
 	bool UseDrawTarget = false;
 	bool UseStencil = false;
+	bool UseIndexedFramebuffer = false;
 	Texture* DrawTarget = NULL;
 	Uint8* StencilBuffer = NULL;
 	size_t StencilBufferSize = 0;
+	Uint8* IndexedFramebuffer = NULL;
+	size_t IndexedFramebufferSize = 0;
 	Matrix4x4* ProjectionMatrix = NULL;
 	Matrix4x4* ViewMatrix = NULL;
 	Shader* CurrentShader = NULL;
@@ -53,6 +56,10 @@ public:
 	void ReallocStencil();
 	void ClearStencil();
 	void DeleteStencil();
+	void SetIndexedFramebufferEnabled(bool enabled);
+	void ReallocIndexedFramebuffer();
+	void ClearIndexedFramebuffer();
+	void DeleteIndexedFramebuffer();
 };
 
 #endif /* ENGINE_SCENE_VIEW_H */
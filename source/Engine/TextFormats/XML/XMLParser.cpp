@@ -414,6 +414,15 @@ bool XMLParser::MatchToken(Token tok, const char* string) {
 	return memcmp(string, tok.Start, tok.Length) == 0;
 }
 float XMLParser::TokenToNumber(Token tok) {
+	// Attribute values are short, so they're converted from a copy on the
+	// stack rather than a temporary string.
+	char buffer[64];
+	if (tok.Length < sizeof buffer) {
+		memcpy(buffer, tok.Start, tok.Length);
+		buffer[tok.Length] = '\0';
+		return atof(buffer);
+	}
+
 	return atof(tok.ToString().c_str());
 }
 
@@ -424,6 +433,7 @@ XMLNode* XMLParser::Parse() {
 		return NULL;
 	}
 
+	XMLRoot->name = {};
 	XMLRoot->base_stream = NULL;
 	XMLRoot->parent = NULL;
 	XMLCurrent = XMLRoot;
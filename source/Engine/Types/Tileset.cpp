@@ -25,14 +25,16 @@ Tileset::Tileset(ISprite* sprite,
 	PropertiesPerTile.resize(TileCount);
 }
 
-void Tileset::RunAnimations() {
+bool Tileset::RunAnimations() {
+	bool changed = false;
 	for (map<int, TileAnimator>::iterator it = AnimatorMap.begin(); it != AnimatorMap.end();
 		it++) {
 		TileAnimator& animator = it->second;
-		if (!animator.Paused) {
-			animator.Animate();
+		if (!animator.Paused && animator.Animate()) {
+			changed = true;
 		}
 	}
+	return changed;
 }
 
 void Tileset::RestartAnimations() {
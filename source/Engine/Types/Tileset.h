@@ -27,7 +27,7 @@ public:
 		size_t startTile,
 		size_t tileCount,
 		char* filename);
-	void RunAnimations();
+	bool RunAnimations();
 	void RestartAnimations();
 	void AddTileAnimSequence(int tileID,
 		TileSpriteInfo* tileSpriteInfo,
@@ -0,0 +1,596 @@
+// Builds HATCH archives from a directory tree, using the engine's own
+// archive and compression code.
+//
+// Usage: HatchPacker [options] <input directory> <output file>
+//
+// Entries are compressed on a pool of worker threads while the main thread
+// writes them out in order. Files with identical contents are stored once,
+// and compression is skipped for entries it doesn't make meaningfully
+// smaller. Large entries are compressed in chunks so they stay seekable.
+
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Diagnostics/Memory.h>
+#include <Engine/Filesystem/File.h>
+#include <Engine/Filesystem/MappedFile.h>
+#include <Engine/Filesystem/Path.h>
+#include <Engine/Filesystem/VFS/HatchVFS.h>
+#include <Engine/Hashing/CRC32.h>
+#include <Engine/Hashing/MD5.h>
+#include <Engine/IO/Compression/ChunkedZLibStream.h>
+#include <Engine/IO/Compression/ZLibStream.h>
+#include <Engine/IO/StandardIOStream.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+struct PackOptions {
+	std::string InputPath;
+	std::string OutputPath;
+	std::string OrderPath;
+	unsigned Jobs = 0;
+	Uint64 ChunkThreshold = 1024 * 1024;
+	unsigned MinSavings = 5;
+	bool Verify = false;
+};
+
+struct PackEntry {
+	std::string Name;
+	std::string FullPath;
+	Uint64 Size = 0;
+	Uint8 Digest[16];
+	int DuplicateOf = -1;
+
+	// Filled in by the worker that packs the entry
+	Uint8* Data = nullptr;
+	MappedFile* Mapping = nullptr;
+	Uint64 DataSize = 0;
+	Uint32 DataFlag = 0;
+	bool Failed = false;
+	bool Ready = false;
+
+	// Filled in when the entry is written
+	Uint64 Offset = 0;
+};
+
+// Data that compresses poorly, and isn't worth trying.
+static const char* StoredExtensions[] = {
+	".ogg", ".ogv", ".mp3", ".mp4", ".webm", ".png", ".jpg", ".jpeg", ".gif", ".zip", ".hatch"};
+
+static bool IsStoredExtension(const std::string& name) {
+	size_t dot = name.find_last_of('.');
+	if (dot == std::string::npos) {
+		return false;
+	}
+
+	std::string extension = name.substr(dot);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+	for (const char* stored : StoredExtensions) {
+		if (extension == stored) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Source files are mapped when possible, so that a large file only costs
+// the pages that are actually touched.
+static bool LoadSource(const PackEntry& entry, Uint8** data, MappedFile** mapping) {
+	*data = nullptr;
+	*mapping = nullptr;
+
+	if (entry.Size == 0) {
+		return true;
+	}
+
+	*mapping = MappedFile::Open(entry.FullPath.c_str());
+	if (*mapping) {
+		if ((*mapping)->Size != entry.Size) {
+			(*mapping)->Release();
+			*mapping = nullptr;
+			return false;
+		}
+
+		*data = (*mapping)->Data;
+		return true;
+	}
+
+	char* buffer = nullptr;
+	size_t size = File::ReadAllBytes(entry.FullPath.c_str(), &buffer);
+	if (size != entry.Size) {
+		Memory::Free(buffer);
+		return false;
+	}
+
+	*data = (Uint8*)buffer;
+	return true;
+}
+static void FreeSource(Uint8* data, MappedFile* mapping) {
+	if (mapping) {
+		mapping->Release();
+	}
+	else {
+		Memory::Free(data);
+	}
+}
+
+// Runs work(i) for every i in [0, count) on the given number of threads.
+static void ParallelFor(size_t count, unsigned jobs, std::function<void(size_t)> work) {
+	std::atomic<size_t> next(0);
+	std::vector<std::thread> threads;
+
+	for (unsigned t = 0; t < jobs; t++) {
+		threads.emplace_back([&]() {
+			for (size_t i = next++; i < count; i = next++) {
+				work(i);
+			}
+		});
+	}
+
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+}
+
+static bool CollectEntries(const PackOptions& options, std::vector<PackEntry>& entries) {
+	std::filesystem::path root = std::filesystem::u8path(options.InputPath);
+	std::error_code ec;
+
+	if (!std::filesystem::is_directory(root, ec)) {
+		Log::Print(Log::LOG_ERROR, "\"%s\" is not a directory!", options.InputPath.c_str());
+		return false;
+	}
+
+	for (auto it = std::filesystem::recursive_directory_iterator(root, ec);
+		it != std::filesystem::recursive_directory_iterator();
+		it.increment(ec)) {
+		if (ec) {
+			Log::Print(Log::LOG_ERROR, "Could not list files: %s", ec.message().c_str());
+			return false;
+		}
+
+		if (!it->is_regular_file(ec)) {
+			continue;
+		}
+
+		PackEntry entry;
+		entry.Name = Path::ToString(it->path().lexically_relative(root));
+		std::replace(entry.Name.begin(), entry.Name.end(), '\\', '/');
+		entry.FullPath = Path::ToString(it->path());
+		entry.Size = it->file_size(ec);
+		entries.push_back(entry);
+	}
+
+	// Files in the same directory tend to be loaded together, so plain path
+	// order keeps them next to each other in the archive.
+	std::sort(entries.begin(), entries.end(), [](const PackEntry& a, const PackEntry& b) {
+		return a.Name < b.Name;
+	});
+
+	if (options.OrderPath.empty()) {
+		return true;
+	}
+
+	// Files listed in the order file (one path per line, such as a record
+	// of what a level loads) go first, in that order.
+	std::ifstream orderFile(options.OrderPath);
+	if (!orderFile) {
+		Log::Print(Log::LOG_ERROR, "Could not open \"%s\"!", options.OrderPath.c_str());
+		return false;
+	}
+
+	std::unordered_map<std::string, size_t> rank;
+	std::string line;
+	while (std::getline(orderFile, line)) {
+		if (!line.empty() && line.back() == '\r') {
+			line.pop_back();
+		}
+		if (!line.empty() && rank.find(line) == rank.end()) {
+			rank[line] = rank.size();
+		}
+	}
+
+	std::stable_sort(entries.begin(), entries.end(), [&](const PackEntry& a, const PackEntry& b) {
+		auto rankA = rank.find(a.Name);
+		auto rankB = rank.find(b.Name);
+		size_t valueA = rankA != rank.end() ? rankA->second : SIZE_MAX;
+		size_t valueB = rankB != rank.end() ? rankB->second : SIZE_MAX;
+		return valueA < valueB;
+	});
+
+	return true;
+}
+
+// Hashes every file's contents, and points each file at the first earlier
+// one with the same contents.
+static bool FindDuplicates(std::vector<PackEntry>& entries, unsigned jobs) {
+	std::atomic<bool> failed(false);
+
+	ParallelFor(entries.size(), jobs, [&](size_t i) {
+		PackEntry& entry = entries[i];
+		Uint8* data;
+		MappedFile* mapping;
+		if (!LoadSource(entry, &data, &mapping)) {
+			Log::Print(Log::LOG_ERROR, "Could not read \"%s\"!", entry.FullPath.c_str());
+			failed = true;
+			return;
+		}
+
+		MD5::EncryptData(entry.Digest, data, (size_t)entry.Size);
+		FreeSource(data, mapping);
+	});
+
+	if (failed) {
+		return false;
+	}
+
+	std::map<std::pair<std::string, Uint64>, int> firstWithContents;
+	for (size_t i = 0; i < entries.size(); i++) {
+		std::pair<std::string, Uint64> key(
+			std::string((char*)entries[i].Digest, sizeof entries[i].Digest), entries[i].Size);
+
+		auto it = firstWithContents.find(key);
+		if (it != firstWithContents.end()) {
+			entries[i].DuplicateOf = it->second;
+		}
+		else {
+			firstWithContents[key] = (int)i;
+		}
+	}
+
+	return true;
+}
+
+static void PackEntryData(PackEntry& entry, const PackOptions& options) {
+	Uint8* data;
+	MappedFile* mapping;
+	if (!LoadSource(entry, &data, &mapping)) {
+		Log::Print(Log::LOG_ERROR, "Could not read \"%s\"!", entry.FullPath.c_str());
+		entry.Failed = true;
+		return;
+	}
+
+	void* compressed = nullptr;
+	size_t compressedSize = 0;
+	bool chunked = false;
+
+	if (entry.Size != 0 && !IsStoredExtension(entry.Name)) {
+		chunked = entry.Size >= options.ChunkThreshold;
+
+		bool didCompress;
+		if (chunked) {
+			didCompress = ChunkedZLibStream::Compress(data,
+				(size_t)entry.Size,
+				CHUNKED_ZLIB_DEFAULT_CHUNK_SIZE,
+				&compressed,
+				&compressedSize);
+		}
+		else {
+			didCompress =
+				ZLibStream::Compress(data, (size_t)entry.Size, &compressed, &compressedSize);
+		}
+
+		// Keep the entry stored if compressing it didn't save enough.
+		Uint64 limit = entry.Size - entry.Size * options.MinSavings / 100;
+		if (didCompress && compressedSize >= limit) {
+			Memory::Free(compressed);
+			didCompress = false;
+		}
+
+		if (!didCompress) {
+			compressed = nullptr;
+		}
+	}
+
+	if (compressed) {
+		FreeSource(data, mapping);
+
+		entry.Data = (Uint8*)compressed;
+		entry.DataSize = compressedSize;
+		entry.DataFlag = chunked ? HATCH_DATA_CHUNKED : 0;
+	}
+	else {
+		// Stored entries are written straight from the source.
+		entry.Data = data;
+		entry.Mapping = mapping;
+		entry.DataSize = entry.Size;
+	}
+}
+
+static bool WriteArchive(std::vector<PackEntry>& entries, const PackOptions& options) {
+	bool mayHaveChunks = false;
+	for (PackEntry& entry : entries) {
+		if (entry.Size >= options.ChunkThreshold && !IsStoredExtension(entry.Name)) {
+			mayHaveChunks = true;
+		}
+	}
+
+	Uint8 version = HATCH_VERSION_ORIGINAL;
+	if (entries.size() > 0xFFFF || mayHaveChunks) {
+		version = HATCH_VERSION_LARGE;
+	}
+
+	Stream* out = File::Open(options.OutputPath.c_str(), File::WRITE_ACCESS);
+	if (!out) {
+		Log::Print(Log::LOG_ERROR, "Could not open \"%s\"!", options.OutputPath.c_str());
+		return false;
+	}
+
+	out->WriteBytes(MAGIC_HATCH, MAGIC_HATCH_SIZE);
+	out->WriteByte(version);
+	out->WriteByte(0x00);
+	out->WriteByte(0x00);
+	if (version >= HATCH_VERSION_LARGE) {
+		out->WriteUInt32((Uint32)entries.size());
+	}
+	else {
+		out->WriteUInt16((Uint16)entries.size());
+	}
+
+	// The table of contents is filled in once every offset is known.
+	size_t tocStart = out->Position();
+	Uint8 zeroes[HATCH_TOC_ENTRY_SIZE] = {0};
+	for (size_t i = 0; i < entries.size(); i++) {
+		out->WriteBytes(zeroes, HATCH_TOC_ENTRY_SIZE);
+	}
+
+	// Workers may only run this far ahead of the writer, which bounds how
+	// much packed data is held in memory at once.
+	size_t window = options.Jobs * 4;
+	size_t written = 0;
+	std::atomic<size_t> next(0);
+	std::mutex mutex;
+	std::condition_variable entryReady;
+	std::condition_variable entryWritten;
+
+	std::vector<std::thread> workers;
+	for (unsigned t = 0; t < options.Jobs; t++) {
+		workers.emplace_back([&]() {
+			for (size_t i = next++; i < entries.size(); i = next++) {
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					entryWritten.wait(lock, [&]() { return i < written + window; });
+				}
+
+				if (entries[i].DuplicateOf < 0) {
+					PackEntryData(entries[i], options);
+				}
+
+				std::lock_guard<std::mutex> lock(mutex);
+				entries[i].Ready = true;
+				entryReady.notify_all();
+			}
+		});
+	}
+
+	bool success = true;
+	Uint64 storedBytes = 0;
+	for (size_t i = 0; i < entries.size(); i++) {
+		PackEntry& entry = entries[i];
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			entryReady.wait(lock, [&]() { return entry.Ready; });
+		}
+
+		if (entry.DuplicateOf >= 0) {
+			// The original always comes first, so it's already written.
+			PackEntry& original = entries[entry.DuplicateOf];
+			entry.Offset = original.Offset;
+			entry.DataSize = original.DataSize;
+			entry.DataFlag = original.DataFlag;
+		}
+		else if (entry.Failed) {
+			success = false;
+		}
+		else {
+			entry.Offset = out->Position();
+			if (entry.DataSize != 0 &&
+				out->WriteBytes(entry.Data, (size_t)entry.DataSize) != entry.DataSize) {
+				Log::Print(Log::LOG_ERROR, "Could not write \"%s\"!", entry.Name.c_str());
+				success = false;
+			}
+			storedBytes += entry.DataSize;
+		}
+
+		FreeSource(entry.Data, entry.Mapping);
+		entry.Data = nullptr;
+		entry.Mapping = nullptr;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		written = i + 1;
+		entryWritten.notify_all();
+	}
+
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+
+	out->Seek(tocStart);
+	for (PackEntry& entry : entries) {
+		out->WriteUInt32(CRC32::EncryptString(entry.Name.c_str()));
+		out->WriteUInt64(entry.Offset);
+		out->WriteUInt64(entry.Size);
+		out->WriteUInt32(entry.DataFlag);
+		out->WriteUInt64(entry.DataSize);
+	}
+
+	out->Close();
+
+	Uint64 totalBytes = 0;
+	size_t duplicates = 0;
+	for (PackEntry& entry : entries) {
+		totalBytes += entry.Size;
+		if (entry.DuplicateOf >= 0) {
+			duplicates++;
+		}
+	}
+
+	printf("Packed %u files (%u duplicates) from %llu to %llu bytes\n",
+		(unsigned)entries.size(),
+		(unsigned)duplicates,
+		(unsigned long long)totalBytes,
+		(unsigned long long)storedBytes);
+
+	return success;
+}
+
+// Opens the archive the same way the engine does, and checks that every
+// entry reads back exactly as the file it came from.
+static bool VerifyArchive(std::vector<PackEntry>& entries, const PackOptions& options) {
+	Stream* stream = File::Open(options.OutputPath.c_str(), File::READ_ACCESS);
+	if (!stream) {
+		Log::Print(Log::LOG_ERROR, "Could not open \"%s\"!", options.OutputPath.c_str());
+		return false;
+	}
+
+	HatchVFS* vfs = new HatchVFS(VFS_READABLE);
+	if (!vfs->Open(stream)) {
+		stream->Close();
+		delete vfs;
+		return false;
+	}
+	vfs->MapArchive(options.OutputPath.c_str());
+
+	size_t mismatches = 0;
+	for (PackEntry& entry : entries) {
+		Uint8* source;
+		MappedFile* mapping;
+		if (!LoadSource(entry, &source, &mapping)) {
+			Log::Print(Log::LOG_ERROR, "Could not read \"%s\"!", entry.FullPath.c_str());
+			mismatches++;
+			continue;
+		}
+
+		Uint8* data = nullptr;
+		size_t size = 0;
+		bool matches = vfs->ReadFile(entry.Name.c_str(), &data, &size) &&
+			size == entry.Size && (size == 0 || memcmp(data, source, size) == 0);
+		Memory::Free(data);
+
+		// Chunked entries are also read back through the seekable path.
+		Stream* seekable = vfs->OpenSeekableStream(entry.Name.c_str());
+		if (seekable) {
+			Uint8 buffer[0x4000];
+			size_t position = 0;
+			size_t read;
+			while (matches && (read = seekable->ReadBytes(buffer, sizeof buffer)) != 0) {
+				matches = position + read <= entry.Size &&
+					memcmp(buffer, source + position, read) == 0;
+				position += read;
+			}
+			matches = matches && position == entry.Size;
+			seekable->Close();
+		}
+
+		FreeSource(source, mapping);
+
+		if (!matches) {
+			Log::Print(Log::LOG_ERROR, "\"%s\" does not match its source!", entry.Name.c_str());
+			mismatches++;
+		}
+	}
+
+	delete vfs;
+
+	if (mismatches) {
+		Log::Print(Log::LOG_ERROR, "%u entries failed verification!", (unsigned)mismatches);
+		return false;
+	}
+
+	printf("Verified %u entries\n", (unsigned)entries.size());
+	return true;
+}
+
+static void PrintUsage(const char* program) {
+	printf("Usage: %s [options] <input directory> <output file>\n"
+	       "\n"
+	       "Options:\n"
+	       "  -j, --jobs <count>          Number of worker threads (default: all cores)\n"
+	       "  --order <file>              Put the files listed in this file first, in order\n"
+	       "  --chunk-threshold <bytes>   Compress entries at least this large in seekable\n"
+	       "                              chunks (default: 1048576)\n"
+	       "  --min-savings <percent>     Store entries that compress by less than this\n"
+	       "                              (default: 5)\n"
+	       "  --verify                    Read every entry back and compare it to its file\n",
+		program);
+}
+
+int main(int argc, char* argv[]) {
+	PackOptions options;
+	std::vector<std::string> positional;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if ((arg == "-j" || arg == "--jobs") && hasValue) {
+			options.Jobs = (unsigned)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (arg == "--order" && hasValue) {
+			options.OrderPath = argv[++i];
+		}
+		else if (arg == "--chunk-threshold" && hasValue) {
+			options.ChunkThreshold = strtoull(argv[++i], nullptr, 10);
+		}
+		else if (arg == "--min-savings" && hasValue) {
+			options.MinSavings = (unsigned)strtoul(argv[++i], nullptr, 10);
+		}
+		else if (arg == "--verify") {
+			options.Verify = true;
+		}
+		else if (arg == "-h" || arg == "--help") {
+			PrintUsage(argv[0]);
+			return 0;
+		}
+		else if (!arg.empty() && arg[0] == '-') {
+			PrintUsage(argv[0]);
+			return 1;
+		}
+		else {
+			positional.push_back(arg);
+		}
+	}
+
+	if (positional.size() != 2) {
+		PrintUsage(argv[0]);
+		return 1;
+	}
+
+	options.InputPath = positional[0];
+	options.OutputPath = positional[1];
+
+	if (options.Jobs == 0) {
+		options.Jobs = std::max(1u, std::thread::hardware_concurrency());
+	}
+	if (options.MinSavings > 100) {
+		options.MinSavings = 100;
+	}
+
+	std::vector<PackEntry> entries;
+	if (!CollectEntries(options, entries)) {
+		return 1;
+	}
+	if (entries.size() > 0xFFFFFFFF) {
+		Log::Print(Log::LOG_ERROR, "Too many files!");
+		return 1;
+	}
+
+	if (!FindDuplicates(entries, options.Jobs)) {
+		return 1;
+	}
+
+	if (!WriteArchive(entries, options)) {
+		return 1;
+	}
+
+	if (options.Verify && !VerifyArchive(entries, options)) {
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,48 @@
+// The engine's own versions of these pull in the rest of the runtime (SDL,
+// the Application class, and so on), which the packer has no use for. These
+// stand in for them with the same behavior, minus the platform-specific
+// paths the packer never goes through.
+
+#include <Engine/Diagnostics/Log.h>
+#include <Engine/Filesystem/Directory.h>
+#include <Engine/Filesystem/Path.h>
+
+int Log::LogLevel = Log::LOG_WARN;
+
+void Log::Print(int sev, const char* format, ...) {
+	if (sev < LogLevel) {
+		return;
+	}
+
+	va_list args;
+	va_start(args, format);
+	vfprintf(stderr, format, args);
+	va_end(args);
+
+	fputc('\n', stderr);
+}
+
+bool Directory::Exists(const char* path) {
+	std::error_code ec;
+	return std::filesystem::is_directory(std::filesystem::u8path(path), ec);
+}
+
+std::string Path::ToString(std::filesystem::path path) {
+	auto string = path.u8string();
+
+	return std::string(string.begin(), string.end());
+}
+std::string Path::Normalize(std::string path) {
+	std::filesystem::path fsPath = std::filesystem::u8path(path);
+
+	std::string result = ToString(fsPath.lexically_normal());
+
+#if WIN32
+	std::replace(result.begin(), result.end(), '\\', '/');
+#endif
+
+	return result;
+}
+std::string Path::Normalize(const char* path) {
+	return Normalize(std::string(path));
+}